@@ -0,0 +1,532 @@
+/* benchNemo.c: Benchmarks of the Nemo Library functions and of the
+   uniSpherical and pointNemo programs, on generated data sets, with results
+   written as JSON - so that the runs before and after a change of a program,
+   or a new Nemo Library release, can be compared.
+
+   The data sets are random points on the sphere, from a fixed seed (-s(eed)
+   option), of the sizes given by -n option (a comma separated list, for
+   instance -n=10000,1000000,100000000). For each size, these are measured:
+
+      us8Encode, us8Decode   NCS to Us8 coordinates, and back
+      chordSqScan            chord squared, a few points to all (chSqMinSoa)
+      szpilaGeodesic         geodesic length, of up to SZPILA_PAIRS legs
+      geoFanGeodesic         as many, from one origin (scullions/geoFan)
+      us8Sort                radix sort of the (unsorted) points
+      itinLegs               leg lengths of the itinerary, in sorted order
+
+   and then, with the points sorted and written to a .p8b file in the data
+   directory (-d(ata) option), the programs are run as separate processes:
+
+      itinWindow      nearNextP8bWindow, window of BENCH_WINDOW locations
+      itinKdTree      nearNextP8bWindow, k-d tree index (window 0)
+      itinBruteForce  nearNextP8bBruteForce (only up to BRUTE_MAX points)
+      extraction      r8bToP8bSelect, a circle of EXTRACT_RADIUS meters
+
+   The geoFan lengths are checked against those of nemo_GeodesicSzpila() as
+   well (the most they differ, as "maxDiffMeters"), and so is geoFanNear(),
+   on test limits just outside GEO_FAN_GUARD of the library length, on either
+   side: the "status" of geoFanGeodesic is the number of tests that came out
+   otherwise than by the library length (0, while the guard is larger than
+   the difference).
+
+   The programs are found in the uniSpherical and pointNemo directories under
+   the -x option directory (default: "..", the parent of this one); those not
+   found (or not executable) are reported as skipped. For the itinerary
+   programs, the tour length (geodesic, including the leg back to the first
+   location) is reported as well, as the measure of the itinerary quality.
+
+   Each measurement is repeated -r(uns) times; all the times are wall clock
+   time, and the best (minimum) and the median time of the runs is reported,
+   with the throughput (items per second) of the best one. The JSON object of
+   the whole benchmark run is written to the standard output and, with the
+   -o(utput) option, appended to the given file, one line per run. The
+   -stats=text (or json, file.json) option reports the time the benchmark
+   took, per data set size (scullions/nemoStats).
+
+   For instance:
+
+   ./benchNemo -n=10000,1000000 -r=3 -t=4 -o=benchHistory.json
+ */
+
+#define PGM_DSCR "Benchmarks of Nemo Library functions and programs"
+#define PGM_LAST_EDIT_DATE "2026.287"         /* format as from 'date +%Y.%j' */
+
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+
+#include <nemo.h>
+#include "../scullions/scullions.h" /* include after nemo.h has been included */
+#include "../scullions/nemoStats.h"
+#include "../scullions/fileMap.h"
+#include "../scullions/chordSqBatch.h"
+#include "../scullions/rngStream.h"
+#include "../scullions/us8Sort.h"
+#include "../scullions/itinLegs.h"
+#include "../scullions/geoFan.h"
+
+#define DEFAULT_SIZES     "10000,1000000"
+#define DEFAULT_SEED      2025
+#define DEFAULT_RUNS         3
+#define MAX_SIZES            8
+#define MAX_RUNS            99
+#define MAX_RESULTS         80
+#define MAX_PATH           512
+#define CHSQ_QUERIES        16            /* points scanned against all, each */
+#define SZPILA_PAIRS   1000000          /* geodesics, at most (per run) */
+#define BRUTE_MAX       100000           /* brute force itinerary, at most */
+#define BENCH_WINDOW      1000
+#define EXTRACT_RADIUS  1000000.0                          /* meters, geodesic */
+#define EXTRACT_CENTER  "-49.0,-123.4"                       /* Point Nemo-ish */
+
+struct benchResult {
+   char name[32];
+   long n;                                /* data set size (locations) */
+   long items;                     /* things done in one run, for throughput */
+   int isSkipped;                                    /* 1: not measured */
+   int status;                            /* program exit status, or 0 */
+   double best, median;                    /* seconds, of all the runs */
+   double tourMeters;                        /* itinerary length, or 0.0 */
+   double maxDiff;               /* geoFan, meters from Szpila's, or 0.0 */
+   };
+
+extern char **environ;
+
+static double kernEncode(void);
+static double kernDecode(void);
+static double kernChordSq(void);
+static double kernSzpila(void);
+static double kernGeoFan(void);
+static double kernSort(void);
+static double kernItinLegs(void);
+static struct benchResult *measureKernel(const char *, double (*)(void), long);
+static void fanAgreement(struct benchResult *);
+static void measureTool(const char *, const char *, const char *, int);
+static double runTool(char *const *, int *);
+static double tourMeters(const char *, long *);
+static void writeJson(FILE *, const char *, const char *);
+static int compDoubles(const void *, const void *);
+void usage(const char *, const char *);
+
+static const char *progName;    /* for error logging by this source file only */
+static int nPts;                           /* size of the current data set */
+static int nRuns, nThreads;
+static nemoPtNcs *genNcs;           /* generated points, NCS and Us8 (sorted) */
+static nemoPtUs8 *genUs8, *work;      /* ...and a work copy of the latter */
+static ncsSoa genSoa;
+static nemoPtEnr *genEnr;                  /* ENR, of the geodesic legs */
+static double *fanLen;                            /* ...their geoFan lengths */
+static rngStream rng;
+static const char *toolDir, *dataDir;
+static char fnData[MAX_PATH], fnOut[MAX_PATH];
+static struct benchResult results[MAX_RESULTS];
+static int nResults;
+/* ========================================================================== */
+int main (int argc,
+          const char *argv[],
+          const char *envr[]) {
+   int i, n, nSizes;
+   long sizes[MAX_SIZES];
+   struct benchResult *r;
+   uint64_t seed;
+   const char *optKey, *optVal;            /* options, in -keyword=value form */
+   const char *strSizes, *fnJson, *p;
+   char *pEnd;
+   char strTime[32];
+   char strPhase[32];                         /* stats phase: data set size */
+   time_t now;
+   FILE *fp;
+/* -------------------------------------------------------------------------- */
+   progName = strrchr(argv[0], '/');                                 /* POSIX */
+   if (progName == NULL) progName = strrchr(argv[0], '\\');         /* MS Win */
+   if (progName) progName += 1;             /* skip found last path separator */
+   if (progName == NULL) progName = argv[0];     /* neither? Just use argv[0] */
+   fprintf(stderr, "\n[%s]: %s\nsource as of: %s, Nemo Library: %.3f\n",
+                   progName, PGM_DSCR, PGM_LAST_EDIT_DATE, NEMO_LIBRARY_DATE);
+   if (statsInit(progName, &argc, argv)) usage("invalid option", "-stats");
+
+   strSizes = DEFAULT_SIZES;
+   seed = DEFAULT_SEED;
+   nRuns = DEFAULT_RUNS;
+   nThreads = 0;
+   toolDir = "..";
+   dataDir = "/tmp";
+   fnJson = NULL;
+   while ((optKey = clOption(argc, argv, &optVal))) {
+      if (*optKey == 'h') usage(NULL, NULL);
+      else if (*optKey == 'n') strSizes = optVal;
+      else if (*optKey == 's') seed = strtoull(optVal, NULL, 10);
+      else if (*optKey == 'r') nRuns = atoi(optVal);
+      else if (*optKey == 't') nThreads = atoi(optVal);
+      else if (*optKey == 'x') toolDir = optVal;
+      else if (*optKey == 'd') dataDir = optVal;
+      else if (*optKey == 'o') fnJson = optVal;
+      else usage("unrecognized option", optKey);
+      }
+   if ((nRuns < 1) || (nRuns > MAX_RUNS)) usage("invalid option", "runs");
+   if ((nThreads < 0) || (nThreads > US8_SORT_MAX_THREADS))
+      usage("invalid option", "threads");
+   for (nSizes = 0, p = strSizes; *p && (nSizes < MAX_SIZES); nSizes++) {
+      sizes[nSizes] = strtol(p, &pEnd, 10);
+      if ((pEnd == p) || (sizes[nSizes] < 2) || (sizes[nSizes] > 1000000000))
+         usage("invalid option", "sizes");
+      p = (*pEnd == ',') ? pEnd + 1 : pEnd;
+      }
+   now = time(NULL);
+   strftime(strTime, sizeof(strTime), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+   fprintf(stderr, "Seed: %llu, runs: %d, threads: %d, chord squared: %s\n",
+           (unsigned long long)seed, nRuns, nThreads, chSqBatchIsa());
+
+   nResults = 0;
+   for (i = 0; i < nSizes; i++) {
+      nPts = (int)sizes[i];
+      fprintf(stderr, "Data set: %d points\n", nPts);
+      snprintf(strPhase, sizeof(strPhase), "n=%d", nPts);
+      statsPhase(strPhase);
+      genNcs = malloc((size_t)nPts * sizeof(nemoPtNcs));
+      genUs8 = malloc((size_t)nPts * sizeof(nemoPtUs8));
+      work = malloc((size_t)nPts * sizeof(nemoPtUs8));
+      genEnr = malloc((size_t)(nPts < SZPILA_PAIRS ? nPts : SZPILA_PAIRS + 1) *
+                      sizeof(nemoPtEnr));
+      fanLen = malloc((size_t)(nPts < SZPILA_PAIRS ? nPts : SZPILA_PAIRS) *
+                      sizeof(double));
+      if ((genNcs == NULL) || (genUs8 == NULL) || (work == NULL) ||
+          (genEnr == NULL) || (fanLen == NULL) || ncsSoaAlloc(&genSoa, nPts))
+         errorExit(progName, __LINE__, "No memory for %d points?\n", nPts);
+      rngSeed(&rng, seed);             /* the same points, for any run */
+      for (n = 0; n < nPts; n++) rngSpherePoint(&rng, genNcs + n);
+      for (n = 0; n < nPts; n++) genUs8[n] = nemo_NcsToUs8(genNcs + n);
+
+      measureKernel("us8Encode", kernEncode, nPts);
+      measureKernel("us8Decode", kernDecode, nPts);
+      for (n = 0; n < nPts; n++) NCS_SOA_SET(&genSoa, n, genNcs + n);
+      measureKernel("chordSqScan", kernChordSq, (long)nPts * CHSQ_QUERIES);
+      n = (nPts - 1 < SZPILA_PAIRS) ? nPts - 1 : SZPILA_PAIRS;
+      measureKernel("szpilaGeodesic", kernSzpila, n);
+      r = measureKernel("geoFanGeodesic", kernGeoFan, n);
+      if (r) fanAgreement(r);
+      measureKernel("us8Sort", kernSort, nPts);
+      if (us8Sort(genUs8, nPts, nThreads))      /* from now on: sorted */
+         errorExit(progName, __LINE__, "Can't sort %d points\n", nPts);
+      measureKernel("itinLegs", kernItinLegs, nPts - 1);
+
+      snprintf(fnData, MAX_PATH, "%s/benchNemo_%d.p8b", dataDir, nPts);
+      snprintf(fnOut, MAX_PATH, "%s/benchNemo_%d_out.p8b", dataDir, nPts);
+      fp = fopen(fnData, "wb");
+      if ((fp == NULL) ||
+          (fwrite(genUs8, sizeof(nemoPtUs8), nPts, fp) != (size_t)nPts) ||
+          fclose(fp)) errorExit(progName, __LINE__, "Can't write [%s]\n", fnData);
+      measureTool("itinWindow", "uniSpherical", "nearNextP8bWindow", BENCH_WINDOW);
+      measureTool("itinKdTree", "uniSpherical", "nearNextP8bWindow", 0);
+      if (nPts <= BRUTE_MAX)
+         measureTool("itinBruteForce", "uniSpherical", "nearNextP8bBruteForce", 0);
+      measureTool("extraction", "pointNemo", "r8bToP8bSelect", 0);
+      remove(fnData);
+      remove(fnOut);
+
+      free(genNcs);
+      free(genUs8);
+      free(work);
+      free(genEnr);
+      free(fanLen);
+      ncsSoaFree(&genSoa);
+      statsAdd("points", nPts);
+      }
+
+   statsPhase("json");
+   writeJson(stdout, strTime, strSizes);
+   if (fnJson) {
+      fp = fopen(fnJson, "a");
+      if (fp == NULL) errorExit(progName, __LINE__, "Can't open [%s]\n", fnJson);
+      writeJson(fp, strTime, strSizes);
+      fclose(fp);
+      }
+   statsAdd("results", nResults);
+   statsReport();
+   return(0);
+   }
+/* ========================================================================== */
+/* Kernels: each does one run of the benchmark, and returns its duration
+   (seconds), not counting any set-up.
+ */
+static double kernEncode(void) {
+   int n;
+   double t;
+/* -------------------------------------------------------------------------- */
+   t = statsWall();
+   for (n = 0; n < nPts; n++) work[n] = nemo_NcsToUs8(genNcs + n);
+   return(statsWall() - t);
+   }
+/* ========================================================================== */
+static double kernDecode(void) {
+   int n;
+   double t;
+/* -------------------------------------------------------------------------- */
+   t = statsWall();
+   for (n = 0; n < nPts; n++) nemo_Us8ToNcs(genUs8[n], genNcs + n);
+   return(statsWall() - t);
+   }
+/* ========================================================================== */
+static double kernChordSq(void) {
+   int q, iMin;
+   double t, sum;
+   nemoPtNcs query[CHSQ_QUERIES];
+/* -------------------------------------------------------------------------- */
+   for (q = 0; q < CHSQ_QUERIES; q++) rngSpherePoint(&rng, query + q);
+   sum = 0.0;
+   t = statsWall();
+   for (q = 0; q < CHSQ_QUERIES; q++)
+      sum += chSqMinSoa(query[q].dc, &genSoa, 0, nPts, &iMin);
+   t = statsWall() - t;
+   if (sum < 0.0) fprintf(stderr, "?\n");        /* keep the result "used" */
+   return(t);
+   }
+/* ========================================================================== */
+static double kernSzpila(void) {
+   int n, nLegs;
+   double t, sum;
+/* -------------------------------------------------------------------------- */
+   nLegs = (nPts - 1 < SZPILA_PAIRS) ? nPts - 1 : SZPILA_PAIRS;
+   for (n = 0; n <= nLegs; n++) nemo_NcsToEnr(nemo_ElrWgs84(), genNcs + n, genEnr + n);
+   sum = 0.0;
+   t = statsWall();
+   for (n = 0; n < nLegs; n++)
+      sum += nemo_GeodesicSzpila(nemo_ElrWgs84(), genEnr + n, genEnr + n + 1, NULL);
+   t = statsWall() - t;
+   if (sum < 0.0) fprintf(stderr, "?\n");
+   return(t);
+   }
+/* ========================================================================== */
+static double kernGeoFan(void) {
+   int n, nLegs;
+   double t;
+   geoFan fan;
+/* -------------------------------------------------------------------------- */
+   nLegs = (nPts - 1 < SZPILA_PAIRS) ? nPts - 1 : SZPILA_PAIRS;
+   for (n = 0; n <= nLegs; n++) nemo_NcsToEnr(nemo_ElrWgs84(), genNcs + n, genEnr + n);
+   t = statsWall();
+   geoFanInit(&fan, genEnr);
+   geoFanBatch(&fan, genEnr + 1, nLegs, fanLen, NULL);
+   return(statsWall() - t);
+   }
+/* ========================================================================== */
+static double kernSort(void) {
+   double t;
+/* -------------------------------------------------------------------------- */
+   memcpy(work, genUs8, (size_t)nPts * sizeof(nemoPtUs8));
+   t = statsWall();
+   if (us8Sort(work, nPts, nThreads))
+      errorExit(progName, __LINE__, "Can't sort %d points\n", nPts);
+   return(statsWall() - t);
+   }
+/* ========================================================================== */
+static double kernItinLegs(void) {
+   double t;
+   itinStats st;
+/* -------------------------------------------------------------------------- */
+   t = statsWall();
+   if (itinLegsUs8(genUs8, nPts, nThreads, &st))
+      errorExit(progName, __LINE__, "Can't measure %d legs\n", nPts - 1);
+   return(statsWall() - t);
+   }
+/* ========================================================================== */
+/* Run the kernel nRuns times, and record the best and the median time (the
+   result returned, NULL if there is no room for it)
+ */
+static struct benchResult *measureKernel(const char *name, double (*kern)(void),
+                                         long items) {
+   int i;
+   double secs[MAX_RUNS];
+   struct benchResult *r;
+/* -------------------------------------------------------------------------- */
+   if (nResults == MAX_RESULTS) return(NULL);
+   r = results + nResults++;
+   memset(r, 0, sizeof(struct benchResult));
+   strncpy(r->name, name, sizeof(r->name) - 1);
+   r->n = nPts;
+   r->items = items;
+   for (i = 0; i < nRuns; i++) secs[i] = kern();
+   qsort(secs, nRuns, sizeof(double), compDoubles);
+   r->best = secs[0];
+   r->median = secs[nRuns / 2];
+   fprintf(stderr, "%-16s %10d %10.4f s\n", name, nPts, r->best);
+   return(r);
+   }
+/* ========================================================================== */
+/* The geoFan lengths of the last kernGeoFan() run, against those of the
+   library; and geoFanNear() tests, at the limits just outside the guard of
+   the library length, that come out otherwise (counted as r->status).
+ */
+static void fanAgreement(struct benchResult *r) {
+   int n, k;
+   double g, limit;
+   geoFan fan;
+/* -------------------------------------------------------------------------- */
+   geoFanInit(&fan, genEnr);
+   for (n = 0; n < r->items; n++) {
+      g = nemo_GeodesicSzpila(nemo_ElrWgs84(), genEnr, genEnr + n + 1, NULL);
+      if ((g == NEMO_DOUBLE_UNDEF) || (fanLen[n] == NEMO_DOUBLE_UNDEF)) continue;
+      if (fabs(fanLen[n] - g) > r->maxDiff) r->maxDiff = fabs(fanLen[n] - g);
+      for (k = -1; k <= 1; k += 2) {              /* below, and above, it */
+         limit = g + k * 1.001 * GEO_FAN_GUARD;
+         if ((geoFanNear(&fan, genEnr + n + 1, limit) < limit) != (g < limit))
+            r->status++;
+         }
+      }
+   fprintf(stderr, "%-16s %10d %10.3f mm, most from Szpila (guard %.0f mm)%s\n",
+                   r->name, nPts, 1000.0 * r->maxDiff, 1000.0 * GEO_FAN_GUARD,
+                   r->status ? ", FAILED" : "");
+   return;
+   }
+/* ========================================================================== */
+/* Run the program (in toolDir/subDir) nRuns times on the data set file, as
+   the benchmark "name"; iArg is the window size of the itinerary programs.
+ */
+static void measureTool(const char *name, const char *subDir,
+                        const char *tool, int iArg) {
+   int i, status;
+   long nTour;
+   char fnTool[MAX_PATH], strArg[32];
+   char *args[8];
+   double secs[MAX_RUNS];
+   struct benchResult *r;
+/* -------------------------------------------------------------------------- */
+   if (nResults == MAX_RESULTS) return;
+   r = results + nResults++;
+   memset(r, 0, sizeof(struct benchResult));
+   strncpy(r->name, name, sizeof(r->name) - 1);
+   r->n = r->items = nPts;
+   snprintf(fnTool, MAX_PATH, "%s/%s/%s", toolDir, subDir, tool);
+   if (access(fnTool, X_OK)) {
+      r->isSkipped = 1;
+      fprintf(stderr, "%-16s %10d skipped, no [%s]\n", name, nPts, fnTool);
+      return;
+      }
+   args[0] = fnTool;
+   args[1] = fnData;
+   args[2] = fnOut;
+   snprintf(strArg, sizeof(strArg), "%d", iArg);
+   if (strcmp(name, "extraction") == 0) {
+      args[3] = "-center=" EXTRACT_CENTER;
+      snprintf(strArg, sizeof(strArg), "-radius=%.0f", EXTRACT_RADIUS);
+      args[4] = strArg;
+      args[5] = NULL;
+      }
+   else {
+      args[3] = strArg;                        /* ignored by brute force */
+      args[4] = NULL;
+      }
+   for (i = 0; i < nRuns; i++) {
+      secs[i] = runTool(args, &status);
+      if (status) r->status = status;
+      }
+   qsort(secs, nRuns, sizeof(double), compDoubles);
+   r->best = secs[0];
+   r->median = secs[nRuns / 2];
+   if (strncmp(name, "itin", 4) == 0) {
+      r->tourMeters = tourMeters(fnOut, &nTour);
+      if (nTour != nPts) r->status = -1;    /* not all locations visited? */
+      }
+   fprintf(stderr, "%-16s %10d %10.4f s%s\n", name, nPts, r->best,
+                   r->status ? ", FAILED" : "");
+   return;
+   }
+/* ========================================================================== */
+/* Run a program, its output discarded, and wait for it to finish. Returns the
+   duration, seconds, and its exit status (-1: it could not be started).
+ */
+static double runTool(char *const *args, int *status) {
+   pid_t pid;
+   int wStatus;
+   double t;
+   posix_spawn_file_actions_t fa;
+/* -------------------------------------------------------------------------- */
+   posix_spawn_file_actions_init(&fa);
+   posix_spawn_file_actions_addopen(&fa, 1, "/dev/null", O_WRONLY, 0);
+   posix_spawn_file_actions_addopen(&fa, 2, "/dev/null", O_WRONLY, 0);
+   t = statsWall();
+   if (posix_spawn(&pid, args[0], &fa, NULL, args, environ)) *status = -1;
+   else if (waitpid(pid, &wStatus, 0) != pid) *status = -1;
+   else *status = WIFEXITED(wStatus) ? WEXITSTATUS(wStatus) : -1;
+   t = statsWall() - t;
+   posix_spawn_file_actions_destroy(&fa);
+   return(t);
+   }
+/* ========================================================================== */
+/* Geodesic length of the itinerary in the file, including the leg back to
+   the first location; also its number of locations (-1: no such file).
+ */
+static double tourMeters(const char *fn, long *nTour) {
+   itinStats st;
+   fileMap tourMap;
+/* -------------------------------------------------------------------------- */
+   *nTour = -1;
+   if (p8bMapOpen(&tourMap, fn)) return(0.0);
+   *nTour = (long)tourMap.nPts;
+   if (itinLegsUs8(tourMap.pts, (int)tourMap.nPts, nThreads, &st))
+      st.gdsTotal = st.gdsStartEnd = 0.0;
+   fileMapClose(&tourMap);
+   return(st.gdsTotal + st.gdsStartEnd);
+   }
+/* ========================================================================== */
+/* The whole benchmark run, as a single line JSON object */
+static void writeJson(FILE *fp, const char *strTime, const char *strSizes) {
+   int i;
+   struct benchResult *r;
+/* -------------------------------------------------------------------------- */
+   fprintf(fp, "{\"program\":\"%s\",\"source\":\"%s\",\"nemoLibrary\":%.3f,"
+               "\"time\":\"%s\",\"sizes\":\"%s\",\"runs\":%d,\"threads\":%d,"
+               "\"chordSqIsa\":\"%s\",\"results\":[", progName,
+               PGM_LAST_EDIT_DATE, NEMO_LIBRARY_DATE, strTime, strSizes,
+               nRuns, nThreads, chSqBatchIsa());
+   for (i = 0; i < nResults; i++) {
+      r = results + i;
+      fprintf(fp, "%s{\"name\":\"%s\",\"n\":%ld", i ? "," : "", r->name, r->n);
+      if (r->isSkipped) fprintf(fp, ",\"skipped\":true}");
+      else {
+         fprintf(fp, ",\"best\":%.6f,\"median\":%.6f,\"perSecond\":%.1f",
+                 r->best, r->median, (r->best > 0.0) ? r->items / r->best : 0.0);
+         if (r->tourMeters > 0.0) fprintf(fp, ",\"tourMeters\":%.3f", r->tourMeters);
+         if (r->maxDiff > 0.0) fprintf(fp, ",\"maxDiffMeters\":%.6f", r->maxDiff);
+         fprintf(fp, ",\"status\":%d}", r->status);
+         }
+      }
+   fprintf(fp, "]}\n");
+   return;
+   }
+/* ========================================================================== */
+static int compDoubles(const void *a, const void *b) {
+   double da = *(const double *)a, db = *(const double *)b;
+   return((da > db) - (da < db));
+   }
+/* ========================================================================== */
+void usage(const char *mA,                  /* first message string (or NULL) */
+           const char *mB) {               /* second message string (or NULL) */
+   if (mA || mB) fprintf (stderr, "Error: %s %s\n", mA ? mA : "\0", mB ? mB : "\0");
+   fprintf (stderr, "Usage: %s [options]\n", progName);
+   fprintf (stderr, "Options:\n");
+   fprintf (stderr, " -h(elp)      to print this usage help and exit\n");
+   fprintf (stderr, " -n=n,n,...   data set sizes (default: %s)\n", DEFAULT_SIZES);
+   fprintf (stderr, " -s(eed)=nnn  random number seed (default: %d)\n", DEFAULT_SEED);
+   fprintf (stderr, " -r(uns)=n    runs of each benchmark (default: %d)\n", DEFAULT_RUNS);
+   fprintf (stderr, " -t(hreads)=n worker threads, sort and legs (default: none)\n");
+   fprintf (stderr, " -x=dir       programs, in dir/uniSpherical... (default: ..)\n");
+   fprintf (stderr, " -d(ata)=dir  data set files (default: /tmp)\n");
+   fprintf (stderr, " -o(utput)=file append JSON results to file\n");
+   fprintf (stderr, " -stats=text|json|file.json time per data set size report\n");
+   exit(1);
+   }
+/* ========================================================================== */
+#include "../scullions/clFileOpt.c"
+#include "../scullions/errorExit.c"
+#include "../scullions/fileMap.c"
+#include "../scullions/rngStream.c"
+#include "../scullions/chordSqBatch.c"
+#include "../scullions/us8Sort.c"
+#include "../scullions/nemoStats.c"
+#include "../scullions/itinLegs.c"
+#include "../scullions/geoFan.c"
+/* ========================================================================== */
@@ -39,29 +39,55 @@ Command line program invocation example:
    and 1 millimeter for 8 decimal digits. Both are an order of magnitude
    higher than 4- and 8-byte (respectively) UniSpherical coordinates).
 
-   Output can be redirected (see example above) for further processing.
+   With the -b(inary) option, the output is not text but its binary
+   equivalent, for the programs that read it as such: for each record two
+   doubles (native, that is little-endian, 8-byte), φ and λ in decimal
+   degrees, and for a marker record both are NaN.
+
+   The records are formatted in chunks (scullions/textOut), by -t(hreads)=n
+   threads, and written in large blocks; the φ, λ of a chunk are decoded in
+   one batch (scullions/us8Batch). Any number of threads writes the same
+   output as the one.
+
+   Output can be redirected (see example above) for further processing. The
+   -stats=text (or json, file.json) option reports the time it all took.
  */
 
 #define PGM_DSCR "Convert binary UniSpherical coordinates to text"
-#define PGM_LAST_EDIT_DATE "2025.093"
+#define PGM_LAST_EDIT_DATE "2026.287"
 #include <stdio.h>
 #include <nemo.h>
 #include "../scullions/scullions.h" /* include after nemo.h has been included */
+#include "../scullions/nemoStats.h"
+#include "../scullions/fileMap.h"
+#include "../scullions/chordSqBatch.h"
+#include "../scullions/us8Batch.h"
+#include "../scullions/asyncOut.h"
+#include "../scullions/textOut.h"
+
+#define MAX_LINE_BYTES    40          /* longest output line, marker's 26 */
+
+struct asciiJob {                 /* record formatting, shared by threads */
+   const nemoPtUs8 *pts;                                 /* input records */
+   int iFormat;                   /* 0: hex, 4 or 8: φ, λ fraction digits */
+   int isBinary;                            /* 1: φ, λ as two doubles */
+   nemoPtUs8 *us8[TEXT_OUT_MAX_THREADS];  /* per buffer: coordinates, and */
+   ncsSoa soa[TEXT_OUT_MAX_THREADS];              /* ...decoded, by chunk */
+   };
 
 static const char *progName;    /* for error logging by this source file only */
 void usage(const char *, const char *);
+static size_t asciiChunk(void *, int, int, int, char *);
 /* ========================================================================== */
 int main (int argc,
           const char *argv[],
           const char *envr[]) {
-   int n, m;
-   int iPlate, iFormat, nRecs, nCoords, nMarkers, idSeg, nSegPts;
+   int n, iErr, nThreads;
+   int nRecs, nCoords, nMarkers;
    const char *optKey, *optVal;            /* options, in -keyword=value form */
    const char *inFn;                                       /* input file name */
-   FILE *inFp;                  /* input binary file, coordinate to trabsform */
-   nemoPtUs8 ptUs8;
-   nemoPtEll locEll;
-   nemoPtNcs locNcs;
+   fileMap inMap;               /* input binary file, coordinate to trabsform */
+   struct asciiJob job;                           /* formatting by chunks */
 /* -------------------------------------------------------------------------- */
    progName = strrchr(argv[0], '/');                                 /* POSIX */
    if (progName == NULL) progName = strrchr(argv[0], '\\');         /* MS Win */
@@ -69,59 +95,135 @@ int main (int argc,
    else progName += 1;                        /* strip leading path separator */
    fprintf(stderr, "\n[%s]: %s\nsource as of: %s, Nemo Library: %.3f\n",
                    progName, PGM_DSCR, PGM_LAST_EDIT_DATE, NEMO_LIBRARY_DATE);
+   if (statsInit(progName, &argc, argv)) errorExit(progName, __LINE__,
+                "-stats=text, -stats=json or -stats=file.json, please\n");
 
-   iFormat = nRecs = 0; /* assume whole file, hexadecimal UniSpherical output */
+   memset(&job, 0, sizeof(job));
+   nRecs = nThreads = 0; /* assume whole file, hexadecimal UniSpherical output */
    while ((optKey = clOption(argc, argv, &optVal))) {
       if (*optKey == 'h') usage(NULL, NULL);
-      else if (*optKey == 'f') iFormat = atoi(optVal);
+      else if (*optKey == 'f') job.iFormat = atoi(optVal);
       else if (*optKey == 'n') nRecs = atoi(optVal);
+      else if (*optKey == 'b') job.isBinary = 1;
+      else if (*optKey == 't') nThreads = atoi(optVal);
       else usage("unrecognized option", optKey);
       }
-   if (iFormat > 4) iFormat = 8;             /* about 1 mm along the meridian */
-   else if (iFormat > 0) iFormat = 4;   /* about 10 meters along the meridian */
-   else iFormat = 0;                       /* just to nix input of a negative */
-/* fprintf(stderr, "limit: %d, format: %d\n", nRecs, iFormat); */
+   if (job.iFormat > 4) job.iFormat = 8;     /* about 1 mm along the meridian */
+   else if (job.iFormat > 0) job.iFormat = 4;     /* about 10 meters along... */
+   else job.iFormat = 0;                   /* just to nix input of a negative */
+   if (job.isBinary) job.iFormat = 8;                /* doubles: φ, λ anyway */
+   if ((nThreads < 0) || (nThreads > TEXT_OUT_MAX_THREADS))
+      errorExit(progName, __LINE__, "invalid thread count %d\n", nThreads);
+   if (nThreads < 1) nThreads = 1;
+/* fprintf(stderr, "limit: %d, format: %d\n", nRecs, job.iFormat); */
 
    inFn = clFileName(argc, argv);                          /* input file name */
    if (inFn == NULL) errorExit(progName, __LINE__,
                  "missing command line argument (input file name)\n");
-   inFp = fopen(inFn, "rb");                            /* Open input file */
-   if (inFp == NULL) errorExit(progName, __LINE__,
-                                "Can't open [%s] for reading\n", inFn);
-   n = nCoords = nMarkers = 0;
-   m = fread(&ptUs8, sizeof(nemoPtUs8), 1, inFp);
-/* fprintf(stderr, "first read: %d\n", m); */
-   while (m) {
-      if ((nRecs) && (n >= nRecs)) break;                     /* want no more */
-      iPlate = NEMO_Us8Plate(ptUs8);
-      if (iPlate == 0) {             /* line segment/ring end "marker" record */
-         nMarkers++;
+   statsPhase("check");
+   iErr = p8bMapOpen(&inMap, inFn);                        /* Open input file */
+   if (iErr) errorExit(progName, __LINE__,
+                       "Can't read [%s]: %s\n", inFn, fileMapErrStr(iErr));
+   if ((nRecs == 0) || (nRecs > (int)inMap.nPts)) nRecs = (int)inMap.nPts;
+   nCoords = nMarkers = 0;
+   for (n = 0; n < nRecs; n++) {
+      if (NEMO_Us8Plate(inMap.pts[n]) == 0) nMarkers++;  /* segment/ring end */
+      else nCoords++;
+      }
+
+   statsPhase("list");
+   job.pts = inMap.pts;
+   for (n = 0; job.iFormat && (n < nThreads); n++) {   /* decoding buffers */
+      job.us8[n] = malloc(TEXT_OUT_CHUNK * sizeof(nemoPtUs8));
+      if ((job.us8[n] == NULL) || ncsSoaAlloc(job.soa + n, TEXT_OUT_CHUNK))
+         errorExit(progName, __LINE__, "No memory for decoding buffers?\n");
+      }
+   iErr = textOutRun(stdout, nRecs, MAX_LINE_BYTES, asciiChunk, &job, nThreads);
+   if (iErr) errorExit(progName, __LINE__, "Output failed (%s)\n",
+                (iErr == TEXT_OUT_WRITE) ? "write error" : "memory or threads");
+   fflush(stdout);
+   for (n = 0; job.iFormat && (n < nThreads); n++) {
+      free(job.us8[n]);
+      ncsSoaFree(job.soa + n);
+      }
+   fileMapClose(&inMap);
+
+   fprintf(stderr, "%s done, coordinates: %d markers: %d\n",
+                    progName, nCoords, nMarkers);
+   statsAdd("coordinates", nCoords);
+   statsAdd("markers", nMarkers);
+   statsReport();
+   return(0);
+   }
+/* ========================================================================== */
+/* Format the n records from the first one into buf, the coordinates of all
+   but the markers decoded in one batch into the buffer's arrays; returns the
+   bytes written.
+ */
+static size_t asciiChunk(void *arg, int iBuf, int first, int n, char *buf) {
+   struct asciiJob *job = arg;
+   int i, k, nUs8, idSeg, nSegPts;
+   char *p = buf;
+   const nemoPtUs8 *pts = job->pts + first;
+   double phiLam[2];
+   nemoPtUs8 ptUs8;
+   nemoPtEll locEll;
+   nemoPtNcs locNcs;
+/* -------------------------------------------------------------------------- */
+   if (job->iFormat) {                                     /* convert to φ, λ */
+      for (i = nUs8 = 0; i < n; i++)
+         if (NEMO_Us8Plate(pts[i])) job->us8[iBuf][nUs8++] = pts[i];
+      us8ToSoa(job->us8[iBuf], nUs8, job->soa + iBuf, 0);
+      }
+   for (i = k = 0; i < n; i++) {
+      ptUs8 = pts[i];
+      if (NEMO_Us8Plate(ptUs8) == 0) {  /* line segment/ring end "marker" record */
+         if (job->isBinary) {
+            phiLam[0] = phiLam[1] = NAN;
+            memcpy(p, phiLam, sizeof(phiLam));
+            p += sizeof(phiLam);
+            continue;
+            }
          idSeg = (int)(ptUs8 >> 32);
          nSegPts = (int)(ptUs8 & 0x00000000ffffffff);
-         putchar('*');
-         if ((idSeg) || (nSegPts)) printf(" %d %d", idSeg, nSegPts);
-         putchar('\n');
+         *p++ = '*';
+         if ((idSeg) || (nSegPts)) {
+            *p++ = ' ';
+            p = textInt(p, idSeg);
+            *p++ = ' ';
+            p = textInt(p, nSegPts);
+            }
+         *p++ = '\n';
          }
-      else {                                /* UniSpherical coordinate record */
-         nCoords++;
-         if (iFormat) {                                    /* convert to φ, λ */
-            nemo_Us8ToNcs(ptUs8, &locNcs);
-            nemo_NcsToEll(nemo_ElrWgs84(), &locNcs, &locEll);
-            if (iFormat > 4) printf("%12.8f %13.8f\n", NEMO_RAD2DEG * locEll.a[0],
-                                                       NEMO_RAD2DEG * locEll.a[1]);
-            else printf("%8.4f %9.4f\n", NEMO_RAD2DEG * locEll.a[0],
-                                         NEMO_RAD2DEG * locEll.a[1]);
+      else if (job->iFormat) {                        /* coordinate, as φ, λ */
+         NCS_SOA_GET(job->soa + iBuf, k, &locNcs);
+         k++;
+         nemo_NcsToEll(nemo_ElrWgs84(), &locNcs, &locEll);
+         phiLam[0] = NEMO_RAD2DEG * locEll.a[0];
+         phiLam[1] = NEMO_RAD2DEG * locEll.a[1];
+         if (job->isBinary) {
+            memcpy(p, phiLam, sizeof(phiLam));
+            p += sizeof(phiLam);
+            continue;
+            }
+         if (job->iFormat > 4) {
+            p = textFixed(p, phiLam[0], 12, 8);
+            *p++ = ' ';
+            p = textFixed(p, phiLam[1], 13, 8);
             }
-         else printf("%016lx\n", ptUs8);
+         else {
+            p = textFixed(p, phiLam[0], 8, 4);
+            *p++ = ' ';
+            p = textFixed(p, phiLam[1], 9, 4);
+            }
+         *p++ = '\n';
+         }
+      else {                                /* UniSpherical coordinate, hex */
+         p = textHex16(p, ptUs8);
+         *p++ = '\n';
          }
-      n++;
-      m = fread(&ptUs8, sizeof(nemoPtUs8), 1, inFp);
       }
-   fclose(inFp);
-
-   fprintf(stderr, "%s done, coordinates: %d markers: %d\n",
-                    progName, nCoords, nMarkers);
-   return(0);
+   return((size_t)(p - buf));
    }
 /* ========================================================================== */
 void usage(const char *mA,                  /* first message string (or NULL) */
@@ -133,9 +235,18 @@ void usage(const char *mA,                  /* first message string (or NULL) */
    fprintf (stderr, " -h[elp|  to print this usage help and exit\n");
    fprintf (stderr, " -f[ormat]=[0|4|8]: 0:hexUniS, n:φ,λ decimal° fraction digits\n");
    fprintf (stderr, " -n[umber]=nn restrict processing to first nn input records\n");
+   fprintf (stderr, " -b[inary]  φ,λ as two (8-byte) doubles per record, markers NaN\n");
+   fprintf (stderr, " -t[hreads]=n  format the output by n threads\n");
+   fprintf (stderr, " -stats=text|json|file.json time and counts report\n");
    exit(1);
    }
 /* ========================================================================== */
 #include "../scullions/errorExit.c"
 #include "../scullions/clFileOpt.c"
+#include "../scullions/fileMap.c"
+#include "../scullions/nemoStats.c"
+#include "../scullions/chordSqBatch.c"
+#include "../scullions/us8Batch.c"
+#include "../scullions/asyncOut.c"
+#include "../scullions/textOut.c"
 /* ========================================================================== */
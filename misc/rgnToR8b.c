@@ -95,47 +95,101 @@
    path/names; for instance:
 
    ./rgnToR8b osmLand.rgn osmLand.
+
+   The input file is memory mapped and processed in chunks of about
+   CHUNK_BYTES of text, each ending with a marker line if there is one in
+   the next MARKER_SEEK bytes; if not (a .pts file, or a very long segment)
+   the chunk ends before a coordinate line, and the segment or ring that it
+   splits is completed (vertex count, OSM checks) as the chunks are merged.
+   With the -t(hreads)=n option, chunks are
+   parsed and converted by n worker threads, a round of CHUNKS_PER_THREAD
+   chunks per thread at a time; the chunks of each round are then written
+   out in input order, and their OSM convention violation counts merged.
+   The output file is the same, with or without threads. While a round is
+   parsed, the text of the next one is read ahead, and the records of the
+   previous one are written by a background thread (scullions/asyncOut).
+   The -stats=text (or json, file.json) option reports the time spent in
+   parsing the rounds and in merging (and queuing the writes of) them, see
+   scullions/nemoStats.
  */
 
 #define PGM_DSCR "Convert .rgn text to .r8b binary file"
-#define PGM_LAST_EDIT_DATE "2025.091"         /* format as from 'date +%Y.%j' */
+#define PGM_LAST_EDIT_DATE "2026.287"         /* format as from 'date +%Y.%j' */
+
+#include <pthread.h>
+#include <stdatomic.h>
 
 #include <nemo.h>
 #include "../scullions/scullions.h" /* include after nemo.h has been included */
+#include "../scullions/nemoStats.h"
+#include "../scullions/fileMap.h"
+#include "../scullions/csvParse.h"
+#include "../scullions/asyncOut.h"
 
 /* pending inclusion to nemo.h */
 #define NEMO_Us8Plate(u8) ((int)((u8 & 0xf000000000000000) >> 60))
 
+#define CHUNK_BYTES        (4 * 1024 * 1024)      /* input text, per chunk */
+#define MARKER_SEEK        (64 * 1024)  /* ...beyond which a marker is sought */
+#define CHUNKS_PER_THREAD  4                 /* chunks in a round, per thread */
+#define MAX_THREADS      256
+
+struct rgnChunk {     /* chunk of input text lines, ending at a marker if any */
+   const char *lo, *hi;                                 /* its text, [lo, hi) */
+   nemoPtUs8 *recs;                   /* output records: vertices and markers */
+   int nRecs, nRecCap;
+   int nLnIn, nComments, nMarks, nTotalPts, markLast;
+   int maxVert, minVert;
+   int nCountMismatch, nIdSequence, nRingOpen;              /* OSM violations */
+   int firstSeg, lastSeg;   /* first and last given ids (-1: if none given) */
+   int *leadRecs;      /* records of markers without id before the first id */
+   int nLeadIds, nLeadCap;             /* (ids resolved when merged, in order) */
+   int headRec;   /* record of the first marker after vertices, or -1: none */
+   int headPts, headCount;   /* ...vertices in chunk before it, (n) or -1 */
+   nemoPtUs8 headStart, headEnd;       /* ...first and last of such vertices */
+   int tailPts;                  /* vertices after the last marker, if any */
+   nemoPtUs8 tailStart;                                 /* ...the first one */
+   int errLine;  /* chunk line of ring/segment-id overflow or bad coordinates */
+   int errCode;                         /* 0: no error... (see parseChunk()) */
+   };
+
+struct rgnPool {                /* chunks of one round, shared by the threads */
+   int nChunks;
+   atomic_int nextChunk;                           /* next one to be taken */
+   struct rgnChunk *chunks;
+   };
+
 void usage(const char *, const char *);
+static const char *chunkEnd(const char *, const char *);
+static int parseUint(const char **, const char *);
+static void parseChunk(struct rgnChunk *);
+static void *parseWorker(void *);
 static const char *progName;    /* for error logging by this source file only */
 /* ========================================================================== */
 int main (int argc,
           const char *argv[],
           const char *envr[]) {
 
-   int n, nLnIn, nRecOut;                    /* count input/output file lines */
-   int nComments, nMarks, nSegPts, nTotalPts, markLast;
+   int i, n, nLnIn, nRecOut, iErr;           /* count input/output file lines */
+   int ic, nc, nSlots;                     /* chunks: this round, at most */
+   int nComments, nMarks, nTotalPts, markLast;
    int nCountMismatch, nIdSequence, nRingOpen;              /* OSM violations */
-   int iSeg, nSeg, prevSeg, iPlate;
+   int prevSeg;
+   int carryPts;        /* vertices of the segment open at the chunk's start */
+   nemoPtUs8 carryStart, ringStart;                 /* ...its first vertex */
+   int nThreads;                           /* number of worker threads, or 0 */
+   pthread_t threads[MAX_THREADS];
+   struct rgnPool pool;                     /* the chunks of current round */
+   struct rgnChunk *chunk;
    const char *optKey;
    const char *optVal;
    const char *fnIn;         /* input: OSM rgn text coastline coordinate file */
    const char *fnOut; /* output: OSM coastline coordinate file as .lnb binary */
-   FILE *fpIn, *fpOut;
-   int lineSize;                                        /* must be signed int */
-   int lineBufSize = 0;
-   char *lineBuf = NULL;      /* will be allocated in first call to getLine() */
-   const char delimiters[] = ", \r\n";
-   char *pa;
-   char *token;
+   fileMap inMap;                                /* input text file, mapped */
+   FILE *fpOut;
+   asyncOut aOut;                                /* ...written in background */
+   const char *p, *end;
    int maxVert, minVert;
-   int nPtIn, nSegIn;
-   nemoPtEll ptEll;                    /* input file angular φ, λ coordinates */
-   nemoPtNcs ptNcs;                                       /* as above, in NCS */
-   nemoPtUs8 ptUs8;                              /* as above, in UniSpherical */
-   nemoPtUs8 ringStartPtUs8;                          /* as above, ring start */
-   nemoPtUs8 segEndMark;                                  /* segment end mark */
-   int mSeg, mSegPrev;                           /* input file segment number */
 /* -------------------------------------------------------------------------- */
    progName = strrchr(argv[0], '/');                                 /* POSIX */
    if (progName == NULL) progName = strrchr(argv[0], '\\');         /* MS Win */
@@ -143,120 +197,133 @@ int main (int argc,
    if (progName == NULL) progName = argv[0];     /* neither? Just use argv[0] */
    fprintf(stderr, "\n[%s]: %s\nsource as of: %s, Nemo Library: %.3f\n",
                    progName, PGM_DSCR, PGM_LAST_EDIT_DATE, NEMO_LIBRARY_DATE);
+   if (statsInit(progName, &argc, argv)) usage("invalid option", "-stats");
 
+   nThreads = 0;                               /* default: single-threaded */
    while ((optKey = clOption(argc, argv, &optVal))) {
       if (*optKey == 'h') usage(NULL, NULL);
+      else if (*optKey == 't') nThreads = atoi(optVal);
       else usage("unrecognized option", optKey);
       }
-
-   if (argc < 3) usage("missing command line filename arguments", NULL);
+   if ((nThreads < 0) || (nThreads > MAX_THREADS)) usage("invalid option",
+                                                        "threads (0...256)");
+   if (nThreads == 1) nThreads = 0;          /* one worker is no worker */
 
 /* First file argument: input file path/name */
    fnIn = clFileName(argc, argv);                               /* input file */
-   fpIn = fopen(fnIn, "rt");
-   if (fpIn == NULL) errorExit(progName, __LINE__,
-                               "Can't open [%s] for reading\n", argv[1]);
-/* fprintf(stderr, "Reading from [%s]\n", argv[1]); */
+   if (fnIn == NULL) usage("missing command line filename arguments", NULL);
+   iErr = fileMapOpen(&inMap, fnIn);
+   if (iErr) errorExit(progName, __LINE__,
+                       "Can't read [%s]: %s\n", fnIn, fileMapErrStr(iErr));
+/* fprintf(stderr, "Reading from [%s]\n", fnIn); */
 
 /* Second file argument: output file path/name */
    fnOut = clFileName(argc, argv);                             /* output file */
+   if (fnOut == NULL) usage("missing command line filename arguments", NULL);
    fpOut = fopen(fnOut, "wb");
    if (fpOut == NULL) errorExit(progName, __LINE__,
-                                "Can't open [%s] for writing\n", argv[2]);
-/* fprintf(stderr, "Writing to [%s]\n", argv[2]); */
+                                "Can't open [%s] for writing\n", fnOut);
+   if (asyncOutOpen(&aOut, fpOut, 0, 3))
+      errorExit(progName, __LINE__, "No memory for output buffers?\n");
+/* fprintf(stderr, "Writing to [%s]\n", fnOut); */
+
+   nSlots = nThreads ? CHUNKS_PER_THREAD * nThreads : 1;
+   pool.chunks = calloc(nSlots, sizeof(struct rgnChunk));
+   if (pool.chunks == NULL) errorExit(progName, __LINE__, "No memory?\n");
    maxVert = 0;
    minVert = 2147483647;
    prevSeg = -1;
+   carryPts = 0;
+   carryStart = 0;
    nCountMismatch = nIdSequence = nRingOpen = 0;
-   nLnIn = nRecOut = nComments = nMarks = nSegPts = nTotalPts = markLast = 0;
-   lineSize = getLine(&lineBuf, &lineBufSize, fpIn);        /* get first line */
-   while (lineSize > 0) {
-      if (nLnIn%1000000 == 0) fprintf(stderr, "%d M\r", nLnIn/1000000);
-      nLnIn++;
-//    if (nLnIn > 1000) break;                                   /* debug...! */
-      pa = lineBuf;
-      while (*pa == ' ') pa++;                    /* skip over leading blanks */
-      if ((*pa == '\0') || (*pa == ';') || (*pa == '#')) {    /* comment line */
-         nComments++;
-         lineSize = getLine(&lineBuf, &lineBufSize, fpIn);
-         continue;
+   nLnIn = nRecOut = nComments = nMarks = nTotalPts = markLast = 0;
+   p = (const char *)inMap.bytes;
+   end = p + inMap.nBytes;
+   while (p < end) {                                 /* a round of chunks */
+      fprintf(stderr, "%d M\r", nLnIn/1000000);
+      statsPhase("parse");
+      for (nc = 0; (nc < nSlots) && (p < end); nc++) {
+         pool.chunks[nc].lo = p;
+         p = chunkEnd(p, end);
+         pool.chunks[nc].hi = p;
          }
-      if (*pa == '*') {                                             /* marker */
-         nMarks++;
-         if (nSegPts) {            /* segment/ring vertices have been written */
-            token = strtok(pa, delimiters);                    /* leading '*' */
-/*          fprintf(stderr, "%s", token); */
-            token = strtok(NULL, delimiters);              /* ring/segment id */
-            iSeg = atoi(token);
-/*          fprintf(stderr, " %u", iSeg); */
-            token = strtok(NULL, delimiters);        /* vertex count, as (n)? */
-            if (*token == '(') token++;
-            nSeg = atoi(token);
-/*          fprintf(stderr, " %u\n", nSeg); */
-/*          Optional: count/report OSM convention violations: */
-            if (nSeg != nSegPts) {                  /* vertex count mis-match */
-               nCountMismatch++;
-/*             fprintf(stderr,
-               "Vertex count mis-match, input line: %d, counted: %d, given: %d\n",
-                nLnIn, nSegPts, nSeg); */
-               }
-            if (iSeg != (prevSeg + 1)) { /* uninterrupted monotonic numbering */
-               nIdSequence++;
-/*             fprintf(stderr,
-               "Segment numbering, input line: %d, previous: %d, current: %d\n",
-                nLnIn, prevSeg, iSeg); */
-               }
-            if (ptUs8 != ringStartPtUs8) {                      /* open ring? */
-               nRingOpen++;
-/*             fprintf(stderr, "Open ring? line: %d, ring: %d, vertices: %d gap: %s\n",
-               nLnIn, iSeg, nSegPts, nemo_StrUs8Dist(ptUs8, ringStartPtUs8)); */
-               }
-            prevSeg = iSeg;
-
-            if (nSegPts > maxVert) maxVert = nSegPts;
-            if (nSegPts < minVert) minVert = nSegPts;
-            nTotalPts += nSegPts;
-/*          Construct, write binary marker record: */
-            segEndMark = 0L;
-            segEndMark = iSeg;
-            segEndMark = (segEndMark << 32) + nSegPts;
-            iPlate = NEMO_Us8Plate(segEndMark);
-            if (iPlate != 0) errorExit(progName, __LINE__,
-              "ring/segment-id overflow? line: %d, ring-id: %d\n", nLnIn, iSeg);
-            n = fwrite(&segEndMark, sizeof(nemoPtUs8), 1, fpOut);   /* marker */
-            if (n != 1) errorExit(progName, __LINE__,
-                    "Marker write error, line in, out: %d,%d\n", nLnIn, nRecOut);
-            nRecOut++;
-            nSegPts = 0;            /* ...and reset segment/ring vertex count */
+      pool.nChunks = nc;                         /* (the last round is short) */
+      fileMapPrefetch(&inMap, (size_t)(p - (const char *)inMap.bytes),
+                      (size_t)nSlots * CHUNK_BYTES);         /* next round */
+      atomic_init(&pool.nextChunk, 0);
+      if (nThreads) {           /* parse and convert the chunks, in any order */
+         n = (nThreads < nc) ? nThreads : nc;
+         for (i = 0; i < n; i++) {
+            if (pthread_create(threads + i, NULL, parseWorker, &pool))
+               errorExit(progName, __LINE__, "Can't create thread %d\n", i);
             }
-         else markLast++;         /* it better be the only one at file's end! */
-
-         lineSize = getLine(&lineBuf, &lineBufSize, fpIn);
-         continue;
+         for (i = 0; i < n; i++) pthread_join(threads[i], NULL);
          }
+      else parseWorker(&pool);
 
-/*    Thus it must be a vertex in the line segment or ring */
-      token = strtok(pa, delimiters);                                    /* φ */
-      ptEll.a[NEMO_LAT] = NEMO_DEG2RAD * strtod(token, NULL);
-      token = strtok(NULL, delimiters);                                  /* λ */
-      ptEll.a[NEMO_LNG] = NEMO_DEG2RAD * strtod(token, NULL);
-/*    fprintf(stderr, "%+11.7f,%+12.7f\n", NEMO_RAD2DEG * ptEll.a[NEMO_LAT],
-                                           NEMO_RAD2DEG * ptEll.a[NEMO_LNG]); */
-      nemo_EllToNcs(nemo_ElrWgs84(), &ptEll, &ptNcs);
-      ptUs8 = nemo_NcsToUs8(&ptNcs);
-      n = fwrite(&ptUs8, sizeof(nemoPtUs8), 1, fpOut);   /* write coordinates */
-      if (n != 1) errorExit(progName, __LINE__,
-              "Coordinates write error, line in, out: %d,%d\n", nLnIn, nRecOut);
-      nRecOut++;
-      nSegPts++;
-      if (nSegPts == 0) ringStartPtUs8 = ptUs8;
-
-      lineSize = getLine(&lineBuf, &lineBufSize, fpIn);    /* next input line */
+      statsPhase("merge");
+      for (ic = 0; ic < nc; ic++) {     /* ...merge and write them in order */
+         chunk = pool.chunks + ic;
+         if (chunk->errCode == 1) errorExit(progName, __LINE__,
+            "No memory for records, line: %d\n", nLnIn + chunk->errLine);
+         if (chunk->errCode == 2) errorExit(progName, __LINE__,
+            "ring/segment-id overflow? line: %d\n", nLnIn + chunk->errLine);
+         if (chunk->errCode == 3) errorExit(progName, __LINE__,
+            "Invalid coordinates, line: %d\n", nLnIn + chunk->errLine);
+         for (i = 0; i < chunk->nLeadIds; i++) {  /* missing ids: continue */
+            if (++prevSeg > 0x0fffffff) errorExit(progName, __LINE__,
+               "ring/segment-id overflow? after line: %d\n", nLnIn);
+            chunk->recs[chunk->leadRecs[i]] |= (nemoPtUs8)prevSeg << 32;
+            }
+         if (chunk->firstSeg >= 0) {        /* numbering across chunk boundary */
+            if (chunk->firstSeg != (prevSeg + 1)) nIdSequence++;
+            prevSeg = chunk->lastSeg;
+            }
+         if (chunk->headRec >= 0) {  /* first segment: its part(s) before too */
+            n = carryPts + chunk->headPts;
+            chunk->recs[chunk->headRec] += carryPts;   /* vertex count bits */
+            ringStart = carryPts ? carryStart : chunk->headStart;
+            if (((chunk->headCount < 0) ? n : chunk->headCount) != n)
+               nCountMismatch++;
+            if (chunk->headEnd != ringStart) nRingOpen++;
+            if (n > maxVert) maxVert = n;
+            if (n < minVert) minVert = n;
+            nTotalPts += n;
+            carryPts = chunk->tailPts;
+            carryStart = chunk->tailStart;
+            }
+         else if (chunk->tailPts) {      /* no marker: the segment goes on */
+            if (carryPts == 0) carryStart = chunk->tailStart;
+            carryPts += chunk->tailPts;
+            }
+         nLnIn += chunk->nLnIn;
+         nComments += chunk->nComments;
+         nMarks += chunk->nMarks;
+         nTotalPts += chunk->nTotalPts;
+         markLast += chunk->markLast;
+         if (chunk->maxVert > maxVert) maxVert = chunk->maxVert;
+         if (chunk->minVert < minVert) minVert = chunk->minVert;
+         nCountMismatch += chunk->nCountMismatch;
+         nIdSequence += chunk->nIdSequence;
+         nRingOpen += chunk->nRingOpen;
+         if (asyncOutWrite(&aOut, chunk->recs,
+                           (size_t)chunk->nRecs * sizeof(nemoPtUs8)))
+            errorExit(progName, __LINE__,
+                      "Write error, line in, out: %d,%d\n", nLnIn, nRecOut);
+         nRecOut += chunk->nRecs;
+         }
       }
 
-   fclose(fpIn);
+   for (ic = 0; ic < nSlots; ic++) {
+      free(pool.chunks[ic].recs);
+      free(pool.chunks[ic].leadRecs);
+      }
+   free(pool.chunks);
+   fileMapClose(&inMap);
+   statsPhase("flush");
+   if (asyncOutClose(&aOut)) errorExit(progName, __LINE__,
+                     "Write error, line in, out: %d,%d\n", nLnIn, nRecOut);
    fclose(fpOut);
-   free(lineBuf);
 
    fprintf(stderr, "Input file lines:            %8d\n", nLnIn);
    fprintf(stderr, "   comments:                 %8d\n", nComments);
@@ -269,6 +336,10 @@ int main (int argc,
    fprintf(stderr, "           open rings:       %8d\n", nRingOpen);
    fprintf(stderr, "Output file records:         %8d\n", nRecOut);
 
+   statsAdd("lines", nLnIn);
+   statsAdd("rings", nMarks);
+   statsAdd("records", nRecOut);
+   statsReport();
    if (markLast > 1) errorExit(progName, __LINE__,
                                        "Terminating markers: %d?\n", markLast);
    return(0);
@@ -278,15 +349,212 @@ void usage(const char *mA,                  /* first message string (or NULL) */
            const char *mB) {               /* second message string (or NULL) */
    if (mA || mB) fprintf (stderr, "Error: %s %s\n", mA ? mA : "\0", mB ? mB : "\0");
    fprintf (stderr, "Usage: %s [option] inFile outFile\n", progName);
-   fprintf (stderr, "  inFile:  .csv coordinate input file\n");
-   fprintf (stderr, "  outFile: .lnb coordinate output file\n");
-   fprintf (stderr, "Option:\n");
+   fprintf (stderr, "  inFile:  .rgn/.lns/.pts coordinate input file\n");
+   fprintf (stderr, "  outFile: .r8b coordinate output file\n");
+   fprintf (stderr, "Options:\n");
    fprintf (stderr, " -h(elp)      to print this usage help and exit\n");
+   fprintf (stderr, " -t(hreads)=n worker threads (default: single-threaded)\n");
+   fprintf (stderr, " -stats=text|json|file.json phases and counters report\n");
    exit(1);
    }
 /* ========================================================================== */
+/* Find the end of the chunk starting at p: just past the first marker line
+   at or after CHUNK_BYTES from its start or, if there is none in MARKER_SEEK
+   bytes more, just before the first coordinate line there (or the end of the
+   text). So a chunk never starts with a marker that ends a split segment.
+ */
+static const char *chunkEnd(const char *p, const char *end) {
+   const char *q, *line, *cut;
+/* -------------------------------------------------------------------------- */
+   if (end - p <= CHUNK_BYTES) return(end);
+   p = csvLineEnd(p + CHUNK_BYTES - 1, end);     /* end of line at the size */
+   cut = NULL;
+   while (p < end) {                        /* p is at the '\n' ending a line */
+      q = line = ++p;                                    /* start of next... */
+      while ((q < end) && (*q == ' ')) q++;
+      p = csvLineEnd(p, end);
+      if ((q < p) && (*q == '*')) return((p < end) ? p + 1 : end); /* marker */
+      if ((cut == NULL) && (q < p) && (((*q >= '0') && (*q <= '9')) ||
+          (*q == '-') || (*q == '+') || (*q == '.'))) cut = line; /* vertex */
+      if (cut && (p - cut >= MARKER_SEEK)) return(cut);      /* none near */
+      }
+   return(end);
+   }
+/* ========================================================================== */
+/* Worker thread (or the main one, if single-threaded): take chunks of the
+   round until there are none left.
+ */
+static void *parseWorker(void *arg) {
+   struct rgnPool *pool = arg;
+   int nc;
+/* -------------------------------------------------------------------------- */
+   while ((nc = atomic_fetch_add(&pool->nextChunk, 1)) < pool->nChunks)
+      parseChunk(pool->chunks + nc);
+   return(NULL);
+   }
+/* ========================================================================== */
+/* Parse an unsigned integer at *pp (after any blanks, commas and an opening
+   bracket), and advance *pp past it. Returns -1 if there is none.
+ */
+static int parseUint(const char **pp, const char *end) {
+   const char *p = *pp;
+   int v;
+/* -------------------------------------------------------------------------- */
+   while ((p < end) && ((*p == ' ') || (*p == ',') || (*p == '\t') || (*p == '('))) p++;
+   if ((p >= end) || (*p < '0') || (*p > '9')) return(-1);
+   for (v = 0; (p < end) && (*p >= '0') && (*p <= '9'); p++) v = 10 * v + (*p - '0');
+   *pp = p;
+   return(v);
+   }
+/* ========================================================================== */
+/* Parse and convert the lines of a chunk into its output records, counting
+   OSM convention violations within it. The segment numbering across chunks
+   is checked when the chunks are merged, and so is the first segment of the
+   chunk, that may have begun in the previous one(s): its marker record gets
+   the vertex count of the chunk only. A marker without an id follows the
+   previous one; up to the first id given in the chunk that is only known
+   then, so those markers are listed in chunk->leadRecs. chunk->errCode is
+   set to 1 for no memory, 2 for segment id overflow, 3 for invalid
+   coordinates.
+ */
+static void parseChunk(struct rgnChunk *chunk) {
+   int n, nSegPts, iSeg, nSeg, prevSeg, iPlate, isHead;
+   int *lead;
+   const char *p, *pa, *eol, *q;
+   double lat, lng;
+   nemoPtEll ptEll;                    /* input file angular φ, λ coordinates */
+   nemoPtNcs ptNcs;                                       /* as above, in NCS */
+   nemoPtUs8 ptUs8;                              /* as above, in UniSpherical */
+   nemoPtUs8 ringStartPtUs8;                          /* as above, ring start */
+   nemoPtUs8 segEndMark;                                  /* segment end mark */
+   nemoPtUs8 *recs;
+/* -------------------------------------------------------------------------- */
+   chunk->nRecs = chunk->nLnIn = chunk->nComments = chunk->nMarks = 0;
+   chunk->nTotalPts = chunk->markLast = chunk->maxVert = 0;
+   chunk->minVert = 2147483647;
+   chunk->nCountMismatch = chunk->nIdSequence = chunk->nRingOpen = 0;
+   chunk->firstSeg = chunk->lastSeg = -1;
+   chunk->nLeadIds = 0;
+   chunk->headRec = -1;
+   chunk->headPts = chunk->headCount = chunk->tailPts = 0;
+   chunk->headStart = chunk->headEnd = chunk->tailStart = 0;
+   chunk->errLine = chunk->errCode = 0;
+   n = 1;                            /* at most one record per line, so... */
+   for (p = chunk->lo; p < chunk->hi; p = eol + 1) {
+      eol = csvLineEnd(p, chunk->hi);
+      n++;
+      }
+   if (n > chunk->nRecCap) {        /* ...grow (reused) record array if need */
+      free(chunk->recs);
+      chunk->recs = malloc(n * sizeof(nemoPtUs8));
+      chunk->nRecCap = chunk->recs ? n : 0;
+      if (chunk->recs == NULL) {
+         chunk->errCode = 1;
+         return;
+         }
+      }
+   recs = chunk->recs;
+   nSegPts = 0;
+   prevSeg = -1;
+   ptUs8 = ringStartPtUs8 = 0;
+   for (p = chunk->lo; p < chunk->hi; p = eol + 1) {
+      eol = csvLineEnd(p, chunk->hi);
+      chunk->nLnIn++;
+      pa = p;
+      while ((pa < eol) && (*pa == ' ')) pa++;    /* skip over leading blanks */
+      if ((pa == eol) || (*pa == '\r') || (*pa == ';') || (*pa == '#')) {
+         chunk->nComments++;                        /* comment or blank line */
+         continue;
+         }
+      if (*pa == '*') {                                             /* marker */
+         chunk->nMarks++;
+         if (nSegPts) {            /* segment/ring vertices have been written */
+            q = pa + 1;                                   /* past leading '*' */
+            iSeg = parseUint(&q, eol);                     /* ring/segment id */
+            nSeg = parseUint(&q, eol);               /* vertex count, as (n)? */
+            if ((iSeg < 0) && (prevSeg >= 0)) iSeg = prevSeg + 1;   /* none? */
+            isHead = (chunk->headRec < 0);     /* checked when merged, if so */
+            if (isHead) {
+               chunk->headRec = chunk->nRecs;
+               chunk->headPts = nSegPts;
+               chunk->headCount = nSeg;
+               chunk->headStart = ringStartPtUs8;
+               chunk->headEnd = ptUs8;
+               }
+            if (nSeg < 0) nSeg = nSegPts;
+/*          Optional: count/report OSM convention violations: */
+            if ((nSeg != nSegPts) && !isHead) chunk->nCountMismatch++;
+            if (iSeg < 0) {             /* no id yet in chunk: merge sets it */
+               if (chunk->nLeadIds == chunk->nLeadCap) {
+                  n = chunk->nLeadCap ? 2 * chunk->nLeadCap : 64;
+                  lead = realloc(chunk->leadRecs, n * sizeof(int));
+                  if (lead == NULL) {
+                     chunk->errCode = 1;
+                     chunk->errLine = chunk->nLnIn;
+                     return;
+                     }
+                  chunk->leadRecs = lead;
+                  chunk->nLeadCap = n;
+                  }
+               chunk->leadRecs[chunk->nLeadIds++] = chunk->nRecs;
+               iSeg = 0;                        /* (its id bits, until then) */
+               }
+            else {
+               if (chunk->firstSeg < 0) chunk->firstSeg = iSeg; /* at merge */
+               else if (iSeg != (prevSeg + 1)) /* uninterrupted monotonic ids */
+                  chunk->nIdSequence++;
+               prevSeg = chunk->lastSeg = iSeg;
+               }
+            if (!isHead) {
+               if (ptUs8 != ringStartPtUs8) chunk->nRingOpen++; /* open ring? */
+               if (nSegPts > chunk->maxVert) chunk->maxVert = nSegPts;
+               if (nSegPts < chunk->minVert) chunk->minVert = nSegPts;
+               chunk->nTotalPts += nSegPts;
+               }
+/*          Construct binary marker record: */
+            segEndMark = 0L;
+            segEndMark = iSeg;
+            segEndMark = (segEndMark << 32) + nSegPts;
+            iPlate = NEMO_Us8Plate(segEndMark);
+            if (iPlate != 0) {
+               chunk->errCode = 2;
+               chunk->errLine = chunk->nLnIn;
+               return;
+               }
+            recs[chunk->nRecs++] = segEndMark;
+            nSegPts = 0;            /* ...and reset segment/ring vertex count */
+            }
+         else chunk->markLast++;  /* it better be the only one at file's end! */
+         continue;
+         }
+
+/*    Thus it must be a vertex in the line segment or ring */
+      q = csvParseDouble(pa, eol, &lat);                                 /* φ */
+      if (q && (q < eol) && (*q == ',')) q++;
+      if (q) q = csvParseDouble(q, eol, &lng);                           /* λ */
+      if (q == NULL) {
+         chunk->errCode = 3;
+         chunk->errLine = chunk->nLnIn;
+         return;
+         }
+      ptEll.a[NEMO_LAT] = NEMO_DEG2RAD * lat;
+      ptEll.a[NEMO_LNG] = NEMO_DEG2RAD * lng;
+      nemo_EllToNcs(nemo_ElrWgs84(), &ptEll, &ptNcs);
+      ptUs8 = nemo_NcsToUs8(&ptNcs);
+      recs[chunk->nRecs++] = ptUs8;
+      if (nSegPts == 0) ringStartPtUs8 = ptUs8;
+      nSegPts++;
+      }
+   chunk->tailPts = nSegPts;
+   chunk->tailStart = ringStartPtUs8;
+   return;
+   }
+/* ========================================================================== */
 #include "../scullions/errorExit.c"
 #include "../scullions/clFileOpt.c"
-#include "../scullions/getLine.c"
 #include "../scullions/nemoStrings.c"
+#include "../scullions/fileMap.c"
+#include "../scullions/nemoStats.c"
+#include "../scullions/csvParse.c"
+#include "../scullions/asyncOut.c"
 /* ========================================================================== */
@@ -2,19 +2,61 @@
    The program requires no files and takes one command line argument, the
    number of random location tests.
 
+   The random locations are tested in chunks of DELTA_CHUNK, each with its
+   own random number stream (scullions/rngStream), derived from the -seed
+   option; the locations of a chunk are generated straight into SoA arrays,
+   and converted to Us8 (and Us4) and back by the batch conversions. The
+   chunks can be processed by several threads (-threads option); the
+   results depend only on the seed, not on the number of threads.
+
+   At the end, the throughput of the batch conversions (scullions/us8Batch),
+   Us8 and Us4 to and from SoA NCS arrays, is reported - as millions of
+   points per second, and compared with the conversion point by point - for
+   (at most) BATCH_POINTS random locations. The -stats=text (or json,
+   file.json) option reports the time it all took (scullions/nemoStats).
+
    (run uniSphericalDeltas -h for usage summary).
  */
 
 #define PGM_DSCR "UniSpherical coordinate encoding Δ\'s"
-#define PGM_LAST_EDIT_DATE "2025.090"         /* format as from 'date +%Y.%j' */
+#define PGM_LAST_EDIT_DATE "2026.287"         /* format as from 'date +%Y.%j' */
 
 #include <stdio.h>
 #include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include <nemo.h>
 #include "../scullions/scullions.h" /* include after nemo.h has been included */
+#include "../scullions/nemoStats.h"
+#include "../scullions/chordSqBatch.h"
+#include "../scullions/us8Batch.h"
+#include "../scullions/rngStream.h"
 
 #define TEST_NUMBER  10000000
+#define BATCH_POINTS  1000000         /* throughput test, at most as many */
+#define DELTA_CHUNK     65536      /* random locations per RNG stream */
+#define DEFAULT_SEED        1
+#define MAX_THREADS       256
+
+struct deltaChunk {                 /* a chunk of random location tests */
+   rngStream rng;                          /* this chunk's own number stream */
+   int n;                                          /* number of locations */
+   double sumSq8, max8;           /* Us8 Δ: sum of squares, and largest... */
+   double sumSq4, max4;                                     /* ...and Us4 */
+   int isNoMem;
+   };
+
+struct deltaPool {                      /* chunks shared by all the threads */
+   int nChunks;
+   atomic_int nextChunk;                           /* next one to be taken */
+   struct deltaChunk *chunks;
+   };
+
 void usage(const char *, const char *);
+static void *deltaWorker(void *);
+static void batchThroughput(int, uint64_t);
+static int soaDiffer(const ncsSoa *, const ncsSoa *, int);
+static void reportRate(const char *, int, double, double);
 static const char *progName;                             /* messaging/logging */
 /* -------------------------------------------------------------------------- */
 int main (int argc,
@@ -24,15 +66,15 @@ int main (int argc,
    const char *optKey;
    const char *optVal;
 
+   int i, n, nStarted, testNum;
+   int nThreads;                           /* number of worker threads, or 0 */
+   pthread_t threads[MAX_THREADS];
+   uint64_t seed;                       /* of all random number streams */
+   rngStream rng;
+   struct deltaPool pool;
+   struct deltaChunk *chunk;
 
-   int n, testNum;
-   nemoPtUs8 u64globLoc;  /* UniSpherical global location 8-byte unsigned int */
-   nemoPtUs4 u32globLoc;                        /* ...and 4-byte unsigned int */
-
-   nemoPtNcs nsFull, nsTruncated; /* NCS locations to be moved to and from it */
-
-   double cdcDelta;                                         /* iu granularity */
-   double cdcDeltaMax;
+   double sumSq8, max8, sumSq4, max4;         /* Δ's, over all the chunks */
    double stDev;                                        /* standard deviation */
 /* -------------------------------------------------------------------------- */
    progName = strrchr(argv[0], '/');                                 /* POSIX */
@@ -41,49 +83,234 @@ int main (int argc,
    if (progName == NULL) progName = argv[0];     /* neither? Just use argv[0] */
    fprintf(stderr, "\n[%s]: %s\nsource as of: %s, Nemo Library: %.3f\n",
                    progName, PGM_DSCR, PGM_LAST_EDIT_DATE, NEMO_LIBRARY_DATE);
+   if (statsInit(progName, &argc, argv)) usage("invalid option", "-stats");
 
    testNum = TEST_NUMBER;                    /* default random location tests */
-
+   seed = DEFAULT_SEED;
+   nThreads = 0;                               /* default: single-threaded */
    while ((optKey = clOption(argc, argv, &optVal))) {
       if (*optKey == 'h') usage(NULL, NULL);
       else if (*optKey == 'r') testNum = atoi(optVal);
+      else if (*optKey == 's') seed = strtoull(optVal, NULL, 10);
+      else if (*optKey == 't') nThreads = atoi(optVal);
       else usage("unrecognized option", optKey);
       }
+   if ((nThreads < 0) || (nThreads > MAX_THREADS)) usage("invalid option",
+                                                        "threads (0...256)");
+   if (nThreads == 1) nThreads = 0;          /* one worker is no worker */
+   if (testNum < 2) usage("invalid option", "randlocs");
+   fprintf(stderr, "Random number seed: %llu\n", (unsigned long long)seed);
+   if (nThreads) fprintf(stderr, "Worker threads: %d\n", nThreads);
+
+   pool.nChunks = (testNum + DELTA_CHUNK - 1) / DELTA_CHUNK;
+   pool.chunks = calloc(pool.nChunks, sizeof(struct deltaChunk));
+   if (pool.chunks == NULL) {
+      fprintf(stderr, "%s: no memory for chunks\n", progName);
+      return(1);
+      }
+   rngSeed(&rng, seed);
+   for (n = 0; n < pool.nChunks; n++) {   /* each chunk: its own sub-stream */
+      chunk = pool.chunks + n;
+      chunk->rng = rng;
+      rngJump(&rng);
+      chunk->n = (n < pool.nChunks - 1) ? DELTA_CHUNK : testNum - n * DELTA_CHUNK;
+      }
+   atomic_init(&pool.nextChunk, 0);
+   statsPhase("deltas");
+   nStarted = 0;
+   if (nThreads) {
+      for (; nStarted < nThreads; nStarted++) {
+         if (pthread_create(threads + nStarted, NULL, deltaWorker, &pool)) break;
+         }
+      for (i = 0; i < nStarted; i++) pthread_join(threads[i], NULL);
+      }
+   if (nStarted == 0) deltaWorker(&pool);    /* single-threaded, or no threads */
+
+   sumSq8 = max8 = sumSq4 = max4 = 0.0;   /* merged in chunk order: the same */
+   for (n = 0; n < pool.nChunks; n++) {        /* ...for any thread count */
+      chunk = pool.chunks + n;
+      if (chunk->isNoMem) {
+         fprintf(stderr, "%s: no memory for the tests\n", progName);
+         return(1);
+         }
+      sumSq8 += chunk->sumSq8;
+      if (chunk->max8 > max8) max8 = chunk->max8;
+      sumSq4 += chunk->sumSq4;
+      if (chunk->max4 > max4) max4 = chunk->max4;
+      }
+   free(pool.chunks);
+   statsAdd("locations", testNum);
 
    printf("Test with %.1f M random locations\n", (double)testNum / 1000000.0);
    printf("Direct/inverse 8-byte UniSpherical transformations:\n");
-   stDev = 0.0;
-   cdcDeltaMax = 0.0;
-   srand(time(NULL));
-   for (n = 0; n < testNum; n++) {
-      if (n%1000000 == 0) fprintf(stderr, "%d M\r", n / 1000000);
-      nsFull = *nemo_SphereRandomPointGlobal(NULL);
-      u64globLoc = nemo_NcsToUs8(&nsFull);
-      nemo_Us8ToNcs(u64globLoc, &nsTruncated);
-      cdcDelta = sqrt(NEMO_ChordSq3(nsFull.dc, nsTruncated.dc)) * NEMO_EARTH_RADIUS;
-      if (cdcDelta > cdcDeltaMax) cdcDeltaMax = cdcDelta;
-      stDev += (cdcDelta * cdcDelta);
-      }
-   stDev = sqrt(stDev  / (double)(n - 1));
-   printf("Δ max: %2d mm\n", (int)(cdcDeltaMax * 1000.0));
+   stDev = sqrt(sumSq8 / (double)(testNum - 1));
+   printf("Δ max: %2d mm\n", (int)(max8 * 1000.0));
    printf("σ    : %2d mm\n", (int)(stDev * 1000.0));
 
    printf("Direct/inverse 4-byte UniSpherical transformations:\n");
-   stDev = 0.0;
-   cdcDeltaMax = 0.0;
-   srand(time(NULL));
-   for (n = 0; n < testNum; n++) {
-      if (n%1000000 == 0) fprintf(stderr, "%d M\r", n / 1000000);
-      nsFull = *nemo_SphereRandomPointGlobal(NULL);
-      u32globLoc = nemo_NcsToUs4(&nsFull);
-      nemo_Us4ToNcs(u32globLoc, &nsTruncated);
-      cdcDelta = sqrt(NEMO_ChordSq3(nsFull.dc, nsTruncated.dc)) * NEMO_EARTH_RADIUS;
-      if (cdcDelta > cdcDeltaMax) cdcDeltaMax = cdcDelta;
-      stDev += (cdcDelta * cdcDelta);
-      }
-   stDev = sqrt(stDev  / (double)(n - 1));
-   printf("Δ max: %3d m\n", (int)(cdcDeltaMax));
+   stDev = sqrt(sumSq4 / (double)(testNum - 1));
+   printf("Δ max: %3d m\n", (int)(max4));
    printf("σ    : %3d m\n", (int)(stDev));
+
+   statsPhase("batch");
+   batchThroughput((testNum < BATCH_POINTS) ? testNum : BATCH_POINTS, seed);
+   statsReport();
+   return(0);
+   }
+/* ========================================================================== */
+/* Worker thread (or the main one, if single-threaded): take chunks of tests
+   until there are none left. The chunk's locations are generated, converted
+   to Us8 and Us4 and back, and their Δ's (chord on the sphere, scaled to
+   meters) summed.
+ */
+static void *deltaWorker(void *arg) {
+   struct deltaPool *pool = arg;
+   struct deltaChunk *chunk;
+   int i, nc, isNoMem;
+   double d;
+   ncsSoa pts, back;                     /* locations, and as converted */
+   nemoPtUs8 *us8;
+   nemoPtUs4 *us4;
+/* -------------------------------------------------------------------------- */
+   us8 = malloc(DELTA_CHUNK * sizeof(nemoPtUs8));
+   us4 = malloc(DELTA_CHUNK * sizeof(nemoPtUs4));
+   isNoMem = (us8 == NULL) || (us4 == NULL);
+   if (ncsSoaAlloc(&pts, DELTA_CHUNK)) isNoMem = 1;
+   if (ncsSoaAlloc(&back, DELTA_CHUNK)) isNoMem = 1;
+   while ((nc = atomic_fetch_add(&pool->nextChunk, 1)) < pool->nChunks) {
+      chunk = pool->chunks + nc;
+      if (nc % 16 == 0) fprintf(stderr, "%d M\r",
+                                (int)(((double)nc * DELTA_CHUNK) / 1000000.0));
+      chunk->isNoMem = isNoMem;
+      if (isNoMem) continue;
+      rngSphereSoa(&chunk->rng, &pts, 0, chunk->n);
+      soaToUs8(&pts, chunk->n, us8, 0);
+      us8ToSoa(us8, chunk->n, &back, 0);
+      for (i = 0; i < chunk->n; i++) {
+         d = (pts.x[i] - back.x[i]) * (pts.x[i] - back.x[i]) +
+             (pts.y[i] - back.y[i]) * (pts.y[i] - back.y[i]) +
+             (pts.z[i] - back.z[i]) * (pts.z[i] - back.z[i]);
+         d = sqrt(d) * NEMO_EARTH_RADIUS;
+         if (d > chunk->max8) chunk->max8 = d;
+         chunk->sumSq8 += d * d;
+         }
+      soaToUs4(&pts, chunk->n, us4, 0);
+      us4ToSoa(us4, chunk->n, &back, 0);
+      for (i = 0; i < chunk->n; i++) {
+         d = (pts.x[i] - back.x[i]) * (pts.x[i] - back.x[i]) +
+             (pts.y[i] - back.y[i]) * (pts.y[i] - back.y[i]) +
+             (pts.z[i] - back.z[i]) * (pts.z[i] - back.z[i]);
+         d = sqrt(d) * NEMO_EARTH_RADIUS;
+         if (d > chunk->max4) chunk->max4 = d;
+         chunk->sumSq4 += d * d;
+         }
+      }
+   ncsSoaFree(&pts);
+   ncsSoaFree(&back);
+   free(us8);
+   free(us4);
+   return(NULL);
+   }
+/* ========================================================================== */
+/* Time the batch conversions of n random locations (from the seed), and the
+   same conversions done point by point; the results of both must be the
+   same.
+ */
+static void batchThroughput(int n, uint64_t seed) {
+   int i;
+   double t, tOne;
+   rngStream rng;
+   ncsSoa soa, soaBack, soaOne;
+   nemoPtNcs ptNcs;
+   nemoPtUs8 *us8, *us8One;
+   nemoPtUs4 *us4, *us4One;
+/* -------------------------------------------------------------------------- */
+   if (n < 1) return;
+   us8 = malloc(n * sizeof(nemoPtUs8));
+   us8One = malloc(n * sizeof(nemoPtUs8));
+   us4 = malloc(n * sizeof(nemoPtUs4));
+   us4One = malloc(n * sizeof(nemoPtUs4));
+   if ((us8 == NULL) || (us8One == NULL) || (us4 == NULL) || (us4One == NULL) ||
+       ncsSoaAlloc(&soa, n) || ncsSoaAlloc(&soaBack, n) ||
+       ncsSoaAlloc(&soaOne, n)) {
+      fprintf(stderr, "%s: no memory for throughput test\n", progName);
+      return;
+      }
+   rngSeed(&rng, seed);
+   rngSphereSoa(&rng, &soa, 0, n);
+   printf("Batch transformations, %d locations (M points/second):\n", n);
+
+   t = statsWall();
+   for (i = 0; i < n; i++) {
+      NCS_SOA_GET(&soa, i, &ptNcs);
+      us8One[i] = nemo_NcsToUs8(&ptNcs);
+      }
+   tOne = statsWall() - t;
+   t = statsWall();
+   soaToUs8(&soa, n, us8, 0);
+   reportRate("NCS to Us8", n, tOne, statsWall() - t);
+
+   t = statsWall();
+   for (i = 0; i < n; i++) {
+      nemo_Us8ToNcs(us8[i], &ptNcs);
+      NCS_SOA_SET(&soaOne, i, &ptNcs);
+      }
+   tOne = statsWall() - t;
+   t = statsWall();
+   us8ToSoa(us8, n, &soaBack, 0);
+   reportRate("Us8 to NCS", n, tOne, statsWall() - t);
+   if (memcmp(us8, us8One, n * sizeof(nemoPtUs8)))
+      printf("   Us8 batch and point by point results differ!\n");
+   if (soaDiffer(&soaBack, &soaOne, n))
+      printf("   Us8 batch and point by point decodes differ!\n");
+
+   t = statsWall();
+   for (i = 0; i < n; i++) {
+      NCS_SOA_GET(&soa, i, &ptNcs);
+      us4One[i] = nemo_NcsToUs4(&ptNcs);
+      }
+   tOne = statsWall() - t;
+   t = statsWall();
+   soaToUs4(&soa, n, us4, 0);
+   reportRate("NCS to Us4", n, tOne, statsWall() - t);
+
+   t = statsWall();
+   for (i = 0; i < n; i++) {
+      nemo_Us4ToNcs(us4[i], &ptNcs);
+      NCS_SOA_SET(&soaOne, i, &ptNcs);
+      }
+   tOne = statsWall() - t;
+   t = statsWall();
+   us4ToSoa(us4, n, &soaBack, 0);
+   reportRate("Us4 to NCS", n, tOne, statsWall() - t);
+   if (memcmp(us4, us4One, n * sizeof(nemoPtUs4)))
+      printf("   Us4 batch and point by point results differ!\n");
+   if (soaDiffer(&soaBack, &soaOne, n))
+      printf("   Us4 batch and point by point decodes differ!\n");
+
+   ncsSoaFree(&soa);
+   ncsSoaFree(&soaBack);
+   ncsSoaFree(&soaOne);
+   free(us8);
+   free(us8One);
+   free(us4);
+   free(us4One);
+   return;
+   }
+/* ========================================================================== */
+/* Non-zero if the first n points of SoA arrays a and b are not bit-identical */
+static int soaDiffer(const ncsSoa *a, const ncsSoa *b, int n) {
+   size_t nBytes = (size_t)n * sizeof(double);
+/* -------------------------------------------------------------------------- */
+   return(memcmp(a->x, b->x, nBytes) || memcmp(a->y, b->y, nBytes) ||
+          memcmp(a->z, b->z, nBytes));
+   }
+/* ========================================================================== */
+static void reportRate(const char *title, int n, double tOne, double tBatch) {
+   printf("   %-12s point by point: %8.2f, batch: %8.2f\n", title,
+          (tOne > 0.0) ? 1.0e-6 * n / tOne : 0.0,
+          (tBatch > 0.0) ? 1.0e-6 * n / tBatch : 0.0);
+   return;
    }
 /* ========================================================================== */
 void usage(const char *mA,                  /* first message string (or NULL) */
@@ -93,8 +320,15 @@ void usage(const char *mA,                  /* first message string (or NULL) */
    fprintf (stderr, "Options:\n");
    fprintf (stderr, " -h(elp)      to print this usage help and exit\n");
    fprintf (stderr, " -r(andlocs)=nnnn: random locations to test (default:%d)\n", TEST_NUMBER);
+   fprintf (stderr, " -s(eed)=nnn: integer, random number seed, (default:%d)\n", DEFAULT_SEED);
+   fprintf (stderr, " -t(hreads)=n: worker threads, (default: single-threaded)\n");
+   fprintf (stderr, " -stats=text|json|file.json: time and counts report\n");
    exit(1);
    }
 /* ========================================================================== */
 #include "../scullions/clFileOpt.c"
+#include "../scullions/chordSqBatch.c"
+#include "../scullions/us8Batch.c"
+#include "../scullions/rngStream.c"
+#include "../scullions/nemoStats.c"
 /* ========================================================================== */
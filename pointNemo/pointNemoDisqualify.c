@@ -16,6 +16,15 @@
    is quite important to keep the code as simple as possible: the
    disqualification verdict must be simple in order to be convincing.
 
+   The only short-cut taken is the chord squared pre-test (proxChord): the
+   points certainly farther than the claimed Nemo distance are rejected
+   without geodesic evaluation. All the others - including any that might
+   disqualify the solution - are still measured by geodesic length: from
+   the claimed Point Nemo, its terms computed once (see scullions/geoFan);
+   the lengths close to the Nemo distance, and all the reported ones, are
+   the library's own (nemo_GeodesicSzpila), so the verdict is too. The file
+   is read ahead of the points being tested, PREFETCH_POINTS at a time.
+
    Input file is assumed to be the same as the one that was used to compute
    the solution to the "longest swim problem": coordinates of the Point Nemo,
    its distance to the nearest point on land and three "proximity vertices".
@@ -30,18 +39,27 @@
 
    Coordinates of the Point Nemo (φ, λ) are in decimal degrees and Nemo
    distance is measured in meters, as the length of geodesic on ellipsoid.
+   With -stats=text (or json, file.json), the counts above and the geodesic
+   iterations histograms (of the library, and of geoFan) are also reported,
+   see scullions/nemoStats.
 
    Programmer: Hrvoje Lukatela, 2023.
  */
 
 #define PGM_DSCR "Point Nemo Disqualification"
-#define PGM_LAST_EDIT_DATE "2025.093"         /* format as from 'date +%Y.%j' */
+#define PGM_LAST_EDIT_DATE "2026.287"         /* format as from 'date +%Y.%j' */
 
 #include <nemo.h>
 #include "../scullions/scullions.h" /* include after nemo.h has been included */
+#include "../scullions/nemoStats.h"
+#include "../scullions/geoFan.h"
+#include "../scullions/fileMap.h"
+#include "../scullions/proxChord.h"
 
 #define MAX_COORD_STR   64
 #define DIST_EPSILON     0.025                              /* 25 millimetres */
+#define PREFETCH_POINTS 262144   /* input read ahead, points at a time (2 MB) */
+#define CHUNK_POINTS      4096          /* input records decoded at a time */
 
 static const char *progName;    /* for error logging by this source file only */
 void usage(const char *, const char *);
@@ -50,11 +68,15 @@ int main (int argc,
           const char *argv[],
           const char *envr[]) {
 
-   int n, nIn, nOut;
+   int n, nChunk, nIn, nOut, nGeod, iErr;
+   size_t k;
    const char *fnIn;
-   FILE *fpIn;
+   fileMap inMap;                  /* input file, as an array of Us8 records */
    nemoPtEll ptEll;           /* command linee input angular φ, λ coordinates */
    nemoPtEnr ptNemo;                                    /* claimet Point Nemo */
+   nemoPtNcs ncsNemo;                  /* as above, on near-conformal sphere */
+   geoFan fanNemo;                    /* geodesics from it, see geoFan.h */
+   double chSqNear, chSqFar;    /* chord squared limits of the Nemo distance */
    double nemoDist;                        /* claimed Nemo distance, geodesic */
    const char delimiters[] = ", ";
    char coordStr[MAX_COORD_STR + 2];
@@ -62,6 +84,8 @@ int main (int argc,
    const char *optKey, *optVal;            /* options, in -keyword=value form */
    const char *strPtNemo, *strDistance;
    nemoPtUs8 ptUs8;                     /* Coastal point from file as CDC/U64 */
+   nemoPtUs8 chunkBuf[CHUNK_POINTS];              /* .z8b records, decoded */
+   const nemoPtUs8 *chunk;            /* ...or, of .p8b, in the mapped file */
    nemoPtNcs ptNcs;                     /* as above, on near-conformal sphere */
    nemoPtEnr ptCoast;                        /* as above, as ellipsoid normal */
    nemoPtEll llCoast;                         /* as above, latitude/longitude */
@@ -73,6 +97,7 @@ int main (int argc,
    if (progName == NULL) progName = argv[0];     /* neither? Just use argv[0] */
    fprintf(stderr, "\n[%s]: %s\nsource as of: %s, Nemo Library: %.3f\n",
                    progName, PGM_DSCR, PGM_LAST_EDIT_DATE, NEMO_LIBRARY_DATE);
+   if (statsInit(progName, &argc, argv)) usage("invalid option", "-stats");
 
    strPtNemo = strDistance = NULL;                        /* mamdatory values */
    while ((optKey = clOption(argc, argv, &optVal))) {
@@ -95,13 +120,17 @@ int main (int argc,
 /* Get Nemo distance, geodesic meters on the surface */
    if (strDistance == NULL) usage("missing argument:", "Nemo distance");
    nemoDist = strtod(strDistance, NULL);
+   nemo_EnrToNcs(nemo_ElrWgs84(), &ptNemo, &ncsNemo);
+   geoFanInit(&fanNemo, &ptNemo);
+   proxChordLimits(nemoDist + DIST_EPSILON, &chSqNear, &chSqFar);
 
 /* First and only file argument: input file path/name */
    fnIn = clFileName(argc, argv);                               /* input file */
    if (fnIn == NULL) usage("Missing input file name", NULL);
-   fpIn = fopen(fnIn, "rb");                                 /* Open the file */
-   if (fpIn == NULL) errorExit(progName, __LINE__,
-                                "Can't open [%s] for reading\n", fnIn);
+   statsPhase("load");
+   iErr = p8bMapOpenBlocks(&inMap, fnIn);     /* Open the file (.z8b lazily) */
+   if (iErr) errorExit(progName, __LINE__,
+                       "Can't read [%s]: %s\n", fnIn, fileMapErrStr(iErr));
 
 /* Report what was specified on the command line. This is quite necessary when
    the error checking is minimal or non-existant (in this case done to keep
@@ -110,31 +139,45 @@ int main (int argc,
    fprintf(stderr, "Claimed Point Nemo:      %13.9f,%14.9f\n",
             NEMO_RAD2DEG * ptEll.a[NEMO_LAT], NEMO_RAD2DEG * ptEll.a[NEMO_LNG]);
    fprintf(stderr, "Claimed Nemo Distance: %13.3f\n", nemoDist);
-   nIn = nOut = 0;
-   n = fread(&ptUs8, sizeof(nemoPtUs8), 1, fpIn);
-   while (n) {
-      if (NEMO_Us8Plate(ptUs8) == 0) {    /* ignore possible ring-end markers */
-         n = fread(&ptUs8, sizeof(nemoPtUs8), 1, fpIn);
-         continue;
-         }
-      nIn++;
-      nemo_Us8ToNcs(ptUs8, &ptNcs);
-      nemo_NcsToEnr(nemo_ElrWgs84(), &ptNcs, &ptCoast);
-      g = nemo_GeodesicSzpila(nemo_ElrWgs84(), &ptNemo,  &ptCoast, NULL);
-      if (g == NEMO_DOUBLE_UNDEF) errorExit(progName, __LINE__,
-                                            "Unexpected Vincenty failure\n");
-      if (g < (nemoDist + DIST_EPSILON)) {   /* point is within Nemo distance */
-         nemo_Dcos3ToLatLong(ptCoast.dc, llCoast.a);
-
-         printf("%13.9f,%14.9f %6.3f\n", NEMO_RAD2DEG * llCoast.a[NEMO_LAT],
-                                         NEMO_RAD2DEG * llCoast.a[NEMO_LNG],
-                                         g - nemoDist);
-         nOut++;
+   statsPhase("disqualify");
+   nIn = nOut = nGeod = 0;
+   for (k = 0; k < inMap.nPts; k += nChunk) {
+      if (k % PREFETCH_POINTS == 0)
+         p8bMapPrefetch(&inMap, k + PREFETCH_POINTS, PREFETCH_POINTS);
+      nChunk = (inMap.nPts - k < CHUNK_POINTS) ? (int)(inMap.nPts - k) :
+                                                 CHUNK_POINTS;
+      chunk = p8bMapRecs(&inMap, k, nChunk, chunkBuf);
+      if (chunk == NULL) errorExit(progName, __LINE__,
+                                   "Invalid input [%s]\n", fnIn);
+      for (n = 0; n < nChunk; n++) {
+         ptUs8 = chunk[n];
+         if (NEMO_Us8Plate(ptUs8) == 0) continue; /* ignore ring-end markers */
+         nIn++;
+         nemo_Us8ToNcs(ptUs8, &ptNcs);
+         if (proxChordTest(&ncsNemo, &ptNcs, chSqNear, chSqFar) < 0) continue;
+         nGeod++;                  /* not certainly far: measure the geodesic */
+         nemo_NcsToEnr(nemo_ElrWgs84(), &ptNcs, &ptCoast);
+         g = geoFanNear(&fanNemo, &ptCoast, nemoDist + DIST_EPSILON);
+         if (g == NEMO_DOUBLE_UNDEF) errorExit(progName, __LINE__,
+                                               "Unexpected Vincenty failure\n");
+         if (g < (nemoDist + DIST_EPSILON)) {      /* within Nemo distance */
+            g = statsSzpila(&ptNemo, &ptCoast); /* reported as by the library */
+            nemo_Dcos3ToLatLong(ptCoast.dc, llCoast.a);
+
+            printf("%13.9f,%14.9f %6.3f\n", NEMO_RAD2DEG * llCoast.a[NEMO_LAT],
+                                            NEMO_RAD2DEG * llCoast.a[NEMO_LNG],
+                                            g - nemoDist);
+            nOut++;
+            }
          }
-      n = fread(&ptUs8, sizeof(nemoPtUs8), 1, fpIn);
       }
-   fclose(fpIn);
+   fileMapClose(&inMap);
    fprintf(stderr, "Points read: %8d, written: %8d\n", nIn, nOut);
+   fprintf(stderr, "Geodesic evaluations: %8d\n", nGeod);
+   statsAdd("pointsRead", nIn);
+   statsAdd("pointsWritten", nOut);
+   statsAdd("geodesicTests", nGeod);
+   statsReport();
    if (nOut > 3) return(1);
    else if (nOut < 3) return(-1);
    else return(0);
@@ -149,10 +192,15 @@ void usage(const char *mA,                  /* first message string (or NULL) */
    fprintf (stderr, " -h[elp|  to print this usage help and exit\n");
    fprintf (stderr, " -p[ointNemo]=\"φ,λ\" Point Nemo coordinates, in decimal degrees\n");
    fprintf (stderr, " -d[istance]=nnn Nemo distance, meters on planetary surface\n");
+   fprintf (stderr, " -stats=text|json|file.json phases and counters report\n");
    exit(1);
    }
 /* ========================================================================== */
 #include "../scullions/errorExit.c"
 #include "../scullions/nemoStrings.c"
 #include "../scullions/clFileOpt.c"
+#include "../scullions/fileMap.c"
+#include "../scullions/proxChord.c"
+#include "../scullions/nemoStats.c"
+#include "../scullions/geoFan.c"
 /* ========================================================================== */
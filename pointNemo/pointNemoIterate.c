@@ -45,29 +45,63 @@
   The solution is obtained by first determining the position as a centre
   of the small circle defined by proximity vertices on near-conformal sphere,
   then iterating for a more precise location that is equidistant to all three
-  proximity vertices on the ellipsoid (c.f., nudgeNemo() preamble). In this
+  proximity vertices on the ellipsoid (c.f., trilatNudge() preamble in
+  scullions/nemoTrilat.c). In this
   implementation the convergence is very slow, but the convergence criterion
   is quite high, and the process requires only a few, easy to understand
-  spherical trigonometry and vector algebra productions.
+  spherical trigonometry and vector algebra productions. With the option
+  -s(olver)=newton, each iteration is instead a Newton step: the two
+  differences of geodesics (to the first vertex, less the one to each of the
+  other two) are driven to zero by moving the point in the plane tangent to
+  the Nemo Sphere, with their derivatives (the Jacobian) found numerically.
+  It converges in a few steps, each one of nine geodesic evaluations. The
+  "nudge" method (-s(olver)=nudge, the default) is kept as the reference.
+
+  With the option -b(atch)=file, the program solves many triples of
+  proximity vertices: in the given file (or "-" for standard input), each
+  three consecutive coordinate lines are a triple - for instance, as
+  written by pointNemoProximityVertices, any number of its outputs
+  concatenated. With -t(hreads)=n, the triples are solved by n threads. For
+  each triple, in input order, a single comma separated line is written:
+  triple sequence number (1...), φ, λ (decimal degrees), mean distance
+  (meters), number of iterations, greatest difference of the three distances
+  from their mean (meters) and "ok", or "fail" if the iteration did not
+  converge or the geometry is ill-defined (then coordinates are "nan").
+
+  For instance:
+
+  ./pointNemoIterate -batch=manyVertices.pts -solver=newton -threads=8
+
+  With -stats=text (or json, file.json), the time taken by the phases, the
+  iteration counts and the histogram of geodesic iterations are reported at
+  the end (see scullions/nemoStats).
 
   Programmer: Hrvoje Lukatela, <www.lukatela.com/hrvoje> 2022.
  */
 #define PGM_DSCR "Iterative trilateration for Point Nemo"
-#define PGM_LAST_EDIT_DATE "2024.211"         /* format as from 'date +%Y.%j' */
+#define PGM_LAST_EDIT_DATE "2026.287"         /* format as from 'date +%Y.%j' */
+
+#include <pthread.h>
+#include <stdatomic.h>
 
 #include <nemo.h>
 #include "../scullions/scullions.h" /* include after nemo.h has been included */
+#include "../scullions/nemoStats.h"
+#include "../scullions/nemoTrilat.h"
+
+#define MAX_THREADS    256
 
-#define MAX_STEPS   1024                  /* the solution failed to converge? */
-#define MAX_DIFF  0.0005            /* iteration criterion: half a millimeter */
+struct triPool {                     /* batch: triples shared by all threads */
+   int nTris;
+   atomic_int nextTri;                             /* next one to be taken */
+   nemoTri *tris;
+   };
 
-void findGeoDists(nemoPtEnr *);         /* to find proximities and their mean */
-void nudgeNemo(nemoPtEnr *);          /* nudge point to a better equidistance */
+int parseVertex(char *, nemoTri *, int);
+void *solveWorker(void *);
+void reportNemo(nemoTri *);
 
-static nemoPtEnr proxVtxEl[3];   /* invar. proximity vertices ellipsoid i,j,k */
-static nemoPtNcs proxVtxNs[3];                  /* as above, on "Nemo Sphere" */
-static double glDist[3];        /* iteration-steep variant geodesic distances */
-static double glMean;                          /* as above, mean of all three */
+static int solver;                          /* TRILAT_NUDGE or TRILAT_NEWTON */
 static const char *progName;
 #define IN_LINE_LENGTH 256
 
@@ -75,16 +109,17 @@ int main (int argc,
           const char *argv[],
           const char *envr[]) {
 
-   int ipv, iDir, nIter;
-   char *pa, *token;
+   int i, ipv, nThreads;
+   long nIters, nFails;                       /* batch totals, for -stats */
+   char *pa;
    char textLine[IN_LINE_LENGTH + 2];
-   nemoPtEnr pointNemo;                                            /* φ and λ */
-   nemoPtNcs ncsAux;                 /* auxiliary spherical point coordinates */
-   nemoPtEnr elrAux;                                /* as above, on ellipsoid */
-   nemoPtEll inPtEll;                          /* proximity vertex from input */
-   double diff, d;
-   char strLat[NEMO_DEBUG_STRING_LENGTH + 2],
-        strLng[NEMO_DEBUG_STRING_LENGTH + 2];
+   const char *optKey, *optVal;            /* options, in -keyword=value form */
+   const char *fnBatch;
+   FILE *inFp;
+   struct triPool pool;
+   nemoTri tri, *t;
+   pthread_t threads[MAX_THREADS];
+   nemoPtEll inPtEll;
 /* -------------------------------------------------------------------------- */
    progName = strrchr(argv[0], '/');                                 /* POSIX */
    if (progName == NULL) progName = strrchr(argv[0], '\\');         /* MS Win */
@@ -92,69 +127,144 @@ int main (int argc,
    if (progName == NULL) progName = argv[0];     /* neither? Just use argv[0] */
    fprintf(stderr, "\n[%s]: %s\nsource as of: %s, Nemo Library: %.3f\n",
                    progName, PGM_DSCR, PGM_LAST_EDIT_DATE, NEMO_LIBRARY_DATE);
+   if (statsInit(progName, &argc, argv)) errorExit(progName, __LINE__,
+                "-stats=text, -stats=json or -stats=file.json, please\n");
 
-/* get φ and λ of three proximity vertices: */
+   solver = TRILAT_NUDGE;
+   nThreads = 0;
+   fnBatch = NULL;
+   while ((optKey = clOption(argc, argv, &optVal))) {
+      if (*optKey == 'b') fnBatch = optVal;
+      else if (*optKey == 't') nThreads = atoi(optVal);
+      else if ((*optKey == 's') && (strcmp(optVal, "newton") == 0)) solver = TRILAT_NEWTON;
+      else if ((*optKey == 's') && (strcmp(optVal, "nudge") == 0)) solver = TRILAT_NUDGE;
+      else errorExit(progName, __LINE__, "invalid option [%s=%s]\n", optKey, optVal);
+      }
+   if ((nThreads < 0) || (nThreads > MAX_THREADS))
+      errorExit(progName, __LINE__, "invalid thread count %d\n", nThreads);
+   if (nThreads == 1) nThreads = 0;          /* one worker is no worker */
 
-   ipv = 0;
-   pa = fgets(textLine, IN_LINE_LENGTH, stdin);
-   while (ipv < 3) {
-      if (pa == NULL) errorExit(progName, __LINE__, "failed to read 3 proximity vertices\n");
-      if ((*pa == '#') || (*pa == '\n')) {         /*  comment or blank line? */
-         pa = fgets(textLine, IN_LINE_LENGTH, stdin);              /* skip it */
-         continue;
-         }
-      token = strtok(textLine, " ,");
-      inPtEll.a[NEMO_LAT] = NEMO_DEG2RAD * atof(token);
-      token = strtok(NULL, " ,");
-      inPtEll.a[NEMO_LNG] = NEMO_DEG2RAD * atof(token);
-      nemo_LatLongToDcos3(inPtEll.a, proxVtxEl[ipv].dc);    /* to ell. normal */
-      nemo_EnrToNcs(nemo_ElrWgs84(), proxVtxEl + ipv, proxVtxNs + ipv);
-      ipv++;
+   if (fnBatch == NULL) {         /* one triple, from stdin, human readable */
+/* get φ and λ of three proximity vertices: */
+      ipv = 0;
       pa = fgets(textLine, IN_LINE_LENGTH, stdin);
+      while (ipv < 3) {
+         if (pa == NULL) errorExit(progName, __LINE__, "failed to read 3 proximity vertices\n");
+         if (parseVertex(textLine, &tri, ipv)) ipv++;  /* comment or blank? */
+         pa = fgets(textLine, IN_LINE_LENGTH, stdin);
+         }
+      for (ipv = 0; ipv < 3; ipv++) {
+         nemo_NcsToEll(nemo_ElrWgs84(), tri.proxVtxNs + ipv, &inPtEll);
+         fprintf(stderr, "%13.9f, %14.9f\n",
+          NEMO_RAD2DEG * inPtEll.a[0], NEMO_RAD2DEG * inPtEll.a[1]);
+         }
+      statsPhase("solve");
+      i = trilatSolve(&tri, solver);
+      statsAdd("iterations", tri.nIter);
+      if (i == TRILAT_GEOMETRY) errorExit(progName, __LINE__,
+                             "ill-defined geometry of proximity vertices\n");
+      if (i == TRILAT_NO_CONVERGENCE) errorExit(progName, __LINE__,
+       "failed to converge in %d iterations\n", TRILAT_MAX_STEPS);
+      reportNemo(&tri);
+      statsReport();
+      return(0);
       }
 
- for (ipv = 0; ipv < 3; ipv++) {
-      nemo_NcsToEll(nemo_ElrWgs84(), proxVtxNs + ipv, &inPtEll);
-      fprintf(stderr, "%13.9f, %14.9f\n",
-       NEMO_RAD2DEG * inPtEll.a[0], NEMO_RAD2DEG * inPtEll.a[1]);
-      }
-/* Prepare the iteration process. First, initialize Point Nemo as the
-   circumcentre of proximity vertices on the Nemo Sphere.
- */
-   iDir = nemo_SphereCircumcenter(proxVtxNs + 0, proxVtxNs + 1, proxVtxNs + 2,
-                                  &ncsAux);
-/* fprintf(stderr, "direction indicator: %d\n", iDir); */
-   if (iDir == -1) {              /* must reverse the order of given vertices */
-      ncsAux = proxVtxNs[0]; proxVtxNs[0] = proxVtxNs[2]; proxVtxNs[2] = ncsAux;
-      elrAux = proxVtxEl[0]; proxVtxEl[0] = proxVtxEl[2]; proxVtxEl[2] = elrAux;
-      iDir = nemo_SphereCircumcenter(proxVtxNs + 0,
-                                     proxVtxNs + 1, proxVtxNs + 2, &ncsAux);
+/* Batch: read all the triples... */
+   statsPhase("read");
+   inFp = strcmp(fnBatch, "-") ? fopen(fnBatch, "r") : stdin;
+   if (inFp == NULL) errorExit(progName, __LINE__, "Can't open [%s]\n", fnBatch);
+   pool.nTris = ipv = 0;
+   pool.tris = NULL;
+   while (fgets(textLine, IN_LINE_LENGTH, inFp)) {
+      if (ipv == 0) {
+         t = realloc(pool.tris, (pool.nTris + 1) * sizeof(nemoTri));
+         if (t == NULL) errorExit(progName, __LINE__, "No memory for triples?\n");
+         pool.tris = t;
+         }
+      if (parseVertex(textLine, pool.tris + pool.nTris, ipv) && (++ipv == 3)) {
+         pool.nTris++;
+         ipv = 0;
+         }
       }
-   if (iDir != 1) errorExit(progName, __LINE__,
-                            "ill-defined geometry of proximity vertices\n");
-
-/* transfer the preliminary location back to the ellipsoid: */
-   nemo_NcsToEnr(nemo_ElrWgs84(), &ncsAux, &pointNemo);
-   findGeoDists(&pointNemo);          /* preliminary geodesics and their mean */
-
-   diff = NEMO_DOUBLE_HUGE;               /* initialize convergence criterion */
-   nIter = 0;
-   while (diff > MAX_DIFF) {                               /* start iteration */
-      if (nIter++ > MAX_STEPS) errorExit(progName, __LINE__,
-       "failed to converge in %d iterations\n", MAX_STEPS);
-      nudgeNemo(&pointNemo);
-      diff = 0.0;
-      for (ipv = 0; ipv < 3; ipv++) {
-         d = fabs(glDist[ipv] - glMean);
-         if (d > diff) diff = d;
+   if (inFp != stdin) fclose(inFp);
+   if (ipv) fprintf(stderr, "incomplete last triple ignored\n");
+   fprintf(stderr, "triples: %d, solver: %s, threads: %d\n", pool.nTris,
+                   (solver == TRILAT_NEWTON) ? "newton" : "nudge", nThreads);
+
+/* ...solve them, in any order... */
+   statsPhase("solve");
+   atomic_init(&pool.nextTri, 0);
+   if (nThreads) {
+      for (i = 0; i < nThreads; i++) {
+         if (pthread_create(threads + i, NULL, solveWorker, &pool))
+            errorExit(progName, __LINE__, "Can't create thread %d\n", i);
          }
-/*    fprintf(stderr, "Iter: %2d, max diff: %.3f (%.3f %.3f %.3f)\n",
-       nIter, diff, glDist[0] - glMean, glDist[1] - glMean, glDist[2] - glMean); */
+      for (i = 0; i < nThreads; i++) pthread_join(threads[i], NULL);
       }
+   else solveWorker(&pool);
 
+/* ...and write the solutions in input order */
+   statsPhase("write");
+   nIters = nFails = 0;
+   for (i = 0; i < pool.nTris; i++) {
+      t = pool.tris + i;
+      nIters += t->nIter;
+      nFails += !t->isSolved;
+      if (t->isSolved) {
+         nemo_Dcos3ToLatLong(t->pointNemo.dc, inPtEll.a);
+         printf("%d,%.9f,%.9f,%.4f,%d,%.6f,ok\n", i + 1,
+                NEMO_RAD2DEG * inPtEll.a[0], NEMO_RAD2DEG * inPtEll.a[1],
+                t->glMean, t->nIter, t->diff);
+         }
+      else printf("%d,nan,nan,nan,%d,nan,fail\n", i + 1, t->nIter);
+      }
+   statsAdd("triples", pool.nTris);
+   statsAdd("iterations", nIters);
+   statsAdd("failed", nFails);
+   free(pool.tris);
+   statsReport();
+   return(0);
+   }
+/* ========================================================================== */
+/* Parse φ and λ (the first two items) of a text line into proximity vertex
+   ipv of the triple. Returns 1 if it was parsed, 0 for comment or blank line.
+ */
+int parseVertex(char *textLine, nemoTri *tri, int ipv) {
+   char *token;
+   nemoPtEll inPtEll;                          /* proximity vertex from input */
+   nemoPtEnr vtx;
+/* -------------------------------------------------------------------------- */
+   if ((*textLine == '#') || (*textLine == '\n')) return(0);
+   token = strtok(textLine, " ,");
+   if ((token == NULL) || (*token == '\n')) return(0);
+   inPtEll.a[NEMO_LAT] = NEMO_DEG2RAD * atof(token);
+   token = strtok(NULL, " ,");
+   inPtEll.a[NEMO_LNG] = token ? NEMO_DEG2RAD * atof(token) : 0.0;
+   nemo_LatLongToDcos3(inPtEll.a, vtx.dc);                /* to ell. normal */
+   trilatVertex(tri, ipv, &vtx);
+   return(1);
+   }
+/* ========================================================================== */
+/* Batch worker thread (or the main one): take triples until none are left */
+void *solveWorker(void *arg) {
+   struct triPool *pool = arg;
+   int n;
+/* -------------------------------------------------------------------------- */
+   while ((n = atomic_fetch_add(&pool->nextTri, 1)) < pool->nTris)
+      trilatSolve(pool->tris + n, solver);
+   return(NULL);
+   }
+/* ========================================================================== */
 /* Report Point Nemo coordinates and mean geodesic length */
-   fprintf(stdout, "# %s iterations: %d\n", progName, nIter);
-   nemo_Dcos3ToLatLong(pointNemo.dc, inPtEll.a);
+void reportNemo(nemoTri *tri) {
+   int ipv;
+   nemoPtEll inPtEll;
+   char strLat[NEMO_DEBUG_STRING_LENGTH + 2],
+        strLng[NEMO_DEBUG_STRING_LENGTH + 2];
+/* -------------------------------------------------------------------------- */
+   fprintf(stdout, "# %s iterations: %d\n", progName, tri->nIter);
+   nemo_Dcos3ToLatLong(tri->pointNemo.dc, inPtEll.a);
    strncpy(strLat, nemo_StrSexagesimal(NEMO_RAD2DEG * inPtEll.a[0]),
            NEMO_DEBUG_STRING_LENGTH);
    strncpy(strLng, nemo_StrSexagesimal(NEMO_RAD2DEG * inPtEll.a[1]),
@@ -163,84 +273,26 @@ int main (int argc,
    printf("# Point Nemo φ, λ and distance:\n");
    printf("%13.9f, %14.9f, (%s, %s), %12.3f\n",
            NEMO_RAD2DEG * inPtEll.a[0], NEMO_RAD2DEG * inPtEll.a[1],
-           strLat, strLng, glMean);
+           strLat, strLng, tri->glMean);
 
 /* Report Vertices and length of geodesic to each */
    printf("# Proximity Vertices  φ, λ and distance:\n");
    for (ipv = 0; ipv < 3; ipv++) {
-      nemo_Dcos3ToLatLong(proxVtxEl[ipv].dc, inPtEll.a);
+      nemo_Dcos3ToLatLong(tri->proxVtxEl[ipv].dc, inPtEll.a);
       strncpy(strLat, nemo_StrSexagesimal(NEMO_RAD2DEG * inPtEll.a[0]),
               NEMO_DEBUG_STRING_LENGTH);
       strncpy(strLng, nemo_StrSexagesimal(NEMO_RAD2DEG * inPtEll.a[1]),
               NEMO_DEBUG_STRING_LENGTH);
       printf("%13.9f, %14.9f, (%s, %s), %12.3f\n",
               NEMO_RAD2DEG * inPtEll.a[0], NEMO_RAD2DEG * inPtEll.a[1],
-              strLat, strLng, glDist[ipv]);
-      }
-
-   return(0);
-   }
-/* ========================================================================== */
-/* Populate the array of three geodesic distances and their mean value */
-void findGeoDists(nemoPtEnr *ptNemo) {
-   int ipv;
-   for (ipv = 0; ipv < 3; ipv++) {
-      glDist[ipv] = nemo_GeodesicSzpila(nemo_ElrWgs84(), ptNemo, proxVtxEl + ipv,
-                                        NULL);
-      }
-   glMean = (glDist[0] + glDist[1] + glDist[2]) / 3.0;
-   return;
-   }
-/* ========================================================================== */
-/* "Nudge" the last best position of Point Nemo toward or away from that
-   distant proximity vertex, from which the difference between the geodesic
-   to it and the mean of all three geodesics is the greatest.
-
-   The process is carried out on Nemo Sphere, where vector algebra productions
-   are much simpler than they would be on an ellipsoid of rotation. Once
-   the process is completed, the position is returned to the ellipsoid: the
-   natural data domain of the Point Nemo and its three proximity vertices.
- */
-void nudgeNemo(nemoPtEnr *ptNemo) {                      /* given and updated */
-
-   int ipv;                             /* outer, proximity vertex loop index */
-   int idc;                             /* inner, direction cosine loop index */
-   int imx;              /* proximity vertex with maximum distance difference */
-   double d, diff;
-   nemoPtNcs ncsAux;                 /* auxiliary spherical point coordinates */
-   double localScale;
-   double nudge;              /* amount of nudge, in meters on planet surface */
-   double dirToPrxVx[3];                     /* direction to proximity vertex */
-/* -------------------------------------------------------------------------- */
-/* fprintf(stderr, "%s ItStep\n", nemo_StrEnrCoords(ptNemo)); */
-   nemo_EnrToNcs(nemo_ElrWgs84(), ptNemo, &ncsAux);   /* Point Nemo on sphere */
-   localScale = nemo_NcsElrScale(nemo_ElrWgs84(), &ncsAux);
-   diff = 0;     /* first, find the vertex with greatest difference from mean */
-   for (ipv = 0; ipv < 3; ipv++) {    /* do for each distant proximity vertex */
-      d = glDist[ipv] - glMean;
-      if (fabs(d) > fabs(diff)) {
-         diff = d;
-         nudge = d;                                /* record nudge difference */
-         imx = ipv;         /* record index of vertex with maximum difference */
-         }
+              strLat, strLng, tri->glDist[ipv]);
       }
-/* fprintf(stderr, "nudge from %d by %6.3f\n", imx, nudge); */
-/* Find vector from Point Nemo towards the vertex it will be nudged to or from */
-   for (idc = 0; idc < 3; idc++) dirToPrxVx[idc] = proxVtxNs[imx].dc[idc] - ncsAux.dc[idc];
-   nemo_NormalizeV3(dirToPrxVx);
-
-/* Nudge Nemo along that vector, by ~nudge~, scaled down to unit sphere */
-   for (idc = 0; idc < 3; idc++) {
-      ncsAux.dc[idc] = ncsAux.dc[idc] + (dirToPrxVx[idc] * nudge / localScale);
-      }
-   nemo_NormalizeV3(ncsAux.dc);
-
-   nemo_NcsToEnr(nemo_ElrWgs84(), &ncsAux, ptNemo);   /* back to ellipsoid... */
-   findGeoDists(ptNemo);  /* ...and update ellipsoid geodesics and their mean */
-
    return;
    }
 /* ========================================================================== */
 #include "../scullions/errorExit.c"
 #include "../scullions/nemoStrings.c"
+#include "../scullions/clFileOpt.c"
+#include "../scullions/nemoStats.c"
+#include "../scullions/nemoTrilat.c"
 /* ========================================================================== */
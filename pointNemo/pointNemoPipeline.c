@@ -0,0 +1,468 @@
+/* pointNemoPipeline.c: Find the Point Nemo - all the steps of the solution
+   in a single program, with the coastline read (memory-mapped) once, and
+   all the intermediate results passed on in memory, with full precision:
+
+   1) Extraction (as r8bToP8bSelect): the coastline vertices within a given
+      geodesic distance of the search centre. With no -e(xtract) option,
+      all the vertices of the input file are used.
+   2) Approximate Point Nemo (as pointNemoProximityVertices, phase 1): the
+      random point farthest from its nearest vertex (scullions/nemoSearch).
+   3) Three proximity vertices, separated by at least 5 km, nearest to it.
+   4) Trilateration (as pointNemoIterate): the point at equal geodesic
+      distance from the three vertices (scullions/nemoTrilat).
+   5) Disqualification (as pointNemoDisqualify): any input vertex, not only
+      an extracted one, closer to the solution than the Nemo distance.
+
+   The input file is indexed (scullions/capIndex) by the bounding caps of its
+   blocks of points, in a "side" file given by -i(ndex) option (created if it
+   does not exist, and then used by r8bToP8bSelect just the same) or, with no
+   such option, in memory. Steps 1 and 5 use the index to skip the blocks of
+   vertices that are all too far from the search centre or the solution.
+   Their geodesics are from a fixed origin (scullions/geoFan); those close
+   to the criterion, and the reported ones, are all the library's own.
+
+   The results are written to the standard output: the approximate Point
+   Nemo, the proximity vertices, the solution and the vertices within its
+   distance, as written by the programs of individual steps. The duration of
+   each step is reported at the end (and, with -stats=text, json or
+   file.json, also the counters and the geodesic iterations histograms, of
+   the library and of geoFan, see scullions/nemoStats). The program exit
+   status is that of pointNemoDisqualify: 0 if exactly three vertices are
+   within the Nemo distance, 1 if more, -1 if fewer are.
+
+   For instance:
+
+   ./pointNemoPipeline osmPacific.p8b -center="-49.0, -123.4" -r=1e6 -p=8
+ */
+
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define PGM_DSCR "Point Nemo, from coastline to disqualification test"
+#define PGM_LAST_EDIT_DATE "2026.287"         /* format as from 'date +%Y.%j' */
+
+#include <nemo.h>
+#include "../scullions/scullions.h" /* include after nemo.h has been included */
+#include "../scullions/nemoStats.h"
+#include "../scullions/geoFan.h"
+#include "../scullions/fileMap.h"
+#include "../scullions/proxChord.h"
+#include "../scullions/capIndex.h"
+#include "../scullions/chordSqBatch.h"
+#include "../scullions/rngStream.h"
+#include "../scullions/ncsKdTree.h"
+#include "../scullions/nemoSearch.h"
+#include "../scullions/nemoTrilat.h"
+
+#define BLOCK_POINTS                      1024      /* as in r8bToP8bSelect */
+#define MAX_COORD_STR                       64
+#define TEST_COUNT                     2000000           /* what's a million? */
+#define PROX_VRTX_SEPARATION              5000             /* five kilometers */
+#define DEFAULT_SEED                      2025
+#define MAX_THREADS                        256
+#define DIST_EPSILON                     0.025              /* 25 millimetres */
+#define N_STAGES                             7
+
+struct exPool {                 /* extraction, blocks shared by the threads */
+   int nBlocks;
+   atomic_int nextBlock;                           /* next one to be taken */
+   atomic_int nGeod;              /* points classified by geodesic length */
+   atomic_int nSkipped;                     /* blocks skipped by the index */
+   };
+
+void usage(const char *, const char *);               /* program command-line */
+static void *extractWorker(void *);
+static int disqualify(const nemoPtEnr *, double);
+static const nemoPtUs8 *inBlock(int, nemoPtUs8 *, int *);
+static void runWorkers(void *(*)(void *), void *, int);
+
+static fileMap inMap;                         /* input, coastline, mapped */
+static capIndex inIndex;                     /* as above, spatial index */
+static unsigned char *isIn;             /* 1: input location is extracted */
+static nemoPtEnr srchEnr;                /* search centre, ellipsoid normal */
+static nemoPtNcs srchNcs;                   /* as above, near-conformal sphere */
+static geoFan srchFan;                      /* geodesics from the search centre */
+static double exRadGeodesic;         /* extraction radius, geodesic, or 0.0 */
+static double chSqNear, chSqFar;             /* chord squared inclusion/exclusion */
+static const char *progName;    /* for error logging by this source file only */
+static const char *stageName[N_STAGES] = {"input and index", "extraction",
+   "vertex tree", "random points", "proximity vertices", "trilateration",
+   "disqualification"};
+/* ========================================================================== */
+int main (int argc,
+          const char *argv[],
+          const char *envr[]) {
+
+   int i, j, k, n, iErr, nOut, solver;
+   const unsigned char *inRecs;             /* isIn flags, of an input block */
+   const nemoPtUs8 *blkRecs;                    /* ...and its records */
+   nemoPtUs8 blkBuf[BLOCK_POINTS];              /* ...if decoded (.z8b) */
+   int testCount;
+   int nThreads;                           /* number of worker threads, or 0 */
+   uint64_t seed;                       /* of all random number streams */
+   const char *optKey, *optVal;            /* options, in -keyword=value form */
+   const char *strCenter, *strRadius, *strExtract, *fnIndex;
+   const char *fnIn;                          /* input binary file, coastline */
+   char coordStr[MAX_COORD_STR + 2];    /* text parsing, as simple as it gets */
+   const char delimiters[] = ", ";
+   char *token;
+   nemoPtEll ptEll;            /* command line input angular φ, λ coordinates */
+   double srgnArc;                      /* Search radius, as NCS arc (approx) */
+   double proxVrtxSeparation;                 /* vertex coincidence criterion */
+   struct exPool exPool;
+   nemoPtNcs *cvx;                              /* extracted coastline vertices */
+   int nCstVtx;
+   kdTree cvxTree;                              /* as above, as spatial index */
+   nemoSearch search;                    /* Monte Carlo search, in the region */
+   int proxId[3];                          /* proximity vertex indices... */
+   double proxVrtxChSq[3];             /* and chord squared distances to them */
+   nemoPtEnr vtxEnr;
+   nemoTri tri;                                 /* trilateration problem */
+/* -------------------------------------------------------------------------- */
+   progName = strrchr(argv[0], '/');                                 /* POSIX */
+   if (progName == NULL) progName = strrchr(argv[0], '\\');         /* MS Win */
+   if (progName) progName += 1;             /* skip found last path separator */
+   if (progName == NULL) progName = argv[0];     /* neither? Just use argv[0] */
+   fprintf(stderr, "\n[%s]: %s\nsource as of: %s, Nemo Library: %.3f\n",
+                   progName, PGM_DSCR, PGM_LAST_EDIT_DATE, NEMO_LIBRARY_DATE);
+   if (statsInit(progName, &argc, argv)) usage("invalid option", "-stats");
+
+   if (argc < 2) usage("Missing command line argument(s)", NULL);
+   testCount = TEST_COUNT;                                         /* default */
+   seed = DEFAULT_SEED;
+   nThreads = 0;                               /* default: single-threaded */
+   solver = TRILAT_NEWTON;
+   strCenter = strRadius = strExtract = fnIndex = NULL;
+   while ((optKey = clOption(argc, argv, &optVal))) {
+      if (*optKey == 'h') usage(NULL, NULL);
+      else if (*optKey == 'c') strCenter = optVal;
+      else if (*optKey == 'r') strRadius = optVal;
+      else if (*optKey == 'e') strExtract = optVal;
+      else if (*optKey == 'i') fnIndex = optVal;
+      else if (*optKey == 't') testCount = atoi(optVal);
+      else if (*optKey == 's') seed = strtoull(optVal, NULL, 10);
+      else if (*optKey == 'p') nThreads = atoi(optVal);
+      else if ((*optKey == 'm') && (strcmp(optVal, "nudge") == 0)) solver = TRILAT_NUDGE;
+      else if ((*optKey == 'm') && (strcmp(optVal, "newton") == 0)) solver = TRILAT_NEWTON;
+      else usage("unrecognized option", optKey);
+      }
+   if ((nThreads < 0) || (nThreads > MAX_THREADS)) usage("invalid option",
+                                                        "parallel (0...256)");
+   if (nThreads == 1) nThreads = 0;          /* one worker is no worker */
+   if (testCount < 1) usage("invalid option", "testcount");
+   fnIn = clFileName(argc, argv);                      /* required input file */
+   if (fnIn == NULL) usage("Missing input file name", NULL);
+
+/* Search centre coordinates, and radius */
+   if (strCenter == NULL) usage("Missing parameter - center coordinates", NULL);
+   strncpy(coordStr, strCenter, MAX_COORD_STR);
+   token = strtok(coordStr, delimiters);
+   ptEll.a[NEMO_LAT] = NEMO_DEG2RAD * strtod(token, NULL);
+   token = strtok(NULL, delimiters);
+   ptEll.a[NEMO_LNG] = token ? NEMO_DEG2RAD * strtod(token, NULL) : 0.0;
+   nemo_LatLongToDcos3(ptEll.a, srchEnr.dc);    /* to ellipsoid normal... */
+   nemo_EnrToNcs(nemo_ElrWgs84(), &srchEnr, &srchNcs);    /* ...and NC sphere */
+   geoFanInit(&srchFan, &srchEnr);
+   if (strRadius == NULL) usage("Missing parameter - search radius", NULL);
+   srgnArc = strtod(strRadius, NULL) / NEMO_EARTH_RADIUS;   /* on unit sphere */
+   exRadGeodesic = strExtract ? strtod(strExtract, NULL) : 0.0;
+   proxVrtxSeparation = PROX_VRTX_SEPARATION / NEMO_EARTH_RADIUS; /* arc on NCS */
+   proxVrtxSeparation = nemo_ArcToChordApprox(proxVrtxSeparation); /* chord */
+   proxVrtxSeparation = proxVrtxSeparation * proxVrtxSeparation;
+
+   fprintf(stderr, "Input file: %s\n", fnIn);
+   fprintf(stderr, "Search centre: %s\n", nemo_StrNcsCoords(&srchNcs));
+   fprintf(stderr, "Search region radius: %.0f\n", srgnArc * NEMO_EARTH_RADIUS);
+   if (strExtract) fprintf(stderr, "Extraction radius: %.0f\n", exRadGeodesic);
+   fprintf(stderr, "Random number seed: %llu\n", (unsigned long long)seed);
+   if (nThreads) fprintf(stderr, "Worker threads: %d\n", nThreads);
+
+/* Stage 0: map the input, and index it (or read the index) */
+   statsPhase(stageName[0]);
+   iErr = p8bMapOpenBlocks(&inMap, fnIn);             /* .z8b: not decoded */
+   if (iErr) errorExit(progName, __LINE__,
+                       "Can't read [%s]: %s\n", fnIn, fileMapErrStr(iErr));
+   iErr = fnIndex ? capIndexLoad(&inIndex, fnIndex) : CAP_INDEX_IO;
+   if (iErr == CAP_INDEX_IO) {                      /* not there (yet) */
+      iErr = capIndexBuild(&inIndex, &inMap, BLOCK_POINTS);
+      if (iErr == CAP_INDEX_FORMAT)                /* a .z8b block's data */
+         errorExit(progName, __LINE__, "Invalid input [%s]\n", fnIn);
+      if ((iErr == 0) && fnIndex) iErr = capIndexSave(&inIndex, fnIndex);
+      if (iErr) errorExit(progName, __LINE__, "Can't create index (%d)\n", iErr);
+      if (fnIndex) fprintf(stderr, "Index created: [%s]\n", fnIndex);
+      }
+   else if (iErr == 0) {
+      if (exRadGeodesic > 0.0) fileMapRandom(&inMap); /* the index's blocks */
+      iErr = capIndexMatch(&inIndex, &inMap, BLOCK_POINTS);
+      if (iErr) errorExit(progName, __LINE__,
+              "Index [%s] is not one of [%s]; delete it?\n", fnIndex, fnIn);
+      fprintf(stderr, "Index from: [%s]\n", fnIndex);
+      }
+   else errorExit(progName, __LINE__, "Can't read index [%s] (%d)\n", fnIndex, iErr);
+   fprintf(stderr, "Input file has: %d records\n", (int)inMap.nPts);
+
+/* Stage 1: extraction, by blocks, into the coastline vertex array */
+   statsPhase(stageName[1]);
+   isIn = calloc(inMap.nPts ? inMap.nPts : 1, 1);
+   if (isIn == NULL) errorExit(progName, __LINE__, "No memory for vertices?\n");
+   if (exRadGeodesic > 0.0) proxChordLimits(exRadGeodesic, &chSqNear, &chSqFar);
+   exPool.nBlocks = inIndex.nBlocks;
+   atomic_init(&exPool.nextBlock, 0);
+   atomic_init(&exPool.nGeod, 0);
+   atomic_init(&exPool.nSkipped, 0);
+   runWorkers(extractWorker, &exPool, nThreads);
+   nCstVtx = 0;
+   for (n = 0; n < (int)inMap.nPts; n++) nCstVtx += isIn[n];
+   cvx = malloc((nCstVtx ? nCstVtx : 1) * sizeof(nemoPtNcs));
+   if (cvx == NULL) errorExit(progName, __LINE__, "No memory for vertices?\n");
+   for (i = j = 0; j < exPool.nBlocks; j++) {        /* in input file order */
+      inRecs = isIn + (size_t)j * BLOCK_POINTS;          /* (flags: 1 or 0) */
+      n = (inMap.nPts - (size_t)j * BLOCK_POINTS < BLOCK_POINTS) ?
+          (int)(inMap.nPts - (size_t)j * BLOCK_POINTS) : BLOCK_POINTS;
+      if (memchr(inRecs, 1, n) == NULL) continue;      /* none: not read */
+      blkRecs = inBlock(j, blkBuf, &n);
+      for (k = 0; k < n; k++) {
+         if (inRecs[k]) nemo_Us8ToNcs(blkRecs[k], cvx + i++);
+         }
+      }
+   free(isIn);
+   if (exRadGeodesic > 0.0) fprintf(stderr,
+        "Extracted: %d, geodesic tests: %d, blocks skipped by index: %d of %d\n",
+        nCstVtx, atomic_load(&exPool.nGeod), atomic_load(&exPool.nSkipped),
+        exPool.nBlocks);
+   fprintf(stderr, "Loaded search array of %d coastline vertices\n", nCstVtx);
+   statsAdd("vertices", nCstVtx);
+   statsAdd("geodesicTests", atomic_load(&exPool.nGeod));
+   statsAdd("blocks", exPool.nBlocks);
+   statsAdd("blocksSkipped", atomic_load(&exPool.nSkipped));
+   if (nCstVtx < 3) errorExit(progName, __LINE__, "Too few coastline vertices\n");
+
+/* Stage 2: the vertices, as a spatial index */
+   statsPhase(stageName[2]);
+   if (kdtBuild(&cvxTree, cvx, nCstVtx)) errorExit(progName, __LINE__,
+                                              "No memory for vertex index?\n");
+
+/* Stage 3: approximate Point Nemo from random points */
+   statsPhase(stageName[3]);
+   fprintf(stderr, "Testing %d random points\n", testCount);
+   nemoSearchInit(&search, &cvxTree, &srchNcs, srgnArc);
+   iErr = nemoSearchRun(&search, testCount, seed, nThreads);
+   if (iErr == NEMO_SEARCH_NONE) errorExit(progName, __LINE__,
+                        "Unexpected condition: no far point found?\n");
+   if (iErr) errorExit(progName, __LINE__, "Random point tests failed (%d)\n", iErr);
+   fprintf(stderr, "Random points inside/outside of search region: %d/%d\n",
+                   search.nIn, search.nOut);
+   statsAdd("pointsIn", search.nIn);
+   statsAdd("pointsOut", search.nOut);
+   fprintf(stderr, "Approximate Point Nemo  %s\n", nemo_StrNcsCoords(&search.ptNemo));
+
+/* Stage 4: three separated proximity vertices */
+   statsPhase(stageName[4]);
+   n = kdtNearestSep(&cvxTree, search.ptNemo.dc, 3, proxVrtxSeparation,
+                     proxId, proxVrtxChSq);
+   if (n < 3) errorExit(progName, __LINE__,
+                        "Only %d separate proximity vertices found\n", n);
+   nemo_NcsToEll(nemo_ElrWgs84(), &search.ptNemo, &ptEll);
+   printf("# approximate point Nemo φ, λ: %13.9f,%14.9f\n",
+          NEMO_RAD2DEG * ptEll.a[0], NEMO_RAD2DEG * ptEll.a[1]);
+   printf("# three proximity vertices and distances to them:\n");
+   for (j = 0; j < 3; j++) {
+      nemo_NcsToEnr(nemo_ElrWgs84(), cvx + proxId[j], &vtxEnr);
+      trilatVertex(&tri, j, &vtxEnr);              /* full precision, as is */
+      nemo_Dcos3ToLatLong(vtxEnr.dc, ptEll.a);
+      printf("%13.9f,%14.9f, %s\n",
+             NEMO_RAD2DEG * ptEll.a[NEMO_LAT], NEMO_RAD2DEG * ptEll.a[NEMO_LNG],
+             nemo_StrChSqDist(proxVrtxChSq[j]));
+      }
+
+/* Stage 5: trilateration */
+   statsPhase(stageName[5]);
+   iErr = trilatSolve(&tri, solver);
+   if (iErr == TRILAT_GEOMETRY) errorExit(progName, __LINE__,
+                             "ill-defined geometry of proximity vertices\n");
+   if (iErr) errorExit(progName, __LINE__,
+       "failed to converge in %d iterations\n", TRILAT_MAX_STEPS);
+   nemo_Dcos3ToLatLong(tri.pointNemo.dc, ptEll.a);
+   printf("# Point Nemo φ, λ and distance (%s iterations: %d):\n",
+          (solver == TRILAT_NEWTON) ? "newton" : "nudge", tri.nIter);
+   printf("%13.9f, %14.9f, %12.3f\n", NEMO_RAD2DEG * ptEll.a[0],
+          NEMO_RAD2DEG * ptEll.a[1], tri.glMean);
+   statsAdd("iterations", tri.nIter);
+
+/* Stage 6: disqualification, against all of the input */
+   statsPhase(stageName[6]);
+   printf("# coast vertices within Nemo distance, and difference:\n");
+   nOut = disqualify(&tri.pointNemo, tri.glMean);
+   fprintf(stderr, "Vertices within Nemo distance: %d, solution %s\n", nOut,
+                   (nOut == 3) ? "is not disqualified" : "IS DISQUALIFIED");
+   statsAdd("withinNemoDistance", nOut);
+
+   statsPhase(NULL);                 /* (the stages are the stats phases) */
+   for (j = 0; j < N_STAGES; j++) {
+      fprintf(stderr, "Stage %d, %-18s %8.3f seconds (wall clock)\n", j,
+                      stageName[j], statsPhaseSeconds(stageName[j]));
+      }
+   free(cvx);
+   kdtFree(&cvxTree);
+   capIndexFree(&inIndex);
+   fileMapClose(&inMap);
+   statsReport();
+   if (nOut > 3) return(1);
+   else if (nOut < 3) return(-1);
+   else return(0);
+   }
+/* ========================================================================== */
+/* Worker thread (or the main one): take blocks of input, and mark those of
+   its locations that are within the extraction radius - or all of them, if
+   there is none. Blocks certainly too far are skipped, by the index.
+ */
+static void *extractWorker(void *arg) {
+   struct exPool *pool = arg;
+   int b, j, n, isClose, nGeod;
+   unsigned char *blkIn;                         /* isIn flags of the block */
+   const nemoPtUs8 *recs;                             /* ...and its records */
+   nemoPtUs8 buf[BLOCK_POINTS];                      /* ...if decoded (.z8b) */
+   nemoPtNcs ptNcs;
+   nemoPtEnr ptEnr;
+/* -------------------------------------------------------------------------- */
+   while ((b = atomic_fetch_add(&pool->nextBlock, 1)) < pool->nBlocks) {
+      if ((exRadGeodesic > 0.0) &&
+          !capIndexHit(&inIndex, b, srchNcs.dc, chSqFar)) {
+         atomic_fetch_add(&pool->nSkipped, 1);
+         continue;
+         }
+      recs = inBlock(b, buf, &n);
+      blkIn = isIn + (size_t)b * BLOCK_POINTS;
+      for (nGeod = j = 0; j < n; j++) {
+         if (NEMO_Us8Plate(recs[j]) == 0) continue;      /* ring-end marker */
+         if (exRadGeodesic <= 0.0) {
+            blkIn[j] = 1;
+            continue;
+            }
+         nemo_Us8ToNcs(recs[j], &ptNcs);
+         isClose = proxChordTest(&srchNcs, &ptNcs, chSqNear, chSqFar);
+         if (isClose == 0) {            /* uncertain: measure the geodesic */
+            nemo_NcsToEnr(nemo_ElrWgs84(), &ptNcs, &ptEnr);
+            isClose = (geoFanNear(&srchFan, &ptEnr, exRadGeodesic) <=
+                       exRadGeodesic) ? 1 : -1;
+            nGeod++;
+            }
+         if (isClose > 0) blkIn[j] = 1;
+         }
+      atomic_fetch_add(&pool->nGeod, nGeod);
+      }
+   return(NULL);
+   }
+/* ========================================================================== */
+/* Write the input vertices closer to the solution than the Nemo distance (as
+   pointNemoDisqualify), and return their number. Only the blocks of the
+   index that can have such vertices are read.
+ */
+static int disqualify(const nemoPtEnr *ptNemo, double nemoDist) {
+   int b, j, n, nOut;
+   const nemoPtUs8 *recs;                           /* records of a block */
+   nemoPtUs8 buf[BLOCK_POINTS];                      /* ...if decoded (.z8b) */
+   double g, dqNear, dqFar;
+   nemoPtNcs ncsNemo, ptNcs;
+   nemoPtEnr ptCoast;
+   nemoPtEll llCoast;
+   geoFan fanNemo;
+/* -------------------------------------------------------------------------- */
+   nemo_EnrToNcs(nemo_ElrWgs84(), ptNemo, &ncsNemo);
+   geoFanInit(&fanNemo, ptNemo);
+   proxChordLimits(nemoDist + DIST_EPSILON, &dqNear, &dqFar);
+   nOut = 0;
+   for (b = 0; b < inIndex.nBlocks; b++) {
+      if (!capIndexHit(&inIndex, b, ncsNemo.dc, dqFar)) continue;
+      recs = inBlock(b, buf, &n);
+      for (j = 0; j < n; j++) {
+         if (NEMO_Us8Plate(recs[j]) == 0) continue;      /* ring-end marker */
+         nemo_Us8ToNcs(recs[j], &ptNcs);
+         if (proxChordTest(&ncsNemo, &ptNcs, dqNear, dqFar) < 0) continue;
+         nemo_NcsToEnr(nemo_ElrWgs84(), &ptNcs, &ptCoast);
+         g = geoFanNear(&fanNemo, &ptCoast, nemoDist + DIST_EPSILON);
+         if (g == NEMO_DOUBLE_UNDEF) errorExit(progName, __LINE__,
+                                               "Unexpected Vincenty failure\n");
+         if (g < (nemoDist + DIST_EPSILON)) {   /* within Nemo distance */
+            g = statsSzpila(ptNemo, &ptCoast);    /* reported, as the library's */
+            nemo_Dcos3ToLatLong(ptCoast.dc, llCoast.a);
+            printf("%13.9f,%14.9f %6.3f\n", NEMO_RAD2DEG * llCoast.a[NEMO_LAT],
+                                            NEMO_RAD2DEG * llCoast.a[NEMO_LNG],
+                                            g - nemoDist);
+            nOut++;
+            }
+         }
+      }
+   return(nOut);
+   }
+/* ========================================================================== */
+/* The records of input block b (*n of them): in place, or decoded into buf
+   (room for BLOCK_POINTS) if the input is .z8b.
+ */
+static const nemoPtUs8 *inBlock(int b, nemoPtUs8 *buf, int *n) {
+   size_t k;
+   const nemoPtUs8 *recs;
+/* -------------------------------------------------------------------------- */
+   k = (size_t)b * BLOCK_POINTS;
+   *n = (inMap.nPts - k < BLOCK_POINTS) ? (int)(inMap.nPts - k) : BLOCK_POINTS;
+   recs = p8bMapRecs(&inMap, k, *n, buf);
+   if (recs == NULL) errorExit(progName, __LINE__,
+                               "Invalid input block %d (.z8b)\n", b);
+   return(recs);
+   }
+/* ========================================================================== */
+/* Run the worker on nThreads threads and wait for all of them to finish; with
+   no threads, in the calling one.
+ */
+static void runWorkers(void *(*worker)(void *), void *arg, int nThreads) {
+   int i;
+   pthread_t threads[MAX_THREADS];
+/* -------------------------------------------------------------------------- */
+   if (nThreads == 0) {
+      worker(arg);
+      return;
+      }
+   for (i = 0; i < nThreads; i++) {
+      if (pthread_create(threads + i, NULL, worker, arg))
+         errorExit(progName, __LINE__, "Can't create thread %d\n", i);
+      }
+   for (i = 0; i < nThreads; i++) pthread_join(threads[i], NULL);
+   return;
+   }
+/* ========================================================================== */
+void usage(const char *mA,                  /* first message string (or NULL) */
+           const char *mB) {               /* second message string (or NULL) */
+
+   if (mA || mB) fprintf (stderr, "Error: %s %s\n", mA ? mA : "\0", mB ? mB : "\0");
+   fprintf (stderr, "Usage: %s [options] inFile\n", progName);
+   fprintf (stderr, "  inFile: .r8b (or .p8b, .z8b) binary coastline vertices\n");
+   fprintf (stderr, "Required options:\n");
+   fprintf (stderr, " -c(enter)=\"φ,λ\": coordinate string, center of search area\n");
+   fprintf (stderr, " -r(adius)=rrrr: meters, search radius\n");
+   fprintf (stderr, "Other options:\n");
+   fprintf (stderr, " -e(xtract)=rrrr: meters, geodesic, extraction radius (default: all)\n");
+   fprintf (stderr, " -i(ndex)=file: spatial index of inFile (created if not there)\n");
+   fprintf (stderr, " -t(estcount)=nnn: integer, random test count, (default:%d)\n", TEST_COUNT);
+   fprintf (stderr, " -s(eed)=nnn: integer, random number seed, (default:%d)\n", DEFAULT_SEED);
+   fprintf (stderr, " -p(arallel)=n: worker threads, (default: single-threaded)\n");
+   fprintf (stderr, " -m(ethod)=newton|nudge: trilateration (default: newton)\n");
+   fprintf (stderr, " -stats=text|json|file.json: phase times and counters report\n");
+   fprintf (stderr, " -h(elp): to print this usage help and exit\n");
+   exit(1);
+   }
+/* ========================================================================== */
+#include "../scullions/clFileOpt.c"
+#include "../scullions/errorExit.c"
+#include "../scullions/nemoStrings.c"
+#include "../scullions/fileMap.c"
+#include "../scullions/proxChord.c"
+#include "../scullions/capIndex.c"
+#include "../scullions/chordSqBatch.c"
+#include "../scullions/rngStream.c"
+#include "../scullions/ncsKdTree.c"
+#include "../scullions/nemoSearch.c"
+#include "../scullions/nemoStats.c"
+#include "../scullions/geoFan.c"
+#include "../scullions/nemoTrilat.c"
+/* ========================================================================== */
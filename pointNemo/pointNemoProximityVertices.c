@@ -26,23 +26,49 @@
    the pointNemoIterate program by appending the above line, like so:
 
    ./pointNemoProximityVertices ... > proximityVertices.pts
+
+   The coastline vertices are indexed by a k-d tree (scullions/ncsKdTree),
+   used to find the nearest vertex to each random point of phase 1, and the
+   three separated proximity vertices of phase 3.
+
+   Random points of phase 1 are tested (scullions/nemoSearch) in chunks, each
+   with its own random number stream, derived from the -seed option. The
+   chunks can be processed by several threads (-p, or -threads, option); the
+   results depend only on the seed, not on the number of threads. With
+   -stats=text (or json, file.json) the phase times and random point counts
+   are reported at the end, see scullions/nemoStats.
 */
 
 #include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
 
 #define PGM_DSCR "Find three Nemo Proximity Vertices"
-#define PGM_LAST_EDIT_DATE "2025.092"         /* format as from 'date +%Y.%j' */
+#define PGM_LAST_EDIT_DATE "2026.287"         /* format as from 'date +%Y.%j' */
 
 #include <nemo.h>
 #include "../scullions/scullions.h" /* include after nemo.h has been included */
+#include "../scullions/nemoStats.h"
+#include "../scullions/fileMap.h"
+#include "../scullions/chordSqBatch.h"
+#include "../scullions/rngStream.h"
+#include "../scullions/ncsKdTree.h"
+#include "../scullions/nemoSearch.h"
 
 #define MAX_COORD_STR                       64
 #define TEST_COUNT                     2000000           /* what's a million? */
-#define GLOBAL_LOCAL_RANDOM_CUTOFF     1500000            /* 1.5 K kilometers */
 #define PROX_VRTX_SEPARATION              5000             /* five kilometers */
+#define DEFAULT_SEED                      2025
+#define MAX_THREADS                        256
+
 void usage(const char *, const char *);               /* program command-line */
 
 static nemoPtNcs *cvx;                  /* a large array of coastlin vertices */
+static ncsSoa cvxSoa;            /* as above, as structure of arrays (SoA) */
+static kdTree cvxTree;                   /* as above, as a spatial index */
+static int nCstVtx;               /* number of points (vertices) on the coast */
+static nemoPtNcs srgnCntr;                    /* search region centre, on NCS */
+static nemoSearch search;                /* Monte Carlo search, in the region */
 static const char *progName;    /* for error logging by this source file only */
 /* ========================================================================== */
 int main (int argc,
@@ -54,14 +80,14 @@ int main (int argc,
    const char *optValCenter;
    const char *optValRadius;
    const char *fnIn;            /* input binary file, OSM coastline (extract) */
-   FILE *fpIn;
+   fileMap inMap;                 /* input file, as an array of Us8 records */
+   int iErr;
 
    int j, n;
    int testCount;
    int iPlate;
-   int nCstVtx;                   /* number of points (vertices) on the coast */
-   double globalLocalCutoff;                   /* for random point generation */
-   double parms[NEMO_GNOMONIC_PCNT];
+   uint64_t seed;                       /* of all random number streams */
+   int nThreads;                           /* number of worker threads, or 0 */
    double proxVrtxSeparation;                 /* vertex coincidence criterion */
    char coordStr[MAX_COORD_STR + 2];    /* text parsing, as simple as it gets */
    const char delimiters[] = ", ";
@@ -69,24 +95,16 @@ int main (int argc,
    nemoPtEll ptEll;           /* command linee input angular φ, λ coordinates */
    double srgnGround;         /* Search radius, as given on planeraty surface */
    double srgnArc;                      /* Search radius, as NCS arc (approx) */
-   double srgnChSq;                    /* Search radius, as NCS chord squared */
-   nemoPtNcs srgnCntr;                        /* search region centre, on NCS */
 
-   size_t inFileSize;
    nemoPtUs8 ptUs8;
-   int nTotalTests, moreTests;
-   int nIn, nOut;
-   double chSq, chSq0, chSq1;                  /* transient use square chords */
-   nemoPtNcs ptRand;        /* random location, is it approximate Point Nemo? */
+   double chSq, chSq0;                         /* transient use square chords */
    nemoPtNcs ptNemo;
-   double nemoDist;                /* ptNemo to nearest coast vertex, minimum */
-   double randDist;          /* random point to nearest coast vertex, minimum */
-   int i, ii, iii;
+   int i, iii;
    nemoPtNcs proxVrtx[3];                         /* three proximity vertices */
+   int proxId[3];                                    /* their vertex indices */
    double proxVrtxChSq[3];             /* and chord squared distances to them */
    nemoPtNcs ptVrtx;                                      /* coastline vertex */
-   double clockSeconds;                                /* timing paraphenalia */
-   time_t clockStart;
+   double wallStart;                                   /* timing paraphenalia */
 /* -------------------------------------------------------------------------- */
    progName = strrchr(argv[0], '/');                                 /* POSIX */
    if (progName == NULL) progName = strrchr(argv[0], '\\');         /* MS Win */
@@ -94,6 +112,7 @@ int main (int argc,
    if (progName == NULL) progName = argv[0];     /* neither? Just use argv[0] */
    fprintf(stderr, "\n[%s]: %s\nsource as of: %s, Nemo Library: %.3f\n",
                    progName, PGM_DSCR, PGM_LAST_EDIT_DATE, NEMO_LIBRARY_DATE);
+   if (statsInit(progName, &argc, argv)) usage("invalid option", "-stats");
 
    if (argc < 2) usage("Missing command line argument(s)", NULL);
 
@@ -104,14 +123,23 @@ int main (int argc,
 /* Retrieve command-line options and input filename */
 
    testCount = TEST_COUNT;                                         /* default */
+   seed = DEFAULT_SEED;
+   nThreads = 0;                               /* default: single-threaded */
    optValCenter = optValRadius = NULL;                    /* required options */
    while ((optKey = clOption(argc, argv, &optVal))) {
       if (*optKey == 'h') usage(NULL, NULL);
       else if (*optKey == 'c') optValCenter = optVal;
       else if (*optKey == 'r') optValRadius = optVal;
+      else if (strncmp(optKey, "th", 2) == 0) nThreads = atoi(optVal);
       else if (*optKey == 't') testCount=atoi(optVal);
+      else if (*optKey == 's') seed = strtoull(optVal, NULL, 10);
+      else if (*optKey == 'p') nThreads = atoi(optVal);
       else usage("unrecognized option", optKey);
       }
+   if ((nThreads < 0) || (nThreads > MAX_THREADS)) usage("invalid option",
+                                                        "parallel (0...256)");
+   if (nThreads == 1) nThreads = 0;          /* one worker is no worker */
+   if (testCount < 1) usage("invalid option", "testcount");
 
    fnIn = clFileName(argc, argv);                      /* required input file */
    if (fnIn == NULL) usage("Missing input file name", NULL);
@@ -131,15 +159,8 @@ int main (int argc,
    srgnGround = strtod(optValRadius, NULL);
 /* fprintf(stderr, "Search region radis, arc on planet surface: %f\n", srgnGround); */
    srgnArc = srgnGround / NEMO_EARTH_RADIUS;         /* as arc on unit sphere */
-   srgnChSq = nemo_ArcToChordApprox(srgnArc);
-   srgnChSq *= srgnChSq;                                  /* as chord squared */
-
-/* initialize local random point generation cutoff */
-/* First, as arc on planet surface */
-   globalLocalCutoff = GLOBAL_LOCAL_RANDOM_CUTOFF / NEMO_EARTH_RADIUS;
-   globalLocalCutoff = nemo_ArcToChordApprox(globalLocalCutoff);  /* chord on unit sphere */
-   globalLocalCutoff = globalLocalCutoff * globalLocalCutoff;  /* as chord squared */
-   parms[0] = NEMO_DOUBLE_UNDEF;
+   nemoSearchInit(&search, &cvxTree, &srgnCntr, srgnArc);  /* tree: below */
+   search.isVerbose = 1;
    proxVrtxSeparation = PROX_VRTX_SEPARATION / NEMO_EARTH_RADIUS; /* arc on NCS */
    proxVrtxSeparation = nemo_ArcToChordApprox(proxVrtxSeparation); /* chord */
    proxVrtxSeparation = proxVrtxSeparation * proxVrtxSeparation;
@@ -150,97 +171,51 @@ int main (int argc,
    fprintf(stderr, "Search region radius: %.0f\n", srgnGround);
    fprintf(stderr, "Vertex to vertex saparation criterion: %s\n",
                      nemo_StrChSqDist(proxVrtxSeparation));
-/*
-   fprintf(stderr, "Global/local randGen cutoff, given on planet: %.1f km\n",
-                    GLOBAL_LOCAL_RANDOM_CUTOFF/1000.0);
-   fprintf(stderr, "Global/local randGen cutoff, arc on NCS:      %.12f\n",
-                    globalLocalCutoff);
-   fprintf(stderr, "Global/local randGen cutoff cgSq:             %.12f\n", globalLocalCutoff);
-   fprintf(stderr, "Global/local randGen cutoff: %.s\n", nemo_StrChSqDist(globalLocalCutoff));
- */
-
-/* Open input file */
-   fpIn = fopen(fnIn, "rb");
-   if (fpIn == NULL) errorExit(progName, __LINE__,
-                                "Can't open [%s] for reading\n", fnIn);
-
-/* Load the input file as memory-resident array; first get the file size:     */
-   if (fseek(fpIn, 0, SEEK_END)) errorExit(progName, __LINE__,
-                                "Can't read [%s]?\n", fnIn);
-   inFileSize = ftell(fpIn);
-   rewind(fpIn);
-   fprintf(stderr, "Input file has: %d records\n", (int)(inFileSize / sizeof(nemoPtUs8)));
-   cvx = malloc((inFileSize / sizeof(nemoPtUs8)) * sizeof(nemoPtNcs));
-   n = fread(&ptUs8, sizeof(nemoPtUs8), 1, fpIn);
+   fprintf(stderr, "Random number seed: %llu\n", (unsigned long long)seed);
+
+/* Open (map) input file */
+   statsPhase("load and index");
+   iErr = p8bMapOpen(&inMap, fnIn);
+   if (iErr) errorExit(progName, __LINE__,
+                       "Can't read [%s]: %s\n", fnIn, fileMapErrStr(iErr));
+
+/* Transform the input file into memory-resident array of NCS coordinates */
+   fprintf(stderr, "Input file has: %d records\n", (int)inMap.nPts);
+   cvx = malloc(inMap.nPts * sizeof(nemoPtNcs));
+   if ((cvx == NULL) && (inMap.nPts)) errorExit(progName, __LINE__,
+                                              "No memory for vertices?\n");
    nCstVtx = 0;                                     /* count number of points */
-   while (n) {
+   for (n = 0; n < (int)inMap.nPts; n++) {
+      ptUs8 = inMap.pts[n];
       iPlate = NEMO_Us8Plate(ptUs8);
       if (iPlate) nemo_Us8ToNcs(ptUs8, cvx + nCstVtx++);
-      n = fread(&ptUs8, sizeof(nemoPtUs8), 1, fpIn);
       }
    fprintf(stderr, "Loaded search array of %d coastline vertices\n", nCstVtx);
-   fclose(fpIn);
+   fileMapClose(&inMap);
+   if (ncsSoaAlloc(&cvxSoa, nCstVtx)) errorExit(progName, __LINE__,
+                                              "No memory for vertices?\n");
+   for (i = 0; i < nCstVtx; i++) NCS_SOA_SET(&cvxSoa, i, cvx + i);
+   if (kdtBuild(&cvxTree, cvx, nCstVtx)) errorExit(progName, __LINE__,
+                                              "No memory for vertex index?\n");
 
 /* ==============================
    Phase 1: testing random points
    ==============================
  */
+   statsPhase("random points");
    fprintf(stderr, "Testing %d random points\n", testCount);
-   moreTests = testCount;
-   nIn = nOut = nTotalTests = n = 0;
-   nemoDist = -(NEMO_DOUBLE_HUGE);
-   clockStart = clock();
-   while (moreTests) {              /* more random points remain to be tested */
-      if (moreTests%1000 == 0) fprintf(stderr, "tests remaining: %d K      \r", moreTests/1000);
-/*    If the search region is large, random points are generated as "global"
-      and rejected if outside of it. Otherwise, random points will be
-      generated as "local". (but the test will still be done). */
-      if (srgnChSq > globalLocalCutoff) {
-          ptRand = *nemo_SphereRandomPointGlobal(NULL);
-//          fprintf(stderr, "Random Point global: %s\n", nemo_StrNcsCoords(&ptRand));
-          }
-      else {
-         ptRand = *nemo_SphereRandomPointLocal(&srgnCntr, srgnArc, parms, NULL);
-//         fprintf(stderr, "Random Point local: %s\n", nemo_StrNcsCoords(&ptRand));
-         }
-/*    its distance to search region centre: */
-      chSq = NEMO_ChordSq3(ptRand.dc, srgnCntr.dc);
-//    fprintf(stderr, "Distance from search region centre: %s\n", nemo_StrChSqDist(chSq));
-/*    Reject generated random point if it is out of the search region */
-      if (chSq > srgnChSq) nOut++;
-      else nIn++;
-      if (chSq > srgnChSq) continue;       /* ptRand is outside search region */
-/*    This random point shiold be tested against all verices, and the closest
-      one (distance and its index, ii recorded. We can abandon the traverse if
-      the distance to a vertex is closer than the "best Nemo" found so far.   */
-//      fprintf(stderr, "Random Point: %s\n", nemo_StrNcsCoords(&ptRand));
-      nTotalTests++;                          /* used only to report progress */
-      moreTests--;                                   /* next Monte Carlo test */
-      randDist = NEMO_DOUBLE_HUGE;
-      for (i = 0; i < nCstVtx; i++) {              /* traverse coast vertices */
-         chSq = NEMO_ChordSq3(ptRand.dc, cvx[i].dc);      /* random to vertex */
-//         fprintf(stderr, "Distance to vertex %3d: %s\n", i, nemo_StrChSqDist(chSq));
-         if (chSq < nemoDist) {                       /* this random point... */
-            randDist = 0.0;        /* ...can't possibly be next point nemo... */
-            break;                    /* ...so break out of random point loop */
-            }
-         if (chSq < randDist) {
-            randDist = chSq;                        /* nearest coastal so far */
-            ii = i;                /* its vertex index */
-            }
-         }
-
-      if (randDist > nemoDist) {                       /* better "Nemo" found */
-         ptNemo = ptRand;
-         nemoDist = randDist;
-         iii = ii;
-//         fprintf(stderr, "New Nemo: %3d %s\n", iii, nemo_StrNcsCoords(&ptRand));
-//         fprintf(stderr, "New dstance: %s\n", nemo_StrChSqDist(randDist));
-         }
-      }
-
-   if (nemoDist == -(NEMO_DOUBLE_HUGE)) errorExit(progName, __LINE__,
+   wallStart = statsWall();
+   if (nThreads) fprintf(stderr, "Worker threads: %d\n", nThreads);
+   iErr = nemoSearchRun(&search, testCount, seed, nThreads);
+   if (iErr == NEMO_SEARCH_NONE) errorExit(progName, __LINE__,
                         "Unexpected condition: no far point found?\n");
+   if (iErr) errorExit(progName, __LINE__, "Random point tests failed (%d)\n", iErr);
+   fprintf(stderr, "Random points inside/outside of search region: %d/%d\n",
+                   search.nIn, search.nOut);
+   statsAdd("pointsIn", search.nIn);
+   statsAdd("pointsOut", search.nOut);
+   ptNemo = search.ptNemo;
+   iii = search.iVrtx;
    fprintf(stderr, "Approximate Point Nemo  %s\n", nemo_StrNcsCoords(&ptNemo));
    fprintf(stderr, "Near coast vertex index: %d\n", iii);
 
@@ -248,48 +223,32 @@ int main (int argc,
    fprintf(stderr, "Near coast vertex:      %s\n", nemo_StrNcsCoords(&ptVrtx));
    chSq = NEMO_ChordSq3(ptVrtx.dc, ptNemo.dc);            /* vertex to random */
    fprintf(stderr, "Distance to it: %s\n", nemo_StrChSqDist(chSq));
-   proxVrtx[0] = ptVrtx;
-   proxVrtxChSq[0] = chSq;
-
-/* verification pass: is it really the closest one? */
-   for (i = 0; i < nCstVtx; i++) {                 /* traverse coast vertices */
-      chSq = NEMO_ChordSq3(cvx[i].dc, ptNemo.dc);     /* vertex to point Nemo */
-      if (chSq < proxVrtxChSq[0]) {
-         errorExit(progName, __LINE__, "Unexpected distance: vertex %d, %s\n",
-         i, nemo_StrChSqDist(chSq));
-         }
+
+/* verification pass: is it really the closest one? (not using the index) */
+   statsPhase("verification");
+   chSq0 = chSq;
+   chSq = chSqMinSoa(ptNemo.dc, &cvxSoa, 0, nCstVtx, &i); /* all coast vertices */
+   if (chSq < chSq0) {
+      errorExit(progName, __LINE__, "Unexpected distance: vertex %d, %s\n",
+      i, nemo_StrChSqDist(chSq));
       }
-   clockSeconds = (double)(clock() - clockStart) / (double)CLOCKS_PER_SEC;
-   fprintf(stderr, "Phase 1 duration: %6.3f seconds, verification passed\n\n", clockSeconds);
+   fprintf(stderr, "Phase 1 duration: %6.3f seconds (wall clock), "
+                   "verification passed\n", statsWall() - wallStart);
+   fprintf(stderr, "\n");
 
 /* ===============================================
    Phase 3: Find three closest points on the coast
    ===============================================
  */
-/* proxVrtx[0] (and its associated distance) has been identified and set.
-   Search for [1] and [2] will be done in two separate passes of coastline.
+/* The nearest vertex, then the nearest one not close to it, then the
+   nearest one close to neither of these two.
  */
-   proxVrtxChSq[1] = NEMO_DOUBLE_HUGE;           /* search for second closest */
-   for (i = 0; i < nCstVtx; i++) {             /* traverse all coast vertices */
-      chSq = NEMO_ChordSq3(ptNemo.dc, cvx[i].dc);     /* point Nemo to vertex */
-      if (chSq > proxVrtxChSq[1]) continue;   /* we already have a better one */
-      chSq0 = NEMO_ChordSq3(cvx[i].dc, proxVrtx[0].dc);
-      if (chSq0 < proxVrtxSeparation) continue;    /* close to [0], ignore it */
-      proxVrtx[1] = cvx[i];                        /* record proximity vertex */
-      proxVrtxChSq[1] = chSq;                           /* and distance to it */
-      }
-
-   proxVrtxChSq[2] = NEMO_DOUBLE_HUGE;            /* search for third closest */
-   for (i = 0; i < nCstVtx; i++) {             /* traverse all coast vertices */
-      chSq = NEMO_ChordSq3(ptNemo.dc, cvx[i].dc);     /* point Nemo to vertex */
-      if (chSq > proxVrtxChSq[2]) continue;   /* we already have a better one */
-      chSq0 = NEMO_ChordSq3(cvx[i].dc, proxVrtx[0].dc);
-      chSq1 = NEMO_ChordSq3(cvx[i].dc, proxVrtx[1].dc);
-      if ((chSq0 < proxVrtxSeparation) ||               /* close to [0] or... */
-          (chSq1 < proxVrtxSeparation)) continue;        /* ...[1], ignore it */
-      proxVrtx[2] = cvx[i];                        /* record proximity vertex */
-      proxVrtxChSq[2] = chSq;                           /* and distance to it */
-      }
+   statsPhase("proximity vertices");
+   n = kdtNearestSep(&cvxTree, ptNemo.dc, 3, proxVrtxSeparation,
+                     proxId, proxVrtxChSq);
+   if (n < 3) errorExit(progName, __LINE__,
+                        "Only %d separate proximity vertices found\n", n);
+   for (j = 0; j < 3; j++) proxVrtx[j] = cvx[proxId[j]];
 
    fprintf(stderr, "Phase 2 done\n");
 
@@ -306,6 +265,9 @@ int main (int argc,
       }
 
    free(cvx);
+   ncsSoaFree(&cvxSoa);
+   kdtFree(&cvxTree);
+   statsReport();
    return(0);
    }
 /* ========================================================================== */
@@ -320,6 +282,9 @@ void usage(const char *mA,                  /* first message string (or NULL) */
    fprintf (stderr, " -r(adius)=rrrr: meters, search radius\n");
    fprintf (stderr, "Other options:\n");
    fprintf (stderr, " -t(estcount)=nnn: integer, random test count, (default:%d)\n", TEST_COUNT);
+   fprintf (stderr, " -s(eed)=nnn: integer, random number seed, (default:%d)\n", DEFAULT_SEED);
+   fprintf (stderr, " -p(arallel)=n or -th(reads)=n: worker threads, (default: single-threaded)\n");
+   fprintf (stderr, " -stats=text|json|file.json: phase times and counters report\n");
    fprintf (stderr, " -h(elp): to print this usage help and exit\n");
    exit(1);
    }
@@ -327,4 +292,10 @@ void usage(const char *mA,                  /* first message string (or NULL) */
 #include "../scullions/clFileOpt.c"
 #include "../scullions/errorExit.c"
 #include "../scullions/nemoStrings.c"
+#include "../scullions/fileMap.c"
+#include "../scullions/chordSqBatch.c"
+#include "../scullions/rngStream.c"
+#include "../scullions/ncsKdTree.c"
+#include "../scullions/nemoSearch.c"
+#include "../scullions/nemoStats.c"
 /* ========================================================================== */
@@ -36,23 +36,158 @@
          extraction distance as a length of ellipsoid geodesic measured in
          meters - for instance, 3000000.003 (in this example three thousand
          kilometres and a little bit more) on the planetary surface).
+
+      -threads
+         (optional) number of worker threads classifying the blocks of input
+         points, for instance -threads=16. The blocks are written to output in
+         input order as they are completed, so the output file is identical
+         to the one created without this option (that is, by single thread).
+
+      -index
+         (optional) spatial index "side" file of the input, for instance
+         -index=input.cix (see scullions/capIndex). If the file does not
+         exist, it is created (which takes a pass over all the input); if it
+         does, the blocks of input points that are certainly all too far
+         from the extraction center are skipped without reading them. With
+         sorted (.p8b) or region (.r8b) input, an extraction of a small circle
+         thus reads a small part of the file: that the index is the one of
+         the file is checked by a few sampled records, and the file is then
+         read only where the blocks left are (with no read-ahead but theirs,
+         see scullions/fileMap). The output does not change. A sorted .z8b
+         input is read in place, too: only the blocks that are left are
+         decoded.
+
+      -stats
+         (optional) -stats=text, -stats=json or -stats=file.json: report the
+         phase times, the counts above and the geodesic iterations histograms,
+         of the library and of geoFan (see scullions/nemoStats).
+
+      -queries
+         (optional) instead of -center, -radius and the output file name,
+         a text file of many extractions, one per line: center φ, λ, radius
+         and output file path/name (with no blanks or commas in it), for
+         instance "-33.86,151.21 150000 sydney.p8b"; empty lines and lines
+         starting with '#' are ignored. The extractions are all made in one
+         pass over the input file: see below.
+
+   The points of a block that the chord test leaves undecided for a circle
+   are measured together, by a batch of geodesics from its center (see
+   scullions/geoFan, geoFanNearBatch()); their iterations are counted in the
+   -stats histogram.
+
+   The input is read ahead of the blocks being classified (only the blocks
+   the index does not skip), and the output is written by a background
+   thread (scullions/asyncOut), so that neither waits for the other.
+
+   With many extractions (-queries), the centers of their circles are held
+   in a k-d tree (scullions/ncsKdTree). For each block of input points, the
+   circles that can include any of them are found by a search of the tree
+   around the block's bounding cap (from the index, if there is one, else
+   from the points themselves - see scullions/capIndex); the points of the
+   block are then tested, by the usual chord and geodesic tests, against
+   those circles only, and written to their output files. A block that no
+   circle reaches is, with an index, not read at all. Each output file is
+   the same as the one made by a run for its circle alone.
+
+   All the output files are open during the pass, so with MAX_QUERIES of them
+   the process needs that many file descriptors, and a few more (the input,
+   index and standard streams): more than some systems allow by default
+   (see "ulimit -n"). Their buffers share QUERY_OUT_BYTES, and one
+   background thread writes them all (an asyncOutGroup).
  */
 #include <time.h>
+#include <pthread.h>
 
 #include <nemo.h>
 #include "../scullions/scullions.h" /* include after nemo.h has been included */
+#include "../scullions/nemoStats.h"
+#include "../scullions/geoFan.h"
+#include "../scullions/fileMap.h"
+#include "../scullions/proxChord.h"
+#include "../scullions/capIndex.h"
+#include "../scullions/ncsKdTree.h"
+#include "../scullions/asyncOut.h"
 
 #define PGM_DSCR "Extraction of point records from .ptb/.lnb file"
-#define PGM_LAST_EDIT_DATE "2025.091"         /* format as from 'date +%Y.%j' */
+#define PGM_LAST_EDIT_DATE "2026.287"         /* format as from 'date +%Y.%j' */
 
-#define BLOCK_POINTS   1024                   /* reading/writing is in blocks */
+#define BLOCK_POINTS   1024              /* processing/writing is in blocks */
 #define MAX_COORD_STR   128
+#define MAX_QUERY_LINE 1024
+#define MAX_QUERIES    1000          /* extraction circles, with -queries */
+#define QUERY_OUT_BYTES (64 * 1024 * 1024)  /* their output buffers, total */
+#define QUERY_OUT_MIN   (32 * 1024) /* ...at least, per buffer: the total */
+                   /* holds up to MAX_QUERIES, QUERY_OUT_MIN * 2 * MAX_QUERIES */
+#define QUERY_CHORD_EPS 1.0e-9          /* tree search margin, for round-off */
+#define MAX_THREADS     256
+#define SLOTS_PER_THREAD  4      /* blocks in flight, per worker thread */
+#define PREFETCH_BLOCKS 256     /* input read ahead, blocks at a time (2 MB) */
 
 /* pending inclusion to nemo.h */
 //#define NEMO_Us8Plate(u8) ((int)((u8 & 0xf000000000000000) >> 60))
 
-int proxChordTest(nemoPtNcs *, nemoPtNcs *, double, double);
-int proxGeodesicTest(nemoPtEnr *, nemoPtEnr *, double);
+struct selQuery {             /* an extraction circle, and its output */
+   nemoPtEnr rtcEnr;              /* retrieval center, as ellipsoid normal */
+   nemoPtNcs rtcNcs;          /* retrieval center as near-conformal sphere */
+   geoFan rtcFan;               /* geodesics from the retrieval center */
+   double exRadGeodesic;                    /* extraction radius, geodesic */
+   double chSqNear, chSqFar;          /* chord squared inclusion/exclusion */
+   double chSqReach;      /* ...and the farthest it reaches: all, past π */
+   const char *fnOut;                             /* output .p8b file... */
+   FILE *fpOut;
+   asyncOut aOut;                                /* ...written in background */
+   int nPtOut;                            /* number of points included, and */
+   int nGeod;       /* ...of those classified by geodesic evaluation */
+   };
+
+struct selBlock {               /* a block of input points, and its outcome */
+   int iBlock;     /* block number (multi-threaded: one the slot waits for) */
+   int isReady;                    /* multi-threaded: 1 once it's classified */
+   const nemoPtUs8 *ptUs8in;      /* input block, slice of the map, or... */
+   nemoPtUs8 ptUs8dec[BLOCK_POINTS];          /* ...decoded here (.z8b) */
+   int nBin;                                    /* number of points in it */
+   nemoPtUs8 ptUs8loc[BLOCK_POINTS];       /* its locations (no markers)... */
+   nemoPtNcs ptNcs[BLOCK_POINTS];                 /* ...and on the NCS */
+   int nLoc;
+   int iIn[BLOCK_POINTS];      /* for a circle: those in, by chord test, */
+   int iOpen[BLOCK_POINTS];          /* ...those it leaves open (indices), */
+   nemoPtEnr ptEnr[BLOCK_POINTS];              /* ...these on the ellipsoid */
+   double gOpen[BLOCK_POINTS];          /* ...and their geodesics (geoFan) */
+   int nCand;     /* number of circles that can include some of the points */
+   int *cand;                                       /* ...the circles, */
+   int *candEnd;                /* ...the end of their points in ptUs8out, */
+   int *candGeod;              /* ...and their geodesic evaluations, each */
+   nemoPtUs8 *ptUs8out;            /* points that are included, by circle */
+   int nBout, nOutCap;                            /* number of points in it */
+   int nMarks;                        /* number of segment/ring end markers */
+   int isSkipped;              /* 1: block is too far, by the spatial index */
+   int isNoMem;                             /* 1: can't grow the ptUs8out */
+   int isBad;                          /* 1: can't decode the (.z8b) block */
+   };
+
+struct selPipe {        /* multi-threaded: blocks being processed together */
+   pthread_mutex_t mtx;                       /* guards all of the below... */
+   pthread_cond_t cond;               /* ...and is signalled on any change */
+   int nBlocks;                               /* input blocks, total number */
+   int nextBlock;                   /* next block to be taken by a worker */
+   int nSlots;                                 /* number of blocks in flight */
+   struct selBlock *slots;         /* block n is processed in slot n%nSlots */
+   };
+
+void selectBlock(struct selBlock *);
+void *selectWorker(void *);
+static int blockQueries(const capBlock *, int *);
+static void prefetchBlocks(int, int, int *);
+static void setQuery(struct selQuery *, const nemoPtEll *, double);
+static int loadQueries(const char *);
+
+static fileMap inMap;            /* input: .ptb, .lnb or .rgb file, mapped */
+static struct selQuery *queries;                 /* the extraction circles */
+static int nQueries;
+static kdTree queryTree;                      /* ...their centers, and */
+static double chMaxFar;           /* ...the largest exclusion radius, chord */
+static capIndex inIndex;                       /* input spatial index, if any */
+static int useIndex;
 
 static const char *progName;    /* for error logging by this source file only */
 void usage(const char *, const char *);
@@ -61,35 +196,29 @@ int main (int argc,
           const char *argv[],
           const char *envr[]) {
 
-   int i, iPlate, n, nb;
-   int isClose;                         /* 1:is close, -1:is far, 0:uncertain */
-   int nBin, nBout;             /* number of points in input and output block */
+   int i, k, n, nb, iErr;
+   int nThreads;                           /* number of worker threads, or 0 */
+   pthread_t threads[MAX_THREADS];
+   struct selPipe pipe;                    /* multi-threaded processing state */
+   struct selBlock *blk;                   /* block to classify and/or write */
    int nMarksIn;                /* number of segment/ring marks in input file */
    int nGeodTests;       /* number of point classified by geodesic evaluation */
    int nPtIn, nPtOut, nPtFar;       /* number of input, output and far points */
+   int nSkipped;                       /* number of blocks skipped by index */
    const char *optKey, *optVal;            /* options, in -keyword=value form */
    const char *fnIn, *fnOut;                  /* as given on the command line */
-   FILE *fpIn;                              /* input: .ptb, .lnb or .rgb file */
-   nemoPtUs8 ptUs8in[BLOCK_POINTS];        /* input block of U64 (CDC) points */
-   FILE *fpOut;                                           /* output .ptb file */
-   nemoPtUs8 ptUs8out[BLOCK_POINTS];                          /* output block */
+   struct selQuery *q;
+   nemoPtNcs *centers;                           /* of the query circles */
+   int *prefetchCand;                       /* blocks' circles, read ahead */
+   size_t outBytes;                          /* per query output buffer */
+   asyncOutGroup outGroup;         /* -queries: one writer for them all */
    char coordStr[MAX_COORD_STR + 2];    /* text parsing, as simple as it gets */
    const char delimiters[] = ", \r\n";
-   const char *strCenter, *strRadius;
+   const char *strCenter, *strRadius, *fnIndex, *fnQueries;
    char *token;
    nemoPtEll ptEll;            /* command line input angular φ, λ coordinates */
-   nemoPtEnr rtcEnr;                 /* retrieval center, as ellipsoid normal */
-   nemoPtNcs rtcNcs;             /* retrieval center as near-conformal sphere */
-
-   nemoPtNcs ptNcs;              /* input file point on near-conformal sphere */
-   nemoPtEnr ptEnr;                   /* input file point as ellipsoid normal */
-
-   double exRadGeodesic;                       /* extraction radius, geodesic */
-   double chSqNear, chSqFar;             /* chord squared inclusion/exclusion */
-   double a, c;                                  /* ...to calculate the above */
 
-   double clockSeconds;                               /* timing paraphernalia */
-   time_t clockStart;
+   double wallStart;                                  /* timing paraphernalia */
 /* -------------------------------------------------------------------------- */
    progName = strrchr(argv[0], '/');                                 /* POSIX */
    if (progName == NULL) progName = strrchr(argv[0], '\\');         /* MS Win */
@@ -97,168 +226,508 @@ int main (int argc,
    if (progName == NULL) progName = argv[0];     /* neither? Just use argv[0] */
    fprintf(stderr, "\n[%s]: %s\nsource as of: %s, Nemo Library: %.3f\n",
                    progName, PGM_DSCR, PGM_LAST_EDIT_DATE, NEMO_LIBRARY_DATE);
+   if (statsInit(progName, &argc, argv)) usage("invalid option", "-stats");
 
-   strCenter = strRadius = NULL;
+   strCenter = strRadius = fnIndex = fnQueries = NULL;
+   nThreads = 0;                               /* default: single-threaded */
    while ((optKey = clOption(argc, argv, &optVal))) {
       if (*optKey == 'h') usage(NULL, NULL);
       else if (*optKey == 'c') strCenter = optVal;
       else if (*optKey == 'r') strRadius = optVal;
+      else if (*optKey == 't') nThreads = atoi(optVal);
+      else if (*optKey == 'i') fnIndex = optVal;
+      else if (*optKey == 'q') fnQueries = optVal;
       else usage("unrecognized option", optKey);
       }
+   if ((nThreads < 0) || (nThreads > MAX_THREADS)) usage("invalid option",
+                                                        "threads (0...256)");
+   if (nThreads == 1) nThreads = 0;          /* one worker is no worker */
 
+   if (fnQueries) {                         /* many circles, from file... */
+      if (strCenter || strRadius) usage("-queries is instead of",
+                                        "-center and -radius");
+      nQueries = loadQueries(fnQueries);
+      fprintf(stderr, "Extraction circles: %d, from [%s]\n", nQueries, fnQueries);
+      }
+   else {                           /* ...or just one, by the command line */
 /* Extract retrieval center φ, λ coordinates */
-   if (strCenter == NULL) usage("missing argument:", "extraction center");
-   strncpy(coordStr, strCenter, MAX_COORD_STR);
-   token = strtok(coordStr, delimiters);
-   ptEll.a[NEMO_LAT] = NEMO_DEG2RAD * strtod(token, NULL);
-   token = strtok(NULL, delimiters);
-   ptEll.a[NEMO_LNG] = NEMO_DEG2RAD * strtod(token, NULL);
-   fprintf(stderr, "Retrieval center, φ,λ: %.7f, %.7f\n",
+      if (strCenter == NULL) usage("missing argument:", "extraction center");
+      strncpy(coordStr, strCenter, MAX_COORD_STR);
+      token = strtok(coordStr, delimiters);
+      ptEll.a[NEMO_LAT] = NEMO_DEG2RAD * strtod(token, NULL);
+      token = strtok(NULL, delimiters);
+      ptEll.a[NEMO_LNG] = NEMO_DEG2RAD * strtod(token, NULL);
+      fprintf(stderr, "Retrieval center, φ,λ: %.7f, %.7f\n",
            NEMO_RAD2DEG * ptEll.a[NEMO_LAT], NEMO_RAD2DEG * ptEll.a[NEMO_LNG]);
 
-   nemo_LatLongToDcos3(ptEll.a, rtcEnr.dc); /* Convert to ellipsoid normal... */
-   nemo_EnrToNcs(nemo_ElrWgs84(), &rtcEnr, &rtcNcs);      /* ...and NC sphere */
-/* fprintf(stderr, "Retrieval center NCS: %f, %f %f\n",
-           rtcNcs.dc[0], rtcNcs.dc[1], rtcNcs.dc[2]); */
-
 /* Extract retrieval radius as geodesic, meters on the surface */
-   if (strRadius == NULL) usage("missing argument:", "extraction radius");
-   exRadGeodesic = strtod(strRadius, NULL);
-   fprintf(stderr, "Retrieval radius: %.0f meters\n", exRadGeodesic);
+      if (strRadius == NULL) usage("missing argument:", "extraction radius");
+      nQueries = 1;
+      queries = calloc(1, sizeof(struct selQuery));
+      if (queries == NULL) errorExit(progName, __LINE__, "No memory?\n");
+      setQuery(queries, &ptEll, strtod(strRadius, NULL));
+      fprintf(stderr, "Retrieval radius: %.0f meters\n", queries->exRadGeodesic);
+      }
 
 /* First file argument: input file path/name */
    fnIn = clFileName(argc, argv);                               /* input file */
    if (fnIn == NULL) usage("Missing input file name", NULL);
-   fpIn = fopen(fnIn, "rb");
-   if (fpIn == NULL) errorExit(progName, __LINE__,
-                                "Can't open [%s] for reading\n", fnIn);
+   statsPhase("load and index");
+   iErr = p8bMapOpenBlocks(&inMap, fnIn);             /* .z8b: not decoded */
+   if (iErr) errorExit(progName, __LINE__,
+                       "Can't read [%s]: %s\n", fnIn, fileMapErrStr(iErr));
    fprintf(stderr, "Input from: [%s]\n", fnIn);
 
-/* Second file argument: output file path/name */
+/* Spatial index of the input blocks: use it if it exists, else create it */
+   useIndex = 0;
+   if (fnIndex) {
+      iErr = capIndexLoad(&inIndex, fnIndex);
+      if (iErr == CAP_INDEX_IO) {                       /* not there (yet) */
+         iErr = capIndexBuild(&inIndex, &inMap, BLOCK_POINTS);
+         if (iErr == CAP_INDEX_FORMAT)             /* a .z8b block's data */
+            errorExit(progName, __LINE__, "Invalid input [%s]\n", fnIn);
+         if (iErr == 0) iErr = capIndexSave(&inIndex, fnIndex);
+         if (iErr) errorExit(progName, __LINE__,
+                             "Can't create index [%s] (%d)\n", fnIndex, iErr);
+         fprintf(stderr, "Index created: [%s]\n", fnIndex);
+         }
+      else if (iErr == 0) {                   /* the index's blocks only... */
+         fileMapRandom(&inMap);          /* ...with prefetchBlocks() ahead */
+         iErr = capIndexMatch(&inIndex, &inMap, BLOCK_POINTS);
+         if (iErr) errorExit(progName, __LINE__,
+                 "Index [%s] is not one of [%s]; delete it?\n", fnIndex, fnIn);
+         fprintf(stderr, "Index from: [%s]\n", fnIndex);
+         }
+      else errorExit(progName, __LINE__, "Can't read index [%s] (%d)\n", fnIndex, iErr);
+      useIndex = 1;
+      }
+
+/* Second file argument: output file path/name (but with -queries) */
    fnOut = clFileName(argc, argv);                             /* output file */
-   if (fnOut == NULL) usage("Missing output file name", NULL);
-   fpOut = fopen(fnOut, "wb");
-   if (fpOut == NULL) errorExit(progName, __LINE__,
-                                "Can't open [%s] for writing\n", fpOut);
-   fprintf(stderr, "Output to: [%s]\n", fnOut);
+   if (fnQueries && fnOut) usage("with -queries, no output file name:", fnOut);
+   if ((fnQueries == NULL) && (fnOut == NULL))
+      usage("Missing output file name", NULL);
+   if (fnOut) queries->fnOut = fnOut;
+   outBytes = QUERY_OUT_BYTES / (2 * nQueries);   /* (one: the default size) */
+   if (outBytes < QUERY_OUT_MIN) outBytes = QUERY_OUT_MIN;
+   if ((nQueries > 1) && asyncOutGroupOpen(&outGroup, nQueries))
+      errorExit(progName, __LINE__, "No memory for output buffers?\n");
+   for (k = 0; k < nQueries; k++) {
+      q = queries + k;
+      q->fpOut = fopen(q->fnOut, "wb");
+      if (q->fpOut == NULL) errorExit(progName, __LINE__,
+                                    "Can't open [%s] for writing\n", q->fnOut);
+      if ((nQueries > 1) ?
+          asyncOutOpenIn(&q->aOut, &outGroup, q->fpOut, outBytes, 2) :
+          asyncOutOpen(&q->aOut, q->fpOut, 0, 3))
+         errorExit(progName, __LINE__, "No memory for output buffers?\n");
+      }
+   if (nQueries == 1) fprintf(stderr, "Output to: [%s]\n", queries->fnOut);
 
 /* Find squared chord magnitude below which the point is included, and the
-   one above which it is rejected. For points with squared chord distances
-   between the two values, the more expensive geodesic length computation
-   will be required in order to decide whether to include or reject. */
-   a = NEMO_GEOARC_MIN * (exRadGeodesic / NEMO_EARTH_RADIUS);
-   c = nemo_ArcToChordApprox(a);
-   chSqNear = c * c;
-   a = NEMO_GEOARC_MAX * (exRadGeodesic / NEMO_EARTH_RADIUS);
-   c = nemo_ArcToChordApprox(a);
-   chSqFar = c * c;
-   fprintf(stderr, "geodesic, (NCS limits): %f, (%f, %f)\n", exRadGeodesic, chSqNear, chSqFar);
-
-   nPtIn = nPtOut = nPtFar = nBin = nBout = nGeodTests = 0;
-   nBin = fread(ptUs8in, sizeof(nemoPtUs8), BLOCK_POINTS, fpIn);
-   nPtIn += nBin;
-   nb = 0;
-
-   clockStart = clock();
-   while (nBin > 0) {
-    if (nb++%1000 == 0) fprintf(stderr, "%d M\r", nb / 1000);
-    for (i = 0; i < nBin; i++) {            /* traverse points in input block */
-         iPlate = NEMO_Us8Plate(ptUs8in[i]);
-         if (iPlate == 0) {
-            nMarksIn++;
-            continue;
-            }
-/*       Determine if the point is within the given proximity; if it is,
-         transfer the coordinates to the next free slot in the output block */
-         isClose = 0;                           /* unknown, we must determine */
-/*       Point coordinates on near-conformal sphere - fast transformation */
-         nemo_Us8ToNcs(ptUs8in[i], &ptNcs);
-/*       For curios cats: comment out the following statement,
-         recompile and observe the change in reported duration */
-         isClose = proxChordTest(&rtcNcs, &ptNcs, chSqNear, chSqFar);
-         if (isClose == 0) {   /* chord proximity test did not provide answer */
-/*          Somewhat more expensive transformation of point coordinates to
-            the ellipsoid, followed by a much more expensive geodesic test... */
-            nemo_NcsToEnr(nemo_ElrWgs84(), &ptNcs, &ptEnr);   /* to ellipsoid */
-            isClose = proxGeodesicTest(&rtcEnr, &ptEnr, exRadGeodesic);
-            }
-         if (isClose > 0) {      /* point is close, must be written to output */
-            ptUs8out[nBout++] = ptUs8in[i];
-            if (nBout == BLOCK_POINTS) {        /* tile to write output block */
-               n = fwrite(ptUs8out, sizeof(nemoPtUs8), BLOCK_POINTS, fpOut);
-               if (n != BLOCK_POINTS) errorExit(progName, __LINE__,
-                   "write error at %d input, %d ouput record\n", nPtIn, nPtOut);
-               nBout = 0;                        /* output block is now empty */
-               }
-            nPtOut++;
-            }
-         else nPtFar++;                     /* point is far, was not included */
-         }
-      nBin = fread(ptUs8in, sizeof(nemoPtUs8), BLOCK_POINTS, fpIn);
-      nPtIn += nBin;
+   one above which it is rejected (for each circle, see setQuery()). For
+   points with squared chord distances between the two values, the more
+   expensive geodesic length computation will be required in order to
+   decide whether to include or reject. The circles' centers are then
+   indexed, to find those that can include the points of a block. */
+   if (nQueries == 1) fprintf(stderr, "geodesic, (NCS limits): %f, (%f, %f)\n",
+             queries->exRadGeodesic, queries->chSqNear, queries->chSqFar);
+   centers = malloc(nQueries * sizeof(nemoPtNcs));
+   if (centers == NULL) errorExit(progName, __LINE__, "No memory?\n");
+   chMaxFar = 0.0;
+   for (k = 0; k < nQueries; k++) {
+      centers[k] = queries[k].rtcNcs;
+      if (sqrt(queries[k].chSqReach) > chMaxFar) chMaxFar = sqrt(queries[k].chSqReach);
       }
+   if (kdtBuild(&queryTree, centers, nQueries))
+      errorExit(progName, __LINE__, "No memory for the circles' tree?\n");
+   free(centers);
 
-   clockSeconds = (double)(clock() - clockStart) / (double)CLOCKS_PER_SEC;
-   printf("duration: %6.3f seconds\n", clockSeconds);
+   nPtIn = nPtOut = nPtFar = nGeodTests = nMarksIn = nSkipped = 0;
+   pipe.nBlocks = (int)((inMap.nPts + BLOCK_POINTS - 1) / BLOCK_POINTS);
+   pipe.nextBlock = 0;
+   pipe.nSlots = nThreads ? (SLOTS_PER_THREAD * nThreads) : 1;
+   pipe.slots = calloc(pipe.nSlots, sizeof(struct selBlock));
+   prefetchCand = malloc(nQueries * sizeof(int));
+   if ((pipe.slots == NULL) || (prefetchCand == NULL))
+      errorExit(progName, __LINE__, "No memory for blocks?\n");
+   for (i = 0; i < pipe.nSlots; i++) {
+      blk = pipe.slots + i;
+      blk->iBlock = i;                  /* slot i is waiting for block i... */
+      blk->isReady = 0;                           /* ...yet to be processed */
+      blk->cand = malloc(3 * nQueries * sizeof(int));
+      blk->candEnd = blk->cand + nQueries;
+      blk->candGeod = blk->candEnd + nQueries;
+      blk->nOutCap = BLOCK_POINTS;
+      blk->ptUs8out = malloc(blk->nOutCap * sizeof(nemoPtUs8));
+      if ((blk->cand == NULL) || (blk->ptUs8out == NULL))
+         errorExit(progName, __LINE__, "No memory for blocks?\n");
+      }
 
-   if (nBout > 0) {                    /* write partially filled block and... */
-      n = fwrite(ptUs8out, sizeof(nemoPtUs8), nBout, fpOut);
-      if (n != nBout) errorExit(progName, __LINE__,
-          "write error at %d input, %d ouput record\n", nPtIn, nPtOut);
-      nBout = 0;            /* not that it matters, but output block is empty */
+   statsPhase("extraction");
+   prefetchBlocks(0, pipe.nSlots, prefetchCand);    /* the first ones taken */
+   wallStart = statsWall();
+   if (nThreads) {          /* start the workers, they'll take blocks in order */
+      fprintf(stderr, "Worker threads: %d\n", nThreads);
+      pthread_mutex_init(&pipe.mtx, NULL);
+      pthread_cond_init(&pipe.cond, NULL);
+      for (i = 0; i < nThreads; i++) {
+         if (pthread_create(threads + i, NULL, selectWorker, &pipe))
+            errorExit(progName, __LINE__, "Can't create thread %d\n", i);
+         }
+      }
+   for (nb = 0; nb < pipe.nBlocks; nb++) {        /* write blocks in order */
+      if (nb%1000 == 0) fprintf(stderr, "%d M\r", nb / 1000);
+      if (nb % PREFETCH_BLOCKS == 0)      /* beyond those the workers take */
+         prefetchBlocks(nb + pipe.nSlots, PREFETCH_BLOCKS, prefetchCand);
+      blk = pipe.slots + nb % pipe.nSlots;
+      if (nThreads) {          /* wait for a worker to finish the block... */
+         pthread_mutex_lock(&pipe.mtx);
+         while (!blk->isReady) pthread_cond_wait(&pipe.cond, &pipe.mtx);
+         pthread_mutex_unlock(&pipe.mtx);
+         }
+      else {                           /* ...or classify the block right here */
+         blk->iBlock = nb;
+         selectBlock(blk);
+         }
+      if (blk->isNoMem) errorExit(progName, __LINE__,
+                                  "No memory for block %d output?\n", nb);
+      if (blk->isBad) errorExit(progName, __LINE__,
+                                "Invalid input [%s] block %d\n", fnIn, nb);
+      for (i = 0; i < blk->nCand; i++) {       /* each circle's points, if */
+         q = queries + blk->cand[i];
+         k = i ? blk->candEnd[i - 1] : 0;
+         n = blk->candEnd[i] - k;
+         if ((n > 0) && asyncOutWrite(&q->aOut, blk->ptUs8out + k,
+                                      (size_t)n * sizeof(nemoPtUs8)))
+            errorExit(progName, __LINE__, "write error at %d input, %d "
+                      "ouput record of [%s]\n", nPtIn, q->nPtOut, q->fnOut);
+         q->nPtOut += n;
+         q->nGeod += blk->candGeod[i];
+         }
+      nPtIn += blk->nBin;
+      nMarksIn += blk->nMarks;
+      nSkipped += blk->isSkipped;
+      if (nThreads) {     /* hand the slot over to block nSlots further on */
+         pthread_mutex_lock(&pipe.mtx);
+         blk->iBlock = nb + pipe.nSlots;
+         blk->isReady = 0;
+         pthread_cond_broadcast(&pipe.cond);
+         pthread_mutex_unlock(&pipe.mtx);
+         }
+      }
+   if (nThreads) {
+      for (i = 0; i < nThreads; i++) pthread_join(threads[i], NULL);
+      pthread_mutex_destroy(&pipe.mtx);
+      pthread_cond_destroy(&pipe.cond);
+      }
+   for (i = 0; i < pipe.nSlots; i++) {
+      free(pipe.slots[i].cand);
+      free(pipe.slots[i].ptUs8out);
       }
+   free(pipe.slots);
+   free(prefetchCand);
+   for (k = 0; k < nQueries; k++) {
+      q = queries + k;
+      if (asyncOutClose(&q->aOut)) errorExit(progName, __LINE__,
+        "write error at %d ouput record of [%s]\n", q->nPtOut, q->fnOut);
+      fclose(q->fpOut);
+      nPtOut += q->nPtOut;
+      nGeodTests += q->nGeod;
+      }
+   if (nQueries > 1) asyncOutGroupClose(&outGroup);
+   nPtFar = nQueries * (nPtIn - nMarksIn) - nPtOut;  /* (each circle's own) */
+
+   printf("duration: %6.3f seconds (wall clock)\n", statsWall() - wallStart);
 
-   fclose(fpIn);
-   fclose(fpOut);
+   fileMapClose(&inMap);
+   kdtFree(&queryTree);
+   if (useIndex) capIndexFree(&inIndex);
 
    fprintf(stderr, "Input points (records):     %8d\n", nPtIn);
    fprintf(stderr, "Input segments or rings:    %8d\n", nMarksIn);
    fprintf(stderr, "Points included:            %8d\n", nPtOut);
    fprintf(stderr, "Points excluded:            %8d\n", nPtFar);
    fprintf(stderr, "Geodesic tests required:    %8d\n", nGeodTests);
+   if (useIndex) fprintf(stderr, "Blocks skipped by index:    %8d of %d\n",
+                                 nSkipped, pipe.nBlocks);
+   for (k = 0; (nQueries > 1) && (k < nQueries); k++) {
+      q = queries + k;
+      fprintf(stderr, "   %8d included, %8d geodesic tests: [%s]\n",
+                      q->nPtOut, q->nGeod, q->fnOut);
+      }
+   statsAdd("pointsIn", nPtIn);
+   statsAdd("segmentsOrRings", nMarksIn);
+   statsAdd("pointsIncluded", nPtOut);
+   statsAdd("pointsExcluded", nPtFar);
+   statsAdd("geodesicTests", nGeodTests);
+   statsAdd("blocks", pipe.nBlocks);
+   statsAdd("blocksSkipped", nSkipped);
+   if (nQueries > 1) statsAdd("queries", nQueries);
+   statsReport();
    return(0);
    }
 /* ========================================================================== */
-/* Determine point proximity based on quick (but possibly inconclusive)
-   spherical square proximity. Return 1 for close, -1 for far, 0 for
-   undetermined.
+/* Read ahead the n blocks from first on, but those the index skips; cand
+   is the room for their circles, as found by blockQueries().
  */
-int proxChordTest(nemoPtNcs *ncsA, nemoPtNcs *ncsB,       /* two given points */
-                  double chSqNear, double chSqFar) {     /* near/far criteria */
-   double chSq;
-   chSq = NEMO_ChordSq3(ncsA->dc, ncsB->dc);
-   if (chSq < chSqNear) return(1);                                  /* inside */
-   if (chSq > chSqFar) return(-1);                                 /* outside */
-   return(0);
+static void prefetchBlocks(int first, int n, int *cand) {
+   int ib, iLo, nBlocks;
+/* -------------------------------------------------------------------------- */
+   nBlocks = (int)((inMap.nPts + BLOCK_POINTS - 1) / BLOCK_POINTS);
+   if (first + n > nBlocks) n = nBlocks - first;
+   iLo = -1;                             /* first of a run of blocks to read */
+   for (ib = first; ib <= first + n; ib++) {
+      if ((ib < first + n) &&
+          (!useIndex || blockQueries(inIndex.blocks + ib, cand))) {
+         if (iLo < 0) iLo = ib;
+         }
+      else if (iLo >= 0) {                            /* the run ends here */
+         p8bMapPrefetch(&inMap, (size_t)iLo * BLOCK_POINTS,
+                        (size_t)(ib - iLo) * BLOCK_POINTS);
+         iLo = -1;
+         }
+      }
+   return;
+   }
+/* ========================================================================== */
+/* Find the circles that can include some of the points in the block cap cb:
+   the tree search is for centers closer than its radius plus the largest
+   circle radius, chord (the chord obeys the triangle inequality, and the
+   arcs - which capIndexCapHit() then tests, for each - are longer). The
+   circles are returned in cand; returns their number.
+ */
+static int blockQueries(const capBlock *cb, int *cand) {
+   int i, n, nCand;
+   double r;
+/* -------------------------------------------------------------------------- */
+   if (cb->chSq < 0.0) return(0);                           /* no points */
+   r = ((cb->chSq < 4.0) ? sqrt(cb->chSq) : 2.0) + chMaxFar + QUERY_CHORD_EPS;
+   n = kdtWithin(&queryTree, cb->dc, (r < 2.0) ? r * r : 5.0, cand, nQueries);
+   nCand = 0;
+   for (i = 0; i < n; i++) {
+      if (capIndexCapHit(cb, queries[cand[i]].rtcNcs.dc, queries[cand[i]].chSqReach))
+         cand[nCand++] = cand[i];
+      }
+   return(nCand);
    }
 /* ========================================================================== */
-/* Determine point proximity based on rigorous geodesic evaluation. Return
-   1 for close, -1 for far. (ε is so minuscule we can - somewhat arbitrary -
-   consider equal length to be "in").
+/* Classify the points in a block (given by blk->iBlock). Points within an
+   extraction circle are transferred to the output part of the block, in
+   input sequence, the circles that can include any of them one after the
+   other.
  */
-int proxGeodesicTest(nemoPtEnr *enrA, nemoPtEnr *enrB,    /* two given points */
-                     double geodesic) {      /* proximity criterion, geodesic */
-   double g;
-   g = nemo_GeodesicSzpila(nemo_ElrWgs84(), enrA,  enrB, NULL);
-   if (g == NEMO_DOUBLE_UNDEF) errorExit(progName, __LINE__,
-                            "Unexpected Vincenty failure\n");
-   if (g > geodesic) return(-1);
-   return(1);
+void selectBlock(struct selBlock *blk) {
+   int i, j, k, c, iPlate, nLoc, nOpen, nIn;
+   int isClose;                         /* 1:is close, -1:is far, 0:uncertain */
+   capBlock cb;                             /* bounding cap of the block */
+   nemoPtNcs *ptNcs;             /* input file point on near-conformal sphere */
+   nemoPtUs8 *grown;
+   struct selQuery *q;
+/* -------------------------------------------------------------------------- */
+   blk->nBin = ((inMap.nPts - (size_t)blk->iBlock * BLOCK_POINTS) < BLOCK_POINTS) ?
+          (int)(inMap.nPts - (size_t)blk->iBlock * BLOCK_POINTS) : BLOCK_POINTS;
+   blk->nBout = blk->nMarks = blk->nLoc = blk->nCand = 0;
+   blk->isSkipped = blk->isNoMem = blk->isBad = 0;
+   if (useIndex) {
+      blk->nCand = blockQueries(inIndex.blocks + blk->iBlock, blk->cand);
+      if (blk->nCand == 0) {              /* all too far: points not read */
+         blk->nMarks = inIndex.blocks[blk->iBlock].nMarks;
+         blk->isSkipped = 1;
+         return;
+         }
+      }
+   blk->ptUs8in = p8bMapRecs(&inMap, (size_t)blk->iBlock * BLOCK_POINTS,
+                             blk->nBin, blk->ptUs8dec);     /* slice, or... */
+   if (blk->ptUs8in == NULL) {
+      blk->isBad = 1;
+      blk->nCand = 0;
+      return;
+      }
+   for (i = 0; i < blk->nBin; i++) {        /* traverse points in input block */
+      iPlate = NEMO_Us8Plate(blk->ptUs8in[i]);
+      if (iPlate == 0) {
+         blk->nMarks++;
+         continue;
+         }
+/*    Point coordinates on near-conformal sphere - fast transformation */
+      blk->ptUs8loc[blk->nLoc] = blk->ptUs8in[i];
+      nemo_Us8ToNcs(blk->ptUs8in[i], blk->ptNcs + blk->nLoc++);
+      }
+   if (!useIndex) {                        /* the circles near the block */
+      capIndexBlockCap(&cb, blk->ptNcs, blk->nLoc);
+      blk->nCand = blockQueries(&cb, blk->cand);
+      }
+   if (blk->nCand * blk->nLoc > blk->nOutCap) {      /* (several circles) */
+      grown = realloc(blk->ptUs8out, blk->nCand * blk->nLoc * sizeof(nemoPtUs8));
+      if (grown == NULL) {
+         blk->isNoMem = 1;
+         blk->nCand = 0;
+         return;
+         }
+      blk->ptUs8out = grown;
+      blk->nOutCap = blk->nCand * blk->nLoc;
+      }
+
+   nLoc = blk->nLoc;
+   for (c = 0; c < blk->nCand; c++) {           /* each circle in its turn */
+      q = queries + blk->cand[c];
+      nOpen = nIn = 0;
+      for (i = 0; i < nLoc; i++) {
+/*       Determine if the point is within the given proximity: the indices of
+         those that are go to iIn, of those that may be (to be measured, below)
+         to iOpen */
+         ptNcs = blk->ptNcs + i;
+/*       For curios cats: comment out the following statement,
+         recompile and observe the change in reported duration */
+         isClose = proxChordTest(&q->rtcNcs, ptNcs, q->chSqNear, q->chSqFar);
+         if (isClose > 0) blk->iIn[nIn++] = i;
+         else if (isClose == 0) {  /* chord proximity test did not answer */
+/*          Somewhat more expensive transformation of point coordinates to
+            the ellipsoid, followed by a much more expensive geodesic test... */
+            nemo_NcsToEnr(nemo_ElrWgs84(), ptNcs, blk->ptEnr + nOpen);
+            blk->iOpen[nOpen++] = i;
+            }
+         }
+/*    ...for all of those at once: geodesics from the circle's centre (near
+      the criterion, by the library's Szpila; equal length is "in") */
+      geoFanNearBatch(&q->rtcFan, blk->ptEnr, nOpen, q->exRadGeodesic, blk->gOpen);
+      blk->candGeod[c] = nOpen;
+/*    Transfer the coordinates of the points within the circle to the next
+      free slots of the output block, in input sequence: the two (ascending)
+      index lists merged */
+      for (j = k = 0; k < nOpen; k++) {
+         if (blk->gOpen[k] == NEMO_DOUBLE_UNDEF) errorExit(progName, __LINE__,
+                                     "Unexpected Vincenty failure\n");
+         if (blk->gOpen[k] > q->exRadGeodesic) continue;            /* far */
+         while ((j < nIn) && (blk->iIn[j] < blk->iOpen[k]))
+            blk->ptUs8out[blk->nBout++] = blk->ptUs8loc[blk->iIn[j++]];
+         blk->ptUs8out[blk->nBout++] = blk->ptUs8loc[blk->iOpen[k]];
+         }
+      while (j < nIn) blk->ptUs8out[blk->nBout++] = blk->ptUs8loc[blk->iIn[j++]];
+      blk->candEnd[c] = blk->nBout;
+      }
+   return;
+   }
+/* ========================================================================== */
+/* Worker thread: take the next input block, wait until its slot has been
+   written out and freed, classify it and mark it ready for writing.
+ */
+void *selectWorker(void *arg) {
+   struct selPipe *pipe = arg;
+   struct selBlock *blk;
+   int nb;
+/* -------------------------------------------------------------------------- */
+   for (;;) {
+      pthread_mutex_lock(&pipe->mtx);
+      nb = pipe->nextBlock++;
+      if (nb >= pipe->nBlocks) {                  /* no more blocks, done */
+         pthread_mutex_unlock(&pipe->mtx);
+         break;
+         }
+      blk = pipe->slots + nb % pipe->nSlots;
+      while (blk->iBlock != nb) pthread_cond_wait(&pipe->cond, &pipe->mtx);
+      pthread_mutex_unlock(&pipe->mtx);
+      selectBlock(blk);
+
+      pthread_mutex_lock(&pipe->mtx);
+      blk->isReady = 1;
+      pthread_cond_broadcast(&pipe->cond);
+      pthread_mutex_unlock(&pipe->mtx);
+      }
+   return(NULL);
+   }
+/* ========================================================================== */
+/* Set the circle of center ptEll (φ, λ, radians) and radius (geodesic,
+   meters): its center on the ellipsoid and the NCS, its geodesic terms
+   (computed once) and its chord squared inclusion and exclusion limits.
+   The exclusion arc of a circle larger than half the meridian is over π:
+   such a circle may include the points of any block.
+ */
+static void setQuery(struct selQuery *q, const nemoPtEll *ptEll, double radius) {
+/* -------------------------------------------------------------------------- */
+   nemo_LatLongToDcos3(ptEll->a, q->rtcEnr.dc); /* to ellipsoid normal... */
+   nemo_EnrToNcs(nemo_ElrWgs84(), &q->rtcEnr, &q->rtcNcs);  /* ...NC sphere */
+   geoFanInit(&q->rtcFan, &q->rtcEnr);
+   q->exRadGeodesic = radius;
+   proxChordLimits(q->exRadGeodesic, &q->chSqNear, &q->chSqFar);
+   q->chSqReach = ((NEMO_GEOARC_MAX * radius / NEMO_EARTH_RADIUS) < NEMO_PI) ?
+                   q->chSqFar : 4.0;      /* (the chord is shorter again) */
+   return;
+   }
+/* ========================================================================== */
+/* Read the extraction circles (-queries file fn) into queries; returns
+   their number. Any error in the file is fatal.
+ */
+static int loadQueries(const char *fn) {
+   int n, nLines;
+   FILE *fp;
+   char textLine[MAX_QUERY_LINE + 2];
+   const char delimiters[] = ", \t\r\n";
+   char *token, *pathName, *end;
+   double radius;
+   nemoPtEll ptEll;
+/* -------------------------------------------------------------------------- */
+   fp = fopen(fn, "r");
+   if (fp == NULL) errorExit(progName, __LINE__, "Can't read [%s]\n", fn);
+   queries = calloc(MAX_QUERIES, sizeof(struct selQuery));
+   if (queries == NULL) errorExit(progName, __LINE__, "No memory?\n");
+   n = nLines = 0;
+   radius = 0.0;
+   while (fgets(textLine, MAX_QUERY_LINE, fp)) {
+      nLines++;
+      token = strtok(textLine, delimiters);
+      if ((token == NULL) || (*token == '#')) continue;    /* empty, comment */
+      ptEll.a[NEMO_LAT] = NEMO_DEG2RAD * strtod(token, &end);
+      if (*end == '\0') {
+         token = strtok(NULL, delimiters);
+         ptEll.a[NEMO_LNG] = NEMO_DEG2RAD * strtod(token ? token : "", &end);
+         }
+      if ((*end == '\0') && token) {
+         token = strtok(NULL, delimiters);
+         radius = strtod(token ? token : "", &end);
+         }
+      pathName = strtok(NULL, delimiters);
+      if ((token == NULL) || (*end != '\0') || !(radius > 0.0) || (pathName == NULL))
+         errorExit(progName, __LINE__, "[%s] line %d: not \"φ,λ radius "
+                                       "outFile\"\n", fn, nLines);
+      if (n == MAX_QUERIES) errorExit(progName, __LINE__,
+                      "[%s]: more than %d extractions\n", fn, MAX_QUERIES);
+      queries[n].fnOut = malloc(strlen(pathName) + 1);
+      if (queries[n].fnOut == NULL) errorExit(progName, __LINE__, "No memory?\n");
+      strcpy((char *)queries[n].fnOut, pathName);
+      setQuery(queries + n++, &ptEll, radius);
+      }
+   fclose(fp);
+   if (n == 0) errorExit(progName, __LINE__, "[%s]: no extractions\n", fn);
+   return(n);
    }
 /* ========================================================================== */
 void usage(const char *mA,                  /* first message string (or NULL) */
            const char *mB) {               /* second message string (or NULL) */
    if (mA || mB) fprintf (stderr, "Error: %s %s\n", mA ? mA : "\0", mB ? mB : "\0");
    fprintf (stderr, "Usage: %s [options] inFile outFile\n", progName);
+   fprintf (stderr, "       %s -queries=file [options] inFile\n", progName);
    fprintf (stderr, "  inFile:  .r8b (or.lnb, .p8b) binary coordinate input file\n");
    fprintf (stderr, "  outFile: .p8b binary coordinate output file\n");
    fprintf (stderr, "Options:\n");
    fprintf (stderr, " -h[elp|  to print this usage help and exit\n");
    fprintf (stderr, " -c[enter]=\"φ,λ\" extraction center, in decimal degrees\n");
    fprintf (stderr, " -r[adius]=nnn extraction radius, meters on planetary surface\n");
+   fprintf (stderr, " -t[hreads]=n  worker threads (default: single-threaded)\n");
+   fprintf (stderr, " -i[ndex]=file spatial index of inFile (created if not there)\n");
+   fprintf (stderr, " -q[ueries]=file many extractions, lines of \"φ,λ radius outFile\"\n");
+   fprintf (stderr, " -stats=text|json|file.json phases and counters report\n");
    exit(1);
    }
 /* ========================================================================== */
 #include "../scullions/errorExit.c"
 #include "../scullions/clFileOpt.c"
+#include "../scullions/fileMap.c"
+#include "../scullions/proxChord.c"
+#include "../scullions/capIndex.c"
+#include "../scullions/nemoStats.c"
+#include "../scullions/geoFan.c"
+#include "../scullions/ncsKdTree.c"
+#include "../scullions/asyncOut.c"
 /* ========================================================================== */
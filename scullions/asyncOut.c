@@ -0,0 +1,274 @@
+/* asyncOut.c: output written by a background thread (see asyncOut.h) */
+
+static int asyncOutInit(asyncOut *, FILE *, size_t, int);
+static int asyncOutQueue(asyncOut *);
+static void asyncOutWriteHead(asyncOut *);
+static void *asyncOutWorker(void *);
+static void *asyncOutGroupWorker(void *);
+/* ========================================================================== */
+/* Start the output to fp, through nBufs (2...MAX_BUFS) buffers of bufBytes
+   (0: ASYNC_OUT_BUF each). If the writer thread can't be created, the
+   buffers are written by the program's own asyncOutWrite() calls instead.
+   Returns 0 or ASYNC_OUT_NOMEM.
+ */
+int asyncOutOpen(asyncOut *ao,                          /* to be initialized */
+                 FILE *fp,                              /* the output file */
+                 size_t bufBytes,                /* bytes per buffer, or 0 */
+                 int nBufs) {                       /* number of buffers */
+/* -------------------------------------------------------------------------- */
+   if (asyncOutInit(ao, fp, bufBytes, nBufs)) return(ASYNC_OUT_NOMEM);
+   ao->mtx = &ao->ownMtx;
+   ao->cond = &ao->ownCond;
+   pthread_mutex_init(ao->mtx, NULL);
+   pthread_cond_init(ao->cond, NULL);
+   if (pthread_create(&ao->writer, NULL, asyncOutWorker, ao) == 0)
+      ao->isThreaded = 1;
+   return(0);
+   }
+/* ========================================================================== */
+/* Start the writer thread of group g, for up to maxOuts outputs (open at the
+   same time). If the thread can't be created, the outputs are written by
+   the program's own asyncOutWrite() calls. Returns 0 or ASYNC_OUT_NOMEM.
+ */
+int asyncOutGroupOpen(asyncOutGroup *g, int maxOuts) {
+/* -------------------------------------------------------------------------- */
+   memset(g, 0, sizeof(asyncOutGroup));
+   g->outs = calloc(maxOuts > 0 ? maxOuts : 1, sizeof(asyncOut *));
+   if (g->outs == NULL) return(ASYNC_OUT_NOMEM);
+   g->maxOuts = maxOuts;
+   pthread_mutex_init(&g->mtx, NULL);
+   pthread_cond_init(&g->cond, NULL);
+   if (pthread_create(&g->writer, NULL, asyncOutGroupWorker, g) == 0)
+      g->isThreaded = 1;
+   return(0);
+   }
+/* ========================================================================== */
+/* As asyncOutOpen(), but the output is written by the writer of group g.
+   Returns 0, or ASYNC_OUT_NOMEM (also if g has maxOuts outputs already).
+ */
+int asyncOutOpenIn(asyncOut *ao,                        /* to be initialized */
+                   asyncOutGroup *g,                  /* its shared writer */
+                   FILE *fp,                            /* the output file */
+                   size_t bufBytes,              /* bytes per buffer, or 0 */
+                   int nBufs) {                     /* number of buffers */
+   int i;
+/* -------------------------------------------------------------------------- */
+   if (asyncOutInit(ao, fp, bufBytes, nBufs)) return(ASYNC_OUT_NOMEM);
+   ao->group = g;
+   ao->mtx = &g->mtx;
+   ao->cond = &g->cond;
+   pthread_mutex_lock(ao->mtx);
+   for (i = 0; (i < g->nOuts) && g->outs[i]; i++) ;   /* a free (closed) one */
+   if (i < g->maxOuts) {
+      g->outs[i] = ao;
+      if (i == g->nOuts) g->nOuts++;
+      ao->isThreaded = g->isThreaded;
+      }
+   pthread_mutex_unlock(ao->mtx);
+   if (i == g->maxOuts) {
+      for (i = 0; i < ao->nBufs; i++) free(ao->bufs[i]);
+      memset(ao, 0, sizeof(asyncOut));               /* (nBufs 0: not open) */
+      return(ASYNC_OUT_NOMEM);
+      }
+   return(0);
+   }
+/* ========================================================================== */
+/* Stop the writer of group g, once all its outputs have been closed */
+void asyncOutGroupClose(asyncOutGroup *g) {
+/* -------------------------------------------------------------------------- */
+   if (g->isThreaded) {
+      pthread_mutex_lock(&g->mtx);
+      g->isClosing = 1;
+      pthread_cond_broadcast(&g->cond);
+      pthread_mutex_unlock(&g->mtx);
+      pthread_join(g->writer, NULL);
+      g->isThreaded = 0;
+      }
+   pthread_mutex_destroy(&g->mtx);
+   pthread_cond_destroy(&g->cond);
+   free(g->outs);
+   memset(g, 0, sizeof(asyncOutGroup));
+   return;
+   }
+/* ========================================================================== */
+/* The buffers and state of asyncOutOpen()/asyncOutOpenIn(), with no writer
+   yet. Returns 0 or ASYNC_OUT_NOMEM.
+ */
+static int asyncOutInit(asyncOut *ao, FILE *fp, size_t bufBytes, int nBufs) {
+   int i;
+   void *p;
+/* -------------------------------------------------------------------------- */
+   memset(ao, 0, sizeof(asyncOut));
+   ao->fp = fp;
+   ao->bufBytes = bufBytes ? bufBytes : ASYNC_OUT_BUF;
+   if (nBufs < 2) nBufs = 2;
+   if (nBufs > ASYNC_OUT_MAX_BUFS) nBufs = ASYNC_OUT_MAX_BUFS;
+   ao->nBufs = nBufs;
+   for (i = 0; i < nBufs; i++) {
+#ifndef _WIN32
+      if (posix_memalign(&p, ASYNC_OUT_ALIGN, ao->bufBytes)) p = NULL;
+#else
+      p = malloc(ao->bufBytes);
+#endif
+      ao->bufs[i] = p;
+      if (p == NULL) ao->iErr = ASYNC_OUT_NOMEM;
+      }
+   if (ao->iErr) {
+      for (i = 0; i < nBufs; i++) free(ao->bufs[i]);
+      memset(ao, 0, sizeof(asyncOut));               /* (nBufs 0: not open) */
+      return(ASYNC_OUT_NOMEM);
+      }
+   return(0);
+   }
+/* ========================================================================== */
+/* Append the n bytes at data to the output. Returns 0, or the error of an
+   earlier write (ASYNC_OUT_WRITE), once it has been found.
+ */
+int asyncOutWrite(asyncOut *ao, const void *data, size_t n) {
+   int iErr;
+   size_t k;
+   const unsigned char *p = data;
+/* -------------------------------------------------------------------------- */
+   iErr = 0;
+   while (n && (iErr == 0)) {
+      k = ao->bufBytes - ao->nBytes[ao->iFill];   /* room in the current one */
+      if (k > n) k = n;
+      memcpy(ao->bufs[ao->iFill] + ao->nBytes[ao->iFill], p, k);
+      ao->nBytes[ao->iFill] += k;
+      p += k;
+      n -= k;
+      if (ao->nBytes[ao->iFill] == ao->bufBytes) iErr = asyncOutQueue(ao);
+      }
+   return(iErr);
+   }
+/* ========================================================================== */
+/* Write the rest of the output, stop the writer (or, in a group, wait for
+   it to write all of this output) and free the buffers; the file itself is
+   flushed, but not closed. Returns 0 or ASYNC_OUT_WRITE.
+ */
+int asyncOutClose(asyncOut *ao) {
+   int i, iErr;
+   asyncOutGroup *g = ao->group;
+/* -------------------------------------------------------------------------- */
+   iErr = asyncOutQueue(ao);                            /* the last, partial */
+   if (g) {
+      pthread_mutex_lock(ao->mtx);
+      while (ao->nQueued > 0) pthread_cond_wait(ao->cond, ao->mtx);
+      for (i = 0; i < g->nOuts; i++) {
+         if (g->outs[i] == ao) g->outs[i] = NULL;     /* (slot free again) */
+         }
+      iErr = ao->iErr;
+      pthread_mutex_unlock(ao->mtx);
+      ao->isThreaded = 0;
+      }
+   else {
+      if (ao->isThreaded) {
+         pthread_mutex_lock(ao->mtx);
+         ao->isClosing = 1;
+         pthread_cond_broadcast(ao->cond);
+         pthread_mutex_unlock(ao->mtx);
+         pthread_join(ao->writer, NULL);
+         iErr = ao->iErr;
+         ao->isThreaded = 0;
+         }
+      pthread_mutex_destroy(ao->mtx);
+      pthread_cond_destroy(ao->cond);
+      }
+   for (i = 0; i < ao->nBufs; i++) {
+      free(ao->bufs[i]);
+      ao->bufs[i] = NULL;
+      }
+   if (fflush(ao->fp) && (iErr == 0)) iErr = ASYNC_OUT_WRITE;
+   ao->iErr = iErr;
+   return(iErr);
+   }
+/* ========================================================================== */
+/* Hand the buffer being filled over to the writer (or, with no writer
+   thread, write it here), and take the next free one - waiting for it, if
+   all are queued. Returns 0, or the error of a write.
+ */
+static int asyncOutQueue(asyncOut *ao) {
+   int iErr;
+/* -------------------------------------------------------------------------- */
+   if (ao->nBytes[ao->iFill] == 0) return(0);              /* nothing in it */
+   if (!ao->isThreaded) {
+      if ((ao->iErr == 0) &&
+          (fwrite(ao->bufs[ao->iFill], ao->nBytes[ao->iFill], 1, ao->fp) == 1))
+         ao->nWritten += ao->nBytes[ao->iFill];
+      else ao->iErr = ASYNC_OUT_WRITE;
+      ao->nBytes[ao->iFill] = 0;
+      return(ao->iErr);
+      }
+   pthread_mutex_lock(ao->mtx);
+   ao->nQueued++;
+   pthread_cond_broadcast(ao->cond);
+   while (ao->nQueued == ao->nBufs) pthread_cond_wait(ao->cond, ao->mtx);
+   ao->iFill = (ao->iHead + ao->nQueued) % ao->nBufs;
+   iErr = ao->iErr;
+   pthread_mutex_unlock(ao->mtx);
+   ao->nBytes[ao->iFill] = 0;               /* (the writer is done with it) */
+   return(iErr);
+   }
+/* ========================================================================== */
+/* Writer thread: write the queued buffers, oldest first, until closed. After
+   a failed write, the rest are only taken off the queue.
+ */
+static void *asyncOutWorker(void *arg) {
+   asyncOut *ao = arg;
+/* -------------------------------------------------------------------------- */
+   pthread_mutex_lock(ao->mtx);
+   for (;;) {
+      while ((ao->nQueued == 0) && !ao->isClosing)
+         pthread_cond_wait(ao->cond, ao->mtx);
+      if (ao->nQueued == 0) break;                     /* closed, and done */
+      asyncOutWriteHead(ao);
+      }
+   pthread_mutex_unlock(ao->mtx);
+   return(NULL);
+   }
+/* ========================================================================== */
+/* Group writer thread: the oldest queued buffer of each open output in turn,
+   until the group is closed.
+ */
+static void *asyncOutGroupWorker(void *arg) {
+   asyncOutGroup *g = arg;
+   asyncOut *ao;
+   int j;
+/* -------------------------------------------------------------------------- */
+   pthread_mutex_lock(&g->mtx);
+   for (;;) {
+      for (ao = NULL, j = 0; (ao == NULL) && (j < g->nOuts); j++) {
+         ao = g->outs[(g->iNext + j) % g->nOuts];
+         if (ao && (ao->nQueued == 0)) ao = NULL;
+         }
+      if (ao == NULL) {                          /* nothing queued, anywhere */
+         if (g->isClosing) break;
+         pthread_cond_wait(&g->cond, &g->mtx);
+         continue;
+         }
+      g->iNext = (g->iNext + j) % g->nOuts;       /* (the one after this one) */
+      asyncOutWriteHead(ao);
+      }
+   pthread_mutex_unlock(&g->mtx);
+   return(NULL);
+   }
+/* ========================================================================== */
+/* Write the oldest queued buffer of ao and take it off the queue; called, and
+   returning, with ao->mtx locked (but not held during the fwrite()).
+ */
+static void asyncOutWriteHead(asyncOut *ao) {
+   int i, isOk;
+/* -------------------------------------------------------------------------- */
+   i = ao->iHead;
+   isOk = (ao->iErr == 0);
+   pthread_mutex_unlock(ao->mtx);
+   if (isOk) isOk = (fwrite(ao->bufs[i], ao->nBytes[i], 1, ao->fp) == 1);
+   pthread_mutex_lock(ao->mtx);
+   if (isOk) ao->nWritten += ao->nBytes[i];
+   else ao->iErr = ASYNC_OUT_WRITE;
+   ao->iHead = (ao->iHead + 1) % ao->nBufs;
+   ao->nQueued--;
+   pthread_cond_broadcast(ao->cond);
+   return;
+   }
+/* ========================================================================== */
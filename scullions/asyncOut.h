@@ -0,0 +1,77 @@
+/* asyncOut.h: output written by a background thread, so that the program
+   goes on computing (or formatting) the next block of its output while the
+   previous ones are being written - for the block-oriented tools whose
+   results are large: r8bToP8bSelect, rgnToR8b, r8bToAscii and listP8b
+   (through textOut).
+
+   The program's data is copied into one of nBufs large buffers (page aligned,
+   where the operating system allows); a full buffer is queued to the writer
+   thread, which writes it by one fwrite() call, and the program fills the
+   next free one. It waits only if all of them are still queued - that is,
+   if the output device is the slower part. The bytes written, and their
+   order, are the same as those of plain fwrite() calls.
+
+   A program writing many files at once (r8bToP8bSelect -queries) opens
+   them in one asyncOutGroup instead (asyncOutGroupOpen(), then
+   asyncOutOpenIn() for each): a single writer thread then writes the queued
+   buffers of all of them, in turns, so that the thread count does not grow
+   with the number of files.
+
+   The input side of such a pipeline needs no thread: the input files are
+   memory mapped (see fileMap), and fileMapPrefetch() asks the operating
+   system to read the part of the file ahead of the one being processed.
+
+   Include after nemo.h; the implementation (asyncOut.c) is included at the
+   end of the program source, just like other scullions.
+ */
+#ifndef ASYNC_OUT_H
+#define ASYNC_OUT_H
+
+#include <pthread.h>
+
+#define ASYNC_OUT_NOMEM     -1                 /* no memory for the buffers */
+#define ASYNC_OUT_WRITE     -2                      /* fwrite() has failed */
+
+#define ASYNC_OUT_MAX_BUFS   8
+#define ASYNC_OUT_BUF  (4 * 1024 * 1024)     /* default buffer size, bytes */
+#define ASYNC_OUT_ALIGN   4096                   /* buffer alignment, bytes */
+
+struct asyncOut;
+
+typedef struct asyncOutGroup {       /* one writer thread for many outputs */
+   struct asyncOut **outs;              /* its open outputs (NULL: closed) */
+   int maxOuts, nOuts;
+   int iNext;                          /* the output to be looked at next */
+   int isClosing;                           /* 1: no more output to come */
+   int isThreaded;                 /* 0: no writer thread, fwrite() there */
+   pthread_t writer;
+   pthread_mutex_t mtx;
+   pthread_cond_t cond;
+   } asyncOutGroup;
+
+typedef struct asyncOut {
+   FILE *fp;                                          /* the output file */
+   unsigned char *bufs[ASYNC_OUT_MAX_BUFS];
+   size_t nBytes[ASYNC_OUT_MAX_BUFS];                  /* ...bytes in each */
+   size_t bufBytes;                                     /* their capacity */
+   int nBufs;
+   int iFill;                         /* the one being filled by the program */
+   int iHead, nQueued;         /* oldest queued buffer (being written), and */
+   int isClosing;                     /* ...how many; 1: no more to come */
+   int isThreaded;                /* 0: no writer thread, fwrite() here */
+   int iErr;
+   size_t nWritten;                                 /* total bytes written */
+   asyncOutGroup *group;        /* its shared writer, or NULL: its own one */
+   pthread_t writer;
+   pthread_mutex_t ownMtx, *mtx;       /* its own, or those of the group */
+   pthread_cond_t ownCond, *cond;
+   } asyncOut;
+
+int asyncOutOpen(asyncOut *, FILE *, size_t, int);
+int asyncOutWrite(asyncOut *, const void *, size_t);
+int asyncOutClose(asyncOut *);
+int asyncOutGroupOpen(asyncOutGroup *, int);
+int asyncOutOpenIn(asyncOut *, asyncOutGroup *, FILE *, size_t, int);
+void asyncOutGroupClose(asyncOutGroup *);
+
+#endif
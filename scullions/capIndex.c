@@ -0,0 +1,217 @@
+/* capIndex.c: spatial index of record blocks, as bounding caps (see
+   capIndex.h). The index file is the CAP_INDEX_MAGIC, the number of records,
+   their key hash (64-bit each), records per block and number of
+   blocks (32-bit each), followed by the array of capBlock structures; like
+   the coordinate files, it is endianness specific.
+ */
+
+#define CAP_INDEX_EPS   1.0e-9   /* radians, cap test margin for round-off */
+
+static double capArc(double);
+static int capKeyHash(const fileMap *, uint64_t *);
+/* ========================================================================== */
+/* Build the index of the fm->nPts records of fm, in blocks of blockRecs.
+   Returns 0 on success, CAP_INDEX_NOMEM if there was no memory, or
+   CAP_INDEX_FORMAT if the (.z8b) records can't be decoded.
+ */
+int capIndexBuild(capIndex *ci,                             /* index to build */
+                  const fileMap *fm,               /* file, of Us8 records */
+                  int blockRecs) {                           /* in a block */
+   int b, i, n, nIn, nMarks, iErr;
+   size_t nRecs;
+   const nemoPtUs8 *recs;                             /* those of a block */
+   nemoPtUs8 *buf;                                   /* ...if decoded (.z8b) */
+   nemoPtNcs *pts;                          /* locations of the block, NCS */
+/* -------------------------------------------------------------------------- */
+   memset(ci, 0, sizeof(capIndex));
+   nRecs = fm->nPts;
+   ci->nRecs = nRecs;
+   ci->blockRecs = blockRecs;
+   ci->nBlocks = (int)((nRecs + blockRecs - 1) / blockRecs);
+   ci->blocks = calloc(ci->nBlocks ? ci->nBlocks : 1, sizeof(capBlock));
+   pts = malloc(blockRecs * sizeof(nemoPtNcs));
+   buf = malloc(blockRecs * sizeof(nemoPtUs8));
+   iErr = ((ci->blocks == NULL) || (pts == NULL) || (buf == NULL)) ?
+          CAP_INDEX_NOMEM : capKeyHash(fm, &ci->keyHash);
+   for (b = 0; (iErr == 0) && (b < ci->nBlocks); b++) {
+      nIn = (nRecs - (size_t)b * blockRecs < (size_t)blockRecs) ?
+            (int)(nRecs - (size_t)b * blockRecs) : blockRecs;
+      recs = p8bMapRecs(fm, (size_t)b * blockRecs, nIn, buf);
+      if (recs == NULL) {
+         iErr = CAP_INDEX_FORMAT;
+         break;
+         }
+      n = nMarks = 0;
+      for (i = 0; i < nIn; i++) {
+         if (NEMO_Us8Plate(recs[i]) == 0) nMarks++;
+         else nemo_Us8ToNcs(recs[i], pts + n++);
+         }
+      capIndexBlockCap(ci->blocks + b, pts, n);
+      ci->blocks[b].nMarks = nMarks;
+      }
+   free(pts);
+   free(buf);
+   return(iErr);
+   }
+/* ========================================================================== */
+/* Find the bounding cap of the nPts points (no markers) as cb; its nMarks
+   is left 0. The center is their normalized sum, the radius the farthest.
+ */
+void capIndexBlockCap(capBlock *cb, const nemoPtNcs *pts, int nPts) {
+   int k, c;
+   double s, chSq;
+/* -------------------------------------------------------------------------- */
+   memset(cb, 0, sizeof(capBlock));
+   cb->nPts = nPts;
+   cb->chSq = -1.0;
+   if (nPts == 0) return;
+   for (k = 0; k < nPts; k++) {           /* the center: sum, normalized... */
+      for (c = 0; c < 3; c++) cb->dc[c] += pts[k].dc[c];
+      }
+   s = sqrt(cb->dc[0] * cb->dc[0] + cb->dc[1] * cb->dc[1] + cb->dc[2] * cb->dc[2]);
+   if (s < 1.0e-6) {             /* points all over the sphere: whole of it */
+      cb->dc[0] = 1.0;
+      cb->dc[1] = cb->dc[2] = 0.0;
+      cb->chSq = 4.0;
+      return;
+      }
+   for (c = 0; c < 3; c++) cb->dc[c] /= s;
+   for (k = 0; k < nPts; k++) {                            /* ...the radius */
+      chSq = NEMO_ChordSq3(cb->dc, pts[k].dc);
+      if (chSq > cb->chSq) cb->chSq = chSq;
+      }
+   return;
+   }
+/* ========================================================================== */
+/* Write the index to file fn. Returns 0 on success, or CAP_INDEX_IO. */
+int capIndexSave(const capIndex *ci, const char *fn) {
+   int iErr;
+   uint64_t hdr[2];
+   int hdrBlock[2];
+   FILE *fp;
+/* -------------------------------------------------------------------------- */
+   fp = fopen(fn, "wb");
+   if (fp == NULL) return(CAP_INDEX_IO);
+   hdr[0] = ci->nRecs;
+   hdr[1] = ci->keyHash;
+   hdrBlock[0] = ci->blockRecs;
+   hdrBlock[1] = ci->nBlocks;
+   iErr = ((fwrite(CAP_INDEX_MAGIC, 1, 8, fp) != 8) ||
+           (fwrite(hdr, sizeof(uint64_t), 2, fp) != 2) ||
+           (fwrite(hdrBlock, sizeof(int), 2, fp) != 2) ||
+           (fwrite(ci->blocks, sizeof(capBlock), ci->nBlocks, fp) !=
+                                                  (size_t)ci->nBlocks));
+   if (fclose(fp)) iErr = 1;
+   return(iErr ? CAP_INDEX_IO : 0);
+   }
+/* ========================================================================== */
+/* Read the index from file fn. Returns 0 on success, CAP_INDEX_IO if it
+   can't be read, CAP_INDEX_FORMAT if it is not an index file, or
+   CAP_INDEX_NOMEM.
+ */
+int capIndexLoad(capIndex *ci, const char *fn) {
+   int iErr;
+   char magic[8];
+   uint64_t hdr[2];
+   int hdrBlock[2];
+   FILE *fp;
+/* -------------------------------------------------------------------------- */
+   memset(ci, 0, sizeof(capIndex));
+   fp = fopen(fn, "rb");
+   if (fp == NULL) return(CAP_INDEX_IO);
+   iErr = 0;
+   if ((fread(magic, 1, 8, fp) != 8) || memcmp(magic, CAP_INDEX_MAGIC, 8) ||
+       (fread(hdr, sizeof(uint64_t), 2, fp) != 2) ||
+       (fread(hdrBlock, sizeof(int), 2, fp) != 2) ||
+       (hdrBlock[0] < 1) || (hdrBlock[1] < 0) ||
+       ((uint64_t)hdrBlock[1] != (hdr[0] + hdrBlock[0] - 1) / hdrBlock[0]))
+      iErr = CAP_INDEX_FORMAT;
+   else {
+      ci->nRecs = (size_t)hdr[0];
+      ci->keyHash = hdr[1];
+      ci->blockRecs = hdrBlock[0];
+      ci->nBlocks = hdrBlock[1];
+      ci->blocks = malloc((ci->nBlocks ? ci->nBlocks : 1) * sizeof(capBlock));
+      if (ci->blocks == NULL) iErr = CAP_INDEX_NOMEM;
+      else if (fread(ci->blocks, sizeof(capBlock), ci->nBlocks, fp) !=
+                                              (size_t)ci->nBlocks)
+         iErr = CAP_INDEX_FORMAT;
+      }
+   fclose(fp);
+   if (iErr) capIndexFree(ci);
+   return(iErr);
+   }
+/* ========================================================================== */
+/* Check that the index was built for the records of fm (number, and the
+   hash of the sampled ones), in blocks of blockRecs.
+   Returns 0 if it was, CAP_INDEX_FORMAT if it was not.
+ */
+int capIndexMatch(const capIndex *ci, const fileMap *fm, int blockRecs) {
+   uint64_t h;
+/* -------------------------------------------------------------------------- */
+   if ((ci->nRecs != fm->nPts) || (ci->blockRecs != blockRecs))
+      return(CAP_INDEX_FORMAT);
+   if (capKeyHash(fm, &h) || (ci->keyHash != h))
+      return(CAP_INDEX_FORMAT);
+   return(0);
+   }
+/* ========================================================================== */
+/* Can block iBlock have points within chSqRadius (chord squared) of dc?
+   Returns 1 if it can, 0 if it certainly has none.
+ */
+int capIndexHit(const capIndex *ci, int iBlock, const double *dc,
+                double chSqRadius) {
+/* -------------------------------------------------------------------------- */
+   return(capIndexCapHit(ci->blocks + iBlock, dc, chSqRadius));
+   }
+/* ========================================================================== */
+/* As capIndexHit(), for the cap cb (of the index, or capIndexBlockCap()) */
+int capIndexCapHit(const capBlock *cb, const double *dc, double chSqRadius) {
+   double arcBlock, arcRadius, arcCenters;
+/* -------------------------------------------------------------------------- */
+   if (cb->chSq < 0.0) return(0);                            /* no points */
+   if ((cb->chSq >= 4.0) || (chSqRadius >= 4.0)) return(1);
+   arcBlock = capArc(cb->chSq);
+   arcRadius = capArc(chSqRadius);
+   arcCenters = capArc(NEMO_ChordSq3(cb->dc, dc));
+   return((arcCenters <= arcBlock + arcRadius + CAP_INDEX_EPS) ? 1 : 0);
+   }
+/* ========================================================================== */
+void capIndexFree(capIndex *ci) {
+   free(ci->blocks);
+   memset(ci, 0, sizeof(capIndex));
+   return;
+   }
+/* ========================================================================== */
+/* Arc (radians, on the unit sphere) subtended by the chord squared */
+static double capArc(double chSq) {
+   if (chSq >= 4.0) return(NEMO_PI);
+   return(2.0 * asin(0.5 * sqrt(chSq)));
+   }
+/* ========================================================================== */
+/* FNV-1a hash (as *pHash) of CAP_INDEX_SAMPLES records of fm, evenly spaced
+   from the first to the last (all of them, if there are not more): a
+   bounded read of the file. Returns 0, or CAP_INDEX_FORMAT if the (.z8b)
+   records can't be decoded.
+ */
+static int capKeyHash(const fileMap *fm, uint64_t *pHash) {
+   int i, j, nSamples;
+   size_t nRecs;
+   uint64_t h, key;
+   const nemoPtUs8 *rec;
+   nemoPtUs8 buf;
+/* -------------------------------------------------------------------------- */
+   h = 0xcbf29ce484222325;                             /* FNV offset basis */
+   nRecs = fm->nPts;
+   nSamples = (nRecs < CAP_INDEX_SAMPLES) ? (int)nRecs : CAP_INDEX_SAMPLES;
+   for (j = 0; j < nSamples; j++) {
+      rec = p8bMapRecs(fm, (nSamples > 1) ?
+                           (nRecs - 1) * j / (nSamples - 1) : 0, 1, &buf);
+      if (rec == NULL) return(CAP_INDEX_FORMAT);
+      key = *rec;
+      for (i = 0; i < 8; i++, key >>= 8) h = (h ^ (key & 0xff)) * 0x100000001b3;
+      }
+   *pHash = h;
+   return(0);
+   }
+/* ========================================================================== */
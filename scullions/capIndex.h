@@ -0,0 +1,64 @@
+/* capIndex.h: spatial index of a binary coordinate file (.p8b, .r8b ...) as
+   a bounding spherical cap (on the NCS) of each of its blocks of records.
+   Sorted .p8b files keep close together in the file the locations that are
+   close together on the sphere, and so do region (.r8b) files, ring by ring:
+   the points of a block are thus confined to a small cap, and a search for
+   the points within some distance of a given one can skip any block whose
+   cap is farther than that. Since a memory-mapped file is read only where
+   it is accessed, an extraction then reads the blocks it needs, not the
+   whole file.
+
+   (The caps are found from the data, not from the Us8 key: the index so
+   works for any record order, and does not rely on the Us8 plate layout).
+
+   The index is kept in a "side" file, created once (capIndexBuild(), then
+   capIndexSave()) and then used for any number of searches. It records the
+   number of records of the file it was built for, and a hash of
+   CAP_INDEX_SAMPLES of them, evenly spaced from the first to the last:
+   capIndexMatch() checks both against the file to be searched, reading only
+   those few records (pages) of it, so that an index is not taken for that of
+   another file - except one that differs nowhere near the samples. The cap of
+   a block can also be found on its own, from its points already on the NCS
+   (capIndexBlockCap()), and tested just like those of the index.
+
+   The records are read through fileMap (p8bMapRecs()), so that the file may
+   be .z8b as well, opened by p8bMapOpenBlocks(): decoded only where read.
+
+   Include after nemo.h and fileMap.h; the implementation (capIndex.c) is
+   included at the end of the program source, just like other scullions.
+ */
+#ifndef CAP_INDEX_H
+#define CAP_INDEX_H
+
+#define CAP_INDEX_NOMEM   -1                       /* no memory for the index */
+#define CAP_INDEX_IO      -2                /* can't open, read or write file */
+#define CAP_INDEX_FORMAT  -3            /* not an index file, or not this one */
+
+#define CAP_INDEX_MAGIC   "NemoCIX\003"
+#define CAP_INDEX_SAMPLES   16                /* records hashed, at most */
+
+typedef struct {                                  /* one block of records */
+   double dc[3];                          /* bounding cap center, on NCS... */
+   double chSq;              /* ...and radius, chord squared; -1.0: no points */
+   int nPts;                              /* location records in the block */
+   int nMarks;                  /* segment/ring end markers (plate 0) in it */
+   } capBlock;
+
+typedef struct {
+   size_t nRecs;                         /* records in the indexed file... */
+   uint64_t keyHash;             /* ...CAP_INDEX_SAMPLES of them, hashed */
+   int blockRecs;                       /* records per block (but the last) */
+   int nBlocks;
+   capBlock *blocks;
+   } capIndex;
+
+int capIndexBuild(capIndex *, const fileMap *, int);
+int capIndexSave(const capIndex *, const char *);
+int capIndexLoad(capIndex *, const char *);
+int capIndexMatch(const capIndex *, const fileMap *, int);
+int capIndexHit(const capIndex *, int, const double *, double);
+void capIndexBlockCap(capBlock *, const nemoPtNcs *, int);
+int capIndexCapHit(const capBlock *, const double *, double);
+void capIndexFree(capIndex *);
+
+#endif
@@ -0,0 +1,256 @@
+/* chordSqBatch.c: chord squared from one NCS point to an SoA array of points
+   (see chordSqBatch.h). The chord squared is evaluated the same way in vector
+   and scalar code: ((dx * dx + dy * dy) + dz * dz), without fused
+   multiply-add, so that all code paths find the same minimum. Contraction is
+   switched off below for this file only, since the compiler would otherwise
+   be free to fuse the scalar (or intrinsic) multiplies and adds on FMA hosts.
+ */
+#if defined(__clang__)
+#pragma clang fp contract(off)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC optimize("fp-contract=off")
+#endif
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#define CH_SQ_VECTOR
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define CH_SQ_VECTOR
+#endif
+
+#ifdef CH_SQ_VECTOR
+static double chSqMinReduce(const double *, const double *, int, int *);
+#endif
+/* ========================================================================== */
+/* Allocate SoA arrays for nPts points. Returns 0 on success, -1 if there was
+   not enough memory.
+ */
+int ncsSoaAlloc(ncsSoa *s, int nPts) {
+/* -------------------------------------------------------------------------- */
+   s->nPts = nPts;
+   s->x = malloc((size_t)(nPts ? nPts : 1) * sizeof(double));
+   s->y = malloc((size_t)(nPts ? nPts : 1) * sizeof(double));
+   s->z = malloc((size_t)(nPts ? nPts : 1) * sizeof(double));
+   if ((s->x == NULL) || (s->y == NULL) || (s->z == NULL)) {
+      ncsSoaFree(s);
+      return(-1);
+      }
+   return(0);
+   }
+/* ========================================================================== */
+void ncsSoaFree(ncsSoa *s) {
+   free(s->x);
+   free(s->y);
+   free(s->z);
+   s->x = s->y = s->z = NULL;
+   s->nPts = 0;
+   return;
+   }
+/* ========================================================================== */
+/* Minimum chord squared from q to the points [lo, hi) of s, and (if iMin is
+   not NULL) the index of the nearest point; returns NEMO_DOUBLE_HUGE and
+   index -1 for empty range.
+ */
+double chSqMinSoa(const double *q,                /* query direction cosines */
+                  const ncsSoa *s,                              /* SoA points */
+                  int lo, int hi,                           /* range in s */
+                  int *iMin) {                 /* nearest point, or NULL */
+   int i, iBest;
+   double dx, dy, dz, chSq, chSqBest;
+/* -------------------------------------------------------------------------- */
+   iBest = -1;
+   chSqBest = NEMO_DOUBLE_HUGE;
+   i = lo;
+#if defined(__AVX512F__)
+   if (hi - lo >= 16) {
+      __m512d qx = _mm512_set1_pd(q[0]), qy = _mm512_set1_pd(q[1]);
+      __m512d qz = _mm512_set1_pd(q[2]);
+      __m512d vMin = _mm512_set1_pd(NEMO_DOUBLE_HUGE);
+      __m512d vIdx = _mm512_set1_pd(-1.0);
+      __m512d vCur = _mm512_set_pd(7, 6, 5, 4, 3, 2, 1, 0);
+      __m512d vStep = _mm512_set1_pd(8.0);
+      __m512d d, e, f;
+      __mmask8 m;
+      double lMin[8], lIdx[8];
+      vCur = _mm512_add_pd(vCur, _mm512_set1_pd((double)lo));
+      for (; i + 8 <= hi; i += 8) {
+         d = _mm512_sub_pd(_mm512_loadu_pd(s->x + i), qx);
+         e = _mm512_sub_pd(_mm512_loadu_pd(s->y + i), qy);
+         f = _mm512_sub_pd(_mm512_loadu_pd(s->z + i), qz);
+         d = _mm512_add_pd(_mm512_add_pd(_mm512_mul_pd(d, d),
+                                         _mm512_mul_pd(e, e)), _mm512_mul_pd(f, f));
+         m = _mm512_cmp_pd_mask(d, vMin, _CMP_LT_OQ);
+         vMin = _mm512_mask_mov_pd(vMin, m, d);
+         vIdx = _mm512_mask_mov_pd(vIdx, m, vCur);
+         vCur = _mm512_add_pd(vCur, vStep);
+         }
+      _mm512_storeu_pd(lMin, vMin);
+      _mm512_storeu_pd(lIdx, vIdx);
+      chSqBest = chSqMinReduce(lMin, lIdx, 8, &iBest);
+      }
+#elif defined(__AVX2__)
+   if (hi - lo >= 8) {
+      __m256d qx = _mm256_set1_pd(q[0]), qy = _mm256_set1_pd(q[1]);
+      __m256d qz = _mm256_set1_pd(q[2]);
+      __m256d vMin = _mm256_set1_pd(NEMO_DOUBLE_HUGE);
+      __m256d vIdx = _mm256_set1_pd(-1.0);
+      __m256d vCur = _mm256_set_pd(3, 2, 1, 0);
+      __m256d vStep = _mm256_set1_pd(4.0);
+      __m256d d, e, f, m;
+      double lMin[4], lIdx[4];
+      vCur = _mm256_add_pd(vCur, _mm256_set1_pd((double)lo));
+      for (; i + 4 <= hi; i += 4) {
+         d = _mm256_sub_pd(_mm256_loadu_pd(s->x + i), qx);
+         e = _mm256_sub_pd(_mm256_loadu_pd(s->y + i), qy);
+         f = _mm256_sub_pd(_mm256_loadu_pd(s->z + i), qz);
+         d = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(d, d),
+                                         _mm256_mul_pd(e, e)), _mm256_mul_pd(f, f));
+         m = _mm256_cmp_pd(d, vMin, _CMP_LT_OQ);
+         vMin = _mm256_blendv_pd(vMin, d, m);
+         vIdx = _mm256_blendv_pd(vIdx, vCur, m);
+         vCur = _mm256_add_pd(vCur, vStep);
+         }
+      _mm256_storeu_pd(lMin, vMin);
+      _mm256_storeu_pd(lIdx, vIdx);
+      chSqBest = chSqMinReduce(lMin, lIdx, 4, &iBest);
+      }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+   if (hi - lo >= 4) {
+      float64x2_t qx = vdupq_n_f64(q[0]), qy = vdupq_n_f64(q[1]);
+      float64x2_t qz = vdupq_n_f64(q[2]);
+      float64x2_t vMin = vdupq_n_f64(NEMO_DOUBLE_HUGE);
+      float64x2_t vIdx = vdupq_n_f64(-1.0);
+      float64x2_t vCur = { (double)lo, (double)lo + 1.0 };
+      float64x2_t vStep = vdupq_n_f64(2.0);
+      float64x2_t d, e, f;
+      uint64x2_t m;
+      double lMin[2], lIdx[2];
+      for (; i + 2 <= hi; i += 2) {
+         d = vsubq_f64(vld1q_f64(s->x + i), qx);
+         e = vsubq_f64(vld1q_f64(s->y + i), qy);
+         f = vsubq_f64(vld1q_f64(s->z + i), qz);
+         d = vaddq_f64(vaddq_f64(vmulq_f64(d, d), vmulq_f64(e, e)), vmulq_f64(f, f));
+         m = vcltq_f64(d, vMin);
+         vMin = vbslq_f64(m, d, vMin);
+         vIdx = vbslq_f64(m, vCur, vIdx);
+         vCur = vaddq_f64(vCur, vStep);
+         }
+      vst1q_f64(lMin, vMin);
+      vst1q_f64(lIdx, vIdx);
+      chSqBest = chSqMinReduce(lMin, lIdx, 2, &iBest);
+      }
+#endif
+   for (; i < hi; i++) {                   /* scalar loop, or vector "tail" */
+      dx = s->x[i] - q[0];
+      dy = s->y[i] - q[1];
+      dz = s->z[i] - q[2];
+      chSq = (dx * dx + dy * dy) + dz * dz;
+      if (chSq < chSqBest) {
+         chSqBest = chSq;
+         iBest = i;
+         }
+      }
+   if (iMin) *iMin = iBest;
+   return(chSqBest);
+   }
+/* ========================================================================== */
+/* Chord squared from q to each of the points [lo, hi) of s, into chSq[0...] */
+void chSqFillSoa(const double *q,                 /* query direction cosines */
+                 const ncsSoa *s,                               /* SoA points */
+                 int lo, int hi,                            /* range in s */
+                 double *chSq) {              /* hi - lo results, returned */
+   int i;
+   double dx, dy, dz;
+/* -------------------------------------------------------------------------- */
+   i = lo;
+#if defined(__AVX512F__)
+   {
+      __m512d qx = _mm512_set1_pd(q[0]), qy = _mm512_set1_pd(q[1]);
+      __m512d qz = _mm512_set1_pd(q[2]);
+      __m512d d, e, f;
+      for (; i + 8 <= hi; i += 8) {
+         d = _mm512_sub_pd(_mm512_loadu_pd(s->x + i), qx);
+         e = _mm512_sub_pd(_mm512_loadu_pd(s->y + i), qy);
+         f = _mm512_sub_pd(_mm512_loadu_pd(s->z + i), qz);
+         _mm512_storeu_pd(chSq + (i - lo), _mm512_add_pd(_mm512_add_pd(
+           _mm512_mul_pd(d, d), _mm512_mul_pd(e, e)), _mm512_mul_pd(f, f)));
+         }
+   }
+#elif defined(__AVX2__)
+   {
+      __m256d qx = _mm256_set1_pd(q[0]), qy = _mm256_set1_pd(q[1]);
+      __m256d qz = _mm256_set1_pd(q[2]);
+      __m256d d, e, f;
+      for (; i + 4 <= hi; i += 4) {
+         d = _mm256_sub_pd(_mm256_loadu_pd(s->x + i), qx);
+         e = _mm256_sub_pd(_mm256_loadu_pd(s->y + i), qy);
+         f = _mm256_sub_pd(_mm256_loadu_pd(s->z + i), qz);
+         _mm256_storeu_pd(chSq + (i - lo), _mm256_add_pd(_mm256_add_pd(
+           _mm256_mul_pd(d, d), _mm256_mul_pd(e, e)), _mm256_mul_pd(f, f)));
+         }
+   }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+   {
+      float64x2_t qx = vdupq_n_f64(q[0]), qy = vdupq_n_f64(q[1]);
+      float64x2_t qz = vdupq_n_f64(q[2]);
+      float64x2_t d, e, f;
+      for (; i + 2 <= hi; i += 2) {
+         d = vsubq_f64(vld1q_f64(s->x + i), qx);
+         e = vsubq_f64(vld1q_f64(s->y + i), qy);
+         f = vsubq_f64(vld1q_f64(s->z + i), qz);
+         vst1q_f64(chSq + (i - lo),
+            vaddq_f64(vaddq_f64(vmulq_f64(d, d), vmulq_f64(e, e)), vmulq_f64(f, f)));
+         }
+   }
+#endif
+   for (; i < hi; i++) {
+      dx = s->x[i] - q[0];
+      dy = s->y[i] - q[1];
+      dz = s->z[i] - q[2];
+      chSq[i - lo] = (dx * dx + dy * dy) + dz * dz;
+      }
+   return;
+   }
+/* ========================================================================== */
+/* Name of the instruction set the kernels were compiled for (for reports) */
+const char *chSqBatchIsa(void) {
+#if defined(__AVX512F__)
+   return("AVX-512");
+#elif defined(__AVX2__)
+   return("AVX2");
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+   return("NEON");
+#else
+   return("scalar");
+#endif
+   }
+/* ========================================================================== */
+#ifdef CH_SQ_VECTOR
+/* Reduce per-lane minima and their indices to a single one; on equal
+   minima the lowest index wins, just as in a scalar sequential scan.
+ */
+static double chSqMinReduce(const double *lMin, const double *lIdx,
+                            int nLanes, int *iBest) {
+   int j;
+   double chSqBest;
+/* -------------------------------------------------------------------------- */
+   chSqBest = NEMO_DOUBLE_HUGE;
+   *iBest = -1;
+   for (j = 0; j < nLanes; j++) {
+      if (lIdx[j] < 0.0) continue;                       /* lane never hit */
+      if ((lMin[j] < chSqBest) ||
+          ((lMin[j] == chSqBest) && ((int)lIdx[j] < *iBest))) {
+         chSqBest = lMin[j];
+         *iBest = (int)lIdx[j];
+         }
+      }
+   return(chSqBest);
+   }
+#endif
+/* ========================================================================== */
+#if defined(__clang__)
+#pragma clang fp contract(on)
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
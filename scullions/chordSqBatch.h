@@ -0,0 +1,36 @@
+/* chordSqBatch.h: chord squared from one NCS point to many, the latter given
+   as a "structure of arrays" (SoA) of direction cosines: all x, all y and
+   all z components in three separate arrays. Such layout lets the vector
+   (SIMD) units of the processor compute 2 (NEON), 4 (AVX2) or 8 (AVX-512)
+   chords in a single instruction sequence.
+
+   The vector code path is selected at compile time, by the instruction set
+   the compiler has been told it can use (e.g. gcc -mavx2 or -march=native);
+   without it, a plain "scalar" loop is compiled. All paths return the same
+   index of the minimum: the lowest one, if there is more than one.
+
+   Include after nemo.h; the implementation (chordSqBatch.c) is included at
+   the end of the program source, just like other scullions.
+ */
+#ifndef CHORD_SQ_BATCH_H
+#define CHORD_SQ_BATCH_H
+
+typedef struct {
+   int nPts;                      /* number of points (allocated capacity) */
+   double *x, *y, *z;                   /* direction cosine components */
+   } ncsSoa;
+
+#define NCS_SOA_SET(s, i, ncs) { (s)->x[i] = (ncs)->dc[0];                    \
+                                 (s)->y[i] = (ncs)->dc[1];                    \
+                                 (s)->z[i] = (ncs)->dc[2]; }
+#define NCS_SOA_GET(s, i, ncs) { (ncs)->dc[0] = (s)->x[i];                    \
+                                 (ncs)->dc[1] = (s)->y[i];                    \
+                                 (ncs)->dc[2] = (s)->z[i]; }
+
+int ncsSoaAlloc(ncsSoa *, int);
+void ncsSoaFree(ncsSoa *);
+double chSqMinSoa(const double *, const ncsSoa *, int, int, int *);
+void chSqFillSoa(const double *, const ncsSoa *, int, int, double *);
+const char *chSqBatchIsa(void);
+
+#endif
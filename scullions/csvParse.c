@@ -0,0 +1,88 @@
+/* csvParse.c: numeric .csv field parsing (see csvParse.h) */
+
+static const double csvPow10[23] = {
+   1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+   1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+/* ========================================================================== */
+/* Parse a decimal number at p (leading blanks are skipped, text ends at
+   end at the latest) into *v. Returns the pointer past the number and any
+   trailing blanks, or NULL if there was no number.
+ */
+const char *csvParseDouble(const char *p, const char *end, double *v) {
+   const char *s, *q;
+   int neg, nDig, exp10, expNeg, expVal;
+   uint64_t m;
+   char buf[CSV_NUMBER_MAX + 1];
+/* -------------------------------------------------------------------------- */
+   while ((p < end) && CSV_IS_BLANK(*p)) p++;
+   s = p;
+   neg = 0;
+   if ((p < end) && ((*p == '-') || (*p == '+'))) neg = (*p++ == '-');
+   m = 0;
+   nDig = exp10 = 0;
+   q = p;
+   while ((p < end) && (*p >= '0') && (*p <= '9')) {       /* integer part */
+      if (m < 100000000000000000ULL) {
+         m = 10 * m + (uint64_t)(*p - '0');
+         if (m) nDig++;
+         }
+      else exp10++;                     /* too many digits to accumulate */
+      p++;
+      }
+   if ((p < end) && (*p == '.')) {                         /* fraction part */
+      p++;
+      while ((p < end) && (*p >= '0') && (*p <= '9')) {
+         if (m < 100000000000000000ULL) {
+            m = 10 * m + (uint64_t)(*p - '0');
+            if (m) nDig++;
+            exp10--;
+            }
+         p++;
+         }
+      }
+   if ((p == q) || ((p == q + 1) && (*q == '.'))) return(NULL); /* no digits */
+   if ((p < end) && ((*p == 'e') || (*p == 'E'))) {              /* exponent */
+      q = p + 1;
+      expNeg = 0;
+      if ((q < end) && ((*q == '-') || (*q == '+'))) expNeg = (*q++ == '-');
+      if ((q < end) && (*q >= '0') && (*q <= '9')) {
+         expVal = 0;
+         while ((q < end) && (*q >= '0') && (*q <= '9')) {
+            if (expVal < 10000) expVal = 10 * expVal + (*q - '0');
+            q++;
+            }
+         exp10 += expNeg ? -expVal : expVal;
+         p = q;
+         }
+      }
+   if ((nDig <= 15) && (exp10 >= -22) && (exp10 <= 22)) {      /* exact path */
+      *v = (exp10 < 0) ? (double)m / csvPow10[-exp10] : (double)m * csvPow10[exp10];
+      if (neg) *v = -*v;
+      }
+   else {                                      /* the rare, general case */
+      if (p - s > CSV_NUMBER_MAX) return(NULL);
+      memcpy(buf, s, (size_t)(p - s));
+      buf[p - s] = '\0';
+      *v = strtod(buf, NULL);
+      }
+   while ((p < end) && CSV_IS_BLANK(*p)) p++;
+   return(p);
+   }
+/* ========================================================================== */
+/* Return the pointer to the start of the next field on the line, just past
+   the delimiter, or NULL if the line ends (at '\n' or end) first.
+ */
+const char *csvNextField(const char *p, const char *end, char delim) {
+   while ((p < end) && (*p != delim) && (*p != '\n')) p++;
+   if ((p < end) && (*p == delim)) return(p + 1);
+   return(NULL);
+   }
+/* ========================================================================== */
+/* Return the pointer to the '\n' ending the line starting at p, or end */
+const char *csvLineEnd(const char *p, const char *end) {
+   const char *q;
+/* -------------------------------------------------------------------------- */
+   q = memchr(p, '\n', (size_t)(end - p));
+   return(q ? q : end);
+   }
+/* ========================================================================== */
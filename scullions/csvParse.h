@@ -0,0 +1,25 @@
+/* csvParse.h: parsing of numeric fields of delimited text (.csv) lines held
+   in memory - for instance, by fileMapOpen() - with no copying of lines,
+   no strtok() and no dependency on the current locale: the decimal
+   separator is always '.'.
+
+   csvParseDouble() is exact: for up to 15 significant digits and small
+   decimal exponents (virtually all coordinate values) the number is
+   computed as one correctly rounded multiplication or division of two
+   exactly represented doubles. Anything else is handed over to strtod().
+   Either way, the result is the same as that of strtod() or atof().
+
+   Include after nemo.h; the implementation (csvParse.c) is included at the
+   end of the program source, just like other scullions.
+ */
+#ifndef CSV_PARSE_H
+#define CSV_PARSE_H
+
+#define CSV_NUMBER_MAX   64          /* longest number text strtod() gets */
+#define CSV_IS_BLANK(c) (((c) == ' ') || ((c) == '\t') || ((c) == '\r'))
+
+const char *csvParseDouble(const char *, const char *, double *);
+const char *csvNextField(const char *, const char *, char);
+const char *csvLineEnd(const char *, const char *);
+
+#endif
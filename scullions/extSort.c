@@ -0,0 +1,232 @@
+/* extSort.c: sorted runs in temporary files, and their merge (see extSort.h) */
+#ifndef _WIN32
+#include <fcntl.h>
+#endif
+
+struct extStream {                           /* one run file, read buffered */
+   FILE *fp;
+   nemoPtUs8 *buf;
+   size_t nBuf, iBuf;                        /* points in buf, next one */
+   nemoPtUs8 cur;                                     /* current point */
+   };
+
+static int writeStart(extSort *, FILE *, const nemoPtUs8 *, size_t, int);
+static int writeWait(extSort *);
+static void *writeWorker(void *);
+static int streamFill(struct extStream *, size_t);
+static void heapDown(struct extStream *, int *, int, int);
+static void runName(const extSort *, int, char *);
+/* ========================================================================== */
+/* Start a sort with no runs yet; their file names will start with prefix.
+   Returns 0, or EXT_SORT_IO if the prefix is too long.
+ */
+int extSortInit(extSort *s, const char *prefix) {
+/* -------------------------------------------------------------------------- */
+   memset(s, 0, sizeof(extSort));
+   if (strlen(prefix) + 16 > EXT_SORT_NAME_MAX) return(EXT_SORT_IO);
+   strcpy(s->prefix, prefix);
+   return(0);
+   }
+/* ========================================================================== */
+/* Add the n sorted, unique points as the next run: their file is written in
+   the background, once the previous run has been written. The points must be
+   left as they are until the next extSortRun() or extSortMerge() call has
+   returned. Returns 0, or EXT_SORT_RUNS, _IO or _THREAD (which may also be
+   the result of the previous run's write).
+ */
+int extSortRun(extSort *s, const nemoPtUs8 *pts, size_t n) {
+   int iErr;
+   FILE *fp;
+   char fn[EXT_SORT_NAME_MAX];
+/* -------------------------------------------------------------------------- */
+   iErr = writeWait(s);                            /* the previous one, if */
+   if (iErr) return(iErr);
+   if (s->nRuns == EXT_SORT_MAX_RUNS) return(EXT_SORT_RUNS);
+   runName(s, s->nRuns, fn);
+   fp = fopen(fn, "wb");
+   if (fp == NULL) return(EXT_SORT_IO);
+   s->nRuns++;                  /* (now extSortFree() removes it, anyway) */
+   s->nPts += n;
+   return(writeStart(s, fp, pts, n, 1));
+   }
+/* ========================================================================== */
+/* Merge all the runs to out, bufPts points per buffer (at least MIN_BUF),
+   dropping the duplicates (points found in more than one run). The numbers
+   of the points written and dropped are returned in nOut and nDups. Returns
+   0, EXT_SORT_NOMEM, _IO or _THREAD.
+ */
+int extSortMerge(extSort *s,                                   /* the runs */
+                 FILE *out,                    /* merged output, written */
+                 size_t bufPts,           /* points per buffer, each run */
+                 size_t *nOut,                       /* points written, */
+                 size_t *nDups) {                     /* ...and dropped */
+   int i, nLive, iErr, iOut;
+   int *heap;                           /* live streams, smallest first */
+   size_t nBuf;
+   nemoPtUs8 last;
+   nemoPtUs8 *outBuf[2];                   /* filled, while other written */
+   struct extStream *in, *top;
+   char fn[EXT_SORT_NAME_MAX];
+/* -------------------------------------------------------------------------- */
+   *nOut = *nDups = 0;
+   iErr = writeWait(s);                                 /* the last run */
+   if (iErr) return(iErr);
+   if (bufPts < EXT_SORT_MIN_BUF) bufPts = EXT_SORT_MIN_BUF;
+   in = calloc(s->nRuns + 1, sizeof(struct extStream));
+   heap = malloc((s->nRuns + 1) * sizeof(int));
+   outBuf[0] = malloc(bufPts * sizeof(nemoPtUs8));
+   outBuf[1] = malloc(bufPts * sizeof(nemoPtUs8));
+   if ((in == NULL) || (heap == NULL) || (outBuf[0] == NULL) || (outBuf[1] == NULL))
+      iErr = EXT_SORT_NOMEM;
+   for (i = 0; (iErr == 0) && (i < s->nRuns); i++) {
+      runName(s, i, fn);
+      in[i].fp = fopen(fn, "rb");
+      in[i].buf = malloc(bufPts * sizeof(nemoPtUs8));
+      if (in[i].buf == NULL) iErr = EXT_SORT_NOMEM;
+      else if (in[i].fp == NULL) iErr = EXT_SORT_IO;
+#if !defined(_WIN32) && defined(POSIX_FADV_SEQUENTIAL)
+      else posix_fadvise(fileno(in[i].fp), 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+      }
+
+   nLive = 0;                                 /* the first point of each */
+   for (i = 0; (iErr == 0) && (i < s->nRuns); i++) {
+      iErr = streamFill(in + i, bufPts);
+      if ((iErr == 0) && (in[i].nBuf > 0)) heap[nLive++] = i;
+      }
+   for (i = nLive / 2 - 1; (iErr == 0) && (i >= 0); i--) heapDown(in, heap, nLive, i);
+   iOut = 0;
+   nBuf = 0;
+   last = 0;
+   while ((iErr == 0) && (nLive > 0)) {
+      top = in + heap[0];
+      if ((*nOut + nBuf == 0) || (top->cur != last)) {
+         last = top->cur;
+         outBuf[iOut][nBuf++] = last;
+         if (nBuf == bufPts) {          /* write it, and fill the other one */
+            iErr = writeStart(s, out, outBuf[iOut], nBuf, 0);
+            *nOut += nBuf;
+            iOut = 1 - iOut;
+            nBuf = 0;
+            }
+         }
+      else (*nDups)++;
+      if (top->iBuf == top->nBuf) {                  /* take its next point */
+         iErr = streamFill(top, bufPts);
+         if (top->nBuf == 0) heap[0] = heap[--nLive];       /* run is done */
+         }
+      else top->cur = top->buf[top->iBuf++];
+      if (nLive > 1) heapDown(in, heap, nLive, 0);
+      }
+   if (iErr == 0) iErr = writeStart(s, out, outBuf[iOut], nBuf, 0);
+   *nOut += nBuf;
+   i = writeWait(s);
+   if (iErr == 0) iErr = i;
+
+   for (i = 0; in && (i < s->nRuns); i++) {
+      if (in[i].fp) fclose(in[i].fp);
+      free(in[i].buf);
+      }
+   free(in);
+   free(heap);
+   free(outBuf[0]);
+   free(outBuf[1]);
+   return(iErr);
+   }
+/* ========================================================================== */
+/* Wait for any background write to finish, and remove the run files */
+void extSortFree(extSort *s) {
+   int i;
+   char fn[EXT_SORT_NAME_MAX];
+/* -------------------------------------------------------------------------- */
+   writeWait(s);
+   for (i = 0; i < s->nRuns; i++) {
+      runName(s, i, fn);
+      remove(fn);
+      }
+   s->nRuns = 0;
+   return;
+   }
+/* ========================================================================== */
+/* Write the n points to fp, by a background thread, once the write started
+   before it (if any) has finished. A run file is then closed by writeWait();
+   the merge output is not. Returns 0, or the error of the previous write.
+ */
+static int writeStart(extSort *s, FILE *fp, const nemoPtUs8 *pts, size_t n,
+                      int isRun) {
+   int iErr;
+/* -------------------------------------------------------------------------- */
+   iErr = writeWait(s);
+   if (iErr) {
+      if (isRun) fclose(fp);
+      return(iErr);
+      }
+   s->wFp = fp;
+   s->wPts = pts;
+   s->wCnt = n;
+   s->wIsRun = isRun;
+   s->wErr = 0;
+   if (pthread_create(&s->writer, NULL, writeWorker, s)) {
+      writeWorker(s);                /* no thread: write it here, and now */
+      if (s->wErr == 0) s->wErr = EXT_SORT_THREAD;
+      }
+   else s->isWriting = 1;
+   return(0);
+   }
+/* ========================================================================== */
+/* Wait for the background write (if any), and return its result */
+static int writeWait(extSort *s) {
+/* -------------------------------------------------------------------------- */
+   if (s->isWriting) {
+      pthread_join(s->writer, NULL);
+      s->isWriting = 0;
+      }
+   if (s->wFp && s->wIsRun) {                              /* close the run */
+      if (fclose(s->wFp) && (s->wErr == 0)) s->wErr = EXT_SORT_IO;
+      }
+   s->wFp = NULL;
+   return(s->wErr);
+   }
+/* ========================================================================== */
+static void *writeWorker(void *arg) {
+   extSort *s = arg;
+/* -------------------------------------------------------------------------- */
+   if (s->wCnt && (fwrite(s->wPts, sizeof(nemoPtUs8), s->wCnt, s->wFp) != s->wCnt))
+      s->wErr = EXT_SORT_IO;
+   return(NULL);
+   }
+/* ========================================================================== */
+/* Refill the stream's buffer from its file, and take its first point; at
+   the end of the file, nBuf is 0. Returns 0, or EXT_SORT_IO.
+ */
+static int streamFill(struct extStream *r, size_t bufPts) {
+/* -------------------------------------------------------------------------- */
+   r->nBuf = fread(r->buf, sizeof(nemoPtUs8), bufPts, r->fp);
+   r->iBuf = 0;
+   if ((r->nBuf == 0) && ferror(r->fp)) return(EXT_SORT_IO);
+   if (r->nBuf) r->cur = r->buf[r->iBuf++];
+   return(0);
+   }
+/* ========================================================================== */
+/* Move heap[i] down to its place in the heap of n streams, by current point */
+static void heapDown(struct extStream *in, int *heap, int n, int i) {
+   int c, t;
+/* -------------------------------------------------------------------------- */
+   for (;;) {
+      c = 2 * i + 1;                                  /* the smaller child */
+      if (c >= n) break;
+      if ((c + 1 < n) && (in[heap[c + 1]].cur < in[heap[c]].cur)) c++;
+      if (in[heap[i]].cur <= in[heap[c]].cur) break;
+      t = heap[i];
+      heap[i] = heap[c];
+      heap[c] = t;
+      i = c;
+      }
+   return;
+   }
+/* ========================================================================== */
+static void runName(const extSort *s, int i, char *fn) {
+   snprintf(fn, EXT_SORT_NAME_MAX, "%s.run%04d", s->prefix, i);
+   return;
+   }
+/* ========================================================================== */
@@ -0,0 +1,51 @@
+/* extSort.h: external (out-of-core) sort of Us8 coordinates, for arrays that
+   do not fit in memory: the points are given in "runs" - each one sorted,
+   and without duplicates, by the caller (us8Sort(), us8Unique()) - which are
+   written to temporary files; the runs are then merged, by a heap of their
+   current points, into a single sorted output, without duplicates.
+
+   A run is written by a background thread while the caller makes the next
+   one (its array can be re-used once the next extSortRun() call returns);
+   the merged output goes through two buffers, one filled by the merge while
+   the other is being written. The run files are read sequentially, with the
+   operating system read-ahead advised (posix_fadvise), a buffer each.
+
+   The run files are named after the prefix given to extSortInit(), with
+   ".run0000", ".run0001" ... appended; extSortFree() removes them.
+
+   Include after nemo.h; the implementation (extSort.c) is included at the
+   end of the program source, just like other scullions.
+ */
+#ifndef EXT_SORT_H
+#define EXT_SORT_H
+
+#include <pthread.h>
+
+#define EXT_SORT_NOMEM      -1                  /* no memory for the buffers */
+#define EXT_SORT_THREAD     -2                    /* can't create a thread */
+#define EXT_SORT_IO         -3   /* can't create, write or read a run file */
+#define EXT_SORT_RUNS       -4                         /* too many runs */
+
+#define EXT_SORT_MAX_RUNS  1000
+#define EXT_SORT_NAME_MAX  4096
+#define EXT_SORT_MIN_BUF   4096          /* merge: least points per buffer */
+
+typedef struct {
+   char prefix[EXT_SORT_NAME_MAX];             /* of the run file names */
+   int nRuns;
+   size_t nPts;                                 /* points, in all the runs */
+   pthread_t writer;                    /* background write: the thread... */
+   int isWriting;
+   FILE *wFp;                                         /* ...its file... */
+   const nemoPtUs8 *wPts;                             /* ...the points... */
+   size_t wCnt;
+   int wIsRun;                         /* ...1: a run file, closed after... */
+   int wErr;                                        /* ...and the result */
+   } extSort;
+
+int extSortInit(extSort *, const char *);
+int extSortRun(extSort *, const nemoPtUs8 *, size_t);
+int extSortMerge(extSort *, FILE *, size_t, size_t *, size_t *);
+void extSortFree(extSort *);
+
+#endif
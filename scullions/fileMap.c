@@ -0,0 +1,333 @@
+/* fileMap.c: read-only, whole-file access to binary coordinate or text files
+   (see fileMap.h). POSIX systems memory-map the file; otherwise, or if the
+   mapping fails, the file is read into an allocated block of memory using
+   FILE_MAP_BLOCK size reads. Compressed .z8b files are also read here, and
+   decoded all at once (p8bMapOpen) or as the records are asked for
+   (p8bMapOpenBlocks, p8bMapRecs).
+ */
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+static int fileMapRead(fileMap *, const char *);
+static int z8bParse(fileMap *, FILE *);
+static int z8bBlock(const fileMap *, int, int, int, nemoPtUs8 *);
+static size_t z8bOffset(const fileMap *, int);
+static uint64_t z8bGet64(const unsigned char *);
+/* ========================================================================== */
+/* Make the whole file accessible as fm->bytes, fm->nBytes. Returns 0 on
+   success, or one of the (negative) FILE_MAP_xxx codes.
+ */
+int fileMapOpen(fileMap *fm,                            /* to be initialized */
+                const char *fn) {                          /* file path/name */
+#ifndef _WIN32
+   int fd;
+   struct stat st;
+   void *p;
+#endif
+/* -------------------------------------------------------------------------- */
+   memset(fm, 0, sizeof(fileMap));
+#ifndef _WIN32
+   fd = open(fn, O_RDONLY);
+   if (fd < 0) return(FILE_MAP_OPEN);
+   if (fstat(fd, &st)) {
+      close(fd);
+      return(FILE_MAP_OPEN);
+      }
+   if (S_ISREG(st.st_mode)) {             /* only regular files are mapped */
+      if (st.st_size == 0) {               /* can't map zero bytes; no need */
+         close(fd);
+         return(0);
+         }
+      p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      close(fd);                        /* the mapping outlives descriptor */
+      if (p != MAP_FAILED) {
+         madvise(p, (size_t)st.st_size, MADV_SEQUENTIAL);  /* only a hint */
+         fm->base = p;
+         fm->baseSize = (size_t)st.st_size;
+         fm->isMapped = 1;
+         fm->bytes = p;
+         fm->nBytes = (size_t)st.st_size;
+         return(0);
+         }
+      }
+   else close(fd);
+#endif
+   return(fileMapRead(fm, fn));             /* fallback: read it in blocks */
+   }
+/* ========================================================================== */
+/* As fileMapOpen(), but the file must be an array of 8-byte UniSpherical
+   records, which are then accessible as fm->pts, fm->nPts. If the file is
+   a .z8b one, it is decoded into an allocated array.
+ */
+int p8bMapOpen(fileMap *fm, const char *fn) {
+   int i, n, iErr;
+   size_t nPts;
+   nemoPtUs8 *pts;
+/* -------------------------------------------------------------------------- */
+   iErr = p8bMapOpenBlocks(fm, fn);
+   if (iErr || (fm->z8bIndex == NULL)) return(iErr);
+   nPts = fm->nPts;
+   pts = malloc((nPts ? nPts : 1) * sizeof(nemoPtUs8));
+   if (pts == NULL) iErr = FILE_MAP_READ;
+   for (i = 0; (iErr == 0) && (i < fm->z8bNBlocks); i++) {
+      n = (i < fm->z8bNBlocks - 1) ? fm->z8bBlockPts :
+                               (int)(nPts - (size_t)i * fm->z8bBlockPts);
+      n = z8bBlock(fm, i, 0, n, pts + (size_t)i * fm->z8bBlockPts);
+      if (n < 0) iErr = n;
+      }
+   fileMapClose(fm);                       /* compressed bytes are not needed */
+   if (iErr) {
+      free(pts);
+      return(iErr);
+      }
+   fm->base = pts;
+   fm->baseSize = nPts * sizeof(nemoPtUs8);
+   fm->bytes = fm->base;
+   fm->nBytes = fm->baseSize;
+   fm->pts = pts;
+   fm->nPts = nPts;
+   return(0);
+   }
+/* ========================================================================== */
+/* As p8bMapOpen(), but a .z8b file is only checked (header and index), not
+   decoded: fm->pts is NULL, and its fm->nPts records are then read with
+   p8bMapRecs(), as those of a .p8b file can be.
+ */
+int p8bMapOpenBlocks(fileMap *fm, const char *fn) {
+   int iErr, isZ8b;
+   char magic[8];
+   FILE *fp;
+/* -------------------------------------------------------------------------- */
+   fp = fopen(fn, "rb");    /* magic, and .z8b header and index, are read: a */
+   isZ8b = fp && (fread(magic, 1, 8, fp) == 8) &&   /* first touch of the map */
+           (memcmp(magic, Z8B_MAGIC, 8) == 0);   /* would be followed by its */
+   iErr = fileMapOpen(fm, fn);          /* read-ahead, see fileMapRandom() */
+   if ((iErr == 0) && isZ8b) {
+      iErr = z8bParse(fm, fp);
+      if (iErr) fileMapClose(fm);
+      }
+   if (fp) fclose(fp);
+   if (iErr || isZ8b) return(iErr);
+   if (fm->nBytes % sizeof(nemoPtUs8)) {
+      fileMapClose(fm);
+      return(FILE_MAP_SIZE);
+      }
+   fm->pts = (const nemoPtUs8 *)fm->bytes;
+   fm->nPts = fm->nBytes / sizeof(nemoPtUs8);
+   return(0);
+   }
+/* ========================================================================== */
+/* The n records from first on (first + n not beyond fm->nPts): in place, or
+   of a .z8b file opened by p8bMapOpenBlocks() decoded into buf (room for n).
+   Returns NULL if they can't be decoded (invalid file).
+ */
+const nemoPtUs8 *p8bMapRecs(const fileMap *fm, size_t first, int n,
+                            nemoPtUs8 *buf) {
+   int iBlock, jLo, jHi;
+   size_t k;
+/* -------------------------------------------------------------------------- */
+   if (fm->z8bIndex == NULL) return(fm->pts + first);
+   for (k = first; k < first + n; k += jHi - jLo) { /* the blocks they're in */
+      iBlock = (int)(k / fm->z8bBlockPts);
+      jLo = (int)(k % fm->z8bBlockPts);
+      jHi = (first + n - k < (size_t)(fm->z8bBlockPts - jLo)) ?
+                           jLo + (int)(first + n - k) : fm->z8bBlockPts;
+      if (z8bBlock(fm, iBlock, jLo, jHi, buf + (k - first)) < 0) return(NULL);
+      }
+   return(buf);
+   }
+/* ========================================================================== */
+/* As fileMapPrefetch(), for the n records from first on (of .p8b, or .z8b
+   file opened by p8bMapOpenBlocks(): the bytes of the blocks they're in).
+ */
+void p8bMapPrefetch(const fileMap *fm, size_t first, size_t n) {
+   size_t lo, hi;
+/* -------------------------------------------------------------------------- */
+   if ((n == 0) || (first >= fm->nPts)) return;
+   if (n > fm->nPts - first) n = fm->nPts - first;
+   if (fm->z8bIndex == NULL) {
+      fileMapPrefetch(fm, first * sizeof(nemoPtUs8), n * sizeof(nemoPtUs8));
+      return;
+      }
+   lo = z8bOffset(fm, (int)(first / fm->z8bBlockPts));
+   hi = z8bOffset(fm, (int)((first + n - 1) / fm->z8bBlockPts) + 1);
+   fileMapPrefetch(fm, lo, hi - lo);
+   return;
+   }
+/* ========================================================================== */
+void fileMapClose(fileMap *fm) {
+#ifndef _WIN32
+   if (fm->isMapped) munmap(fm->base, fm->baseSize);
+   else
+#endif
+   free(fm->base);
+   free(fm->z8bIndex);
+   memset(fm, 0, sizeof(fileMap));
+   return;
+   }
+/* ========================================================================== */
+/* Ask for the nBytes from offset off to be read ahead (only a hint; nothing
+   to do if the file is not mapped, but read in memory).
+ */
+void fileMapPrefetch(const fileMap *fm, size_t off, size_t nBytes) {
+#ifndef _WIN32
+   size_t lo, page;
+/* -------------------------------------------------------------------------- */
+   if (!fm->isMapped || (off >= fm->nBytes)) return;
+   if (nBytes > fm->nBytes - off) nBytes = fm->nBytes - off;
+   page = (size_t)sysconf(_SC_PAGESIZE);
+   lo = off - off % page;                         /* madvise(): page aligned */
+   madvise((char *)fm->base + lo, off + nBytes - lo, MADV_WILLNEED);
+#endif
+   return;
+   }
+/* ========================================================================== */
+/* No read-ahead of the mapped file, but by fileMapPrefetch(): it is to be
+   read in parts (only a hint; nothing to do if it is not mapped).
+ */
+void fileMapRandom(const fileMap *fm) {
+/* -------------------------------------------------------------------------- */
+#ifndef _WIN32
+   if (fm->isMapped) madvise(fm->base, fm->baseSize, MADV_RANDOM);
+#endif
+   return;
+   }
+/* ========================================================================== */
+const char *fileMapErrStr(int iErr) {
+   if (iErr == FILE_MAP_OPEN) return("can't open file");
+   if (iErr == FILE_MAP_SIZE) return("file size not a multiple of record size");
+   if (iErr == FILE_MAP_READ) return("no memory or read error");
+   if (iErr == FILE_MAP_FORMAT) return("invalid .z8b file");
+   return("no error");
+   }
+/* ========================================================================== */
+/* Read the whole file into allocated memory, FILE_MAP_BLOCK bytes at a time.
+   (File size is not assumed to be known in advance).
+ */
+static int fileMapRead(fileMap *fm, const char *fn) {
+   FILE *fp;
+   size_t n;
+   unsigned char *p;
+/* -------------------------------------------------------------------------- */
+   fp = fopen(fn, "rb");
+   if (fp == NULL) return(FILE_MAP_OPEN);
+   do {
+      if (fm->nBytes + FILE_MAP_BLOCK > fm->baseSize) {      /* grow buffer */
+         p = realloc(fm->base, 2 * fm->baseSize + FILE_MAP_BLOCK);
+         if (p == NULL) {
+            fclose(fp);
+            fileMapClose(fm);
+            return(FILE_MAP_READ);
+            }
+         fm->base = p;
+         fm->baseSize = 2 * fm->baseSize + FILE_MAP_BLOCK;
+         }
+      n = fread((unsigned char *)fm->base + fm->nBytes, 1, FILE_MAP_BLOCK, fp);
+      fm->nBytes += n;
+      } while (n == FILE_MAP_BLOCK);
+   if (ferror(fp)) {
+      fclose(fp);
+      fileMapClose(fm);
+      return(FILE_MAP_READ);
+      }
+   fclose(fp);
+   fm->bytes = fm->base;
+   return(0);
+   }
+/* ========================================================================== */
+/* Decode points [jLo, jHi) of block iBlock into pts (room for jHi - jLo);
+   the differences are decoded from the block's start, up to jHi. Returns the
+   number of points decoded, or FILE_MAP_FORMAT if the block is invalid (as
+   far as decoded: its length is checked when all of it is).
+ */
+static int z8bBlock(const fileMap *fm, int iBlock, int jLo, int jHi,
+                    nemoPtUs8 *pts) {
+   int j, n, shift;
+   uint64_t d;
+   nemoPtUs8 v;
+   const unsigned char *p, *end, *ie;
+/* -------------------------------------------------------------------------- */
+   if ((iBlock < 0) || (iBlock >= fm->z8bNBlocks)) return(FILE_MAP_FORMAT);
+   n = fm->z8bBlockPts;
+   if (iBlock == fm->z8bNBlocks - 1) n = (int)(fm->nPts - (size_t)iBlock * n);
+   if ((jLo < 0) || (jHi > n) || (jLo >= jHi)) return(FILE_MAP_FORMAT);
+   ie = fm->z8bIndex + (size_t)iBlock * Z8B_INDEX_ENTRY;
+   p = fm->bytes + z8bOffset(fm, iBlock);
+   end = fm->bytes + z8bOffset(fm, iBlock + 1);
+   v = (nemoPtUs8)z8bGet64(ie);
+   if (jLo == 0) pts[0] = v;
+   for (j = 1; j < jHi; j++) {
+      d = 0;
+      for (shift = 0; ; shift += 7) {               /* LEB128, 7 bits a byte */
+         if ((p == end) || (shift > 63)) return(FILE_MAP_FORMAT);
+         d |= (uint64_t)(*p & 0x7f) << shift;
+         if ((*p++ & 0x80) == 0) break;
+         }
+      if ((d == 0) || (v + d < v)) return(FILE_MAP_FORMAT); /* dup, overflow */
+      v += d;
+      if (j >= jLo) pts[j - jLo] = v;
+      }
+   if ((jHi == n) && (p != end)) return(FILE_MAP_FORMAT);
+   return(jHi - jLo);
+   }
+/* ========================================================================== */
+/* Offset of the data of block iBlock (or of the file end, for nBlocks) */
+static size_t z8bOffset(const fileMap *fm, int iBlock) {
+   if (iBlock >= fm->z8bNBlocks) return(fm->nBytes);
+   return((size_t)z8bGet64(fm->z8bIndex +
+                           (size_t)iBlock * Z8B_INDEX_ENTRY + 8));
+   }
+/* ========================================================================== */
+/* Read the .z8b header (after the magic) and index from fp, check them
+   against the file size, and set the fm->z8bXxx fields (the index copied)
+   and fm->nPts from them.
+ */
+static int z8bParse(fileMap *fm, FILE *fp) {
+   int i, blockPts, nBlocks;
+   uint64_t nPts, off, offPrev;
+   unsigned char hdr[Z8B_HEADER - 8];
+   unsigned char *index;
+/* -------------------------------------------------------------------------- */
+   if (fread(hdr, 1, sizeof(hdr), fp) != sizeof(hdr)) return(FILE_MAP_FORMAT);
+   nPts = z8bGet64(hdr);
+   blockPts = (int)(z8bGet64(hdr + 8) & 0xffffffff);
+   nBlocks = (int)(z8bGet64(hdr + 8) >> 32);
+   if ((blockPts < 1) || (nBlocks < 0) ||
+       (nPts != 0 && (uint64_t)nBlocks != (nPts - 1) / blockPts + 1) ||
+       (nPts == 0 && nBlocks != 0)) return(FILE_MAP_FORMAT);
+   offPrev = Z8B_HEADER + (uint64_t)nBlocks * Z8B_INDEX_ENTRY;
+   if (offPrev > fm->nBytes) return(FILE_MAP_FORMAT);
+   index = malloc(nBlocks ? (size_t)nBlocks * Z8B_INDEX_ENTRY : 1);
+   if (index == NULL) return(FILE_MAP_READ);
+   if (fread(index, Z8B_INDEX_ENTRY, nBlocks, fp) != (size_t)nBlocks) {
+      free(index);
+      return(FILE_MAP_FORMAT);
+      }
+   for (i = 0; i < nBlocks; i++) {                 /* data offsets ascending */
+      off = z8bGet64(index + (size_t)i * Z8B_INDEX_ENTRY + 8);
+      if ((off < offPrev) || (off > fm->nBytes)) {
+         free(index);
+         return(FILE_MAP_FORMAT);
+         }
+      offPrev = off;
+      }
+   fm->nPts = (size_t)nPts;
+   fm->z8bIndex = index;
+   fm->z8bBlockPts = blockPts;
+   fm->z8bNBlocks = nBlocks;
+   return(0);
+   }
+/* ========================================================================== */
+/* 64-bit little-endian integer, from any (byte) alignment */
+static uint64_t z8bGet64(const unsigned char *p) {
+   int i;
+   uint64_t v;
+/* -------------------------------------------------------------------------- */
+   for (v = 0, i = 7; i >= 0; i--) v = (v << 8) | p[i];
+   return(v);
+   }
+/* ========================================================================== */
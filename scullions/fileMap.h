@@ -0,0 +1,78 @@
+/* fileMap.h: read-only, whole-file access to binary coordinate (.p8b, .r8b,
+   ...) or text files. Where the operating system allows, the file is memory
+   mapped and the records are accessed in place, with no copying and no
+   per-record stdio calls. Otherwise (or if mapping fails - e.g. the file is
+   a pipe) the file is read into memory in large blocks.
+
+   Arrays of Us8 records sorted in ascending order (no duplicates) can also
+   be stored in the compressed .z8b form (see p8bToZ8b program); p8bMapOpen()
+   recognizes such file and decodes it, so that programs read it just like a
+   .p8b file. The .z8b file (all integers little-endian) consists of:
+      header:  8-byte Z8B_MAGIC, 64-bit number of points, 32-bit points per
+               block and 32-bit number of blocks;
+      index:   for each block, its first point (Us8) and the 64-bit offset
+               of its data from the start of the file;
+      blocks:  for each point of the block after the first one, difference
+               from the previous point, as an unsigned LEB128 "varint".
+   Neighbouring sorted Us8 share most of their leading bits, so differences
+   mostly take 2-4 bytes instead of 8; a zero difference (a duplicate) is
+   invalid. p8bMapOpen() decodes the whole file into allocated memory, as the
+   size of the equivalent .p8b, for the programs that go through all of the
+   records. Programs that go through a file block by block open it with
+   p8bMapOpenBlocks() instead: a .z8b one then stays mapped (fm->pts is NULL)
+   (its header and index read into memory, not through the mapping) and
+   p8bMapRecs() decodes just the records asked for, from the mapped bytes;
+   for a .p8b one it returns them in place. Blocks that are skipped
+   (see capIndex) are so not read, nor decoded, in either form.
+
+   A program going through a mapped file block by block can call
+   fileMapPrefetch() for the bytes (or p8bMapPrefetch() for the records, of
+   .p8b or .z8b file) some blocks ahead: the operating system then reads them in the background (madvise WILLNEED) while the program
+   computes, which the plain sequential read-ahead does not do when some of
+   the blocks are skipped (see capIndex) or the file is on a slow device.
+   A mapped file is opened for sequential reading (madvise SEQUENTIAL), and
+   the system may then read much more of it than each access needs; one that
+   is to be read only in parts (the blocks an index leaves) is switched by
+   fileMapRandom() to no read-ahead but that asked for by fileMapPrefetch().
+
+   Include after nemo.h; the implementation (fileMap.c) is included at the
+   end of the program source, just like other scullions.
+ */
+#ifndef FILE_MAP_H
+#define FILE_MAP_H
+
+#define FILE_MAP_OPEN   -1                        /* can't open or stat file */
+#define FILE_MAP_SIZE   -2     /* binary file size not a multiple of record */
+#define FILE_MAP_READ   -3                 /* no memory, or read/map error */
+#define FILE_MAP_FORMAT -4                    /* invalid (corrupt) .z8b file */
+
+#define FILE_MAP_BLOCK  (4 * 1024 * 1024)  /* fallback read block, in bytes */
+
+#define Z8B_MAGIC       "NemoZ8B\001"    /* not a valid Us8: plate 0 */
+#define Z8B_HEADER      24                           /* header size, bytes */
+#define Z8B_INDEX_ENTRY 16                      /* index entry size, bytes */
+#define Z8B_BLOCK_PTS   4096      /* default points per block (when written) */
+
+typedef struct {
+   const unsigned char *bytes;                   /* whole file, as bytes... */
+   size_t nBytes;
+   const nemoPtUs8 *pts;                /* ...or as an array of Us8 records */
+   size_t nPts;
+   void *base;                          /* mapped or allocated memory block */
+   size_t baseSize;
+   int isMapped;                           /* 1: memory mapped, 0: allocated */
+   unsigned char *z8bIndex;    /* .z8b, p8bMapOpenBlocks(): index (copy), */
+   int z8bBlockPts, z8bNBlocks;    /* ...points per block (but last), blocks */
+   } fileMap;
+
+int fileMapOpen(fileMap *, const char *);
+int p8bMapOpen(fileMap *, const char *);
+int p8bMapOpenBlocks(fileMap *, const char *);
+const nemoPtUs8 *p8bMapRecs(const fileMap *, size_t, int, nemoPtUs8 *);
+void p8bMapPrefetch(const fileMap *, size_t, size_t);
+void fileMapClose(fileMap *);
+void fileMapPrefetch(const fileMap *, size_t, size_t);
+void fileMapRandom(const fileMap *);
+const char *fileMapErrStr(int);
+
+#endif
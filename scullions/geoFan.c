@@ -0,0 +1,154 @@
+/* geoFan.c: one-to-many WGS84 geodesics (see geoFan.h) */
+
+static void geoFanReduced(const geoFan *, const nemoPtEnr *, double *,
+                          double *, double *);
+static double geoFanSolve(const geoFan *, const nemoPtEnr *, double, double,
+                          double, int *);
+/* ========================================================================== */
+/* Set up the fan of geodesics from the origin. The axes of the library's
+   ellipsoid are its chords: 90 degrees of the equator is a * sqrt(2), and
+   the pole to the equator sqrt(a * a + b * b).
+ */
+void geoFanInit(geoFan *fan, const nemoPtEnr *org) {
+   nemoPtEnr eq0 = {{1.0, 0.0, 0.0}}, eq90 = {{0.0, 1.0, 0.0}};
+   nemoPtEnr pole = {{0.0, 0.0, 1.0}};
+   double aSq;
+/* -------------------------------------------------------------------------- */
+   aSq = 0.5 * nemo_EllipsoidChordInverse(nemo_ElrWgs84(), &eq0, &eq90,
+                                          NULL, NULL);
+   fan->a = sqrt(aSq);
+   fan->b = sqrt(nemo_EllipsoidChordInverse(nemo_ElrWgs84(), &pole, &eq0,
+                                            NULL, NULL) - aSq);
+   fan->f = 1.0 - fan->b / fan->a;
+   fan->org = *org;
+   geoFanReduced(fan, org, &fan->sinU, &fan->cosU, &fan->lng);
+   return;
+   }
+/* ========================================================================== */
+/* Length of geodesic from the origin to dst, meters (or NEMO_DOUBLE_UNDEF, if
+   nemo_GeodesicSzpila() fails as well). Iterations go to *nIter, unless NULL
+   (-1: the length is that of nemo_GeodesicSzpila(), by statsSzpila()).
+ */
+double geoFanLength(const geoFan *fan, const nemoPtEnr *dst, int *nIter) {
+   double sinU, cosU, lng;
+/* -------------------------------------------------------------------------- */
+   geoFanReduced(fan, dst, &sinU, &cosU, &lng);
+   return(geoFanSolve(fan, dst, sinU, cosU, lng, nIter));
+   }
+/* ========================================================================== */
+/* Lengths of geodesics from the origin to n destinations (and the number of
+   iterations of each, unless nIter is NULL). The destination terms are
+   computed in a pass of their own, a tile of GEO_FAN_TILE at a time, before
+   the iterations for the tile.
+ */
+void geoFanBatch(const geoFan *fan, const nemoPtEnr *dst, int n,
+                 double *len, int *nIter) {
+   int i, i0, nt;
+   double sinU[GEO_FAN_TILE], cosU[GEO_FAN_TILE], lng[GEO_FAN_TILE];
+/* -------------------------------------------------------------------------- */
+   for (i0 = 0; i0 < n; i0 += GEO_FAN_TILE) {
+      nt = (n - i0 < GEO_FAN_TILE) ? n - i0 : GEO_FAN_TILE;
+      for (i = 0; i < nt; i++)
+         geoFanReduced(fan, dst + i0 + i, sinU + i, cosU + i, lng + i);
+      for (i = 0; i < nt; i++) len[i0 + i] = geoFanSolve(fan, dst + i0 + i,
+                     sinU[i], cosU[i], lng[i], nIter ? nIter + i0 + i : NULL);
+      }
+   return;
+   }
+/* ========================================================================== */
+/* Length of geodesic from the origin to dst, for a test against the limit:
+   close to it, the one of nemo_GeodesicSzpila() (see geoFan.h).
+ */
+double geoFanNear(const geoFan *fan, const nemoPtEnr *dst, double limit) {
+   int nIter;
+   double g;
+/* -------------------------------------------------------------------------- */
+   g = geoFanLength(fan, dst, &nIter);
+   statsFanIters(&nIter, 1);
+   if ((g == NEMO_DOUBLE_UNDEF) || (fabs(g - limit) <= GEO_FAN_GUARD))
+      g = statsSzpila(&fan->org, dst);
+   return(g);
+   }
+/* ========================================================================== */
+/* As geoFanNear(), for n destinations: their lengths to len[0...n - 1] */
+void geoFanNearBatch(const geoFan *fan, const nemoPtEnr *dst, int n,
+                     double limit, double *len) {
+   int i, i0, nt;
+   int nIter[GEO_FAN_TILE];
+/* -------------------------------------------------------------------------- */
+   for (i0 = 0; i0 < n; i0 += GEO_FAN_TILE) {
+      nt = (n - i0 < GEO_FAN_TILE) ? n - i0 : GEO_FAN_TILE;
+      geoFanBatch(fan, dst + i0, nt, len + i0, nIter);
+      statsFanIters(nIter, nt);
+      for (i = i0; i < i0 + nt; i++) {
+         if ((len[i] == NEMO_DOUBLE_UNDEF) || (fabs(len[i] - limit) <= GEO_FAN_GUARD))
+            len[i] = statsSzpila(&fan->org, dst + i);
+         }
+      }
+   return;
+   }
+/* ========================================================================== */
+/* Sine and cosine of the reduced latitude, and the longitude, of a point */
+static void geoFanReduced(const geoFan *fan, const nemoPtEnr *p, double *sinU,
+                          double *cosU, double *lng) {
+   double h, zr, r;
+/* -------------------------------------------------------------------------- */
+   h = sqrt(p->dc[0] * p->dc[0] + p->dc[1] * p->dc[1]);
+   zr = (1.0 - fan->f) * p->dc[2];                 /* tan U = (1 - f) tan φ */
+   r = sqrt(h * h + zr * zr);
+   *sinU = zr / r;
+   *cosU = h / r;
+   *lng = atan2(p->dc[1], p->dc[0]);
+   return;
+   }
+/* ========================================================================== */
+/* Vincenty inverse, from the origin to the destination of given terms */
+static double geoFanSolve(const geoFan *fan, const nemoPtEnr *dst,
+                          double sinU2, double cosU2, double lng2, int *nIter) {
+   int n;
+   double L, lambda, lambdaPrev, sinLambda, cosLambda;
+   double sinSigma, cosSigma, sigma, sinAlpha, cosSqAlpha, cos2SigmaM, c;
+   double uSq, aa, bb, deltaSigma, t1, t2;
+   const double sinU1 = fan->sinU, cosU1 = fan->cosU, f = fan->f;
+/* -------------------------------------------------------------------------- */
+   L = lng2 - fan->lng;
+   if (L > NEMO_PI) L -= 2.0 * NEMO_PI;
+   else if (L < -NEMO_PI) L += 2.0 * NEMO_PI;
+   lambda = L;
+   for (n = 1; ; n++) {
+      sinLambda = sin(lambda);
+      cosLambda = cos(lambda);
+      t1 = cosU2 * sinLambda;
+      t2 = cosU1 * sinU2 - sinU1 * cosU2 * cosLambda;
+      sinSigma = sqrt(t1 * t1 + t2 * t2);
+      if (sinSigma == 0.0) {                         /* coincident points */
+         if (nIter) *nIter = n;
+         return(0.0);
+         }
+      cosSigma = sinU1 * sinU2 + cosU1 * cosU2 * cosLambda;
+      sigma = atan2(sinSigma, cosSigma);
+      sinAlpha = cosU1 * cosU2 * sinLambda / sinSigma;
+      cosSqAlpha = 1.0 - sinAlpha * sinAlpha;
+      cos2SigmaM = (cosSqAlpha != 0.0) ?            /* 0: equatorial line */
+                    cosSigma - 2.0 * sinU1 * sinU2 / cosSqAlpha : 0.0;
+      c = f / 16.0 * cosSqAlpha * (4.0 + f * (4.0 - 3.0 * cosSqAlpha));
+      lambdaPrev = lambda;
+      lambda = L + (1.0 - c) * f * sinAlpha * (sigma + c * sinSigma *
+               (cos2SigmaM + c * cosSigma * (-1.0 + 2.0 * cos2SigmaM * cos2SigmaM)));
+      if (fabs(lambda - lambdaPrev) < GEO_FAN_EPS) break;
+      if ((n == GEO_FAN_MAX_ITER) || (fabs(lambda) > NEMO_PI)) { /* antipodal */
+         if (nIter) *nIter = -1;              /* (counted by statsSzpila()) */
+         return(statsSzpila(&fan->org, dst));
+         }
+      }
+   if (nIter) *nIter = n;
+   uSq = cosSqAlpha * (fan->a * fan->a - fan->b * fan->b) / (fan->b * fan->b);
+   aa = 1.0 + uSq / 16384.0 * (4096.0 + uSq * (-768.0 + uSq * (320.0 - 175.0 * uSq)));
+   bb = uSq / 1024.0 * (256.0 + uSq * (-128.0 + uSq * (74.0 - 47.0 * uSq)));
+   deltaSigma = bb * sinSigma * (cos2SigmaM + bb / 4.0 * (cosSigma *
+                (-1.0 + 2.0 * cos2SigmaM * cos2SigmaM) - bb / 6.0 * cos2SigmaM *
+                (-3.0 + 4.0 * sinSigma * sinSigma) *
+                (-3.0 + 4.0 * cos2SigmaM * cos2SigmaM)));
+   return(fan->b * aa * (sigma - deltaSigma));
+   }
+/* ========================================================================== */
@@ -0,0 +1,50 @@
+/* geoFan.h: "one-to-many" geodesics on the WGS84 ellipsoid - the lengths of
+   geodesics from a fixed origin (the Point Nemo, the centre of extraction)
+   to many destinations, by the Vincenty inverse formulae, with the terms of
+   the origin (its reduced latitude and longitude) computed once, when the
+   fan is set up, instead of in every evaluation. The ellipsoid is that of
+   the library, nemo_ElrWgs84(): its axes are taken, by the library's chord
+   function, when the fan is set up.
+
+   The iteration ends when the longitude on the auxiliary sphere changes by
+   less than GEO_FAN_EPS radians; if it does not in GEO_FAN_MAX_ITER steps
+   (which happens for near-antipodal destinations only), the length is that
+   of nemo_GeodesicSzpila(). Destinations may be given one at a time or in
+   batches; a batch computes their reduced latitudes in a single pass first,
+   a tile at a time, and then iterates for each one in turn (the iterations
+   are scalar code, the number of them differs from one destination to the
+   next).
+
+   geoFanNear() serves the proximity tests: if the length is within
+   GEO_FAN_GUARD of the test limit, the length returned is that of the
+   library function instead, so the test always comes out the same as it
+   would with nemo_GeodesicSzpila() alone. geoFanNearBatch() does the same
+   for a batch (by geoFanBatch()). Both add their iteration counts to the
+   geoFan histogram of nemoStats (statsFanIters()), apart from the one of
+   nemo_GeodesicSzpila() (of statsSzpila(), the fallbacks included).
+
+   Include after nemo.h and nemoStats.h; the implementation (geoFan.c) is
+   included at the end of the program source, just like other scullions.
+ */
+#ifndef GEO_FAN_H
+#define GEO_FAN_H
+
+#define GEO_FAN_EPS      1.0e-12
+#define GEO_FAN_MAX_ITER      64
+#define GEO_FAN_TILE         256           /* batch destinations, at a time */
+#define GEO_FAN_GUARD      0.001   /* meters; the error is under 0.1 mm */
+
+typedef struct {
+   double a, b, f;           /* nemo_ElrWgs84() axes, meters, flattening */
+   nemoPtEnr org;                                      /* fixed end point */
+   double lng;                                       /* its longitude, and */
+   double sinU, cosU;                        /* ...reduced latitude terms */
+   } geoFan;
+
+void geoFanInit(geoFan *, const nemoPtEnr *);
+double geoFanLength(const geoFan *, const nemoPtEnr *, int *);
+void geoFanBatch(const geoFan *, const nemoPtEnr *, int, double *, int *);
+double geoFanNear(const geoFan *, const nemoPtEnr *, double);
+void geoFanNearBatch(const geoFan *, const nemoPtEnr *, int, double, double *);
+
+#endif
@@ -0,0 +1,817 @@
+/* itinEngine.c: nearest-next itinerary and its improvement (see itinEngine.h) */
+
+#define ITIN_VISITED_DC    NAN   /* chord to it compares false: never nearest */
+#define ITIN_LIVE_COMPACT  128     /* live list compaction, visited entries share */
+#define ITIN_SLICE_MIN    4096   /* fewer un-visited per thread: search in one */
+#define ITIN_SPIN_YIELD   1024             /* idle waits, before sched_yield() */
+#define ITIN_MAX_SHIFT   50000     /* most locations reversed or moved across */
+#define ITIN_MIN_GAIN  1.0e-12      /* radians, ~6 micrometers: no "cycling" */
+#define ITIN_OR_OPT_MAX      3        /* most locations moved by Or-opt move */
+#define ITIN_PI_4  0.78539816339744830962  /* curve cells: atan(1), 45 degrees */
+
+#define IS_VISITED(w, n)   ((w)->visitBits[(n) >> 3] & (1 << ((n) & 7)))
+#define SET_VISITED(w, n)  ((w)->visitBits[(n) >> 3] |= (unsigned char)(1 << ((n) & 7)))
+#define SUCC(o, p) (((p) + 1 < (o)->nLcn) ? (o)->tour[(p) + 1] : -1)
+
+struct itinSearch {            /* window and tree strategies, search state */
+   const ncsSoa *lcn;                      /* location coordinates, decoded */
+   int nLcn;                                           /* number of locations */
+   int iWin;                   /* half of the search window, 0: k-d tree */
+   unsigned char *visitBits;                /* bit set: location visited */
+   int liveCnt, liveDead;         /* live list: length, visited in it... */
+   int *liveIdx;                        /* ...location indices, ascending... */
+   ncsSoa liveSoa;                     /* ...and coordinates, or VISITED_DC */
+   kdTree tree;                    /* spatial index of un-visited (tree) */
+   itinPlan *plan;
+   };
+
+struct itinPool;
+struct itinSlice {                         /* one thread's part of the search */
+   double chSq;                                      /* nearest in it, and */
+   int iNear;                                /* ...its index (-1: none) */
+   int iSlice;                                     /* this slice's number */
+   struct itinPool *pool;
+   char pad[64 - sizeof(double) - 2 * sizeof(int) - sizeof(void *)];
+   };                                               /* (own cache line each) */
+
+struct itinPool {                /* brute force strategy, search of each step */
+   ncsSoa soa;               /* location coordinates, re-ordered as visited */
+   double q[3];                                      /* leg start location */
+   int lo, hi;                             /* un-visited, range of the arrays */
+   int nSlices;          /* threads, the calling one included (1: retired) */
+   atomic_int step;               /* incremented as each search is started */
+   atomic_int nBusy;                  /* slices of the step not yet searched */
+   atomic_int isDone;                          /* no more steps: threads exit */
+   struct itinSlice slices[ITIN_ENGINE_MAX_THREADS];
+   };
+
+struct itinOpt {                    /* improvement by local search, its state */
+   int nLcn;                                           /* number of locations */
+   double *xyz;                 /* location NCS direction cosines, 3 each */
+   int *tour;                          /* location at each itinerary position */
+   int *pos;                                /* itinerary position of location */
+   int nNbrs;                            /* neighbour list length, per location */
+   int *nbrs;                       /* nNbrs nearest neighbours, per location */
+   int *queue, qHead, qCount;            /* locations waiting to be examined */
+   unsigned char *inQueue;
+   int n2opt, nOrOpt;                              /* moves applied, by type */
+   };
+
+static int cs8ToSoaCodec(const void *, int, ncsSoa *, int);
+static int us8ToSoaCodec(const void *, int, ncsSoa *, int);
+static int us4ToSoaCodec(const void *, int, ncsSoa *, int);
+static int closeInWin(struct itinSearch *, int);
+static int closeOutWin(struct itinSearch *, int);
+static int closeInTree(struct itinSearch *, int);
+static void visit(struct itinSearch *, int);
+static int liveLowerBound(const struct itinSearch *, int);
+static void liveCompact(struct itinSearch *);
+static int nearBrute(const ncsSoa *, int, itinPlan *, int *);
+static int nearSeeded(const ncsSoa *, int, itinPlan *, int *);
+static uint64_t curveCell(int, int, int);
+static int nearSlices(struct itinPool *, const double *, int, int);
+static void searchSlice(struct itinPool *, int);
+static void *sliceWorker(void *);
+static double legArc(const struct itinOpt *, int, int);
+static int try2opt(struct itinOpt *, int);
+static int tryOrOpt(struct itinOpt *, int);
+static void reverseTour(struct itinOpt *, int, int);
+static void queuePush(struct itinOpt *, int);
+static void optFree(struct itinOpt *);
+
+const itinCodec itinCodecCs8 = {"Cs8", sizeof(nemoPtCs8), cs8ToSoaCodec};
+const itinCodec itinCodecUs8 = {"Us8", sizeof(nemoPtUs8), us8ToSoaCodec};
+const itinCodec itinCodecUs4 = {"Us4", sizeof(nemoPtUs4), us4ToSoaCodec};
+
+static const struct {      /* cube faces, in curve order: +X +Y +Z -X -Y -Z */
+   int uAxis, vAxis;      /* face coordinates: along the curve start-to-end */
+   double uSign, vSign;         /* edge, and across it; curve start corner */
+   } curveFaces[6] = {{1, 2, -1.0, -1.0}, {2, 0, -1.0,  1.0}, {0, 1,  1.0,  1.0},
+                      {1, 2,  1.0,  1.0}, {2, 0,  1.0, -1.0}, {0, 1, -1.0, -1.0}};
+/* ========================================================================== */
+/* The itinerary of the n locations (decoded, lcn), from the first one, by
+   the plan's strategy: the location indices, in the itinerary order, are
+   written to itin. Returns 0, ITIN_ENGINE_NOMEM, _THREAD or _ASSERT; the
+   counts of the searches are in the plan.
+ */
+int itinNearNext(const ncsSoa *lcn,                  /* locations, decoded */
+                 int n,                                /* number of locations */
+                 itinPlan *plan,                   /* strategy, and results */
+                 int *itin) {          /* location indices, in the itinerary */
+   int i, k, nPrev, nNext, iErr;
+   nemoPtNcs *lcnNcs;                  /* spatial index build, transient use */
+   struct itinSearch w;
+/* -------------------------------------------------------------------------- */
+   plan->nInside = plan->nOutside = 0;
+   if (n < 1) return(0);
+   if (plan->strategy == ITIN_CURVE) return(itinCurve(lcn, n, plan->nThreads, itin));
+   if (plan->isSeeded) return(nearSeeded(lcn, n, plan, itin));
+   if (plan->strategy == ITIN_BRUTE) return(nearBrute(lcn, n, plan, itin));
+
+   memset(&w, 0, sizeof(w));
+   w.lcn = lcn;
+   w.nLcn = n;
+   w.plan = plan;
+   w.iWin = 0;                                        /* 0: the k-d tree */
+   if (plan->strategy == ITIN_WINDOW) w.iWin = (plan->window < 2) ? 1 :
+                                                  plan->window / 2;
+   w.visitBits = calloc(n / 8 + 1, 1);               /* all "unvisited" */
+   if (w.visitBits == NULL) return(ITIN_ENGINE_NOMEM);
+   if (w.iWin == 0) {                              /* build the spatial index */
+      lcnNcs = malloc(n * sizeof(nemoPtNcs));
+      if (lcnNcs == NULL) {
+         free(w.visitBits);
+         return(ITIN_ENGINE_NOMEM);
+         }
+      for (i = 0; i < n; i++) NCS_SOA_GET(lcn, i, lcnNcs + i);
+      iErr = kdtBuild(&w.tree, lcnNcs, n);
+      free(lcnNcs);
+      if (iErr) {
+         free(w.visitBits);
+         return(ITIN_ENGINE_NOMEM);
+         }
+      }
+   else {                        /* the live list: at first, all locations */
+      w.liveCnt = n;
+      w.liveIdx = malloc(n * sizeof(int));
+      if ((w.liveIdx == NULL) || ncsSoaAlloc(&w.liveSoa, n)) {
+         free(w.liveIdx);
+         free(w.visitBits);
+         return(ITIN_ENGINE_NOMEM);
+         }
+      for (i = 0; i < n; i++) w.liveIdx[i] = i;
+      memcpy(w.liveSoa.x, lcn->x, n * sizeof(double));
+      memcpy(w.liveSoa.y, lcn->y, n * sizeof(double));
+      memcpy(w.liveSoa.z, lcn->z, n * sizeof(double));
+      }
+
+   iErr = 0;
+   visit(&w, 0);                               /* first location is visited */
+   itin[0] = 0;
+   nPrev = 0;                               /* index of last visited location */
+   for (k = 1; k < n; k++) {
+      if (plan->isVerbose && (k%1000 == 0))
+         fprintf(stderr, "Itinerary stations: %dK\r", k / 1000);
+      if (w.iWin == 0) nNext = closeInTree(&w, nPrev);   /* nearest of all left */
+      else {
+         nNext = closeInWin(&w, nPrev); /* closest inside "search window" */
+         if (nNext == -1) nNext = closeOutWin(&w, nPrev); /* none, go outside */
+         }
+      if (nNext == -1) {
+         iErr = ITIN_ENGINE_ASSERT;
+         break;
+         }
+      visit(&w, nNext);
+      itin[k] = nNext;               /* record itinerary visitation order... */
+      nPrev = nNext;                              /* ...and resume the search */
+      }
+
+   if (w.iWin == 0) kdtFree(&w.tree);
+   else {
+      free(w.liveIdx);
+      ncsSoaFree(&w.liveSoa);
+      }
+   free(w.visitBits);
+   return(iErr);
+   }
+/* ========================================================================== */
+/* The order of the n locations (decoded, lcn) along the closed Hilbert curve
+   over the 6 cube faces (see itinEngine.h), from the first location: their
+   indices are written to order. The curve keys (face, Hilbert index of the
+   cell, and the location index in the low bits: ties in the input order)
+   are sorted by us8Sort, by nThreads threads. Returns 0, ITIN_ENGINE_NOMEM
+   or ITIN_ENGINE_THREAD.
+ */
+int itinCurve(const ncsSoa *lcn,                     /* locations, decoded */
+              int n,                                   /* number of locations */
+              int nThreads,                  /* sort threads, or 0 (or 1) */
+              int *order) {            /* location indices, in curve order */
+   int i, f, a, idxBits, level, iErr, iFirst;
+   uint64_t idxMask;
+   double dc[3], g, u, v, cells;
+   nemoPtUs8 *keys;                     /* curve keys, sorted by us8Sort() */
+/* -------------------------------------------------------------------------- */
+   if (n < 1) return(0);
+   for (idxBits = 1; (idxBits < 31) && ((n - 1) >> idxBits); idxBits++) ;
+   idxMask = ((uint64_t)1 << idxBits) - 1;
+   level = (64 - 3 - idxBits) / 2;                /* a face: 2^level cells... */
+   if (level > ITIN_CURVE_ORDER) level = ITIN_CURVE_ORDER;  /* ...per edge */
+   cells = (double)((uint64_t)1 << level);
+   keys = malloc(n * sizeof(nemoPtUs8));
+   if (keys == NULL) return(ITIN_ENGINE_NOMEM);
+   for (i = 0; i < n; i++) {
+      dc[0] = lcn->x[i];
+      dc[1] = lcn->y[i];
+      dc[2] = lcn->z[i];
+      a = (fabs(dc[1]) > fabs(dc[0])) ? 1 : 0;      /* the face: axis of the */
+      if (fabs(dc[2]) > fabs(dc[a])) a = 2;         /* largest cosine, and */
+      f = (dc[a] < 0.0) ? a + 3 : a;                            /* its sign */
+      g = dc[curveFaces[f].uAxis] / fabs(dc[a]);  /* gnomonic, -1...1, to */
+      u = 0.5 - 0.5 * curveFaces[f].uSign * atan(g) / ITIN_PI_4;  /* 0...1 */
+      g = dc[curveFaces[f].vAxis] / fabs(dc[a]);
+      v = 0.5 - 0.5 * curveFaces[f].vSign * atan(g) / ITIN_PI_4; /* ~equal */
+      keys[i] = (nemoPtUs8)(((((uint64_t)f << (2 * level)) |
+                 curveCell((int)fmin(u * cells, cells - 1.0),
+                           (int)fmin(v * cells, cells - 1.0), level)) << idxBits) |
+                 (uint64_t)i);
+      }
+   iErr = us8Sort(keys, (size_t)n, nThreads);
+   if (iErr) {
+      free(keys);
+      return((iErr == US8_SORT_NOMEM) ? ITIN_ENGINE_NOMEM : ITIN_ENGINE_THREAD);
+      }
+   iFirst = 0;                       /* cut the loop at the first location */
+   for (i = 0; i < n; i++) if (((uint64_t)keys[i] & idxMask) == 0) iFirst = i;
+   for (i = 0; i < n; i++)
+      order[i] = (int)((uint64_t)keys[(iFirst + i) % n] & idxMask);
+   free(keys);
+   return(0);
+   }
+/* ========================================================================== */
+/* Hilbert curve index of the cell (u, v) of a face of 2^level by 2^level
+   cells: the curve starts at cell (0, 0) and ends at (2^level - 1, 0).
+ */
+static uint64_t curveCell(int u, int v, int level) {
+   int s, t, ru, rv, side;
+   uint64_t d;
+/* -------------------------------------------------------------------------- */
+   side = 1 << level;
+   d = 0;
+   for (s = side / 2; s > 0; s /= 2) {
+      ru = (u & s) ? 1 : 0;
+      rv = (v & s) ? 1 : 0;
+      d += (uint64_t)s * (uint64_t)s * (uint64_t)((3 * ru) ^ rv);
+      if (rv == 0) {                              /* rotate the quadrant */
+         if (ru == 1) {
+            u = side - 1 - u;
+            v = side - 1 - v;
+            }
+         t = u;
+         u = v;
+         v = t;
+         }
+      }
+   return(d);
+   }
+/* ========================================================================== */
+/* The itinerary by the plan's strategy, searched over the locations in the
+   curve order (see itinCurve), and then translated back to the input order.
+ */
+static int nearSeeded(const ncsSoa *lcn, int n, itinPlan *plan, int *itin) {
+   int i, iErr;
+   int *order;                             /* input index, in curve order */
+   ncsSoa seedSoa;                      /* the locations, in curve order */
+/* -------------------------------------------------------------------------- */
+   order = malloc(n * sizeof(int));
+   if ((order == NULL) || ncsSoaAlloc(&seedSoa, n)) {
+      free(order);
+      return(ITIN_ENGINE_NOMEM);
+      }
+   iErr = itinCurve(lcn, n, plan->nThreads, order);
+   if (iErr == 0) {
+      for (i = 0; i < n; i++) {
+         seedSoa.x[i] = lcn->x[order[i]];
+         seedSoa.y[i] = lcn->y[order[i]];
+         seedSoa.z[i] = lcn->z[order[i]];
+         }
+      plan->isSeeded = 0;
+      iErr = itinNearNext(&seedSoa, n, plan, itin);
+      plan->isSeeded = 1;
+      if (iErr == 0) for (i = 0; i < n; i++) itin[i] = order[itin[i]];
+      }
+   ncsSoaFree(&seedSoa);
+   free(order);
+   return(iErr);
+   }
+/* ========================================================================== */
+/* Improve the itinerary (tour: location indices, in the itinerary order) of
+   the n locations by 2-opt and Or-opt moves, within the plan's budget. The
+   first location remains first. Returns 0 or ITIN_ENGINE_NOMEM; the counts
+   of moves are in the plan.
+ */
+int itinImprove(const ncsSoa *lcn,                   /* locations, decoded */
+                int n,                                 /* number of locations */
+                itinPlan *plan,                     /* budget, and results */
+                int *tour) {                         /* itinerary, improved */
+   int i, k, p, iErr, nPopped, isDone;
+   int ids[KDT_MAX_SEP];
+   double wallStart;
+   nemoPtNcs *lcnNcs;                  /* spatial index build, transient use */
+   kdTree lcnTree;
+   struct itinOpt o;
+/* -------------------------------------------------------------------------- */
+   plan->n2opt = plan->nOrOpt = plan->nPopped = 0;
+   plan->isOptimum = 1;
+   plan->nbrSeconds = 0.0;
+   if ((n < 4) || (plan->nNbrs < 1)) return(0);      /* no move is possible */
+   if (plan->nNbrs > KDT_MAX_SEP - 1) plan->nNbrs = KDT_MAX_SEP - 1;
+
+   memset(&o, 0, sizeof(o));
+   o.nLcn = n;
+   o.nNbrs = plan->nNbrs;
+   o.tour = tour;
+   o.xyz = malloc(3 * n * sizeof(double));
+   o.pos = malloc(n * sizeof(int));
+   o.nbrs = malloc(o.nNbrs * n * sizeof(int));
+   o.queue = malloc(n * sizeof(int));
+   o.inQueue = calloc(n, 1);
+   lcnNcs = malloc(n * sizeof(nemoPtNcs));
+   if ((o.xyz == NULL) || (o.pos == NULL) || (o.nbrs == NULL) ||
+       (o.queue == NULL) || (o.inQueue == NULL) || (lcnNcs == NULL)) {
+      free(lcnNcs);
+      optFree(&o);
+      return(ITIN_ENGINE_NOMEM);
+      }
+
+   wallStart = statsWall();
+   for (i = 0; i < n; i++) {
+      NCS_SOA_GET(lcn, i, lcnNcs + i);
+      for (k = 0; k < 3; k++) o.xyz[3 * i + k] = lcnNcs[i].dc[k];
+      }
+   for (p = 0; p < n; p++) o.pos[tour[p]] = p;
+   iErr = kdtBuild(&lcnTree, lcnNcs, n);
+   if (iErr) {
+      free(lcnNcs);
+      optFree(&o);
+      return(ITIN_ENGINE_NOMEM);
+      }
+   for (i = 0; i < n; i++) {          /* neighbour lists, nearest first... */
+      iErr = kdtNearestSep(&lcnTree, lcnNcs[i].dc, o.nNbrs + 1, 0.0, ids, NULL);
+      for (k = p = 0; (p < iErr) && (k < o.nNbrs); p++) { /* ...not including i */
+         if (ids[p] != i) o.nbrs[o.nNbrs * i + k++] = ids[p];
+         }
+      while (k < o.nNbrs) o.nbrs[o.nNbrs * i + k++] = -1;
+      }
+   kdtFree(&lcnTree);
+   free(lcnNcs);
+   plan->nbrSeconds = statsWall() - wallStart;
+
+   for (i = 0; i < n; i++) queuePush(&o, i);
+   nPopped = isDone = 0;
+   while (o.qCount && !isDone) {
+      i = o.queue[o.qHead];
+      o.qHead = (o.qHead + 1) % n;
+      o.qCount--;
+      o.inQueue[i] = 0;
+      while (try2opt(&o, i) || tryOrOpt(&o, i)) {  /* improve around i, while... */
+         if ((plan->maxMoves) && (o.n2opt + o.nOrOpt >= plan->maxMoves)) break;
+         }                                                          /* ...can */
+      if ((plan->maxMoves) && (o.n2opt + o.nOrOpt >= plan->maxMoves)) isDone = 1;
+      if ((++nPopped % 1024 == 0) &&
+          (statsWall() - wallStart > plan->maxSeconds)) isDone = 1;
+      if (plan->isVerbose && (nPopped % 100000 == 0))
+         fprintf(stderr, "moves: %d + %d, queued %d   \r", o.n2opt, o.nOrOpt,
+                                                           o.qCount);
+      }
+   plan->n2opt = o.n2opt;
+   plan->nOrOpt = o.nOrOpt;
+   plan->nPopped = nPopped;
+   plan->isOptimum = (o.qCount == 0);
+   optFree(&o);
+   return(0);
+   }
+/* ========================================================================== */
+/* Codecs: n records of the format to SoA, with (up to) nThreads threads */
+static int cs8ToSoaCodec(const void *recs, int n, ncsSoa *soa, int nThreads) {
+   int i;
+   nemoPtNcs ptNcs;
+/* -------------------------------------------------------------------------- */
+   (void)nThreads;          /* Cs8 input is decoded by the calling thread only */
+   for (i = 0; i < n; i++) {
+      nemo_Cs8ToNcs(((const nemoPtCs8 *)recs)[i], &ptNcs);
+      NCS_SOA_SET(soa, i, &ptNcs);
+      }
+   return(0);
+   }
+static int us8ToSoaCodec(const void *recs, int n, ncsSoa *soa, int nThreads) {
+   return(us8ToSoa(recs, n, soa, nThreads) ? ITIN_ENGINE_THREAD : 0);
+   }
+static int us4ToSoaCodec(const void *recs, int n, ncsSoa *soa, int nThreads) {
+   return(us4ToSoa(recs, n, soa, nThreads) ? ITIN_ENGINE_THREAD : 0);
+   }
+/* ========================================================================== */
+/* Search for the closest location inside the window +/- slots from nLast,
+   among the live list entries. Coordinates of visited (but not yet dropped)
+   locations are VISITED_DC, and the batch chord squared kernel never selects
+   them; on equal distances, the lowest location index wins.
+ */
+static int closeInWin(struct itinSearch *w, int nLast) {
+   int nStart, nEnd, nMin;
+   double dcLast[3];                    /* ncs coords of the "stable" point */
+/* -------------------------------------------------------------------------- */
+   nStart = nLast - w->iWin;
+   if (nStart < 0) nStart = 0;
+   nEnd = nLast + w->iWin;
+   if (nEnd > w->nLcn) nEnd = w->nLcn;
+   dcLast[0] = w->lcn->x[nLast];
+   dcLast[1] = w->lcn->y[nLast];
+   dcLast[2] = w->lcn->z[nLast];
+   chSqMinSoa(dcLast, &w->liveSoa, liveLowerBound(w, nStart),
+              liveLowerBound(w, nEnd), &nMin);            /* -1: all visited */
+   w->plan->nInside++;
+   return((nMin < 0) ? -1 : w->liveIdx[nMin]);
+   }
+/* ========================================================================== */
+/* Search for the next point to resume itinerary outside the "close search"
+   window: the un-visited location nearest (by index) to the low or to the
+   high side of the window, the low one if they are as near.
+   Not finding a point would be an obvious "two-level-search" algorithm error.
+ */
+static int closeOutWin(struct itinSearch *w, int nLast) {
+   int nLow, nHigh, iLow, iHigh;
+/* -------------------------------------------------------------------------- */
+   nLow = nLast - w->iWin;
+   if (nLow < 0) nLow = 0;
+   nHigh = nLast + w->iWin;
+   if (nHigh > w->nLcn) nHigh = w->nLcn;
+   w->plan->nOutside++;
+   for (iLow = liveLowerBound(w, nLow + 1) - 1; iLow >= 0; iLow--) {
+      if (!IS_VISITED(w, w->liveIdx[iLow])) break;
+      }
+   if ((iLow >= 0) && (w->liveIdx[iLow] == 0)) iLow = -1;  /* 0 is never "low" */
+   for (iHigh = liveLowerBound(w, nHigh); iHigh < w->liveCnt; iHigh++) {
+      if (!IS_VISITED(w, w->liveIdx[iHigh])) break;
+      }
+   if (iLow >= 0) {
+      if ((iHigh == w->liveCnt) ||
+          (nLow - w->liveIdx[iLow] <= w->liveIdx[iHigh] - nHigh))
+         return(w->liveIdx[iLow]);
+      }
+   if (iHigh < w->liveCnt) return(w->liveIdx[iHigh]);
+   return(-1);                                     /* this better not happen! */
+   }
+/* ========================================================================== */
+/* Search the spatial index for the un-visited location nearest to nLast */
+static int closeInTree(struct itinSearch *w, int nLast) {
+   double dcLast[3];
+/* -------------------------------------------------------------------------- */
+   dcLast[0] = w->lcn->x[nLast];
+   dcLast[1] = w->lcn->y[nLast];
+   dcLast[2] = w->lcn->z[nLast];
+   w->plan->nInside++;
+   return(kdtNearest(&w->tree, dcLast, NEMO_DOUBLE_HUGE, NULL));
+   }
+/* ========================================================================== */
+/* Mark location n visited: delete it from the spatial index (window size 0)
+   or from the live list. The latter is compacted when the visited entries
+   outnumber half of the window, and are 1/LIVE_COMPACT of all its entries.
+ */
+static void visit(struct itinSearch *w, int n) {
+   int i;
+/* -------------------------------------------------------------------------- */
+   SET_VISITED(w, n);
+   if (w->iWin == 0) {
+      kdtDelete(&w->tree, n);
+      return;
+      }
+   i = liveLowerBound(w, n);
+   w->liveSoa.x[i] = w->liveSoa.y[i] = w->liveSoa.z[i] = ITIN_VISITED_DC;
+   if ((++w->liveDead > w->iWin) && (ITIN_LIVE_COMPACT * w->liveDead > w->liveCnt))
+      liveCompact(w);
+   return;
+   }
+/* ========================================================================== */
+/* Position of the first live list entry with location index >= n */
+static int liveLowerBound(const struct itinSearch *w, int n) {
+   int lo, hi, mid;
+/* -------------------------------------------------------------------------- */
+   lo = 0;
+   hi = w->liveCnt;
+   while (lo < hi) {
+      mid = (lo + hi) >> 1;
+      if (w->liveIdx[mid] < n) lo = mid + 1;
+      else hi = mid;
+      }
+   return(lo);
+   }
+/* ========================================================================== */
+/* Drop the visited locations from the live list, keeping the index order */
+static void liveCompact(struct itinSearch *w) {
+   int i, j;
+/* -------------------------------------------------------------------------- */
+   for (i = j = 0; i < w->liveCnt; i++) {
+      if (IS_VISITED(w, w->liveIdx[i])) continue;
+      w->liveIdx[j] = w->liveIdx[i];
+      w->liveSoa.x[j] = w->liveSoa.x[i];
+      w->liveSoa.y[j] = w->liveSoa.y[i];
+      w->liveSoa.z[j] = w->liveSoa.z[i];
+      j++;
+      }
+   w->liveCnt = j;
+   w->liveDead = 0;
+   return;
+   }
+/* ========================================================================== */
+/* Brute force strategy: the locations are copied, and the visited ones are
+   swapped in front of those not visited, which thus remain together at the
+   end of the arrays. Each step's search of those is split in slices, one
+   per thread; the calling thread searches the first one.
+ */
+static int nearBrute(const ncsSoa *lcn, int n, itinPlan *plan, int *itin) {
+   int i, k, nx, nThreads, nStarted;
+   struct itinPool *pool;
+   nemoPtNcs ptNcs, holdNcs;
+   pthread_t threads[ITIN_ENGINE_MAX_THREADS];
+/* -------------------------------------------------------------------------- */
+   pool = malloc(sizeof(struct itinPool));
+   if (pool == NULL) return(ITIN_ENGINE_NOMEM);
+   if (ncsSoaAlloc(&pool->soa, n)) {
+      free(pool);
+      return(ITIN_ENGINE_NOMEM);
+      }
+   memcpy(pool->soa.x, lcn->x, n * sizeof(double));
+   memcpy(pool->soa.y, lcn->y, n * sizeof(double));
+   memcpy(pool->soa.z, lcn->z, n * sizeof(double));
+   for (i = 0; i < n; i++) itin[i] = i;
+
+   nThreads = plan->nThreads;
+   if (nThreads > ITIN_ENGINE_MAX_THREADS) nThreads = ITIN_ENGINE_MAX_THREADS;
+   pool->nSlices = 1;
+   pool->slices[0].pool = pool;
+   atomic_init(&pool->step, 0);
+   atomic_init(&pool->nBusy, 0);
+   atomic_init(&pool->isDone, 0);
+   for (nStarted = 0; nStarted < nThreads - 1; nStarted++) {
+      pool->slices[nStarted + 1].iSlice = nStarted + 1;
+      pool->slices[nStarted + 1].pool = pool;
+      if (pthread_create(threads + nStarted, NULL, sliceWorker,
+                         pool->slices + nStarted + 1)) break;
+      pool->nSlices++;
+      }
+
+   nx = 0;
+   if (pool->nSlices < nThreads) nx = ITIN_ENGINE_THREAD;
+   else for (k = 0; k < n - 2; k++) {
+      if (plan->isVerbose && (k%1000 == 0))
+         fprintf(stderr, "Itinerary stations: %dK\r", k / 1000);
+      NCS_SOA_GET(&pool->soa, k, &ptNcs);   /* got leg start, find closest end */
+      nx = nearSlices(pool, ptNcs.dc, k + 1, n);
+      if (nx == -1) {
+         nx = ITIN_ENGINE_ASSERT;
+         break;
+         }
+/*    found next location to visit. Swap it with k + 1, move to the next k */
+      i = itin[k + 1];
+      itin[k + 1] = itin[nx];
+      itin[nx] = i;
+      NCS_SOA_GET(&pool->soa, k + 1, &holdNcs);          /* ...and its coords */
+      NCS_SOA_GET(&pool->soa, nx, &ptNcs);
+      NCS_SOA_SET(&pool->soa, k + 1, &ptNcs);
+      NCS_SOA_SET(&pool->soa, nx, &holdNcs);
+      plan->nInside++;
+      nx = 0;
+      }
+   atomic_store(&pool->isDone, 1);
+   for (i = 0; i < nStarted; i++) pthread_join(threads[i], NULL);
+   ncsSoaFree(&pool->soa);
+   free(pool);
+   return(nx);
+   }
+/* ========================================================================== */
+/* The nearest location to q, of those in [lo, hi): its index, or -1. If there
+   are enough of them, the range is split in slices (of multiples of 8, for
+   the vector code of chSqMinSoa), searched by all the threads at once; the
+   slices are then taken in order, so that on equal distance the nearest one
+   is the first, as it would be when searched by one thread. The range only
+   shrinks, so once it is too small for the threads they are retired (they
+   exit, and are joined by nearBrute()) rather than left spinning idle.
+ */
+static int nearSlices(struct itinPool *pool, const double *q, int lo, int hi) {
+   int i, iNear, nSpin;
+   double chSqNear;
+/* -------------------------------------------------------------------------- */
+   if ((pool->nSlices == 1) || (hi - lo < ITIN_SLICE_MIN * pool->nSlices)) {
+      if (pool->nSlices > 1) {              /* from now on: this thread only */
+         atomic_store(&pool->isDone, 1);
+         pool->nSlices = 1;
+         }
+      chSqMinSoa(q, &pool->soa, lo, hi, &iNear);
+      return(iNear);
+      }
+   pool->q[0] = q[0];
+   pool->q[1] = q[1];
+   pool->q[2] = q[2];
+   pool->lo = lo;
+   pool->hi = hi;
+   atomic_store(&pool->nBusy, pool->nSlices - 1);
+   atomic_fetch_add_explicit(&pool->step, 1, memory_order_release);    /* go */
+   searchSlice(pool, 0);
+   for (nSpin = 0; atomic_load_explicit(&pool->nBusy, memory_order_acquire); )
+      if (++nSpin > ITIN_SPIN_YIELD) sched_yield();
+
+   iNear = -1;
+   chSqNear = NEMO_DOUBLE_HUGE;
+   for (i = 0; i < pool->nSlices; i++) {
+      if ((pool->slices[i].iNear >= 0) && (pool->slices[i].chSq < chSqNear)) {
+         chSqNear = pool->slices[i].chSq;
+         iNear = pool->slices[i].iNear;
+         }
+      }
+   return(iNear);
+   }
+/* ========================================================================== */
+/* Search slice i of the current step's range */
+static void searchSlice(struct itinPool *pool, int i) {
+   int len, sLo, sHi;
+/* -------------------------------------------------------------------------- */
+   len = (pool->hi - pool->lo + pool->nSlices - 1) / pool->nSlices;
+   len = (len + 7) & ~7;
+   sLo = pool->lo + i * len;
+   sHi = (sLo + len < pool->hi) ? sLo + len : pool->hi;
+   if (sLo >= sHi) {
+      pool->slices[i].chSq = NEMO_DOUBLE_HUGE;
+      pool->slices[i].iNear = -1;
+      }
+   else pool->slices[i].chSq = chSqMinSoa(pool->q, &pool->soa, sLo, sHi,
+                                          &pool->slices[i].iNear);
+   return;
+   }
+/* ========================================================================== */
+/* Worker thread: wait for the next step, search its slice, until done */
+static void *sliceWorker(void *arg) {
+   struct itinSlice *slice = arg;
+   struct itinPool *pool = slice->pool;
+   int step, nSpin;
+/* -------------------------------------------------------------------------- */
+   step = 0;
+   for (;;) {
+      for (nSpin = 0;
+           atomic_load_explicit(&pool->step, memory_order_acquire) == step; ) {
+         if (atomic_load_explicit(&pool->isDone, memory_order_relaxed)) return(NULL);
+         if (++nSpin > ITIN_SPIN_YIELD) sched_yield();
+         }
+      step++;
+      searchSlice(pool, slice->iSlice);
+      atomic_fetch_sub_explicit(&pool->nBusy, 1, memory_order_release);
+      }
+   return(NULL);
+   }
+/* ========================================================================== */
+/* Leg length, as an arc on the unit sphere, between two locations; -1 is the
+   "end" of the open itinerary, at zero distance from any location.
+ */
+static double legArc(const struct itinOpt *o, int a, int b) {
+   double chSq;
+/* -------------------------------------------------------------------------- */
+   if ((a < 0) || (b < 0)) return(0.0);
+   chSq = NEMO_ChordSq3(o->xyz + 3 * a, o->xyz + 3 * b);
+   return(2.0 * asin(0.5 * sqrt(chSq)));
+   }
+/* ========================================================================== */
+/* Find and apply an improving 2-opt move that creates a leg from location a
+   to one of its neighbours c, replacing either the legs leaving a and c, or
+   the legs arriving at them. Returns 1 if the itinerary was changed.
+ */
+static int try2opt(struct itinOpt *o, int a) {
+   int k, c, pa, pc, sa, sc, lo, hi;
+   double dAC, dA, delta;
+/* -------------------------------------------------------------------------- */
+   pa = o->pos[a];
+/* Legs leaving a and c: (a, succ a), (c, succ c) -> (a, c), (succ a, succ c) */
+   sa = SUCC(o, pa);
+   dA = legArc(o, a, sa);
+   for (k = 0; k < o->nNbrs; k++) {
+      c = o->nbrs[o->nNbrs * a + k];
+      if (c < 0) break;
+      dAC = legArc(o, a, c);
+      if (dAC >= dA) break;              /* neighbours farther can't improve */
+      pc = o->pos[c];
+      sc = SUCC(o, pc);
+      if ((c == sa) || (sc == a)) continue;
+      delta = dAC + legArc(o, sa, sc) - dA - legArc(o, c, sc);
+      if (delta > -ITIN_MIN_GAIN) continue;
+      lo = (pa < pc) ? pa + 1 : pc + 1;
+      hi = (pa < pc) ? pc : pa;
+      if (hi - lo > ITIN_MAX_SHIFT) continue;
+      reverseTour(o, lo, hi);
+      queuePush(o, a); queuePush(o, c);
+      if (sa >= 0) queuePush(o, sa);
+      if (sc >= 0) queuePush(o, sc);
+      o->n2opt++;
+      return(1);
+      }
+/* Legs arriving: (pred a, a), (pred c, c) -> (a, c), (pred a, pred c) */
+   if (pa == 0) return(0);                       /* the start has no pred */
+   sa = o->tour[pa - 1];
+   dA = legArc(o, sa, a);
+   for (k = 0; k < o->nNbrs; k++) {
+      c = o->nbrs[o->nNbrs * a + k];
+      if (c < 0) break;
+      dAC = legArc(o, a, c);
+      if (dAC >= dA) break;
+      pc = o->pos[c];
+      if (pc == 0) continue;
+      sc = o->tour[pc - 1];
+      if ((c == sa) || (sc == a)) continue;
+      delta = dAC + legArc(o, sa, sc) - dA - legArc(o, sc, c);
+      if (delta > -ITIN_MIN_GAIN) continue;
+      lo = (pa < pc) ? pa : pc;
+      hi = (pa < pc) ? pc - 1 : pa - 1;
+      if (hi - lo > ITIN_MAX_SHIFT) continue;
+      reverseTour(o, lo, hi);
+      queuePush(o, a); queuePush(o, c); queuePush(o, sa); queuePush(o, sc);
+      o->n2opt++;
+      return(1);
+      }
+   return(0);
+   }
+/* ========================================================================== */
+/* Find and apply an improving Or-opt move: the section of 1...OR_OPT_MAX
+   locations starting at a (in itinerary order) is moved between one of the
+   neighbours c of its end location and the location next to c, in either
+   orientation. Returns 1 if the itinerary was changed.
+ */
+static int tryOrOpt(struct itinOpt *o, int a) {
+   int k, len, c, pa, pe, prev, next, q, nq, e, end, rev, i, j, lo, hi;
+   int sec[ITIN_OR_OPT_MAX];
+   int *tour = o->tour, *pos = o->pos;
+   double gainOut, delta, dFwd, dRev;
+/* -------------------------------------------------------------------------- */
+   pa = pos[a];
+   if (pa == 0) return(0);                          /* the start stays first */
+   prev = tour[pa - 1];
+   for (len = 1; len <= ITIN_OR_OPT_MAX; len++) {
+      pe = pa + len - 1;                                 /* section: [pa, pe] */
+      if (pe >= o->nLcn) break;
+      next = SUCC(o, pe);
+      gainOut = legArc(o, prev, a) + legArc(o, tour[pe], next) -
+                legArc(o, prev, next);
+      if (gainOut < ITIN_MIN_GAIN) continue;
+      for (e = 0; e < 2; e++) {      /* neighbours of either section end... */
+         end = e ? tour[pe] : a;
+         for (k = 0; k < o->nNbrs; k++) {
+            c = o->nbrs[o->nNbrs * end + k];
+            if (c < 0) break;
+            if (legArc(o, end, c) >= gainOut) break;  /* can't gain any more */
+            if ((pos[c] >= pa) && (pos[c] <= pe)) continue;  /* in section */
+            for (i = 0; i < 2; i++) {  /* ...inserted after c, or before it */
+               q = i ? pos[c] - 1 : pos[c];        /* insert after tour[q] */
+               if ((q < 0) || ((q >= pa - 1) && (q <= pe))) continue;
+               nq = SUCC(o, q);
+               dFwd = legArc(o, tour[q], a) + legArc(o, tour[pe], nq);
+               dRev = legArc(o, tour[q], tour[pe]) + legArc(o, a, nq);
+               rev = (dRev < dFwd);
+               delta = (rev ? dRev : dFwd) - legArc(o, tour[q], nq) - gainOut;
+               if (delta > -ITIN_MIN_GAIN) continue;
+               lo = (q < pa) ? q + 1 : pa;
+               hi = (q < pa) ? pe : q;
+               if (hi - lo > ITIN_MAX_SHIFT) continue;
+               for (j = 0; j < len; j++) sec[j] = tour[pa + (rev ? len - 1 - j : j)];
+               if (q < pa) {           /* shift [q + 1, pa) up, section down */
+                  memmove(tour + q + 1 + len, tour + q + 1, (pa - q - 1) * sizeof(int));
+                  memcpy(tour + q + 1, sec, len * sizeof(int));
+                  }
+               else {                /* shift (pe, q] down, section up */
+                  memmove(tour + pa, tour + pe + 1, (q - pe) * sizeof(int));
+                  memcpy(tour + q - len + 1, sec, len * sizeof(int));
+                  }
+               for (j = lo; j <= hi; j++) pos[tour[j]] = j;
+               queuePush(o, prev);
+               if (next >= 0) queuePush(o, next);
+               queuePush(o, c);
+               if (nq >= 0) queuePush(o, nq);
+               for (j = 0; j < len; j++) queuePush(o, sec[j]);
+               o->nOrOpt++;
+               return(1);
+               }
+            }
+         }
+      }
+   return(0);
+   }
+/* ========================================================================== */
+/* Reverse the itinerary section between positions lo and hi, inclusive */
+static void reverseTour(struct itinOpt *o, int lo, int hi) {
+   int t;
+/* -------------------------------------------------------------------------- */
+   while (lo < hi) {
+      t = o->tour[lo];
+      o->tour[lo] = o->tour[hi];
+      o->tour[hi] = t;
+      o->pos[o->tour[lo]] = lo;
+      o->pos[o->tour[hi]] = hi;
+      lo++;
+      hi--;
+      }
+   if (lo == hi) o->pos[o->tour[lo]] = lo;
+   return;
+   }
+/* ========================================================================== */
+static void queuePush(struct itinOpt *o, int n) {
+   if (o->inQueue[n]) return;
+   o->inQueue[n] = 1;
+   o->queue[(o->qHead + o->qCount) % o->nLcn] = n;
+   o->qCount++;
+   return;
+   }
+/* ========================================================================== */
+/* Free the local search work buffers (not the tour, it is the caller's) */
+static void optFree(struct itinOpt *o) {
+   free(o->xyz);
+   free(o->pos);
+   free(o->nbrs);
+   free(o->queue);
+   free(o->inQueue);
+   return;
+   }
+/* ========================================================================== */
@@ -0,0 +1,102 @@
+/* itinEngine.h: "nearest next" itinerary of locations, and its improvement
+   by local search, for the programs of any binary coordinate format: the
+   locations are decoded once - by the format's codec, Cs8, Us8 or Us4 - to
+   NCS direction cosines in SoA form (see chordSqBatch.h), and everything
+   else is done with those.
+
+   The itinerary starts at the first location, and goes to the nearest one
+   not yet visited, found by one of the strategies:
+
+      ITIN_WINDOW
+         within a window of the input order (the locations "below" and
+         "above" the last one visited), or if all of those have been
+         visited, the one nearest to the window (in the input order). Fast,
+         and good for input sorted by coordinate value.
+      ITIN_TREE
+         the truly nearest one, of a k-d tree spatial index (ncsKdTree.h)
+         from which the locations are deleted as they are visited.
+      ITIN_BRUTE
+         as above, by a scan of all those not visited, at each step split
+         in slices searched by nThreads threads. Slow, but simple enough to
+         be the exact reference of the other two.
+      ITIN_CURVE
+         no search at all: the itinerary is the order of the locations
+         along a Hilbert curve (see below). Fastest, and a good start for
+         the improvement.
+
+   With the plan's isSeeded set, the window, tree and brute force searches
+   are done over the locations re-ordered along that curve, instead of the
+   input order: the window then holds the locations near on the surface,
+   whatever the file order, and the window search does not "jump blindly"
+   where the numeric order of the coordinates does (at the plate edges).
+   The curve is made of one Hilbert curve on each of the 6 faces of the
+   cube around the sphere (like the 6 digiNental plates; the face is that
+   of the largest NCS direction cosine, and its sign), each ending at the
+   cube corner where the curve of the next face starts, so that the 6 make
+   one closed loop. The loop
+   is cut at the first location, which stays first. It is found by the
+   radix sort of the curve keys (us8Sort.h), O(n) both in time and memory.
+
+   On equal distance, all of them go to the location that comes first (in
+   the input order, ITIN_BRUTE: in the order of its scan), so the itinerary
+   does not depend on the number of threads.
+
+   The itinerary (any, not only one of the above) is improved by 2-opt and
+   Or-opt moves between the nNbrs nearest neighbours of each location, until
+   none improves it, or the time or moves budget is exhausted (see the
+   improveP8b program for the details).
+
+   Include after nemo.h, nemoStats.h, chordSqBatch.h, us8Batch.h, us8Sort.h
+   and ncsKdTree.h; the implementation (itinEngine.c) is included at the end of
+   the program source, just like other scullions.
+ */
+#ifndef ITIN_ENGINE_H
+#define ITIN_ENGINE_H
+
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define ITIN_WINDOW             0                   /* itinerary strategies */
+#define ITIN_TREE               1
+#define ITIN_BRUTE              2
+#define ITIN_CURVE              3
+
+#define ITIN_MIN_WIN           16   /* the low value only for testing/debbuging */
+#define ITIN_MAX_WIN        32000
+#define ITIN_ENGINE_MAX_THREADS 256
+#define ITIN_CURVE_ORDER       20   /* most curve levels, 2^20 cells per edge */
+
+#define ITIN_ENGINE_NOMEM      -1              /* no memory for work buffers */
+#define ITIN_ENGINE_THREAD     -2                   /* can't create a thread */
+#define ITIN_ENGINE_ASSERT     -3         /* no next location: can't happen */
+
+typedef struct {               /* coordinate format, of one location record */
+   const char *name;                                /* "Cs8", "Us8", "Us4" */
+   int recSize;                                   /* bytes, in a file record */
+   int (*toSoa)(const void *, int, ncsSoa *, int);  /* decode n, by threads */
+   } itinCodec;
+
+typedef struct {
+   int strategy;       /* ITIN_WINDOW, ITIN_TREE, ITIN_BRUTE or ITIN_CURVE */
+   int isSeeded;            /* 1: search in the curve order, not the input */
+   int window;                       /* ITIN_WINDOW: size of search window */
+   int nThreads;             /* ITIN_BRUTE search, curve sort: threads, or 0 */
+   int nNbrs;                   /* improvement: neighbours per location... */
+   double maxSeconds;                           /* ...budget: wall time... */
+   int maxMoves;                                 /* ...and moves, or 0 */
+   int isVerbose;                   /* progress, to stderr (with \r only) */
+   int nInside, nOutside;   /* results: found in/outside window (or steps) */
+   int n2opt, nOrOpt, nPopped;           /* moves applied, locations tried */
+   int isOptimum;                /* 1: no improving move left, 0: budget */
+   double nbrSeconds;                      /* neighbour lists, wall time */
+   } itinPlan;
+
+extern const itinCodec itinCodecCs8, itinCodecUs8, itinCodecUs4;
+
+int itinNearNext(const ncsSoa *, int, itinPlan *, int *);
+int itinImprove(const ncsSoa *, int, itinPlan *, int *);
+int itinCurve(const ncsSoa *, int, int, int *);
+
+#endif
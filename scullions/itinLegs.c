@@ -0,0 +1,198 @@
+/* itinLegs.c: itinerary leg lengths, totals and histogram (see itinLegs.h) */
+
+struct itinChunk {                    /* results for one chunk of the legs */
+   double arcSum, arcComp, arcMin, arcMax;     /* Kahan sum and compensation */
+   double gdsSum, gdsComp, gdsMin, gdsMax;
+   int histo[ITIN_HISTO_BINS];
+   };
+
+struct itinJob {                    /* state shared by all the threads */
+   const nemoPtUs8 *us8;                  /* locations, if given as Us8... */
+   const nemoPtNcs *ncs;                  /* ...or NCS: read from here, and */
+   nemoPtNcs *ncsBuf;                   /* converted into here, if Us8 */
+   nemoPtEnr *enr;                                /* locations, as ENR */
+   int nPts;
+   int nChunks;                          /* chunks of ITIN_CHUNK locations */
+   int nThreads;
+   struct itinChunk *chunks;
+   atomic_int nextChunk;                /* next one to be taken by a thread */
+   };
+
+static int itinLegsJob(struct itinJob *, itinStats *);
+static int itinLegsRun(struct itinJob *, void *(*)(void *));
+static void *itinConvert(void *);
+static void *itinMeasure(void *);
+static void kahanAdd(double *, double *, double);
+/* ========================================================================== */
+/* Leg lengths of the itinerary through nPts Us8 locations, using nThreads
+   threads (0 or 1: the calling thread only). Returns 0 on success,
+   ITIN_LEGS_NOMEM or ITIN_LEGS_THREAD if it could not be done.
+ */
+int itinLegsUs8(const nemoPtUs8 *pts,              /* locations, in order */
+                int nPts,                             /* number of locations */
+                int nThreads,                  /* max. worker threads, or 0 */
+                itinStats *st) {                          /* results returned */
+   int iErr;
+   struct itinJob job;
+/* -------------------------------------------------------------------------- */
+   memset(&job, 0, sizeof(struct itinJob));
+   job.us8 = pts;
+   job.nPts = nPts;
+   job.nThreads = nThreads;
+   job.ncsBuf = malloc((size_t)(nPts ? nPts : 1) * sizeof(nemoPtNcs));
+   if (job.ncsBuf == NULL) return(ITIN_LEGS_NOMEM);
+   job.ncs = job.ncsBuf;
+   iErr = itinLegsJob(&job, st);
+   free(job.ncsBuf);
+   return(iErr);
+   }
+/* ========================================================================== */
+/* Same as itinLegsUs8(), for locations already converted to NCS */
+int itinLegsNcs(const nemoPtNcs *pts,              /* locations, in order */
+                int nPts,                             /* number of locations */
+                int nThreads,                  /* max. worker threads, or 0 */
+                itinStats *st) {                          /* results returned */
+   struct itinJob job;
+/* -------------------------------------------------------------------------- */
+   memset(&job, 0, sizeof(struct itinJob));
+   job.ncs = pts;
+   job.nPts = nPts;
+   job.nThreads = nThreads;
+   return(itinLegsJob(&job, st));
+   }
+/* ========================================================================== */
+/* Lower limit (meters) of geodesic leg lengths counted in histogram bin i */
+double itinHistoFrom(int i) {
+   return((i > 0) ? ldexp(1.0, i - 1) : 0.0);
+   }
+/* ========================================================================== */
+/* Convert the locations, measure the legs chunk by chunk, and add up the
+   chunk results in chunk order.
+ */
+static int itinLegsJob(struct itinJob *job, itinStats *st) {
+   int i, b, iErr;
+   double arcComp, gdsComp;
+   struct itinChunk *ch;
+/* -------------------------------------------------------------------------- */
+   memset(st, 0, sizeof(itinStats));
+   st->arcMin = st->gdsMin = NEMO_DOUBLE_HUGE;
+   if (job->nPts < 1) return(0);
+   st->nLegs = job->nPts - 1;
+   if (job->nThreads < 1) job->nThreads = 1;
+   if (job->nThreads > ITIN_MAX_THREADS) job->nThreads = ITIN_MAX_THREADS;
+   job->nChunks = (job->nPts + ITIN_CHUNK - 1) / ITIN_CHUNK;
+   job->enr = malloc((size_t)job->nPts * sizeof(nemoPtEnr));
+   job->chunks = calloc((size_t)job->nChunks, sizeof(struct itinChunk));
+   if ((job->enr == NULL) || (job->chunks == NULL)) {
+      free(job->enr);
+      free(job->chunks);
+      return(ITIN_LEGS_NOMEM);
+      }
+   atomic_init(&job->nextChunk, 0);
+   iErr = itinLegsRun(job, itinConvert);
+   atomic_init(&job->nextChunk, 0);
+   if (iErr == 0) iErr = itinLegsRun(job, itinMeasure);
+   if (iErr == 0) {
+      arcComp = gdsComp = 0.0;
+      for (i = 0; i < job->nChunks; i++) {
+         ch = job->chunks + i;
+         kahanAdd(&st->arcTotal, &arcComp, ch->arcSum);
+         kahanAdd(&st->arcTotal, &arcComp, -ch->arcComp);
+         kahanAdd(&st->gdsTotal, &gdsComp, ch->gdsSum);
+         kahanAdd(&st->gdsTotal, &gdsComp, -ch->gdsComp);
+         if (ch->arcMin < st->arcMin) st->arcMin = ch->arcMin;
+         if (ch->arcMax > st->arcMax) st->arcMax = ch->arcMax;
+         if (ch->gdsMin < st->gdsMin) st->gdsMin = ch->gdsMin;
+         if (ch->gdsMax > st->gdsMax) st->gdsMax = ch->gdsMax;
+         for (b = 0; b < ITIN_HISTO_BINS; b++) st->histo[b] += ch->histo[b];
+         }
+/* let's hope the peddler does not end up exactly at the antipodes... */
+      i = job->nPts - 1;
+      st->arcStartEnd = NEMO_EARTH_RADIUS * nemo_ArcV3(job->ncs[0].dc, job->ncs[i].dc);
+      st->gdsStartEnd = statsSzpila(job->enr, job->enr + i);
+      }
+   free(job->enr);
+   free(job->chunks);
+   return(iErr);
+   }
+/* ========================================================================== */
+/* Run the given stage on job->nThreads threads, and wait for all of them to
+   finish. Single-threaded job runs in the calling thread.
+ */
+static int itinLegsRun(struct itinJob *job, void *(*stage)(void *)) {
+   int i, nStarted;
+   pthread_t threads[ITIN_MAX_THREADS];
+/* -------------------------------------------------------------------------- */
+   if (job->nThreads == 1) {
+      stage(job);
+      return(0);
+      }
+   for (nStarted = 0; nStarted < job->nThreads; nStarted++) {
+      if (pthread_create(threads + nStarted, NULL, stage, job)) break;
+      }
+   for (i = 0; i < nStarted; i++) pthread_join(threads[i], NULL);
+   return((nStarted == job->nThreads) ? 0 : ITIN_LEGS_THREAD);
+   }
+/* ========================================================================== */
+/* Take chunks of locations, and convert each location (once) to NCS, if
+   given as Us8, and to ENR.
+ */
+static void *itinConvert(void *arg) {
+   struct itinJob *job = arg;
+   int c, n, nEnd;
+/* -------------------------------------------------------------------------- */
+   while ((c = atomic_fetch_add(&job->nextChunk, 1)) < job->nChunks) {
+      n = c * ITIN_CHUNK;
+      nEnd = (n + ITIN_CHUNK < job->nPts) ? n + ITIN_CHUNK : job->nPts;
+      for (; n < nEnd; n++) {
+         if (job->us8) nemo_Us8ToNcs(job->us8[n], job->ncsBuf + n);
+         nemo_NcsToEnr(nemo_ElrWgs84(), job->ncs + n, job->enr + n);
+         }
+      }
+   return(NULL);
+   }
+/* ========================================================================== */
+/* Take chunks of legs - the ones ending at the locations of the chunk - and
+   measure them.
+ */
+static void *itinMeasure(void *arg) {
+   struct itinJob *job = arg;
+   int c, n, nEnd, b;
+   double arc, gds;
+   struct itinChunk *ch;
+/* -------------------------------------------------------------------------- */
+   while ((c = atomic_fetch_add(&job->nextChunk, 1)) < job->nChunks) {
+      ch = job->chunks + c;
+      ch->arcMin = ch->gdsMin = NEMO_DOUBLE_HUGE;
+      n = c * ITIN_CHUNK;
+      nEnd = (n + ITIN_CHUNK < job->nPts) ? n + ITIN_CHUNK : job->nPts;
+      if (n == 0) n = 1;                      /* the first location: no leg */
+      for (; n < nEnd; n++) {
+         arc = NEMO_EARTH_RADIUS * nemo_ArcV3(job->ncs[n - 1].dc, job->ncs[n].dc);
+         gds = statsSzpila(job->enr + n - 1, job->enr + n);
+         kahanAdd(&ch->arcSum, &ch->arcComp, arc);
+         kahanAdd(&ch->gdsSum, &ch->gdsComp, gds);
+         if (arc < ch->arcMin) ch->arcMin = arc;
+         if (arc > ch->arcMax) ch->arcMax = arc;
+         if (gds < ch->gdsMin) ch->gdsMin = gds;
+         if (gds > ch->gdsMax) ch->gdsMax = gds;
+         if (gds < 1.0) b = 0;
+         else frexp(gds, &b);                  /* gds in [2^(b-1), 2^b) */
+         if (b >= ITIN_HISTO_BINS) b = ITIN_HISTO_BINS - 1;
+         ch->histo[b]++;
+         }
+      }
+   return(NULL);
+   }
+/* ========================================================================== */
+/* Compensated (Kahan) summation: add x to sum, comp is the running error */
+static void kahanAdd(double *sum, double *comp, double x) {
+   double y, t;
+/* -------------------------------------------------------------------------- */
+   y = x - *comp;
+   t = *sum + y;
+   *comp = (t - *sum) - y;
+   *sum = t;
+   return;
+   }
+/* ========================================================================== */
@@ -0,0 +1,44 @@
+/* itinLegs.h: itinerary leg lengths - on the spherical, and along geodesics
+   on the WGS84 ellipsoid Earth - and their totals, minima and maxima, for an
+   "open" itinerary through an array of locations (plus the "return home"
+   leg, from the last location back to the first).
+
+   Each location is converted once, to NCS and ENR, into a buffer shared by
+   the two legs it belongs to; the legs are then evaluated in chunks of
+   ITIN_CHUNK, by one or more threads. Totals are compensated (Kahan) sums,
+   per chunk, added up in the chunk order: the results do not depend on the
+   number of threads, nor on the run.
+
+   The legs are also counted in a histogram of geodesic lengths: bin 0 are
+   legs shorter than 1 meter, bin i > 0 the ones of [2^(i-1), 2^i) meters.
+
+   Geodesics are evaluated by statsSzpila() (nemoStats.h), and so counted if
+   the program was run with -stats. Include after nemo.h and nemoStats.h; the
+   implementation (itinLegs.c) is included at the end of the program source,
+   just like other scullions.
+ */
+#ifndef ITIN_LEGS_H
+#define ITIN_LEGS_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define ITIN_CHUNK         65536                  /* legs per unit of work */
+#define ITIN_MAX_THREADS     256
+#define ITIN_HISTO_BINS       26          /* last bin: 2^24 m, over 16000 km */
+
+#define ITIN_LEGS_NOMEM      -1              /* no memory for work buffers */
+#define ITIN_LEGS_THREAD     -2                   /* can't create a thread */
+
+typedef struct {
+   int nLegs;                          /* open itinerary, number of locations - 1 */
+   double arcTotal, arcMin, arcMax, arcStartEnd;   /* spherical Earth, meters */
+   double gdsTotal, gdsMin, gdsMax, gdsStartEnd;  /* WGS84 ellipsoid, meters */
+   int histo[ITIN_HISTO_BINS];                  /* legs, by geodesic length */
+   } itinStats;
+
+int itinLegsUs8(const nemoPtUs8 *, int, int, itinStats *);
+int itinLegsNcs(const nemoPtNcs *, int, int, itinStats *);
+double itinHistoFrom(int);
+
+#endif
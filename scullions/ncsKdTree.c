@@ -0,0 +1,338 @@
+/* ncsKdTree.c: k-d tree spatial index over NCS point direction cosines.
+   (See ncsKdTree.h for the outline of data structure).
+
+   The tree is "implicit": the nodes are the elements of an array ordered so
+   that the root of any sub-tree spanning array slots [lo, hi) is the slot
+   (lo + hi) / 2, its "low" sub-tree spans [lo, mid) and "high" [mid + 1, hi).
+   The point coordinates are copied into the node array, so that a search
+   descending toward the leaves touches memory that is close together.
+ */
+#define KDT_SWAP(t, i, j) {                                                   \
+   double s_; int n_, c_;                                                     \
+   for (c_ = 0; c_ < 3; c_++) {                                               \
+      s_ = (t)->xyz[3 * (i) + c_];                                            \
+      (t)->xyz[3 * (i) + c_] = (t)->xyz[3 * (j) + c_];                        \
+      (t)->xyz[3 * (j) + c_] = s_;                                            \
+      }                                                                       \
+   n_ = (t)->ptId[i]; (t)->ptId[i] = (t)->ptId[j]; (t)->ptId[j] = n_;         \
+   }
+
+static void kdtSplit(kdTree *, int, int);
+static void kdtSelect(kdTree *, int, int, int, int);
+static void kdtSearch(const kdTree *, int, int, const double *,
+                      double *, int *);
+static void kdtSearchSep(const kdTree *, int, int, const double *,
+                         const int *, int, double, double *, int *);
+static void kdtCollect(const kdTree *, int, int, const double *, double,
+                       int *, int, int *);
+/* ========================================================================== */
+/* Build the tree from an array of NCS points. Point "id" used by all other
+   functions is the index of the point in this array. Returns 0 on success,
+   -1 if there was not enough memory.
+ */
+int kdtBuild(kdTree *t,                                     /* tree to build */
+             const nemoPtNcs *pts,                            /* given points */
+             int nPts) {                                  /* number of points */
+   int n, c;
+/* -------------------------------------------------------------------------- */
+   memset(t, 0, sizeof(kdTree));
+   t->xyz = malloc(3 * (size_t)nPts * sizeof(double));
+   t->ptId = malloc((size_t)nPts * sizeof(int));
+   t->nodeOf = malloc((size_t)nPts * sizeof(int));
+   t->live = malloc((size_t)nPts * sizeof(int));
+   t->axis = calloc((size_t)nPts, 1);
+   t->gone = calloc((size_t)nPts, 1);
+   if ((nPts > 0) && ((t->xyz == NULL) || (t->ptId == NULL) ||
+       (t->nodeOf == NULL) || (t->live == NULL) ||
+       (t->axis == NULL) || (t->gone == NULL))) {
+      kdtFree(t);
+      return(-1);
+      }
+   t->nPts = t->nLive = nPts;
+   for (n = 0; n < nPts; n++) {
+      for (c = 0; c < 3; c++) t->xyz[3 * n + c] = pts[n].dc[c];
+      t->ptId[n] = n;
+      }
+   kdtSplit(t, 0, nPts);
+   for (n = 0; n < nPts; n++) t->nodeOf[t->ptId[n]] = n;
+   return(0);
+   }
+/* ========================================================================== */
+void kdtFree(kdTree *t) {
+   free(t->xyz);
+   free(t->ptId);
+   free(t->nodeOf);
+   free(t->live);
+   free(t->axis);
+   free(t->gone);
+   memset(t, 0, sizeof(kdTree));
+   return;
+   }
+/* ========================================================================== */
+/* Find the live point nearest to the given direction cosines, but closer
+   than the given chord squared bound (NEMO_DOUBLE_HUGE for "any"). Returns
+   the point id, or -1 if there is no such point. If chSqFound is not NULL,
+   chord squared to the found point is returned in it.
+ */
+int kdtNearest(const kdTree *t,
+               const double *dc,                /* query point, on the NCS */
+               double chSqBound,   /* only points closer than this qualify */
+               double *chSqFound) {           /* if not NULL, found distance */
+   int nBest;
+/* -------------------------------------------------------------------------- */
+   nBest = -1;
+   kdtSearch(t, 0, t->nPts, dc, &chSqBound, &nBest);
+   if (chSqFound) *chSqFound = chSqBound;
+   return((nBest >= 0) ? t->ptId[nBest] : -1);
+   }
+/* ========================================================================== */
+/* Find up to k live points nearest to the given direction cosines, each one
+   at least sepChSq (chord squared) away from all the ones found before it:
+   ids[0] is the nearest point, ids[1] the nearest one not close to ids[0],
+   and so on; with sepChSq 0.0, these are simply the k nearest points.
+   Returns the number of points found; if chSqFound is not NULL, chord
+   squared to each found point is returned in it.
+ */
+int kdtNearestSep(const kdTree *t,
+                  const double *dc,             /* query point, on the NCS */
+                  int k,                         /* number of points wanted */
+                  double sepChSq,            /* separation of found points */
+                  int *ids,                          /* k point ids, returned */
+                  double *chSqFound) {/* if not NULL, k distances, returned */
+   int j, nBest;
+   int exNode[KDT_MAX_SEP];              /* nodes of the points found so far */
+   double chSq;
+/* -------------------------------------------------------------------------- */
+   if (k > KDT_MAX_SEP) k = KDT_MAX_SEP;
+   for (j = 0; j < k; j++) {
+      nBest = -1;
+      chSq = NEMO_DOUBLE_HUGE;
+      kdtSearchSep(t, 0, t->nPts, dc, exNode, j, sepChSq, &chSq, &nBest);
+      if (nBest < 0) break;                     /* no more such points left */
+      exNode[j] = nBest;
+      ids[j] = t->ptId[nBest];
+      if (chSqFound) chSqFound[j] = chSq;
+      }
+   return(j);
+   }
+/* ========================================================================== */
+/* Find the live points closer than chSqRadius (chord squared) to the given
+   direction cosines, but no more than maxIds of them. Returns the number of
+   points found; their ids are returned in ids, unless it is NULL. With
+   maxIds of 1, it is a quick test if there is any point that close.
+ */
+int kdtWithin(const kdTree *t,
+              const double *dc,                 /* query point, on the NCS */
+              double chSqRadius,                  /* search radius, squared */
+              int *ids,                      /* found point ids, or NULL */
+              int maxIds) {                   /* stop after finding these */
+   int nFound;
+/* -------------------------------------------------------------------------- */
+   nFound = 0;
+   if (maxIds > 0) kdtCollect(t, 0, t->nPts, dc, chSqRadius, ids, maxIds, &nFound);
+   return(nFound);
+   }
+/* ========================================================================== */
+/* Delete a point (given by its id) from the tree. Deleting an already
+   deleted point is a no-op.
+ */
+void kdtDelete(kdTree *t, int id) {
+   int node, lo, hi, mid;
+/* -------------------------------------------------------------------------- */
+   node = t->nodeOf[id];
+   if (t->gone[node]) return;
+   t->gone[node] = 1;
+   t->nLive--;
+   lo = 0;
+   hi = t->nPts;
+   while (lo < hi) {             /* walk down from the root to the node... */
+      mid = (lo + hi) >> 1;
+      t->live[mid]--;          /* ...decrementing live count along the way */
+      if (node == mid) break;
+      if (node < mid) hi = mid;
+      else lo = mid + 1;
+      }
+   return;
+   }
+/* ========================================================================== */
+/* Recursively arrange the nodes in [lo, hi): the median along the axis of
+   greatest coordinate spread goes to the middle slot, lower ones before it.
+ */
+static void kdtSplit(kdTree *t, int lo, int hi) {
+   int n, c, ax, mid;
+   double cMin[3], cMax[3], spread;
+/* -------------------------------------------------------------------------- */
+   if (lo >= hi) return;
+   mid = (lo + hi) >> 1;
+   t->live[mid] = hi - lo;                /* initially, all points are live */
+   if (hi - lo == 1) return;
+   for (c = 0; c < 3; c++) cMin[c] = cMax[c] = t->xyz[3 * lo + c];
+   for (n = lo + 1; n < hi; n++) {
+      for (c = 0; c < 3; c++) {
+         if (t->xyz[3 * n + c] < cMin[c]) cMin[c] = t->xyz[3 * n + c];
+         if (t->xyz[3 * n + c] > cMax[c]) cMax[c] = t->xyz[3 * n + c];
+         }
+      }
+   ax = 0;
+   spread = cMax[0] - cMin[0];
+   for (c = 1; c < 3; c++) {
+      if ((cMax[c] - cMin[c]) > spread) {
+         spread = cMax[c] - cMin[c];
+         ax = c;
+         }
+      }
+   kdtSelect(t, lo, hi, mid, ax);
+   t->axis[mid] = (unsigned char)ax;
+   kdtSplit(t, lo, mid);
+   kdtSplit(t, mid + 1, hi);
+   return;
+   }
+/* ========================================================================== */
+/* Hoare's selection: re-order [lo, hi) so that slot k holds the node that
+   would be there if the range was sorted on the coordinate ax.
+ */
+static void kdtSelect(kdTree *t, int lo, int hi, int k, int ax) {
+   int i, j;
+   double pivot;
+/* -------------------------------------------------------------------------- */
+   while (hi - lo > 1) {
+      pivot = t->xyz[3 * ((lo + hi) >> 1) + ax];
+      i = lo;
+      j = hi - 1;
+      while (i <= j) {
+         while (t->xyz[3 * i + ax] < pivot) i++;
+         while (t->xyz[3 * j + ax] > pivot) j--;
+         if (i <= j) {
+            KDT_SWAP(t, i, j);
+            i++;
+            j--;
+            }
+         }
+      if (k <= j) hi = j + 1;            /* [lo, j] are all <= pivot, ...  */
+      else if (k >= i) lo = i;               /* ...[i, hi) all >= pivot... */
+      else return;             /* ...and whatever is between equals pivot */
+      }
+   return;
+   }
+/* ========================================================================== */
+/* Nearest live point search in the sub-tree spanning [lo, hi). The side of
+   the splitting plane the query point is on is searched first, the other
+   side only if the plane itself is closer than the best point found so far.
+ */
+static void kdtSearch(const kdTree *t, int lo, int hi,
+                      const double *q,                      /* query point */
+                      double *chSqBest,        /* best so far, and updated */
+                      int *nBest) {                /* its node, and updated */
+   int mid, ax;
+   const double *p;
+   double d, chSq;
+/* -------------------------------------------------------------------------- */
+   while (lo < hi) {
+      mid = (lo + hi) >> 1;
+      if (t->live[mid] == 0) return;          /* nothing left in sub-tree */
+      p = t->xyz + 3 * mid;
+      if (!t->gone[mid]) {
+         chSq = NEMO_ChordSq3(q, p);
+         if (chSq < *chSqBest) {
+            *chSqBest = chSq;
+            *nBest = mid;
+            }
+         }
+      ax = t->axis[mid];
+      d = q[ax] - p[ax];
+      if (d < 0.0) {
+         kdtSearch(t, lo, mid, q, chSqBest, nBest);       /* near side... */
+         if (d * d >= *chSqBest) return;
+         lo = mid + 1;                         /* ...then the far side too */
+         }
+      else {
+         kdtSearch(t, mid + 1, hi, q, chSqBest, nBest);
+         if (d * d >= *chSqBest) return;
+         hi = mid;
+         }
+      }
+   return;
+   }
+/* ========================================================================== */
+/* Same as kdtSearch(), but the points closer than sepChSq to any of the nEx
+   nodes in exNode don't qualify.
+ */
+static void kdtSearchSep(const kdTree *t, int lo, int hi,
+                         const double *q,                   /* query point */
+                         const int *exNode, int nEx,    /* excluded nodes... */
+                         double sepChSq,           /* ...and their vicinity */
+                         double *chSqBest,     /* best so far, and updated */
+                         int *nBest) {             /* its node, and updated */
+   int mid, ax, j;
+   const double *p;
+   double d, chSq;
+/* -------------------------------------------------------------------------- */
+   while (lo < hi) {
+      mid = (lo + hi) >> 1;
+      if (t->live[mid] == 0) return;          /* nothing left in sub-tree */
+      p = t->xyz + 3 * mid;
+      if (!t->gone[mid]) {
+         chSq = NEMO_ChordSq3(q, p);
+         if (chSq < *chSqBest) {
+            for (j = 0; j < nEx; j++) {
+               if ((mid == exNode[j]) ||
+                   (NEMO_ChordSq3(p, t->xyz + 3 * exNode[j]) < sepChSq)) break;
+               }
+            if (j == nEx) {                    /* not close to any excluded */
+               *chSqBest = chSq;
+               *nBest = mid;
+               }
+            }
+         }
+      ax = t->axis[mid];
+      d = q[ax] - p[ax];
+      if (d < 0.0) {
+         kdtSearchSep(t, lo, mid, q, exNode, nEx, sepChSq, chSqBest, nBest);
+         if (d * d >= *chSqBest) return;
+         lo = mid + 1;
+         }
+      else {
+         kdtSearchSep(t, mid + 1, hi, q, exNode, nEx, sepChSq, chSqBest, nBest);
+         if (d * d >= *chSqBest) return;
+         hi = mid;
+         }
+      }
+   return;
+   }
+/* ========================================================================== */
+/* Collect live points in [lo, hi) closer than chSqRadius to q, until maxIds
+   of them have been found.
+ */
+static void kdtCollect(const kdTree *t, int lo, int hi,
+                       const double *q,                     /* query point */
+                       double chSqRadius,
+                       int *ids, int maxIds,       /* found ids (or NULL)... */
+                       int *nFound) {                /* ...and their count */
+   int mid, ax;
+   const double *p;
+   double d;
+/* -------------------------------------------------------------------------- */
+   while ((lo < hi) && (*nFound < maxIds)) {
+      mid = (lo + hi) >> 1;
+      if (t->live[mid] == 0) return;          /* nothing left in sub-tree */
+      p = t->xyz + 3 * mid;
+      if ((!t->gone[mid]) && (NEMO_ChordSq3(q, p) < chSqRadius)) {
+         if (ids) ids[*nFound] = t->ptId[mid];
+         (*nFound)++;
+         }
+      ax = t->axis[mid];
+      d = q[ax] - p[ax];
+      if (d < 0.0) {                       /* the query point's side... */
+         kdtCollect(t, lo, mid, q, chSqRadius, ids, maxIds, nFound);
+         if (d * d >= chSqRadius) return;  /* ...and the other, if in reach */
+         lo = mid + 1;
+         }
+      else {
+         kdtCollect(t, mid + 1, hi, q, chSqRadius, ids, maxIds, nFound);
+         if (d * d >= chSqRadius) return;
+         hi = mid;
+         }
+      }
+   return;
+   }
+/* ========================================================================== */
@@ -0,0 +1,44 @@
+/* ncsKdTree.h: k-d tree spatial index over near-conformal sphere (NCS)
+   point direction cosines. Since the square of the chord between two
+   points on the unit sphere is simply their square Euclidean distance in
+   3-space, the tree answers "nearest point" queries in exactly the same
+   metric (NEMO_ChordSq3) that the programs use for proximity everywhere.
+
+   The tree is built once, is never re-balanced, and points can be deleted
+   from it (for instance, as they are "visited" by an itinerary). Each tree
+   node keeps the count of live points in its sub-tree, so that the searches
+   skip over any sub-tree from which all points have been deleted.
+
+   Besides the single nearest point, queries return the nearest k points
+   that are (pairwise) separated by at least a given distance - for
+   instance, proximity vertices which are not all on the same stretch of
+   coastline - and the points within a given distance of the query point.
+   Queries do not modify the tree, and may run in several threads at once.
+
+   Include after nemo.h; the implementation (ncsKdTree.c) is included at
+   the end of the program source, just like other scullions.
+ */
+#ifndef NCS_KD_TREE_H
+#define NCS_KD_TREE_H
+
+#define KDT_MAX_SEP  16              /* most points kdtNearestSep() finds */
+
+typedef struct {
+   int nPts;                                 /* number of points in the tree */
+   int nLive;                       /* number of points not (yet) deleted */
+   double *xyz;       /* point direction cosines, in tree node order, 3 each */
+   int *ptId;                   /* caller's point index of each tree node */
+   int *nodeOf;                 /* tree node of each caller's point index */
+   int *live;             /* number of live points in sub-tree rooted here */
+   unsigned char *axis;                /* split axis (0, 1, 2) of the node */
+   unsigned char *gone;           /* 1: point in this node has been deleted */
+   } kdTree;
+
+int kdtBuild(kdTree *, const nemoPtNcs *, int);
+void kdtFree(kdTree *);
+int kdtNearest(const kdTree *, const double *, double, double *);
+int kdtNearestSep(const kdTree *, const double *, int, double, int *, double *);
+int kdtWithin(const kdTree *, const double *, double, int *, int);
+void kdtDelete(kdTree *, int);
+
+#endif
@@ -0,0 +1,197 @@
+/* nemoSearch.c: Monte Carlo search for the approximate Point Nemo (see
+   nemoSearch.h)
+ */
+
+struct mcChunk {             /* a chunk of Monte Carlo (random point) tests */
+   rngStream rng;                          /* this chunk's own number stream */
+   int nTrials;                    /* random points (inside region) to test */
+   int nIn, nOut;             /* random points generated inside/outside region */
+   double bestDist;                 /* furthest from coast, as chord squared... */
+   nemoPtNcs ptBest;                         /* ...the point itself and... */
+   int iVrtx;                           /* ...index of its nearest vertex */
+   };
+
+struct mcPool {                         /* chunks shared by all the threads */
+   const nemoSearch *ns;
+   int nChunks;
+   atomic_int nextChunk;                           /* next one to be taken */
+   atomic_uint_least64_t bestBits;       /* best distance so far, as bits */
+   struct mcChunk *chunks;
+   };
+
+static void testChunk(struct mcPool *, struct mcChunk *);
+static void *testWorker(void *);
+/* ========================================================================== */
+/* Set up the search, for the vertices in the tree, in the region of given
+   centre and radius (arc, on the unit sphere).
+ */
+void nemoSearchInit(nemoSearch *ns,                          /* to set up */
+                    const kdTree *tree,                /* coastline vertices */
+                    const nemoPtNcs *center,         /* search region centre */
+                    double srgnArc) {      /* search region radius, NCS arc */
+   double globalLocalCutoff;                   /* for random point generation */
+/* -------------------------------------------------------------------------- */
+   memset(ns, 0, sizeof(nemoSearch));
+   ns->tree = tree;
+   ns->srgnCntr = *center;
+   ns->srgnChSq = nemo_ArcToChordApprox(srgnArc);
+   ns->srgnChSq *= ns->srgnChSq;                          /* as chord squared */
+/* Global/local random point generation cutoff: first, as arc on planet... */
+   globalLocalCutoff = NEMO_SEARCH_CUTOFF / NEMO_EARTH_RADIUS;
+   globalLocalCutoff = nemo_ArcToChordApprox(globalLocalCutoff);   /* chord */
+   globalLocalCutoff = globalLocalCutoff * globalLocalCutoff;  /* chord sq. */
+   ns->isGlobalRand = (ns->srgnChSq > globalLocalCutoff);
+   rngCapInit(&ns->srgnCap, center, srgnArc);
+   return;
+   }
+/* ========================================================================== */
+/* Test testCount random points in the search region, using nThreads threads
+   (0 or 1: the calling thread only). Returns 0 on success, with the result
+   in ns, or NEMO_SEARCH_NOMEM, NEMO_SEARCH_THREAD or NEMO_SEARCH_NONE.
+ */
+int nemoSearchRun(nemoSearch *ns,
+                  int testCount,                  /* random points to test */
+                  uint64_t seed,                /* of all random number streams */
+                  int nThreads) {              /* max. worker threads, or 0 */
+   int i, n, nStarted;
+   rngStream rng;
+   struct mcPool pool;                   /* Monte Carlo, tests to be done */
+   struct mcChunk *chunk;
+   pthread_t threads[NEMO_SEARCH_MAX_THREADS];
+/* -------------------------------------------------------------------------- */
+   if (nThreads > NEMO_SEARCH_MAX_THREADS) nThreads = NEMO_SEARCH_MAX_THREADS;
+   if (nThreads == 1) nThreads = 0;          /* one worker is no worker */
+   pool.ns = ns;
+   pool.nChunks = (testCount + NEMO_SEARCH_CHUNK - 1) / NEMO_SEARCH_CHUNK;
+   pool.chunks = malloc((pool.nChunks ? pool.nChunks : 1) * sizeof(struct mcChunk));
+   if (pool.chunks == NULL) return(NEMO_SEARCH_NOMEM);
+   rngSeed(&rng, seed);
+   for (n = 0; n < pool.nChunks; n++) {   /* each chunk: its own sub-stream */
+      chunk = pool.chunks + n;
+      chunk->rng = rng;
+      rngJump(&rng);
+      chunk->nTrials = (n < pool.nChunks - 1) ? NEMO_SEARCH_CHUNK :
+                                          testCount - n * NEMO_SEARCH_CHUNK;
+      }
+   atomic_init(&pool.nextChunk, 0);
+   atomic_init(&pool.bestBits, 0);                          /* i.e. 0.0 */
+   nStarted = 0;
+   if (nThreads) {
+      for (; nStarted < nThreads; nStarted++) {
+         if (pthread_create(threads + nStarted, NULL, testWorker, &pool)) break;
+         }
+      for (i = 0; i < nStarted; i++) pthread_join(threads[i], NULL);
+      }
+   else testWorker(&pool);
+   if (nStarted < nThreads) {
+      free(pool.chunks);
+      return(NEMO_SEARCH_THREAD);
+      }
+
+/* Pick the best of the chunks; on equal distance, the first one (as would
+   the tests done one after another) */
+   ns->nIn = ns->nOut = 0;
+   ns->nemoChSq = -(NEMO_DOUBLE_HUGE);
+   ns->iVrtx = -1;
+   for (n = 0; n < pool.nChunks; n++) {
+      chunk = pool.chunks + n;
+      ns->nIn += chunk->nIn;
+      ns->nOut += chunk->nOut;
+      if (chunk->bestDist > ns->nemoChSq) {            /* better "Nemo" found */
+         ns->ptNemo = chunk->ptBest;
+         ns->nemoChSq = chunk->bestDist;
+         ns->iVrtx = chunk->iVrtx;
+         }
+      }
+   free(pool.chunks);
+   return((ns->iVrtx < 0) ? NEMO_SEARCH_NONE : 0);
+   }
+/* ========================================================================== */
+/* Worker thread (or the main one, if single-threaded): take chunks of tests
+   until there are none left.
+ */
+static void *testWorker(void *arg) {
+   struct mcPool *pool = arg;
+   int nc;
+/* -------------------------------------------------------------------------- */
+   while ((nc = atomic_fetch_add(&pool->nextChunk, 1)) < pool->nChunks) {
+      if (pool->ns->isVerbose) fprintf(stderr, "tests remaining: %d K      \r",
+                              (pool->nChunks - nc) * (NEMO_SEARCH_CHUNK / 1000));
+      testChunk(pool, pool->chunks + nc);
+      }
+   return(NULL);
+   }
+/* ========================================================================== */
+/* Test one chunk of random points. The best distance found by any thread so
+   far is shared (pool->bestBits) so that the search for the nearest coast
+   vertex can be skipped, as soon as it is clear the random point can't be
+   the next point Nemo. This never affects the overall result - only the points
+   which can't be the best one are abandoned.
+ */
+static void testChunk(struct mcPool *pool, struct mcChunk *chunk) {
+   const nemoSearch *ns = pool->ns;
+   int ii;
+   int moreTests;
+   uint64_t bits, newBits;
+   double chSq;
+   double nemoDist;       /* best distance: this chunk's or the shared one */
+   double randDist;          /* random point to nearest coast vertex, minimum */
+   nemoPtNcs ptRand;        /* random location, is it approximate Point Nemo? */
+   int iTile, nTile;                     /* next point of the tile, of... */
+   double tileX[RNG_TILE], tileY[RNG_TILE], tileZ[RNG_TILE];
+   ncsSoa tile;                        /* ...random points, generated and */
+   double tileChSq[RNG_TILE];       /* ...their distances to region centre */
+/* -------------------------------------------------------------------------- */
+   tile.nPts = RNG_TILE;
+   tile.x = tileX;
+   tile.y = tileY;
+   tile.z = tileZ;
+   iTile = nTile = 0;
+   chunk->nIn = chunk->nOut = 0;
+   chunk->bestDist = -(NEMO_DOUBLE_HUGE);
+   chunk->iVrtx = -1;
+   moreTests = chunk->nTrials;
+   while (moreTests) {              /* more random points remain to be tested */
+/*    If the search region is large, random points are generated as "global"
+      and rejected if outside of it. Otherwise, random points will be
+      generated as "local". (but the test will still be done). They are
+      generated a tile at a time, with their distances to search region
+      centre (the same points as one by one; the rest of the last tile of
+      the chunk is not used). */
+      if (iTile == nTile) {
+         if (ns->isGlobalRand) rngSphereSoa(&chunk->rng, &tile, 0, RNG_TILE);
+         else rngCapSoa(&chunk->rng, &ns->srgnCap, &tile, 0, RNG_TILE);
+         chSqFillSoa(ns->srgnCntr.dc, &tile, 0, RNG_TILE, tileChSq);
+         iTile = 0;
+         nTile = RNG_TILE;
+         }
+      NCS_SOA_GET(&tile, iTile, &ptRand);
+      chSq = tileChSq[iTile++];
+/*    Reject generated random point if it is out of the search region */
+      if (chSq > ns->srgnChSq) {
+         chunk->nOut++;
+         continue;                         /* ptRand is outside search region */
+         }
+      chunk->nIn++;
+      moreTests--;                                   /* next Monte Carlo test */
+      bits = atomic_load_explicit(&pool->bestBits, memory_order_relaxed);
+      memcpy(&nemoDist, &bits, sizeof(double));
+      if (chunk->bestDist > nemoDist) nemoDist = chunk->bestDist;
+/*    The nearest coast vertex to this random point (distance and its index,
+      ii) is found using the spatial index. If there is any vertex closer
+      than the "best Nemo" found so far, there's no need to look further. */
+      if (kdtWithin(ns->tree, ptRand.dc, nemoDist, NULL, 1)) continue;
+      ii = kdtNearest(ns->tree, ptRand.dc, NEMO_DOUBLE_HUGE, &randDist);
+      if ((ii < 0) || (randDist <= chunk->bestDist)) continue;
+      chunk->ptBest = ptRand;                          /* better "Nemo" found */
+      chunk->bestDist = randDist;
+      chunk->iVrtx = ii;
+      memcpy(&newBits, &randDist, sizeof(double));    /* publish it, unless */
+      bits = atomic_load_explicit(&pool->bestBits, memory_order_relaxed);
+      while (newBits > bits) {                  /* ...another one is better */
+         if (atomic_compare_exchange_weak(&pool->bestBits, &bits, newBits)) break;
+         }
+      }
+   return;
+   }
+/* ========================================================================== */
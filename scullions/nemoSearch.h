@@ -0,0 +1,50 @@
+/* nemoSearch.h: Monte Carlo search for the approximate Point Nemo - of many
+   random points in a search region (a spherical cap on the NCS), the one
+   farthest from its nearest coastline vertex. The vertices are indexed by a
+   k-d tree (ncsKdTree), which answers both "is there any vertex closer than
+   the best distance so far" (mostly, there is - and the point is abandoned)
+   and "which vertex is the nearest one".
+
+   Random points are tested in chunks of NEMO_SEARCH_CHUNK, each with its own
+   random number stream (rngStream) derived from the seed. The chunks can be
+   processed by several threads; the result depends only on the seed, not on
+   the number of threads. The random points are generated, and their chords
+   to the region centre computed, a tile (RNG_TILE) at a time (rngSphereSoa(),
+   chSqFillSoa()).
+
+   Include after nemo.h, chordSqBatch.h, rngStream.h and ncsKdTree.h; the implementation
+   (nemoSearch.c) is included at the end of the program source, just like
+   other scullions.
+ */
+#ifndef NEMO_SEARCH_H
+#define NEMO_SEARCH_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define NEMO_SEARCH_CHUNK       10000   /* random tests per RNG stream */
+#define NEMO_SEARCH_MAX_THREADS   256
+#define NEMO_SEARCH_CUTOFF    1500000    /* meters, global/local random points */
+
+#define NEMO_SEARCH_NOMEM   -1                      /* no memory for chunks */
+#define NEMO_SEARCH_THREAD  -2                /* can't create worker threads */
+#define NEMO_SEARCH_NONE    -3           /* no point in the region was found */
+
+typedef struct {
+   const kdTree *tree;               /* coastline vertices, as spatial index */
+   nemoPtNcs srgnCntr;                        /* search region centre, NCS... */
+   double srgnChSq;                    /* ...and radius, NCS chord squared */
+   int isGlobalRand;     /* random points on whole sphere, or on a cap */
+   rngCap srgnCap;                          /* search region, for local ones */
+   int isVerbose;                   /* 1: progress report, on stderr */
+/* results of nemoSearchRun(): */
+   nemoPtNcs ptNemo;                     /* approximate Point Nemo, and... */
+   double nemoChSq;         /* ...chord squared to its nearest vertex, and */
+   int iVrtx;                                            /* ...its index */
+   int nIn, nOut;         /* random points generated inside/outside region */
+   } nemoSearch;
+
+void nemoSearchInit(nemoSearch *, const kdTree *, const nemoPtNcs *, double);
+int nemoSearchRun(nemoSearch *, int, uint64_t, int);
+
+#endif
@@ -0,0 +1,273 @@
+/* nemoStats.c: program instrumentation (see nemoStats.h) */
+
+struct statsPhase {
+   char name[STATS_NAME];
+   double seconds;                                   /* accumulated time */
+   int count;                                  /* number of times entered */
+   };
+
+struct statsCounter {
+   char name[STATS_NAME];
+   atomic_long value;
+   };
+
+static struct {
+   int mode;                                /* STATS_OFF, _TEXT or _JSON */
+   const char *fnJson;                       /* JSON output file, or NULL */
+   const char *progName;
+   double wallStart;                               /* of the whole run */
+   int nPhases, iPhase;                /* phases, and the current one (-1) */
+   double phaseStart;
+   struct statsPhase phases[STATS_MAX_PHASES];
+   atomic_int nCounters;
+   struct statsCounter counters[STATS_MAX_COUNTERS];
+   pthread_mutex_t mtx;               /* counter registration, worst leg */
+   atomic_long szpilaBins[STATS_SZPILA_BINS];
+   atomic_long szpilaFails;                /* NEMO_DOUBLE_UNDEF returned */
+   atomic_int szpilaMax;                         /* most iterations, and */
+   nemoPtEnr worstA, worstB;                          /* ...of which leg */
+   atomic_long fanBins[STATS_SZPILA_BINS];     /* geoFan (Vincenty) ones */
+   } stats = {.mode = STATS_OFF, .progName = "", .iPhase = -1,
+              .mtx = PTHREAD_MUTEX_INITIALIZER};
+
+static int statsOption(const char *);
+/* ========================================================================== */
+/* Start of the run (call it first, whether or not there will be -stats):
+   takes the -stats=value arguments, if any, out of argv - so that the rest
+   of the command line is parsed as ever. Returns 0, or -1 if the value is
+   not "text", "json" nor a file name ending in ".json".
+ */
+int statsInit(const char *progName, int *argc, const char *argv[]) {
+   int i, n, iErr;
+/* -------------------------------------------------------------------------- */
+   stats.progName = progName;
+   stats.wallStart = statsWall();
+   iErr = 0;
+   for (n = i = 1; i < *argc; i++) {
+      if (strncmp(argv[i], "-stats=", 7) == 0) {
+         if (statsOption(argv[i] + 7)) iErr = -1;
+         }
+      else argv[n++] = argv[i];
+      }
+   if (n < *argc) argv[n] = NULL;
+   *argc = n;
+   return(iErr);
+   }
+/* ========================================================================== */
+/* End the current phase, and start the named one (unless name is NULL) */
+void statsPhase(const char *name) {
+   int i;
+   double t;
+/* -------------------------------------------------------------------------- */
+   t = statsWall();
+   if (stats.iPhase >= 0) stats.phases[stats.iPhase].seconds += t - stats.phaseStart;
+   stats.iPhase = -1;
+   if (name == NULL) return;
+   for (i = 0; i < stats.nPhases; i++) {
+      if (strcmp(stats.phases[i].name, name) == 0) break;
+      }
+   if (i == stats.nPhases) {
+      if (i == STATS_MAX_PHASES) return;                /* too many: ignore */
+      strncpy(stats.phases[i].name, name, STATS_NAME - 1);
+      stats.nPhases++;
+      }
+   stats.phases[i].count++;
+   stats.iPhase = i;
+   stats.phaseStart = t;
+   return;
+   }
+/* ========================================================================== */
+/* Time accumulated in the named phase so far, seconds (0.0 if there is no
+   such phase); the current phase counts up to its last statsPhase() call.
+ */
+double statsPhaseSeconds(const char *name) {
+   int i;
+/* -------------------------------------------------------------------------- */
+   for (i = 0; i < stats.nPhases; i++) {
+      if (strcmp(stats.phases[i].name, name) == 0) return(stats.phases[i].seconds);
+      }
+   return(0.0);
+   }
+/* ========================================================================== */
+/* Add n to the named counter (created, as 0, the first time it is used) */
+void statsAdd(const char *name, long n) {
+   int i, nc;
+/* -------------------------------------------------------------------------- */
+   nc = atomic_load(&stats.nCounters);
+   for (i = 0; i < nc; i++) {
+      if (strcmp(stats.counters[i].name, name) == 0) break;
+      }
+   if (i == nc) {                     /* not (yet) there, look again, locked */
+      pthread_mutex_lock(&stats.mtx);
+      nc = atomic_load(&stats.nCounters);
+      for (i = 0; i < nc; i++) {
+         if (strcmp(stats.counters[i].name, name) == 0) break;
+         }
+      if ((i == nc) && (nc < STATS_MAX_COUNTERS)) {
+         strncpy(stats.counters[i].name, name, STATS_NAME - 1);
+         atomic_init(&stats.counters[i].value, 0);
+         atomic_store(&stats.nCounters, nc + 1);        /* now it's visible */
+         }
+      pthread_mutex_unlock(&stats.mtx);
+      if (i == STATS_MAX_COUNTERS) return;              /* too many: ignore */
+      }
+   atomic_fetch_add_explicit(&stats.counters[i].value, n, memory_order_relaxed);
+   return;
+   }
+/* ========================================================================== */
+/* WGS84 geodesic length between the two points, its iterations counted */
+double statsSzpila(const nemoPtEnr *a, const nemoPtEnr *b) {
+   int nIter, b0;
+   double g;
+/* -------------------------------------------------------------------------- */
+   if (stats.mode == STATS_OFF) return(nemo_GeodesicSzpila(nemo_ElrWgs84(), a, b, NULL));
+   nIter = 0;
+   g = nemo_GeodesicSzpila(nemo_ElrWgs84(), a, b, &nIter);
+   if (g == NEMO_DOUBLE_UNDEF)
+      atomic_fetch_add_explicit(&stats.szpilaFails, 1, memory_order_relaxed);
+   b0 = (nIter < STATS_SZPILA_BINS - 1) ? nIter : STATS_SZPILA_BINS - 1;
+   if (b0 < 0) b0 = 0;
+   atomic_fetch_add_explicit(stats.szpilaBins + b0, 1, memory_order_relaxed);
+   if (nIter > atomic_load_explicit(&stats.szpilaMax, memory_order_relaxed)) {
+      pthread_mutex_lock(&stats.mtx);
+      if (nIter > atomic_load(&stats.szpilaMax)) {
+         atomic_store(&stats.szpilaMax, nIter);
+         stats.worstA = *a;
+         stats.worstB = *b;
+         }
+      pthread_mutex_unlock(&stats.mtx);
+      }
+   return(g);
+   }
+/* ========================================================================== */
+/* Add the iteration counts of n geodesics solved by geoFan (Vincenty) to
+   a histogram of their own; a block at a time, not locked. A negative count
+   is skipped: that geodesic was left to statsSzpila() (near-antipodal).
+ */
+void statsFanIters(const int *nIter, int n) {
+   int i, b0;
+   long bins[STATS_SZPILA_BINS] = {0};
+/* -------------------------------------------------------------------------- */
+   if ((stats.mode == STATS_OFF) || (n <= 0)) return;
+   for (i = 0; i < n; i++) {
+      if (nIter[i] < 0) continue;            /* (counted by statsSzpila()) */
+      b0 = (nIter[i] < STATS_SZPILA_BINS - 1) ? nIter[i] : STATS_SZPILA_BINS - 1;
+      bins[b0]++;
+      }
+   for (i = 0; i < STATS_SZPILA_BINS; i++) {
+      if (bins[i]) atomic_fetch_add_explicit(stats.fanBins + i, bins[i],
+                                             memory_order_relaxed);
+      }
+   return;
+   }
+/* ========================================================================== */
+/* Write the statistics, as requested by the -stats option (if any) */
+void statsReport(void) {
+   int i, nc, last, lastFan;
+   long n, nCalls, nFan;
+   FILE *fp;
+   nemoPtEll llA, llB;
+/* -------------------------------------------------------------------------- */
+   if (stats.mode == STATS_OFF) return;
+   statsPhase(NULL);
+   nc = atomic_load(&stats.nCounters);
+   for (nCalls = 0, last = i = 0; i < STATS_SZPILA_BINS; i++) {
+      n = atomic_load(stats.szpilaBins + i);
+      nCalls += n;
+      if (n) last = i;
+      }
+   for (nFan = 0, lastFan = i = 0; i < STATS_SZPILA_BINS; i++) {
+      n = atomic_load(stats.fanBins + i);
+      nFan += n;
+      if (n) lastFan = i;
+      }
+   nemo_Dcos3ToLatLong(stats.worstA.dc, llA.a);
+   nemo_Dcos3ToLatLong(stats.worstB.dc, llB.a);
+
+   if (stats.mode == STATS_TEXT) {
+      fprintf(stderr, "Statistics, %s: %.3f seconds (wall clock)\n",
+                      stats.progName, statsWall() - stats.wallStart);
+      for (i = 0; i < stats.nPhases; i++)
+         fprintf(stderr, "   phase %-24s %10.3f seconds (%d)\n", stats.phases[i].name,
+                         stats.phases[i].seconds, stats.phases[i].count);
+      for (i = 0; i < nc; i++)
+         fprintf(stderr, "   count %-24s %10ld\n", stats.counters[i].name,
+                         atomic_load(&stats.counters[i].value));
+      if (nCalls) {
+         fprintf(stderr, "   geodesics: %ld, failed: %ld, iterations histogram:\n",
+                         nCalls, atomic_load(&stats.szpilaFails));
+         for (i = 0; i <= last; i++)
+            fprintf(stderr, "      %2d%s %10ld\n", i, (i == STATS_SZPILA_BINS - 1) ?
+                            "+" : " ", atomic_load(stats.szpilaBins + i));
+         if (atomic_load(&stats.szpilaMax) > 0)        /* (by statsSzpila()) */
+            fprintf(stderr, "   most iterations: %d, %.7f,%.7f to %.7f,%.7f\n",
+                    atomic_load(&stats.szpilaMax),
+                    NEMO_RAD2DEG * llA.a[NEMO_LAT], NEMO_RAD2DEG * llA.a[NEMO_LNG],
+                    NEMO_RAD2DEG * llB.a[NEMO_LAT], NEMO_RAD2DEG * llB.a[NEMO_LNG]);
+         }
+      if (nFan) {
+         fprintf(stderr, "   geoFan (Vincenty) geodesics: %ld, iterations:\n", nFan);
+         for (i = 0; i <= lastFan; i++)
+            fprintf(stderr, "      %2d%s %10ld\n", i, (i == STATS_SZPILA_BINS - 1) ?
+                            "+" : " ", atomic_load(stats.fanBins + i));
+         }
+      return;
+      }
+
+   fp = stats.fnJson ? fopen(stats.fnJson, "a") : stderr;
+   if (fp == NULL) {
+      fprintf(stderr, "%s: can't open [%s] for statistics\n", stats.progName,
+                      stats.fnJson);
+      return;
+      }
+   fprintf(fp, "{\"program\":\"%s\",\"nemoLibrary\":%.3f,\"wallSeconds\":%.6f,"
+               "\"phases\":[", stats.progName, NEMO_LIBRARY_DATE,
+               statsWall() - stats.wallStart);
+   for (i = 0; i < stats.nPhases; i++)
+      fprintf(fp, "%s{\"name\":\"%s\",\"seconds\":%.6f,\"count\":%d}", i ? "," : "",
+              stats.phases[i].name, stats.phases[i].seconds, stats.phases[i].count);
+   fprintf(fp, "],\"counters\":{");
+   for (i = 0; i < nc; i++)
+      fprintf(fp, "%s\"%s\":%ld", i ? "," : "", stats.counters[i].name,
+              atomic_load(&stats.counters[i].value));
+   fprintf(fp, "},\"szpila\":{\"calls\":%ld,\"failed\":%ld,\"maxIterations\":%d",
+           nCalls, atomic_load(&stats.szpilaFails), atomic_load(&stats.szpilaMax));
+   if (atomic_load(&stats.szpilaMax) > 0) fprintf(fp, ",\"worstLeg\":[%.7f,%.7f,%.7f,%.7f]",
+                 NEMO_RAD2DEG * llA.a[NEMO_LAT], NEMO_RAD2DEG * llA.a[NEMO_LNG],
+                 NEMO_RAD2DEG * llB.a[NEMO_LAT], NEMO_RAD2DEG * llB.a[NEMO_LNG]);
+   fprintf(fp, ",\"iterations\":[");
+   for (i = 0; i <= last; i++)
+      fprintf(fp, "%s%ld", i ? "," : "", atomic_load(stats.szpilaBins + i));
+   fprintf(fp, "]},\"geoFan\":{\"calls\":%ld,\"iterations\":[", nFan);
+   for (i = 0; i <= lastFan; i++)
+      fprintf(fp, "%s%ld", i ? "," : "", atomic_load(stats.fanBins + i));
+   fprintf(fp, "]}}\n");
+   if (fp != stderr) fclose(fp);
+   return;
+   }
+/* ========================================================================== */
+/* The value of the -stats option: "text", "json" or a file name ending in
+   ".json". Returns 0, or -1 if the value is none of these.
+ */
+static int statsOption(const char *optVal) {
+   size_t len;
+/* -------------------------------------------------------------------------- */
+   len = optVal ? strlen(optVal) : 0;
+   if (len == 0) return(-1);
+   if (strcmp(optVal, "text") == 0) stats.mode = STATS_TEXT;
+   else if (strcmp(optVal, "json") == 0) stats.mode = STATS_JSON;
+   else if ((len > 5) && (strcmp(optVal + len - 5, ".json") == 0)) {
+      stats.mode = STATS_JSON;
+      stats.fnJson = optVal;
+      }
+   else return(-1);
+   return(0);
+   }
+/* ========================================================================== */
+/* Monotonic wall clock, seconds: with threads, clock() reports CPU time */
+double statsWall(void) {
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return((double)ts.tv_sec + 1.0e-9 * (double)ts.tv_nsec);
+   }
+/* ========================================================================== */
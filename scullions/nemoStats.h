@@ -0,0 +1,59 @@
+/* nemoStats.h: program instrumentation - wall clock phase timers, named
+   counters and the histograms of geodesic iteration counts -
+   reported at the end of the run, if the program was given -stats option:
+
+      -stats=text        as text lines, on stderr
+      -stats=json        as a single line JSON object, on stderr
+      -stats=file.json   as above, appended to the file (value ends in .json)
+
+   statsInit() takes the option out of the command line, before the program
+   parses the rest of it (and so the option is the same in all programs).
+
+   Phases are timed by the monotonic (wall) clock: statsPhase(name) ends the
+   current phase, if any, and starts the named one (a phase entered more than
+   once accumulates its time); statsPhase(NULL) just ends the current one.
+   Phases are meant to be switched by the main thread only. They are timed
+   with or without the -stats option, so statsPhaseSeconds() can serve a
+   program's own report too; statsWall() is the clock itself, in seconds,
+   for any other timing the programs do.
+
+   Counters are looked up by name, and may be added to by any thread; they
+   are meant for totals of a block or a run, not for each item of a hot loop
+   (accumulate those in a local variable first). statsSzpila() computes the
+   WGS84 geodesic and counts its iterations, with no locking unless the leg
+   is the worst one so far (then its end points are recorded: for instance a
+   near-antipodal leg). With no -stats option, it is just the geodesic.
+   statsFanIters() adds the iteration counts of geodesics solved otherwise,
+   by scullions/geoFan (Vincenty), a block at a time, to a histogram of their
+   own: the two are reported apart, as "szpila" and "geoFan".
+
+   Include after nemo.h, before the other scullions that use it (itinLegs,
+   nemoTrilat); the implementation (nemoStats.c) is included at the end of
+   the program source, just like other scullions, and before those.
+ */
+#ifndef NEMO_STATS_H
+#define NEMO_STATS_H
+
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define STATS_OFF           0                               /* output modes */
+#define STATS_TEXT          1
+#define STATS_JSON          2
+
+#define STATS_MAX_PHASES   16
+#define STATS_MAX_COUNTERS 32
+#define STATS_NAME         32                  /* longest name, with the 0 */
+#define STATS_SZPILA_BINS  32     /* iterations 0...30; last bin: 31 or more */
+
+int statsInit(const char *, int *, const char *[]);
+void statsPhase(const char *);
+double statsPhaseSeconds(const char *);
+double statsWall(void);
+void statsAdd(const char *, long);
+double statsSzpila(const nemoPtEnr *, const nemoPtEnr *);
+void statsFanIters(const int *, int);
+void statsReport(void);
+
+#endif
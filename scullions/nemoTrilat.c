@@ -0,0 +1,177 @@
+/* nemoTrilat.c: iterative geodesic trilateration (see nemoTrilat.h) */
+
+static void trilatDists(nemoTri *, const nemoPtEnr *, double *);
+static void trilatNudge(nemoTri *);
+static int trilatNewton(nemoTri *);
+/* ========================================================================== */
+/* Set proximity vertex ipv (0, 1 or 2) of the problem */
+void trilatVertex(nemoTri *tri, int ipv, const nemoPtEnr *vtx) {
+   tri->proxVtxEl[ipv] = *vtx;
+   nemo_EnrToNcs(nemo_ElrWgs84(), tri->proxVtxEl + ipv, tri->proxVtxNs + ipv);
+   return;
+   }
+/* ========================================================================== */
+/* Solve the problem, by the given method (TRILAT_NUDGE or TRILAT_NEWTON).
+   Returns 0 on success, TRILAT_GEOMETRY or TRILAT_NO_CONVERGENCE (and
+   tri->isSolved is then 0). The vertices may be re-ordered.
+ */
+int trilatSolve(nemoTri *tri, int method) {
+   int ipv, iDir;
+   double d;
+   nemoPtNcs ncsAux;                 /* auxiliary spherical point coordinates */
+   nemoPtEnr elrAux;                                /* as above, on ellipsoid */
+/* -------------------------------------------------------------------------- */
+   tri->isSolved = tri->nIter = 0;
+/* Prepare the iteration process. First, initialize Point Nemo as the
+   circumcentre of proximity vertices on the Nemo Sphere.
+ */
+   iDir = nemo_SphereCircumcenter(tri->proxVtxNs + 0, tri->proxVtxNs + 1,
+                                  tri->proxVtxNs + 2, &ncsAux);
+   if (iDir == -1) {              /* must reverse the order of given vertices */
+      ncsAux = tri->proxVtxNs[0];
+      tri->proxVtxNs[0] = tri->proxVtxNs[2];
+      tri->proxVtxNs[2] = ncsAux;
+      elrAux = tri->proxVtxEl[0];
+      tri->proxVtxEl[0] = tri->proxVtxEl[2];
+      tri->proxVtxEl[2] = elrAux;
+      iDir = nemo_SphereCircumcenter(tri->proxVtxNs + 0, tri->proxVtxNs + 1,
+                                     tri->proxVtxNs + 2, &ncsAux);
+      }
+   if (iDir != 1) return(TRILAT_GEOMETRY);
+
+/* transfer the preliminary location back to the ellipsoid: */
+   nemo_NcsToEnr(nemo_ElrWgs84(), &ncsAux, &tri->pointNemo);
+   trilatDists(tri, &tri->pointNemo, tri->glDist);    /* preliminary geodesics */
+
+   tri->diff = NEMO_DOUBLE_HUGE;          /* initialize convergence criterion */
+   while (tri->diff > TRILAT_MAX_DIFF) {                   /* start iteration */
+      if (tri->nIter++ > TRILAT_MAX_STEPS) return(TRILAT_NO_CONVERGENCE);
+      if ((method != TRILAT_NEWTON) || trilatNewton(tri)) trilatNudge(tri);
+      tri->diff = 0.0;
+      for (ipv = 0; ipv < 3; ipv++) {
+         d = fabs(tri->glDist[ipv] - tri->glMean);
+         if (d > tri->diff) tri->diff = d;
+         }
+/*    fprintf(stderr, "Iter: %2d, max diff: %.3f (%.3f %.3f %.3f)\n", tri->nIter,
+       tri->diff, tri->glDist[0] - tri->glMean, tri->glDist[1] - tri->glMean,
+       tri->glDist[2] - tri->glMean); */
+      }
+   tri->isSolved = 1;
+   return(0);
+   }
+/* ========================================================================== */
+/* Find the three geodesic distances from the point to the vertices; if it is
+   the problem's current solution, also their mean value.
+ */
+static void trilatDists(nemoTri *tri, const nemoPtEnr *ptNemo, double *dist) {
+   int ipv;
+   for (ipv = 0; ipv < 3; ipv++) {
+      dist[ipv] = statsSzpila(ptNemo, tri->proxVtxEl + ipv);
+      }
+   if (dist == tri->glDist) tri->glMean = (dist[0] + dist[1] + dist[2]) / 3.0;
+   return;
+   }
+/* ========================================================================== */
+/* "Nudge" the last best position of Point Nemo toward or away from that
+   distant proximity vertex, from which the difference between the geodesic
+   to it and the mean of all three geodesics is the greatest.
+
+   The process is carried out on Nemo Sphere, where vector algebra productions
+   are much simpler than they would be on an ellipsoid of rotation. Once
+   the process is completed, the position is returned to the ellipsoid: the
+   natural data domain of the Point Nemo and its three proximity vertices.
+ */
+static void trilatNudge(nemoTri *tri) {                  /* given and updated */
+
+   int ipv;                             /* outer, proximity vertex loop index */
+   int idc;                             /* inner, direction cosine loop index */
+   int imx;              /* proximity vertex with maximum distance difference */
+   double d, diff;
+   nemoPtNcs ncsAux;                 /* auxiliary spherical point coordinates */
+   double localScale;
+   double nudge;              /* amount of nudge, in meters on planet surface */
+   double dirToPrxVx[3];                     /* direction to proximity vertex */
+/* -------------------------------------------------------------------------- */
+   nemo_EnrToNcs(nemo_ElrWgs84(), &tri->pointNemo, &ncsAux); /* Nemo on sphere */
+   localScale = nemo_NcsElrScale(nemo_ElrWgs84(), &ncsAux);
+   diff = 0;     /* first, find the vertex with greatest difference from mean */
+   nudge = 0.0;
+   imx = 0;
+   for (ipv = 0; ipv < 3; ipv++) {    /* do for each distant proximity vertex */
+      d = tri->glDist[ipv] - tri->glMean;
+      if (fabs(d) > fabs(diff)) {
+         diff = d;
+         nudge = d;                                /* record nudge difference */
+         imx = ipv;         /* record index of vertex with maximum difference */
+         }
+      }
+/* Find vector from Point Nemo towards the vertex it will be nudged to or from */
+   for (idc = 0; idc < 3; idc++)
+      dirToPrxVx[idc] = tri->proxVtxNs[imx].dc[idc] - ncsAux.dc[idc];
+   nemo_NormalizeV3(dirToPrxVx);
+
+/* Nudge Nemo along that vector, by ~nudge~, scaled down to unit sphere */
+   for (idc = 0; idc < 3; idc++) {
+      ncsAux.dc[idc] = ncsAux.dc[idc] + (dirToPrxVx[idc] * nudge / localScale);
+      }
+   nemo_NormalizeV3(ncsAux.dc);
+
+   nemo_NcsToEnr(nemo_ElrWgs84(), &ncsAux, &tri->pointNemo); /* to ellipsoid.. */
+   trilatDists(tri, &tri->pointNemo, tri->glDist);    /* ..update geodesics */
+   return;
+   }
+/* ========================================================================== */
+/* Newton step: on Nemo Sphere, in the plane tangent at the last best position
+   (axes e1, e2), find the displacement that makes the differences of geodesics
+   r = (g0 - g1, g0 - g2) zero, were they linear in it. Their derivatives (the
+   Jacobian) are found from two displaced positions, TRILAT_NEWTON_STEP meters
+   along e1 and e2. Returns 0, or 1 if the Jacobian is singular (position is
+   then not changed).
+ */
+static int trilatNewton(nemoTri *tri) {                  /* given and updated */
+   int i, idc;
+   double localScale, h, d, det, s1, s2;
+   double e1[3], e2[3];                         /* tangent plane axes, unit */
+   double r[2], jac[2][2];                  /* residuals and their Jacobian */
+   double dist[3];
+   nemoPtNcs ncsNemo, ncsAux;
+   nemoPtEnr enrAux;
+/* -------------------------------------------------------------------------- */
+   nemo_EnrToNcs(nemo_ElrWgs84(), &tri->pointNemo, &ncsNemo);
+   localScale = nemo_NcsElrScale(nemo_ElrWgs84(), &ncsNemo);
+   h = TRILAT_NEWTON_STEP / localScale;               /* on the unit sphere */
+
+/* tangent plane axes: e1 toward the first vertex, e2 = p x e1 */
+   for (idc = 0; idc < 3; idc++) e1[idc] = tri->proxVtxNs[0].dc[idc] - ncsNemo.dc[idc];
+   d = e1[0] * ncsNemo.dc[0] + e1[1] * ncsNemo.dc[1] + e1[2] * ncsNemo.dc[2];
+   for (idc = 0; idc < 3; idc++) e1[idc] -= d * ncsNemo.dc[idc];
+   nemo_NormalizeV3(e1);
+   e2[0] = ncsNemo.dc[1] * e1[2] - ncsNemo.dc[2] * e1[1];
+   e2[1] = ncsNemo.dc[2] * e1[0] - ncsNemo.dc[0] * e1[2];
+   e2[2] = ncsNemo.dc[0] * e1[1] - ncsNemo.dc[1] * e1[0];
+
+   r[0] = tri->glDist[0] - tri->glDist[1];
+   r[1] = tri->glDist[0] - tri->glDist[2];
+   for (i = 0; i < 2; i++) {                /* derivatives along e1 and e2 */
+      for (idc = 0; idc < 3; idc++)
+         ncsAux.dc[idc] = ncsNemo.dc[idc] + h * (i ? e2[idc] : e1[idc]);
+      nemo_NormalizeV3(ncsAux.dc);
+      nemo_NcsToEnr(nemo_ElrWgs84(), &ncsAux, &enrAux);
+      trilatDists(tri, &enrAux, dist);
+      jac[0][i] = ((dist[0] - dist[1]) - r[0]) / h;
+      jac[1][i] = ((dist[0] - dist[2]) - r[1]) / h;
+      }
+   det = jac[0][0] * jac[1][1] - jac[0][1] * jac[1][0];
+   if (fabs(det) <= 1.0e-12 * (fabs(jac[0][0] * jac[1][1]) +
+                               fabs(jac[0][1] * jac[1][0]))) return(1);
+   s1 = (-r[0] * jac[1][1] + r[1] * jac[0][1]) / det;            /* J s = -r */
+   s2 = (-r[1] * jac[0][0] + r[0] * jac[1][0]) / det;
+
+   for (idc = 0; idc < 3; idc++)
+      ncsAux.dc[idc] = ncsNemo.dc[idc] + s1 * e1[idc] + s2 * e2[idc];
+   nemo_NormalizeV3(ncsAux.dc);
+   nemo_NcsToEnr(nemo_ElrWgs84(), &ncsAux, &tri->pointNemo); /* to ellipsoid.. */
+   trilatDists(tri, &tri->pointNemo, tri->glDist);    /* ..update geodesics */
+   return(0);
+   }
+/* ========================================================================== */
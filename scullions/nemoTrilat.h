@@ -0,0 +1,50 @@
+/* nemoTrilat.h: iterative geodesic trilateration - the point on the
+   ellipsoid at equal geodesic distance from three given points (proximity
+   vertices), as used to find the exact Point Nemo. The iteration starts at
+   the circumcentre of the vertices on the Nemo Sphere (NCS), and is one of:
+
+   TRILAT_NUDGE: move the point toward or away from the vertex whose geodesic
+      differs most from the mean of all three (see trilatNudge() preamble);
+      converges slowly, but each step is a few easy to understand spherical
+      trigonometry and vector algebra productions.
+   TRILAT_NEWTON: a Newton step in the plane tangent to the Nemo Sphere,
+      driving the two differences of geodesics to zero, with the derivatives
+      found numerically; converges in a few steps, of nine geodesics each.
+
+   The iteration ends when none of the three geodesics differs from their
+   mean by more than TRILAT_MAX_DIFF. All the state of a problem is in its
+   nemoTri structure: any number of problems can be solved in several
+   threads at once.
+
+   Include after nemo.h and nemoStats.h (geodesics are evaluated by
+   statsSzpila()); the implementation (nemoTrilat.c) is included at the end
+   of the program source, just like other scullions.
+ */
+#ifndef NEMO_TRILAT_H
+#define NEMO_TRILAT_H
+
+#define TRILAT_NUDGE            0                         /* solver methods */
+#define TRILAT_NEWTON           1
+
+#define TRILAT_GEOMETRY        -1      /* ill-defined geometry of vertices */
+#define TRILAT_NO_CONVERGENCE  -2     /* not in TRILAT_MAX_STEPS iterations */
+
+#define TRILAT_MAX_STEPS     1024
+#define TRILAT_MAX_DIFF    0.0005          /* meters: half a millimeter */
+#define TRILAT_NEWTON_STEP   10.0    /* meters, numerical derivative step */
+
+typedef struct {                   /* one trilateration problem, and solution */
+   nemoPtEnr proxVtxEl[3];      /* proximity vertices ellipsoid normals i,j,k */
+   nemoPtNcs proxVtxNs[3];                      /* as above, on "Nemo Sphere" */
+   double glDist[3];            /* iteration-steep variant geodesic distances */
+   double glMean;                              /* as above, mean of all three */
+   nemoPtEnr pointNemo;                         /* solution, ellipsoid normal */
+   int nIter;                                /* number of iterations taken */
+   double diff;            /* greatest distance difference from their mean */
+   int isSolved;                                                  /* 1: ok */
+   } nemoTri;
+
+void trilatVertex(nemoTri *, int, const nemoPtEnr *);
+int trilatSolve(nemoTri *, int);
+
+#endif
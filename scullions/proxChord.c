@@ -0,0 +1,32 @@
+/* proxChord.c: chord squared proximity pre-test (see proxChord.h) */
+/* ========================================================================== */
+/* Find squared chord magnitude below which a point is within the given
+   geodesic distance, and the one above which it is not.
+ */
+void proxChordLimits(double geodesic,        /* meters, on planetary surface */
+                     double *chSqNear,                   /* inclusion limit */
+                     double *chSqFar) {                  /* exclusion limit */
+   double a, c;
+/* -------------------------------------------------------------------------- */
+   a = NEMO_GEOARC_MIN * (geodesic / NEMO_EARTH_RADIUS);
+   c = nemo_ArcToChordApprox(a);
+   *chSqNear = c * c;
+   a = NEMO_GEOARC_MAX * (geodesic / NEMO_EARTH_RADIUS);
+   c = nemo_ArcToChordApprox(a);
+   *chSqFar = c * c;
+   return;
+   }
+/* ========================================================================== */
+/* Determine point proximity based on quick (but possibly inconclusive)
+   spherical square proximity. Return 1 for close, -1 for far, 0 for
+   undetermined.
+ */
+int proxChordTest(const nemoPtNcs *ncsA, const nemoPtNcs *ncsB, /* two points */
+                  double chSqNear, double chSqFar) {     /* near/far criteria */
+   double chSq;
+   chSq = NEMO_ChordSq3(ncsA->dc, ncsB->dc);
+   if (chSq < chSqNear) return(1);                                  /* inside */
+   if (chSq > chSqFar) return(-1);                                 /* outside */
+   return(0);
+   }
+/* ========================================================================== */
@@ -0,0 +1,18 @@
+/* proxChord.h: quick, spherical pre-test of the proximity of two points to
+   a given ~geodesic~ distance. The geodesic length, expressed as an arc on
+   the unit sphere, is bracketed by the NEMO_GEOARC_MIN and NEMO_GEOARC_MAX
+   ratios, and the two arcs converted to chord squared limits: points closer
+   than the "near" limit are certainly within the geodesic distance, those
+   farther than the "far" limit certainly are not, and only the ones in
+   between require the (expensive) evaluation of the geodesic itself.
+
+   Include after nemo.h; the implementation (proxChord.c) is included at the
+   end of the program source, just like other scullions.
+ */
+#ifndef PROX_CHORD_H
+#define PROX_CHORD_H
+
+void proxChordLimits(double, double *, double *);
+int proxChordTest(const nemoPtNcs *, const nemoPtNcs *, double, double);
+
+#endif
@@ -0,0 +1,161 @@
+/* rngStream.c: pseudo-random number streams and random points on the unit
+   sphere (see rngStream.h). Points are uniformly distributed by area, on
+   the whole sphere or on a spherical cap.
+ */
+#define RNG_ROTL(x, k) (((x) << (k)) | ((x) >> (64 - (k))))
+/* ========================================================================== */
+/* Initialize the stream state from a single 64-bit seed (any value) */
+void rngSeed(rngStream *r, uint64_t seed) {
+   int i;
+   uint64_t z;
+/* -------------------------------------------------------------------------- */
+   for (i = 0; i < 4; i++) {                                    /* splitmix64 */
+      z = (seed += 0x9e3779b97f4a7c15ULL);
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+      r->s[i] = z ^ (z >> 31);
+      }
+   return;
+   }
+/* ========================================================================== */
+uint64_t rngNext(rngStream *r) {
+   uint64_t *s = r->s;
+   uint64_t result, t;
+/* -------------------------------------------------------------------------- */
+   result = RNG_ROTL(s[1] * 5, 7) * 9;
+   t = s[1] << 17;
+   s[2] ^= s[0];
+   s[3] ^= s[1];
+   s[1] ^= s[2];
+   s[0] ^= s[3];
+   s[2] ^= t;
+   s[3] = RNG_ROTL(s[3], 45);
+   return(result);
+   }
+/* ========================================================================== */
+/* Advance the stream by 2^128 numbers: the start of the next sub-stream */
+void rngJump(rngStream *r) {
+   static const uint64_t jump[4] = { 0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL,
+                                     0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL };
+   uint64_t s[4] = { 0, 0, 0, 0 };
+   int i, b;
+/* -------------------------------------------------------------------------- */
+   for (i = 0; i < 4; i++) {
+      for (b = 0; b < 64; b++) {
+         if (jump[i] & ((uint64_t)1 << b)) {
+            s[0] ^= r->s[0];
+            s[1] ^= r->s[1];
+            s[2] ^= r->s[2];
+            s[3] ^= r->s[3];
+            }
+         rngNext(r);
+         }
+      }
+   memcpy(r->s, s, sizeof(s));
+   return;
+   }
+/* ========================================================================== */
+/* Uniform double in [0, 1), with 53 random bits */
+double rngUniform(rngStream *r) {
+   return((double)(rngNext(r) >> 11) * (1.0 / 9007199254740992.0));
+   }
+/* ========================================================================== */
+/* Random point, uniform over the whole sphere */
+void rngSpherePoint(rngStream *r, nemoPtNcs *pt) {
+   double z, rho, lng;
+/* -------------------------------------------------------------------------- */
+   z = 2.0 * rngUniform(r) - 1.0;             /* uniform z is uniform area */
+   lng = NEMO_TWOPI * rngUniform(r);
+   rho = sqrt(1.0 - z * z);
+   pt->dc[0] = rho * cos(lng);
+   pt->dc[1] = rho * sin(lng);
+   pt->dc[2] = z;
+   return;
+   }
+/* ========================================================================== */
+/* Set up spherical cap generation: centre and (angular) radius, in radians */
+void rngCapInit(rngCap *cap, const nemoPtNcs *centre, double arc) {
+   int i;
+   double a[3], d, n;
+/* -------------------------------------------------------------------------- */
+   for (i = 0; i < 3; i++) cap->e3[i] = centre->dc[i];
+   a[0] = a[1] = a[2] = 0.0;             /* any axis not close to the centre */
+   if (fabs(centre->dc[0]) < 0.9) a[0] = 1.0;
+   else a[1] = 1.0;
+   d = a[0] * cap->e3[0] + a[1] * cap->e3[1] + a[2] * cap->e3[2];
+   for (i = 0; i < 3; i++) cap->e1[i] = a[i] - d * cap->e3[i];
+   n = sqrt(cap->e1[0] * cap->e1[0] + cap->e1[1] * cap->e1[1] +
+            cap->e1[2] * cap->e1[2]);
+   for (i = 0; i < 3; i++) cap->e1[i] /= n;
+   cap->e2[0] = cap->e3[1] * cap->e1[2] - cap->e3[2] * cap->e1[1];  /* e3 x e1 */
+   cap->e2[1] = cap->e3[2] * cap->e1[0] - cap->e3[0] * cap->e1[2];
+   cap->e2[2] = cap->e3[0] * cap->e1[1] - cap->e3[1] * cap->e1[0];
+   cap->cosArc = (arc < NEMO_PI) ? cos(arc) : -1.0;
+   return;
+   }
+/* ========================================================================== */
+/* Random point, uniform over the spherical cap set up by rngCapInit() */
+void rngCapPoint(rngStream *r, const rngCap *cap, nemoPtNcs *pt) {
+   int i;
+   double cosT, sinT, lng, c, s;
+/* -------------------------------------------------------------------------- */
+   cosT = 1.0 - rngUniform(r) * (1.0 - cap->cosArc);  /* uniform cap area */
+   sinT = 1.0 - cosT * cosT;
+   sinT = (sinT > 0.0) ? sqrt(sinT) : 0.0;
+   lng = NEMO_TWOPI * rngUniform(r);
+   c = sinT * cos(lng);
+   s = sinT * sin(lng);
+   for (i = 0; i < 3; i++)
+      pt->dc[i] = cosT * cap->e3[i] + c * cap->e1[i] + s * cap->e2[i];
+   return;
+   }
+/* ========================================================================== */
+/* Fill points first ... first + n - 1 of soa with random points, uniform
+   over the whole sphere (as n rngSpherePoint() calls would).
+ */
+void rngSphereSoa(rngStream *r, ncsSoa *soa, int first, int n) {
+   int i, k, m;
+   double z, rho, lng;
+   double u[2 * RNG_TILE];                       /* numbers, for the tile */
+/* -------------------------------------------------------------------------- */
+   for (i = 0; i < n; i += m) {
+      m = (n - i < RNG_TILE) ? n - i : RNG_TILE;
+      for (k = 0; k < 2 * m; k++) u[k] = rngUniform(r);    /* in stream order */
+      for (k = 0; k < m; k++) {                     /* ...then the points */
+         z = 2.0 * u[2 * k] - 1.0;
+         lng = NEMO_TWOPI * u[2 * k + 1];
+         rho = sqrt(1.0 - z * z);
+         soa->x[first + i + k] = rho * cos(lng);
+         soa->y[first + i + k] = rho * sin(lng);
+         soa->z[first + i + k] = z;
+         }
+      }
+   return;
+   }
+/* ========================================================================== */
+/* Fill points first ... first + n - 1 of soa with random points, uniform
+   over the cap (as n rngCapPoint() calls would).
+ */
+void rngCapSoa(rngStream *r, const rngCap *cap, ncsSoa *soa, int first, int n) {
+   int i, k, m;
+   double cosT, sinT, lng, c, s;
+   double u[2 * RNG_TILE];                       /* numbers, for the tile */
+/* -------------------------------------------------------------------------- */
+   for (i = 0; i < n; i += m) {
+      m = (n - i < RNG_TILE) ? n - i : RNG_TILE;
+      for (k = 0; k < 2 * m; k++) u[k] = rngUniform(r);    /* in stream order */
+      for (k = 0; k < m; k++) {                     /* ...then the points */
+         cosT = 1.0 - u[2 * k] * (1.0 - cap->cosArc);
+         sinT = 1.0 - cosT * cosT;
+         sinT = (sinT > 0.0) ? sqrt(sinT) : 0.0;
+         lng = NEMO_TWOPI * u[2 * k + 1];
+         c = sinT * cos(lng);
+         s = sinT * sin(lng);
+         soa->x[first + i + k] = cosT * cap->e3[0] + c * cap->e1[0] + s * cap->e2[0];
+         soa->y[first + i + k] = cosT * cap->e3[1] + c * cap->e1[1] + s * cap->e2[1];
+         soa->z[first + i + k] = cosT * cap->e3[2] + c * cap->e1[2] + s * cap->e2[2];
+         }
+      }
+   return;
+   }
+/* ========================================================================== */
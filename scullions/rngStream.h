@@ -0,0 +1,47 @@
+/* rngStream.h: independent, reproducible streams of pseudo-random numbers,
+   and random points on the unit sphere (NCS) generated from them. Unlike
+   nemo_SphereRandomPointGlobal() and nemo_SphereRandomPointLocal(), which
+   share one hidden generator state, each stream is a separate object: a
+   thread can own one, and a given seed always yields the same sequence.
+
+   The generator is xoshiro256** (Blackman and Vigna), seeded by splitmix64.
+   rngJump() advances a stream by 2^128 numbers, so that streams created by
+   successive jumps from a single seed never overlap in practice.
+
+   rngSphereSoa() and rngCapSoa() generate many points at once, straight into
+   a "structure of arrays" (ncsSoa, see chordSqBatch.h) - ready for the batch
+   chord and Us8 conversion functions. The numbers of a tile of RNG_TILE
+   points are drawn first, then the points are computed from them: the
+   points are the same, in the same order, as those of rngSpherePoint() and
+   rngCapPoint() calls on the same stream.
+
+   Include after nemo.h and chordSqBatch.h; the implementation (rngStream.c)
+   is included at the end of the program source, just like other scullions.
+ */
+#ifndef RNG_STREAM_H
+#define RNG_STREAM_H
+
+#include <stdint.h>
+
+#define RNG_TILE  256            /* batch generation: points per tile */
+
+typedef struct {
+   uint64_t s[4];                                    /* xoshiro256** state */
+   } rngStream;
+
+typedef struct {            /* spherical cap, for rngCapPoint() generation */
+   double e1[3], e2[3], e3[3];        /* orthonormal basis, e3: cap centre */
+   double cosArc;                        /* cosine of cap (angular) radius */
+   } rngCap;
+
+void rngSeed(rngStream *, uint64_t);
+void rngJump(rngStream *);
+uint64_t rngNext(rngStream *);
+double rngUniform(rngStream *);
+void rngSpherePoint(rngStream *, nemoPtNcs *);
+void rngCapInit(rngCap *, const nemoPtNcs *, double);
+void rngCapPoint(rngStream *, const rngCap *, nemoPtNcs *);
+void rngSphereSoa(rngStream *, ncsSoa *, int, int);
+void rngCapSoa(rngStream *, const rngCap *, ncsSoa *, int, int);
+
+#endif
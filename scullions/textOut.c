@@ -0,0 +1,164 @@
+/* textOut.c: chunked, threaded formatting and buffered output (see textOut.h) */
+
+#define TEXT_OUT_FIX_MAX  9.0e15  /* textFixed(), scaled: exact in a double */
+#define TEXT_OUT_FIX_LEN     352       /* ...and DBL_MAX, "%.9f": 320 bytes */
+
+struct textOutSlot {                              /* one chunk of a round */
+   struct textOutJob *job;
+   int iSlot;
+   int first, nRecs;                       /* records of the chunk, and */
+   char *buf;                                 /* ...their formatted text */
+   size_t nBytes;
+   };
+
+struct textOutJob {
+   textOutFmt fmt;
+   void *ctx;
+   struct textOutSlot slots[TEXT_OUT_MAX_THREADS];
+   };
+
+static void *textOutWorker(void *);
+
+static const double textPow10[TEXT_OUT_MAX_DEC + 1] = {1.0e0, 1.0e1, 1.0e2,
+       1.0e3, 1.0e4, 1.0e5, 1.0e6, 1.0e7, 1.0e8, 1.0e9};
+static const char textHexDigits[] = "0123456789abcdef";
+/* ========================================================================== */
+/* Format the nRecs records by fmt, chunk by chunk in rounds of nThreads
+   (0 or 1: the calling thread only), and write them to fp. Each record takes
+   at most maxRecBytes. Returns 0, TEXT_OUT_NOMEM, _THREAD or _WRITE.
+ */
+int textOutRun(FILE *fp,                                   /* output file */
+               int nRecs,                       /* number of records, and */
+               int maxRecBytes,                 /* ...most of the bytes each */
+               textOutFmt fmt,                    /* formatting function */
+               void *ctx,                                   /* ...its data */
+               int nThreads) {                /* max. worker threads, or 0 */
+   int i, nSlots, nStarted, first, iErr;
+   struct textOutJob job;
+   asyncOut aOut;                  /* a round written, while the next is made */
+   struct textOutSlot *sl;
+   pthread_t threads[TEXT_OUT_MAX_THREADS];
+/* -------------------------------------------------------------------------- */
+   if (nRecs < 1) return(0);
+   nSlots = (nRecs + TEXT_OUT_CHUNK - 1) / TEXT_OUT_CHUNK;
+   if (nThreads < 1) nThreads = 1;
+   if (nThreads > TEXT_OUT_MAX_THREADS) nThreads = TEXT_OUT_MAX_THREADS;
+   if (nSlots > nThreads) nSlots = nThreads;                /* no idle ones */
+   job.fmt = fmt;
+   job.ctx = ctx;
+   iErr = asyncOutOpen(&aOut, fp, 0, 3) ? TEXT_OUT_NOMEM : 0;
+   for (i = 0; i < nSlots; i++) {
+      job.slots[i].job = &job;
+      job.slots[i].iSlot = i;
+      job.slots[i].buf = malloc((size_t)TEXT_OUT_CHUNK * maxRecBytes);
+      if (job.slots[i].buf == NULL) iErr = TEXT_OUT_NOMEM;
+      }
+
+   for (first = 0; (iErr == 0) && (first < nRecs); ) {
+      for (i = 0; i < nSlots; i++) {                   /* this round's chunks */
+         sl = job.slots + i;
+         sl->first = first;
+         sl->nRecs = (nRecs - first < TEXT_OUT_CHUNK) ? nRecs - first :
+                                                         TEXT_OUT_CHUNK;
+         first += sl->nRecs;
+         }
+      for (nStarted = 1; nStarted < nSlots; nStarted++) {  /* slot 0: here */
+         if (pthread_create(threads + nStarted, NULL, textOutWorker,
+                            job.slots + nStarted)) break;
+         }
+      textOutWorker(job.slots);
+      for (i = 1; i < nStarted; i++) pthread_join(threads[i], NULL);
+      if (nStarted < nSlots) {
+         iErr = TEXT_OUT_THREAD;
+         break;
+         }
+      for (i = 0; i < nSlots; i++) {                 /* ...written in order */
+         sl = job.slots + i;
+         if (asyncOutWrite(&aOut, sl->buf, sl->nBytes)) iErr = TEXT_OUT_WRITE;
+         sl->nRecs = 0;                   /* none left, in the last round */
+         sl->nBytes = 0;
+         }
+      }
+   for (i = 0; i < nSlots; i++) free(job.slots[i].buf);
+   if ((aOut.nBufs > 0) && asyncOutClose(&aOut) && (iErr == 0))
+      iErr = TEXT_OUT_WRITE;
+   return(iErr);
+   }
+/* ========================================================================== */
+/* Worker thread (or the main one): format one chunk, into its slot buffer */
+static void *textOutWorker(void *arg) {
+   struct textOutSlot *sl = arg;
+/* -------------------------------------------------------------------------- */
+   sl->nBytes = 0;
+   if (sl->nRecs > 0) sl->nBytes = sl->job->fmt(sl->job->ctx, sl->iSlot,
+                                               sl->first, sl->nRecs, sl->buf);
+   return(NULL);
+   }
+/* ========================================================================== */
+/* Write v, as printf("%*.*f", width, nDec, v) would, at p; returns the end
+   of the text written (no terminating null).
+ */
+char *textFixed(char *p,                                       /* output */
+                double v,                                 /* value, and */
+                int width,                      /* ...its min. text width */
+                int nDec) {               /* fraction digits, 0...MAX_DEC */
+   int k, len;
+   uint64_t ip;
+   double a, f;
+   char digits[TEXT_OUT_FIX_LEN];   /* reversed, no sign (or, by snprintf) */
+/* -------------------------------------------------------------------------- */
+   if ((nDec < 0) || (nDec > TEXT_OUT_MAX_DEC)) nDec = 6;     /* as printf */
+   a = fabs(v) * textPow10[nDec];
+   f = a - floor(a);
+   if (!(a < TEXT_OUT_FIX_MAX) || (fabs(f - 0.5) <= 1.0e-15 * a + 1.0e-12)) {
+      len = snprintf(digits, sizeof(digits), "%.*f", nDec, v);
+      if ((len < 0) || (len >= (int)sizeof(digits))) len = 0;  /* can't be */
+      for (k = len; k < width; k++) *p++ = ' ';
+      memcpy(p, digits, len);
+      return(p + len);
+      }
+   ip = (uint64_t)floor(a) + ((f > 0.5) ? 1 : 0);             /* rounded */
+   len = 0;
+   for (k = 0; k < nDec; k++) {                          /* fraction digits */
+      digits[len++] = (char)('0' + ip % 10);
+      ip /= 10;
+      }
+   if (nDec) digits[len++] = '.';
+   do {                                      /* integer part, at least one */
+      digits[len++] = (char)('0' + ip % 10);
+      ip /= 10;
+      } while (ip);
+   if (signbit(v)) digits[len++] = '-';   /* printf("%.4f", -0.0): "-0.0000" */
+   for (k = len; k < width; k++) *p++ = ' ';
+   while (len) *p++ = digits[--len];
+   return(p);
+   }
+/* ========================================================================== */
+/* Write u as printf("%016lx") would, at p; returns the end of the text */
+char *textHex16(char *p, uint64_t u) {
+   int k;
+/* -------------------------------------------------------------------------- */
+   for (k = 15; k >= 0; k--) {
+      p[k] = textHexDigits[u & 0xf];
+      u >>= 4;
+      }
+   return(p + 16);
+   }
+/* ========================================================================== */
+/* Write v as printf("%d") would, at p; returns the end of the text */
+char *textInt(char *p, int v) {
+   int len;
+   unsigned int u;
+   char digits[12];
+/* -------------------------------------------------------------------------- */
+   u = (v < 0) ? 0u - (unsigned int)v : (unsigned int)v;
+   len = 0;
+   do {
+      digits[len++] = (char)('0' + u % 10);
+      u /= 10;
+      } while (u);
+   if (v < 0) *p++ = '-';
+   while (len) *p++ = digits[--len];
+   return(p);
+   }
+/* ========================================================================== */
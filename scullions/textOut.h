@@ -0,0 +1,42 @@
+/* textOut.h: fast text (or raw binary) output of large record arrays, such
+   as the coordinate listings of r8bToAscii and listP8b.
+
+   The records are formatted in chunks of TEXT_OUT_CHUNK, each into its own
+   buffer, by the program's formatting function; a round of up to nThreads
+   chunks is formatted by as many threads, and the buffers are then written,
+   in the chunk order, by a background thread (asyncOut) while the next round
+   is being formatted. The output is the same for any number of threads.
+
+   The formatters write numbers with no printf() format parsing: textFixed()
+   is printf("%*.*f"), found by integer arithmetic on the scaled value (and
+   by snprintf() itself only if that value is within rounding error of a
+   decimal half-way point, or too large), textHex16() is printf("%016lx")
+   and textInt() printf("%d"). The output is byte-for-byte that of printf().
+
+   Include after nemo.h and asyncOut.h; the implementation (textOut.c) is included at the
+   end of the program source, just like other scullions.
+ */
+#ifndef TEXT_OUT_H
+#define TEXT_OUT_H
+
+#include <pthread.h>
+
+#define TEXT_OUT_NOMEM      -1                 /* no memory for the buffers */
+#define TEXT_OUT_THREAD     -2                    /* can't create a thread */
+#define TEXT_OUT_WRITE      -3                      /* fwrite() has failed */
+
+#define TEXT_OUT_CHUNK     16384                /* records per unit of work */
+#define TEXT_OUT_MAX_THREADS 256
+#define TEXT_OUT_MAX_DEC       9         /* textFixed(): most fraction digits */
+
+typedef size_t (*textOutFmt)(void *,    /* program's context, as given, and */
+                             int,         /* buffer (and thread) number, */
+                             int, int,    /* first record, and their count */
+                             char *);  /* the buffer; returns bytes written */
+
+int textOutRun(FILE *, int, int, textOutFmt, void *, int);
+char *textFixed(char *, double, int, int);
+char *textHex16(char *, uint64_t);
+char *textInt(char *, int);
+
+#endif
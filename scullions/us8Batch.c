@@ -0,0 +1,128 @@
+/* us8Batch.c: Us8, Us4 <-> SoA NCS array conversion (see us8Batch.h) */
+
+#define US_BATCH_TO_SOA   0x1                     /* job->kind bits: decode, */
+#define US_BATCH_US4      0x2                                   /* ...Us4 */
+
+struct usBatchJob {                         /* shared by all the threads */
+   int kind;
+   nemoPtUs8 *us8;                      /* one of these two, input or output */
+   nemoPtUs4 *us4;
+   ncsSoa *soa;
+   int nPts, nChunks;
+   atomic_int nextChunk;                           /* next one to be taken */
+   };
+
+static int usBatchRun(struct usBatchJob *, int);
+static void *usBatchWorker(void *);
+static void usBatchTile(struct usBatchJob *, int, int);
+/* ========================================================================== */
+/* Decode n Us8 points into s (its first n points), using nThreads threads
+   (0 or 1: the calling thread only). Returns 0, or US_BATCH_THREAD.
+ */
+int us8ToSoa(const nemoPtUs8 *us8, int n, ncsSoa *s, int nThreads) {
+   struct usBatchJob job;
+/* -------------------------------------------------------------------------- */
+   job.kind = US_BATCH_TO_SOA;
+   job.us8 = (nemoPtUs8 *)us8;                   /* (read only, in decoding) */
+   job.soa = s;
+   job.nPts = n;
+   return(usBatchRun(&job, nThreads));
+   }
+/* ========================================================================== */
+/* Encode the first n points of s as Us8, see us8ToSoa() */
+int soaToUs8(const ncsSoa *s, int n, nemoPtUs8 *us8, int nThreads) {
+   struct usBatchJob job;
+/* -------------------------------------------------------------------------- */
+   job.kind = 0;
+   job.us8 = us8;
+   job.soa = (ncsSoa *)s;                        /* (read only, in encoding) */
+   job.nPts = n;
+   return(usBatchRun(&job, nThreads));
+   }
+/* ========================================================================== */
+/* Decode n Us4 points into s, see us8ToSoa() */
+int us4ToSoa(const nemoPtUs4 *us4, int n, ncsSoa *s, int nThreads) {
+   struct usBatchJob job;
+/* -------------------------------------------------------------------------- */
+   job.kind = US_BATCH_TO_SOA | US_BATCH_US4;
+   job.us4 = (nemoPtUs4 *)us4;
+   job.soa = s;
+   job.nPts = n;
+   return(usBatchRun(&job, nThreads));
+   }
+/* ========================================================================== */
+/* Encode the first n points of s as Us4, see us8ToSoa() */
+int soaToUs4(const ncsSoa *s, int n, nemoPtUs4 *us4, int nThreads) {
+   struct usBatchJob job;
+/* -------------------------------------------------------------------------- */
+   job.kind = US_BATCH_US4;
+   job.us4 = us4;
+   job.soa = (ncsSoa *)s;
+   job.nPts = n;
+   return(usBatchRun(&job, nThreads));
+   }
+/* ========================================================================== */
+/* Run the job on nThreads threads, and wait for all of them to finish */
+static int usBatchRun(struct usBatchJob *job, int nThreads) {
+   int i, nStarted;
+   pthread_t threads[US_BATCH_MAX_THREADS];
+/* -------------------------------------------------------------------------- */
+   job->nChunks = (job->nPts + US_BATCH_CHUNK - 1) / US_BATCH_CHUNK;
+   atomic_init(&job->nextChunk, 0);
+   if (nThreads > job->nChunks) nThreads = job->nChunks;  /* no idle ones */
+   if (nThreads > US_BATCH_MAX_THREADS) nThreads = US_BATCH_MAX_THREADS;
+   if (nThreads < 2) {
+      usBatchWorker(job);
+      return(0);
+      }
+   for (nStarted = 0; nStarted < nThreads; nStarted++) {
+      if (pthread_create(threads + nStarted, NULL, usBatchWorker, job)) break;
+      }
+   for (i = 0; i < nStarted; i++) pthread_join(threads[i], NULL);
+   return((nStarted < nThreads) ? US_BATCH_THREAD : 0);
+   }
+/* ========================================================================== */
+/* Worker thread (or the main one): take chunks until there are none left */
+static void *usBatchWorker(void *arg) {
+   struct usBatchJob *job = arg;
+   int c, n, nEnd;
+/* -------------------------------------------------------------------------- */
+   while ((c = atomic_fetch_add(&job->nextChunk, 1)) < job->nChunks) {
+      nEnd = (c + 1) * US_BATCH_CHUNK;
+      if (nEnd > job->nPts) nEnd = job->nPts;
+      for (n = c * US_BATCH_CHUNK; n < nEnd; n += US_BATCH_TILE)
+         usBatchTile(job, n, (nEnd - n < US_BATCH_TILE) ? nEnd - n : US_BATCH_TILE);
+      }
+   return(NULL);
+   }
+/* ========================================================================== */
+/* Convert a tile of nt points, starting at n0. Only the library calls go
+   point by point; the component arrays are read or written by the plain
+   (vectorizable) loops over the tile.
+ */
+static void usBatchTile(struct usBatchJob *job, int n0, int nt) {
+   int i;
+   double *x, *y, *z;
+   nemoPtNcs tile[US_BATCH_TILE];
+/* -------------------------------------------------------------------------- */
+   x = job->soa->x + n0;
+   y = job->soa->y + n0;
+   z = job->soa->z + n0;
+   if (job->kind & US_BATCH_TO_SOA) {
+      if (job->kind & US_BATCH_US4)
+         for (i = 0; i < nt; i++) nemo_Us4ToNcs(job->us4[n0 + i], tile + i);
+      else for (i = 0; i < nt; i++) nemo_Us8ToNcs(job->us8[n0 + i], tile + i);
+      for (i = 0; i < nt; i++) x[i] = tile[i].dc[0];
+      for (i = 0; i < nt; i++) y[i] = tile[i].dc[1];
+      for (i = 0; i < nt; i++) z[i] = tile[i].dc[2];
+      return;
+      }
+   for (i = 0; i < nt; i++) tile[i].dc[0] = x[i];
+   for (i = 0; i < nt; i++) tile[i].dc[1] = y[i];
+   for (i = 0; i < nt; i++) tile[i].dc[2] = z[i];
+   if (job->kind & US_BATCH_US4)
+      for (i = 0; i < nt; i++) job->us4[n0 + i] = nemo_NcsToUs4(tile + i);
+   else for (i = 0; i < nt; i++) job->us8[n0 + i] = nemo_NcsToUs8(tile + i);
+   return;
+   }
+/* ========================================================================== */
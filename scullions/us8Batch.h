@@ -0,0 +1,32 @@
+/* us8Batch.h: conversion of arrays of UniSpherical coordinates, Us8 or Us4,
+   to and from NCS direction cosines in "structure of arrays" form (ncsSoa,
+   see chordSqBatch.h): the layout the batch scans of the SoA points use.
+
+   The points are converted a tile (US_BATCH_TILE points) at a time: the
+   Nemo library call for each point of the tile, then a single transposing
+   pass between the tile and the three component arrays. The transposing
+   loops are simple enough to be vectorized by the compiler. Chunks of
+   US_BATCH_CHUNK points can be converted by several threads; the result
+   does not depend on the number of threads.
+
+   Include after nemo.h and chordSqBatch.h; the implementation (us8Batch.c)
+   is included at the end of the program source, just like other scullions.
+ */
+#ifndef US8_BATCH_H
+#define US8_BATCH_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define US_BATCH_THREAD     -1                    /* can't create a thread */
+
+#define US_BATCH_TILE        256
+#define US_BATCH_CHUNK     65536                /* points per unit of work */
+#define US_BATCH_MAX_THREADS 256
+
+int us8ToSoa(const nemoPtUs8 *, int, ncsSoa *, int);
+int soaToUs8(const ncsSoa *, int, nemoPtUs8 *, int);
+int us4ToSoa(const nemoPtUs4 *, int, ncsSoa *, int);
+int soaToUs4(const ncsSoa *, int, nemoPtUs4 *, int);
+
+#endif
@@ -0,0 +1,192 @@
+/* us8Sort.c: radix sort of Us8 coordinates (see us8Sort.h) */
+
+#define US8_SORT_SMALL     64     /* buckets up to this size: insertion sort */
+
+struct us8SortJob {                  /* state shared by all sorting threads */
+   nemoPtUs8 *a;                                      /* array to be sorted */
+   nemoPtUs8 *tmp;                                 /* work array, same size */
+   size_t n;
+   int nThreads;
+   size_t *cnt;          /* per thread: top byte counts, then their offsets */
+   size_t bStart[257];                 /* start of each top byte bucket */
+   atomic_int nextBucket;               /* next one to be taken by a thread */
+   };
+
+struct us8SortPart {                     /* one thread's share of the job */
+   struct us8SortJob *job;
+   int iThread;
+   };
+
+static int us8SortRun(struct us8SortJob *, void *(*)(void *));
+static void *us8SortCount(void *);
+static void *us8SortScatter(void *);
+static void *us8SortBuckets(void *);
+static void us8SortBucket(nemoPtUs8 *, nemoPtUs8 *, size_t);
+/* ========================================================================== */
+/* Sort n Us8 points in ascending order, using nThreads threads (0 or 1: the
+   calling thread only). Returns 0 on success, US8_SORT_NOMEM or
+   US8_SORT_THREAD if it could not be done (the array is then left as is).
+ */
+int us8Sort(nemoPtUs8 *a,                              /* array to be sorted */
+            size_t n,                                  /* number of points */
+            int nThreads) {                /* max. worker threads, or 0 */
+   int i, b, iErr;
+   size_t k, next;
+   struct us8SortJob job;
+/* -------------------------------------------------------------------------- */
+   if (n < 2) return(0);
+   if (nThreads < 1) nThreads = 1;
+   if (nThreads > US8_SORT_MAX_THREADS) nThreads = US8_SORT_MAX_THREADS;
+   job.a = a;
+   job.n = n;
+   job.nThreads = nThreads;
+   job.tmp = malloc(n * sizeof(nemoPtUs8));
+   job.cnt = calloc((size_t)nThreads * 256, sizeof(size_t));
+   if ((job.tmp == NULL) || (job.cnt == NULL)) {
+      free(job.tmp);
+      free(job.cnt);
+      return(US8_SORT_NOMEM);
+      }
+/* Count top bytes in each thread's slice of the array, turn the counts into
+   scatter offsets (all of thread 0's, then thread 1's ... for each bucket
+   in turn, which keeps the sort stable) and scatter into buckets in tmp */
+   iErr = us8SortRun(&job, us8SortCount);
+   if (iErr == 0) {
+      next = 0;
+      for (b = 0; b < 256; b++) {
+         job.bStart[b] = next;
+         for (i = 0; i < nThreads; i++) {
+            k = job.cnt[256 * i + b];
+            job.cnt[256 * i + b] = next;
+            next += k;
+            }
+         }
+      job.bStart[256] = next;
+      iErr = us8SortRun(&job, us8SortScatter);
+      }
+/* Sort the buckets, from tmp back to a */
+   atomic_init(&job.nextBucket, 0);
+   if (iErr == 0) iErr = us8SortRun(&job, us8SortBuckets);
+   free(job.tmp);
+   free(job.cnt);
+   return(iErr);
+   }
+/* ========================================================================== */
+/* Drop the duplicates of the n sorted points, keeping the first of each;
+   returns the number of points left at the front of the array.
+ */
+size_t us8Unique(nemoPtUs8 *a, size_t n) {
+   size_t k, m;
+/* -------------------------------------------------------------------------- */
+   if (n < 2) return(n);
+   for (m = 1, k = 1; k < n; k++) if (a[k] != a[m - 1]) a[m++] = a[k];
+   return(m);
+   }
+/* ========================================================================== */
+/* Run the given sorting stage on job->nThreads threads, and wait for all of
+   them to finish. Single-threaded job runs in the calling thread.
+ */
+static int us8SortRun(struct us8SortJob *job, void *(*stage)(void *)) {
+   int i, nStarted;
+   pthread_t threads[US8_SORT_MAX_THREADS];
+   struct us8SortPart parts[US8_SORT_MAX_THREADS];
+/* -------------------------------------------------------------------------- */
+   for (i = 0; i < job->nThreads; i++) {
+      parts[i].job = job;
+      parts[i].iThread = i;
+      }
+   if (job->nThreads == 1) {
+      stage(parts);
+      return(0);
+      }
+   for (nStarted = 0; nStarted < job->nThreads; nStarted++) {
+      if (pthread_create(threads + nStarted, NULL, stage, parts + nStarted))
+         break;
+      }
+   for (i = 0; i < nStarted; i++) pthread_join(threads[i], NULL);
+   return((nStarted == job->nThreads) ? 0 : US8_SORT_THREAD);
+   }
+/* ========================================================================== */
+static void *us8SortCount(void *arg) {
+   struct us8SortPart *part = arg;
+   struct us8SortJob *job = part->job;
+   size_t k, kEnd, *cnt;
+/* -------------------------------------------------------------------------- */
+   cnt = job->cnt + 256 * part->iThread;
+   k = job->n * part->iThread / job->nThreads;
+   kEnd = job->n * (part->iThread + 1) / job->nThreads;
+   for (; k < kEnd; k++) cnt[(uint64_t)job->a[k] >> 56]++;
+   return(NULL);
+   }
+/* ========================================================================== */
+static void *us8SortScatter(void *arg) {
+   struct us8SortPart *part = arg;
+   struct us8SortJob *job = part->job;
+   size_t k, kEnd, *pos;
+/* -------------------------------------------------------------------------- */
+   pos = job->cnt + 256 * part->iThread;
+   k = job->n * part->iThread / job->nThreads;
+   kEnd = job->n * (part->iThread + 1) / job->nThreads;
+   for (; k < kEnd; k++) job->tmp[pos[(uint64_t)job->a[k] >> 56]++] = job->a[k];
+   return(NULL);
+   }
+/* ========================================================================== */
+/* Take top byte buckets, one at a time, until there are none left */
+static void *us8SortBuckets(void *arg) {
+   struct us8SortPart *part = arg;
+   struct us8SortJob *job = part->job;
+   int b;
+   size_t lo, hi;
+/* -------------------------------------------------------------------------- */
+   while ((b = atomic_fetch_add(&job->nextBucket, 1)) < 256) {
+      lo = job->bStart[b];
+      hi = job->bStart[b + 1];
+      us8SortBucket(job->tmp + lo, job->a + lo, hi - lo);
+      }
+   return(NULL);
+   }
+/* ========================================================================== */
+/* Sort one bucket (all points share the top byte) from src into dst; src
+   is used as work space. The LSD passes over bytes 0...6 ping-pong between
+   the two, skipping any byte that is the same in all the points.
+ */
+static void us8SortBucket(nemoPtUs8 *src, nemoPtUs8 *dst, size_t n) {
+   int d, b, sh;
+   size_t k, j, next, cnt[7][256];
+   uint64_t u;
+   nemoPtUs8 *from, *to, *swap;
+/* -------------------------------------------------------------------------- */
+   if (n <= US8_SORT_SMALL) {                         /* small, or empty... */
+      for (k = 1; k < n; k++) {                        /* ...insertion sort */
+         u = (uint64_t)src[k];
+         for (j = k; (j > 0) && ((uint64_t)src[j - 1] > u); j--) src[j] = src[j - 1];
+         src[j] = (nemoPtUs8)u;
+         }
+      memcpy(dst, src, n * sizeof(nemoPtUs8));
+      return;
+      }
+   memset(cnt, 0, sizeof(cnt));               /* all seven histograms... */
+   for (k = 0; k < n; k++) {                        /* ...in a single pass */
+      u = (uint64_t)src[k];
+      for (d = 0; d < 7; d++) cnt[d][(u >> (8 * d)) & 0xff]++;
+      }
+   from = src;
+   to = dst;
+   for (d = 0; d < 7; d++) {
+      sh = 8 * d;
+      if (cnt[d][((uint64_t)from[0] >> sh) & 0xff] == n) continue; /* skip */
+      next = 0;
+      for (b = 0; b < 256; b++) {              /* counts to scatter offsets */
+         k = cnt[d][b];
+         cnt[d][b] = next;
+         next += k;
+         }
+      for (k = 0; k < n; k++) to[cnt[d][((uint64_t)from[k] >> sh) & 0xff]++] = from[k];
+      swap = from;
+      from = to;
+      to = swap;
+      }
+   if (from != dst) memcpy(dst, from, n * sizeof(nemoPtUs8));
+   return;
+   }
+/* ========================================================================== */
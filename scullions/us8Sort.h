@@ -0,0 +1,30 @@
+/* us8Sort.h: sort an array of UniSpherical (Us8) coordinates into their
+   "canonical" (ascending, unsigned 64-bit key) order, with a radix sort
+   instead of qsort() with a comparison function callback.
+
+   The array is first partitioned on the most significant byte of the key
+   (that is, by plate and then by the top four bits within the plate) into
+   256 buckets, and each bucket is then sorted by least significant digit
+   passes over the remaining seven bytes. The partitioning, as well as the
+   sorting of buckets, can be shared among several threads. The sort is
+   stable, and the result does not depend on the number of threads.
+   us8Unique() then drops the duplicates of a sorted array, in place.
+
+   Include after nemo.h; the implementation (us8Sort.c) is included at the
+   end of the program source, just like other scullions.
+ */
+#ifndef US8_SORT_H
+#define US8_SORT_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define US8_SORT_NOMEM    -1                   /* no memory for work arrays */
+#define US8_SORT_THREAD   -2                    /* can't create a thread */
+
+#define US8_SORT_MAX_THREADS  256
+
+int us8Sort(nemoPtUs8 *, size_t, int);
+size_t us8Unique(nemoPtUs8 *, size_t);
+
+#endif
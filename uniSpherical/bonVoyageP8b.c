@@ -6,30 +6,39 @@
    For instance:
 
    bonVoyageP8b w1904711.p8b
+
+   The legs are measured by the scullions/itinLegs engine, with the
+   -t(hreads)=n option by n threads (the report does not depend on it).
+   With -h(istogram)=legs.csv, the number of legs by (WGS84 geodesic)
+   length is written to the legs.csv file, one line per power of 2 meters.
+   With -stats=text (or json, or file.json) the time taken by the phases and
+   the geodesic iterations histogram (scullions/nemoStats) are reported too.
  */
 
 #define PGM_DSCR "Report itinerary of .p8b (Us8 binary format) file"
-#define PGM_LAST_EDIT_DATE "2025.085"
+#define PGM_LAST_EDIT_DATE "2026.287"
 #include <stdio.h>
 
 #include <nemo.h>
 #include "../scullions/scullions.h" /* include after nemo.h has been included */
+#include "../scullions/nemoStats.h"
+#include "../scullions/fileMap.h"
+#include "../scullions/itinLegs.h"
 
-#define LINE_MAX      256
 #define METERS2NM       0.0005399568
-double arcLegLength(nemoPtUs8, nemoPtUs8);
-double geodesicLegLength(nemoPtUs8, nemoPtUs8);
 
 static const char *progName;    /* for error logging by this source file only */
 /* ========================================================================== */
 int main (int argc,
           const char *argv[],
           const char *envr[]) {
-   int n;
-   FILE *inFpCoords;               /* input binary file, location coordinates */
-   nemoPtUs8 startUs8, locUs8, xLocUs8;    /* first, current, previous as Us8 */
-   double arc, arcTotal, arcMin, arcMax, arcStartEnd;   /* on spherical Earth */
-   double gds, gdsTotal, gdsMin, gdsMax, gdsStartEnd; /* on ellipsoidal Earth */
+   int i, iErr;
+   int nThreads;                           /* number of worker threads, or 0 */
+   const char *optKey, *optVal;            /* options, in -keyword=value form */
+   const char *fnIn, *fnHisto;                /* as given on the command line */
+   fileMap inMap;                  /* input binary file, location coordinates */
+   itinStats st;                               /* leg lengths, on both Earths */
+   FILE *histoFp;
 /* -------------------------------------------------------------------------- */
    progName = strrchr(argv[0], '/');                                 /* POSIX */
    if (progName == NULL) progName = strrchr(argv[0], '\\');         /* MS Win */
@@ -37,76 +46,70 @@ int main (int argc,
    else progName += 1;                        /* strip leading path separator */
    fprintf(stderr, "\n[%s]: %s\nsource as of: %s, Nemo Library: %.3f\n",
                    progName, PGM_DSCR, PGM_LAST_EDIT_DATE, NEMO_LIBRARY_DATE);
+   if (statsInit(progName, &argc, argv)) errorExit(progName, __LINE__,
+                "-stats=text, -stats=json or -stats=file.json, please\n");
 
-   if (argc < 2) errorExit(progName, __LINE__,
-      "command-line arguments: w1904711.ptb\n");
-
-   inFpCoords = fopen(argv[1], "rb");                      /* Open input file */
-   if (inFpCoords == NULL) errorExit(progName, __LINE__,
-                                "Can't open [%s] for reading\n", argv[1]);
-
-   arcTotal = arcMax = 0.0;
-   gdsTotal = gdsMax = 0.0;
-   arcMin = gdsMin = NEMO_DOUBLE_HUGE;
-   n = 0;
-/* first leg starting coordinate */
-   fread(&startUs8, sizeof(nemoPtUs8), 1, inFpCoords);
-   xLocUs8 = startUs8;
-   while (fread(&locUs8, sizeof(nemoPtUs8), 1, inFpCoords)) { /* leg ending.. */
-      arc = arcLegLength(xLocUs8, locUs8);
-      if (arc < arcMin) arcMin = arc;
-      if (arc > arcMax) arcMax = arc;
-      arcTotal += arc;
-      gds = geodesicLegLength(xLocUs8, locUs8);
-      if (gds < gdsMin) gdsMin = gds;
-      if (gds > gdsMax) gdsMax = gds;
-      gdsTotal += gds;
-      xLocUs8 = locUs8;
-      n++;
+   nThreads = 0;                               /* default: single-threaded */
+   fnHisto = NULL;
+   while ((optKey = clOption(argc, argv, &optVal))) {
+      if (*optKey == 't') nThreads = atoi(optVal);
+      else if (*optKey == 'h') fnHisto = optVal;
+      else errorExit(progName, __LINE__, "unrecognized option [%s]\n", optKey);
       }
-   fclose(inFpCoords);
+   if ((nThreads < 0) || (nThreads > ITIN_MAX_THREADS))
+      errorExit(progName, __LINE__, "invalid thread count %d\n", nThreads);
+   fnIn = clFileName(argc, argv);
+   if (fnIn == NULL) errorExit(progName, __LINE__,
+      "command-line arguments: [-t(hreads)=n] [-h(istogram)=legs.csv] w1904711.ptb\n");
 
-/* let's hope the peddler does not end up exactly at the antipodes... */
-   arcStartEnd = arcLegLength(startUs8, xLocUs8);
-   gdsStartEnd = geodesicLegLength(startUs8, xLocUs8);
+   statsPhase("load");
+   iErr = p8bMapOpen(&inMap, fnIn);                        /* Open input file */
+   if (iErr) errorExit(progName, __LINE__,
+                "Can't read [%s]: %s\n", fnIn, fileMapErrStr(iErr));
+   if (inMap.nPts == 0) errorExit(progName, __LINE__,
+                                     "No locations in [%s]?\n", fnIn);
 
-   printf("Itinerary from: %s, legs: %d\n", argv[1], n);
+   statsPhase("legs");
+   iErr = itinLegsUs8(inMap.pts, (int)inMap.nPts, nThreads, &st);
+   if (iErr) errorExit(progName, __LINE__, "Leg lengths failed (%d)\n", iErr);
+   fileMapClose(&inMap);
+   statsAdd("legs", st.nLegs);
+
+   statsPhase("report");
+   printf("Itinerary from: %s, legs: %d\n", fnIn, st.nLegs);
    printf("\"Open\" itinerary distances (meters, nautical miles):\n");
    printf("Spherical Earth (radius %10.3f meters):\n", NEMO_EARTH_RADIUS);
-   printf("   minumum leg: %18.3f, %12.3f\n", arcMin, METERS2NM * arcMin);
-   printf("   maximum leg: %18.3f, %12.3f\n", arcMax, METERS2NM * arcMax);
-   printf("   total:       %18.3f, %12.3f\n", arcTotal, METERS2NM * arcTotal);
-   printf("  (return home: %18.3f, %12.3f)\n", arcStartEnd, METERS2NM * arcStartEnd);
+   printf("   minumum leg: %18.3f, %12.3f\n", st.arcMin, METERS2NM * st.arcMin);
+   printf("   maximum leg: %18.3f, %12.3f\n", st.arcMax, METERS2NM * st.arcMax);
+   printf("   total:       %18.3f, %12.3f\n", st.arcTotal, METERS2NM * st.arcTotal);
+   printf("  (return home: %18.3f, %12.3f)\n", st.arcStartEnd, METERS2NM * st.arcStartEnd);
    printf("WGS84 Ellipsoid Earth:\n");
-   printf("   minumum leg: %18.3f, %12.3f\n", gdsMin, METERS2NM * gdsMin);
-   printf("   maximum leg: %18.3f, %12.3f\n", gdsMax, METERS2NM * gdsMax);
-   printf("   total:       %18.3f, %12.3f\n", gdsTotal, METERS2NM * gdsTotal);
-   printf("  (return home: %18.3f, %12.3f)\n", gdsStartEnd, METERS2NM * gdsStartEnd);
+   printf("   minumum leg: %18.3f, %12.3f\n", st.gdsMin, METERS2NM * st.gdsMin);
+   printf("   maximum leg: %18.3f, %12.3f\n", st.gdsMax, METERS2NM * st.gdsMax);
+   printf("   total:       %18.3f, %12.3f\n", st.gdsTotal, METERS2NM * st.gdsTotal);
+   printf("  (return home: %18.3f, %12.3f)\n", st.gdsStartEnd, METERS2NM * st.gdsStartEnd);
    printf("(For \"circular\" itinerary, add return leg to total. Et Bon Voyage!)\n");
 
+   if (fnHisto) {                    /* legs by geodesic length, as .csv */
+      histoFp = fopen(fnHisto, "w");
+      if (histoFp == NULL) errorExit(progName, __LINE__,
+                                     "Can't open [%s] for writing\n", fnHisto);
+      fprintf(histoFp, "fromMeters,toMeters,legs\n");
+      for (i = 0; i < ITIN_HISTO_BINS; i++) {
+         fprintf(histoFp, "%.0f,%.0f,%d\n", itinHistoFrom(i),
+                          itinHistoFrom(i + 1), st.histo[i]);
+         }
+      fclose(histoFp);
+      }
+
+   statsReport();
    return(0);
    }
 /* ========================================================================== */
-double arcLegLength(nemoPtUs8 locA, nemoPtUs8 locB) {
-   nemoPtNcs ptNcsA, ptNcsB;
-   nemo_Us8ToNcs(locA, &ptNcsA);
-   nemo_Us8ToNcs(locB, &ptNcsB);
-   return(NEMO_EARTH_RADIUS * nemo_ArcV3(ptNcsA.dc, ptNcsB.dc));
-   }
-/* ========================================================================== */
-double geodesicLegLength(nemoPtUs8 locA, nemoPtUs8 locB) {
-   int nIter;
-   double gds;
-   nemoPtNcs ptNcsA, ptNcsB;
-   nemoPtEnr ptEnrA, ptEnrB;
-   nemo_Us8ToNcs(locA, &ptNcsA);
-   nemo_Us8ToNcs(locB, &ptNcsB);
-   nemo_NcsToEnr(nemo_ElrWgs84(), &ptNcsA, &ptEnrA);
-   nemo_NcsToEnr(nemo_ElrWgs84(), &ptNcsB, &ptEnrB);
-   gds = nemo_GeodesicSzpila(nemo_ElrWgs84(), &ptEnrA, &ptEnrB, &nIter);
-   return(gds);
-   }
-/* ========================================================================== */
 #include "../scullions/errorExit.c"
 #include "../scullions/nemoStrings.c"
+#include "../scullions/clFileOpt.c"
+#include "../scullions/fileMap.c"
+#include "../scullions/nemoStats.c"
+#include "../scullions/itinLegs.c"
 /* ========================================================================== */
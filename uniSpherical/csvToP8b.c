@@ -6,32 +6,84 @@
    For instance:
 
    csvToP8b w1904711.csv w1904711.p8b
+
+   The file is read once (memory mapped, see scullions/fileMap), and split
+   into chunks of whole lines. The φ, λ fields are parsed in place, with no
+   line length limit and independent of the locale (scullions/csvParse);
+   lines without two valid numbers in the φ, λ columns are counted and
+   skipped. By default, φ and λ are in the first two columns; -c(olumns)=2,3
+   selects, for instance, the 2nd and 3rd (the w1904711 csv starts with a
+   line number), and -d(elimiter)=; changes the delimiter from comma.
+
+   The sort is a radix sort (scullions/us8Sort); with the -t(hreads)=n
+   option, the chunks are converted, and the points sorted, by n threads.
+   The output does not depend on it. Duplicate locations are dropped (and
+   counted). With -stats=text (or json, file.json), the time taken to
+   parse, sort and write is reported (scullions/nemoStats).
+
+   With the -m(emory)=MB option, no more than about that many megabytes are
+   used for the points: if there are more of them, the input is taken in
+   sections of lines, and the points of each sorted into a "run" written to
+   a temporary file (the output file name with .run0000, .run0001 ...
+   appended) while the next section is parsed. The runs are then merged
+   into the output, and removed (scullions/extSort). Without -m, all the
+   points are sorted in memory, and the output is the same either way.
  */
 
 #define PGM_DSCR "From .csv (φ, λ) create (Us8 format) .p8b file"
-#define PGM_LAST_EDIT_DATE "2025.085"
+#define PGM_LAST_EDIT_DATE "2026.287"
 
 #include <stdio.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include <nemo.h>
 #include "../scullions/scullions.h" /* include after nemo.h has been included */
+#include "../scullions/nemoStats.h"
+#include "../scullions/fileMap.h"
+#include "../scullions/csvParse.h"
+#include "../scullions/us8Sort.h"
+#include "../scullions/extSort.h"
+
+#define CHUNKS_PER_THREAD  8        /* chunks of input lines, per thread */
+#define RUN_BUFFERS        3   /* per run point: its own, the one being...
+                                  ...written, and the sort's work array */
+
+struct csvChunk {                        /* a chunk of whole input lines */
+   const char *lo, *hi;                        /* its text, [lo, hi) */
+   nemoPtUs8 *pts;                         /* converted points, in order */
+   size_t nPts;                     /* (size_t: a chunk can be the whole file) */
+   long nBad;                   /* lines without two valid φ, λ numbers */
+   };
 
-static int compU640(const void *, const void *);
-#define LINE_MAX      256
+struct csvPool {                        /* chunks shared by all the threads */
+   int nChunks;
+   atomic_int nextChunk;                           /* next one to be taken */
+   struct csvChunk *chunks;
+   };
+
+static size_t parseSection(const char *, const char *, int, nemoPtUs8 **, long *);
+static const char *sectionEnd(const char *, const char *, size_t);
+static void parseChunk(struct csvChunk *);
+static void *parseWorker(void *);
 
+static int colLat, colLng;                /* φ, λ column indices, from 0 */
+static char delim;                                      /* field delimiter */
 static const char *progName;    /* for error logging by this source file only */
 /* ========================================================================== */
 int main (int argc,
           const char *argv[],
           const char *envr[]) {
-   int n;
-   int lCount;
-   char textLine[LINE_MAX + 2];
-   char *lineRead;
-   char *token;
-   nemoPtUs8 *locations;
-   nemoPtEll locEll;
-   nemoPtNcs locNcs;
-   FILE *inFp;                                                  /* input .csv */
+   int iErr, iRun;
+   int nThreads;                           /* number of worker threads, or 0 */
+   long nBad, nIn;                    /* lines skipped, points parsed */
+   size_t n, nOut, nDups;
+   size_t memMB, runCap;                 /* -m: budget, points per run */
+   const char *optKey, *optVal;            /* options, in -keyword=value form */
+   const char *fnIn, *fnOut;                  /* as given on the command line */
+   const char *p, *q, *end;
+   fileMap inMap;                                    /* input .csv, mapped */
+   nemoPtUs8 *runPts[2];             /* section points, and previous run */
+   extSort ext;                                /* sorted runs, in files */
    FILE *outFp;                                     /* output "canonical" ptb */
 /* -------------------------------------------------------------------------- */
    progName = strrchr(argv[0], '/');                                 /* POSIX */
@@ -40,62 +92,267 @@ int main (int argc,
    else progName += 1;                        /* strip leading path separator */
    fprintf(stderr, "\n[%s]: %s\nsource as of: %s, Nemo Library: %.3f\n",
                    progName, PGM_DSCR, PGM_LAST_EDIT_DATE, NEMO_LIBRARY_DATE);
+   if (statsInit(progName, &argc, argv)) errorExit(progName, __LINE__,
+                "-stats=text, -stats=json or -stats=file.json, please\n");
 
-   if (argc < 3) errorExit(progName, __LINE__,
-                 "usage: %s xyz.csv xyzCnc.ptb\n", progName);
+   nThreads = 0;                               /* default: single-threaded */
+   memMB = 0;                                      /* default: no budget */
+   colLat = 0;
+   colLng = 1;
+   delim = ',';
+   while ((optKey = clOption(argc, argv, &optVal))) {
+      if (*optKey == 't') nThreads = atoi(optVal);
+      else if (*optKey == 'm') {
+         memMB = (size_t)strtoul(optVal, NULL, 10);
+         if (memMB == 0) errorExit(progName, __LINE__,
+                                   "invalid memory budget [%s]\n", optVal);
+         }
+      else if (*optKey == 'c') {
+         if ((sscanf(optVal, "%d,%d", &colLat, &colLng) != 2) ||
+             (colLat < 1) || (colLng < 1) || (colLat == colLng))
+            errorExit(progName, __LINE__, "invalid columns [%s]\n", optVal);
+         colLat--;
+         colLng--;
+         }
+      else if (*optKey == 'd') {
+         if ((optVal[0] == '\0') || (optVal[1] != '\0') || (optVal[0] == '.'))
+            errorExit(progName, __LINE__, "invalid delimiter [%s]\n", optVal);
+         delim = optVal[0];
+         }
+      else errorExit(progName, __LINE__, "unrecognized option [%s]\n", optKey);
+      }
+   if ((nThreads < 0) || (nThreads > US8_SORT_MAX_THREADS))
+      errorExit(progName, __LINE__, "invalid thread count %d\n", nThreads);
+   if (nThreads == 1) nThreads = 0;          /* one worker is no worker */
+   fnIn = clFileName(argc, argv);
+   fnOut = clFileName(argc, argv);
+   if (fnOut == NULL) errorExit(progName, __LINE__,
+                 "usage: %s [-t(hreads)=n] [-c(olumns)=φ,λ] [-d(elimiter)=c]"
+                 " [-m(emory)=MB] xyz.csv xyzCnc.ptb\n", progName);
 
-   inFp = fopen(argv[1], "rt");                        /* Open input file */
-   if (inFp == NULL) errorExit(progName, __LINE__,
-                                  "Can't open [%s] for reading\n", argv[1]);
+   iErr = fileMapOpen(&inMap, fnIn);              /* Open (map) input file */
+   if (iErr) errorExit(progName, __LINE__,
+                       "Can't read [%s]: %s\n", fnIn, fileMapErrStr(iErr));
+   fprintf(stderr, "in .csv bytes %lu, columns φ:%d λ:%d\n",
+                   (unsigned long)inMap.nBytes, colLat + 1, colLng + 1);
+   outFp = fopen(fnOut, "wb");                        /* Open output file */
+   if (outFp == NULL) errorExit(progName, __LINE__,
+                                  "Can't open [%s] for writing\n", fnOut);
+   if (extSortInit(&ext, fnOut)) errorExit(progName, __LINE__,
+                                     "Output name [%s] too long\n", fnOut);
 
-   lineRead = fgets(textLine, LINE_MAX, inFp);
-   lCount = 0;                                                 /* count lines */
-   while (lineRead) {
-/*    if (lCount < 10) fprintf(stderr, "%d:%s", lCount, textLine); */
-      lCount++;
-      lineRead = fgets(textLine, LINE_MAX, inFp);
-      }
-   rewind(inFp);
-   fprintf(stderr, "in .csv lines %d\n", lCount);
-
-   locations = malloc(lCount * sizeof(nemoPtUs8));
-   if (locations == NULL) errorExit(progName, __LINE__, "No memory?\n");
-
-   for (n = 0; n < lCount; n++) {
-      fgets(textLine, LINE_MAX, inFp);
-      token = strtok(textLine, ",");
-/*    token = strtok(NULL, ",\n"); */  /* w1904711 csv includes line number!? */
-      locEll.a[0] = NEMO_DEG2RAD * atof(token);
-      token = strtok(NULL, ",\n");
-      locEll.a[1] = NEMO_DEG2RAD * atof(token);
-      nemo_EllToNcs(nemo_ElrWgs84(), &locEll, &locNcs);
-      locations[n] = nemo_NcsToUs8(&locNcs);
-/*    fprintf(stderr, "%s\n", nemo_StrU64Coords(locations[n])); */
-      }
-   fclose(inFp);
+/* Take the text a section (of at most runCap lines) at a time, parse it
+   into the points of a run, and sort them. If it is all in one section (no
+   -m, or the points fit), the sorted points are the output */
+   runCap = memMB ? (memMB << 20) / (RUN_BUFFERS * sizeof(nemoPtUs8)) : 0;
+   if (memMB && (runCap < 1024)) errorExit(progName, __LINE__,
+                                  "memory budget too small (%dMB)\n", (int)memMB);
+   runPts[0] = runPts[1] = NULL;
+   p = (const char *)inMap.bytes;
+   end = p + inMap.nBytes;
+   nIn = nBad = 0;
+   iRun = 0;
+   nOut = nDups = 0;
+   do {
+      statsPhase("parse");
+      q = runCap ? sectionEnd(p, end, runCap) : end;
+      if (runCap && (runPts[iRun] == NULL)) {     /* a point per line, max. */
+         runPts[iRun] = malloc(runCap * sizeof(nemoPtUs8));
+         if (runPts[iRun] == NULL) errorExit(progName, __LINE__, "No memory?\n");
+         }
+      n = parseSection(p, q, nThreads, runPts + iRun, &nBad);
+      nIn += (long)n;
+      p = q;
 
-   fprintf(stderr, "Sort start...");
-   qsort(locations, lCount, sizeof(nemoPtUs8), compU640);
-   fprintf(stderr, " ...end\n");
+      statsPhase("sort");
+      iErr = us8Sort(runPts[iRun], n, nThreads);
+      if (iErr) errorExit(progName, __LINE__, "Sort failed (%d)\n", iErr);
+      nOut = us8Unique(runPts[iRun], n);
+      nDups += n - nOut;
+      if ((ext.nRuns == 0) && (p == end)) {              /* all of them */
+         statsPhase("write");
+         if (fwrite(runPts[iRun], sizeof(nemoPtUs8), nOut, outFp) != nOut)
+            errorExit(progName, __LINE__, "Error in writing [%s]\n", fnOut);
+         break;
+         }
+      statsPhase("runs");          /* written, while the next one is made */
+      iErr = extSortRun(&ext, runPts[iRun], nOut);
+      if (iErr == EXT_SORT_RUNS) errorExit(progName, __LINE__,
+                 "More than %d runs: a larger -m, please\n", EXT_SORT_MAX_RUNS);
+      if (iErr) errorExit(progName, __LINE__, "Can't write run %d of [%s] (%d)\n",
+                          ext.nRuns, fnOut, iErr);
+      iRun = 1 - iRun;
+      } while (p < end);
+   fileMapClose(&inMap);
+   fprintf(stderr, "in .csv points %ld, lines skipped %ld\n", nIn, nBad);
+   statsAdd("points", nIn);
+   statsAdd("linesSkipped", nBad);
 
-   outFp = fopen(argv[2], "wb");                        /* Open input file */
-   if (outFp == NULL) errorExit(progName, __LINE__,
-                                  "Can't open [%s] for reading\n", argv[2]);
-   fwrite(locations, sizeof(nemoPtUs8), lCount, outFp);
-   fclose(outFp);
-   free(locations);
-   fprintf(stderr, "%s done, locations:  %d\n", progName, n);
+   if (ext.nRuns) {                        /* merge the runs, if there are */
+      statsPhase("merge");
+      fprintf(stderr, "sorted runs: %d, merge...", ext.nRuns);
+      free(runPts[iRun]);       /* not the last one's: it is being written */
+      runPts[iRun] = NULL;
+      iErr = extSortMerge(&ext, outFp, (memMB << 20) / sizeof(nemoPtUs8) /
+                          (RUN_BUFFERS * (ext.nRuns + 2)), &nOut, &n);
+      if (iErr) errorExit(progName, __LINE__, "Merge failed (%d)\n", iErr);
+      nDups += n;
+      fprintf(stderr, " ...end\n");
+      statsAdd("runs", ext.nRuns);
+      extSortFree(&ext);
+      }
+   if (fclose(outFp)) errorExit(progName, __LINE__,
+                                "Error in writing [%s]\n", fnOut);
+   free(runPts[0]);
+   free(runPts[1]);
+   fprintf(stderr, "duplicates dropped: %ld\n", (long)nDups);
+   statsAdd("duplicates", (long)nDups);
+   fprintf(stderr, "%s done, locations:  %ld\n", progName, (long)nOut);
 
+   statsReport();
    return(0);
    }
 /* ========================================================================== */
-/* compare two blocks of memory starting with a 64-bit unsigned integer       */
-static int compU640(const void *p1, const void *p2) {
-   if (*(uint64_t *)p1 > *(uint64_t *)p2) return(1);
-   if (*(uint64_t *)p1 < *(uint64_t *)p2) return(-1);
-   return(0);
-   };
+/* Parse the lines of [lo, hi) into *pts - room for a point per line or, if
+   NULL, allocated here for the points there are - in chunks of about the
+   same size, by nThreads threads (or 0); the points are in the input order.
+   Returns their number; lines skipped are added to *nBad.
+ */
+static size_t parseSection(const char *lo,                 /* the text */
+                           const char *hi,
+                           int nThreads,       /* worker threads, or 0 */
+                           nemoPtUs8 **pts,                  /* points */
+                           long *nBad) {                /* lines skipped */
+   int i;
+   size_t n;
+   const char *p;
+   pthread_t threads[US8_SORT_MAX_THREADS];
+   struct csvPool pool;
+   struct csvChunk *chunk;
+/* -------------------------------------------------------------------------- */
+/* Split the text into chunks of whole lines, of about the same size */
+   pool.nChunks = nThreads ? CHUNKS_PER_THREAD * nThreads : 1;
+   pool.chunks = calloc(pool.nChunks, sizeof(struct csvChunk));
+   if (pool.chunks == NULL) errorExit(progName, __LINE__, "No memory?\n");
+   p = lo;
+   for (i = 0; i < pool.nChunks; i++) {
+      pool.chunks[i].lo = p;
+      if (i == pool.nChunks - 1) p = hi;
+      else {
+         p = lo + (size_t)(hi - lo) * (i + 1) / pool.nChunks;
+         if (p < pool.chunks[i].lo) p = pool.chunks[i].lo;
+         if (p > lo) p = csvLineEnd(p - 1, hi);
+         if (p < hi) p++;                           /* just past the '\n' */
+         }
+      pool.chunks[i].hi = p;
+      }
+
+/* Parse and convert, the chunks in any order... */
+   atomic_init(&pool.nextChunk, 0);
+   if (nThreads) {
+      for (i = 0; i < nThreads; i++) {
+         if (pthread_create(threads + i, NULL, parseWorker, &pool))
+            errorExit(progName, __LINE__, "Can't create thread %d\n", i);
+         }
+      for (i = 0; i < nThreads; i++) pthread_join(threads[i], NULL);
+      }
+   else parseWorker(&pool);
+
+/* ...and gather the points in input order */
+   n = 0;
+   for (i = 0; i < pool.nChunks; i++) {
+      if (pool.chunks[i].pts == NULL) errorExit(progName, __LINE__, "No memory?\n");
+      n += pool.chunks[i].nPts;
+      }
+   if (*pts == NULL) *pts = malloc((n ? n : 1) * sizeof(nemoPtUs8));
+   if (*pts == NULL) errorExit(progName, __LINE__, "No memory?\n");
+   n = 0;
+   for (i = 0; i < pool.nChunks; i++) {
+      chunk = pool.chunks + i;
+      memcpy(*pts + n, chunk->pts, chunk->nPts * sizeof(nemoPtUs8));
+      n += chunk->nPts;
+      *nBad += chunk->nBad;
+      free(chunk->pts);
+      }
+   free(pool.chunks);
+   return(n);
+   }
+/* ========================================================================== */
+/* The end of the section of at most maxLines lines from p: just past the
+   '\n' of the last one, or end.
+ */
+static const char *sectionEnd(const char *p, const char *end, size_t maxLines) {
+   size_t k;
+/* -------------------------------------------------------------------------- */
+   for (k = 0; (k < maxLines) && (p < end); k++) {
+      p = memchr(p, '\n', end - p);
+      if (p == NULL) return(end);
+      p++;
+      }
+   return(p);
+   }
+/* ========================================================================== */
+/* Worker thread (or the main one, if single-threaded): take chunks of lines
+   until there are none left.
+ */
+static void *parseWorker(void *arg) {
+   struct csvPool *pool = arg;
+   int nc;
+/* -------------------------------------------------------------------------- */
+   while ((nc = atomic_fetch_add(&pool->nextChunk, 1)) < pool->nChunks)
+      parseChunk(pool->chunks + nc);
+   return(NULL);
+   }
+/* ========================================================================== */
+/* Parse the φ, λ columns of the lines in a chunk, and convert them to Us8.
+   Blank lines are ignored; lines without valid numbers in both columns are
+   counted in chunk->nBad. (chunk->pts is NULL if there was no memory).
+ */
+static void parseChunk(struct csvChunk *chunk) {
+   int col, isBad;
+   size_t nCap;
+   const char *p, *q, *eol;
+   double v[2];                                       /* φ, λ, in degrees */
+   nemoPtEll locEll;
+   nemoPtNcs locNcs;
+/* -------------------------------------------------------------------------- */
+   nCap = 1;                              /* at most one point per line... */
+   for (p = chunk->lo; p < chunk->hi; p = eol + 1) {
+      eol = csvLineEnd(p, chunk->hi);
+      nCap++;
+      }
+   chunk->pts = malloc(nCap * sizeof(nemoPtUs8));
+   if (chunk->pts == NULL) return;
+   for (p = chunk->lo; p < chunk->hi; p = eol + 1) {
+      eol = csvLineEnd(p, chunk->hi);
+      for (q = p; (q < eol) && CSV_IS_BLANK(*q); q++);
+      if (q == eol) continue;                                /* blank line */
+      isBad = 2;                               /* two numbers are missing */
+      for (col = 0, q = p; q && (isBad > 0); col++, q = csvNextField(q, eol, delim)) {
+         if ((col != colLat) && (col != colLng)) continue;
+         q = csvParseDouble(q, eol, v + (col == colLng));
+         if ((q == NULL) || ((q < eol) && (*q != delim))) break; /* not a number */
+         isBad--;
+         }
+      if (isBad) {
+         chunk->nBad++;
+         continue;
+         }
+      locEll.a[0] = NEMO_DEG2RAD * v[0];
+      locEll.a[1] = NEMO_DEG2RAD * v[1];
+      nemo_EllToNcs(nemo_ElrWgs84(), &locEll, &locNcs);
+      chunk->pts[chunk->nPts++] = nemo_NcsToUs8(&locNcs);
+/*    fprintf(stderr, "%s\n", nemo_StrU64Coords(chunk->pts[chunk->nPts - 1])); */
+      }
+   return;
+   }
 /* ========================================================================== */
 #include "../scullions/errorExit.c"
 #include "../scullions/nemoStrings.c"
+#include "../scullions/clFileOpt.c"
+#include "../scullions/fileMap.c"
+#include "../scullions/csvParse.c"
+#include "../scullions/us8Sort.c"
+#include "../scullions/extSort.c"
+#include "../scullions/nemoStats.c"
 /* ========================================================================== */
@@ -0,0 +1,199 @@
+/* improveP8b.c: Improve an itinerary of locations - a .p8b file (array of
+   Us8 point locations) in itinerary order, for instance one created by the
+   nearNextP8bWindow program - by local search: 2-opt moves (reversal of a
+   section of the itinerary) and Or-opt moves (a section of one, two or three
+   locations is moved elsewhere in the itinerary, possibly reversed).
+
+   The itinerary is "open", as in bonVoyageP8b report: it starts at the first
+   location of the input file (which remains first) and ends wherever the
+   search leaves it. Leg lengths are arcs on the near-conformal sphere.
+
+   Candidate moves are restricted to the k nearest neighbours of each
+   location, found with a k-d tree spatial index (see scullions/ncsKdTree.c).
+   The locations are processed from a queue; a location is queued again only
+   when one of its legs has been changed ("don't look bits"). The search
+   ends when no move improves the itinerary, or when the time or number of
+   moves budget is exhausted. To keep each move at a bounded cost, sections
+   longer than ITIN_MAX_SHIFT locations are not reversed or moved across.
+   (The search is that of scullions/itinEngine, also used after the
+   construction of the itinerary by the "nearNextP8bWindow -i" command.)
+
+   First command line argument is the input itinerary, the second is the
+   (improved) output itinerary; for instance:
+
+   improveP8b w1904711Itin_kdt.p8b w1904711Itin_opt.p8b -seconds=60
+
+   The itinerary lengths, before and after, are reported the same way as by
+   bonVoyageP8b: as nautical miles on the spherical and WGS84 ellipsoid Earth.
+   With -stats=text (or json, file.json), the phase times and move counts are
+   reported too (see scullions/nemoStats).
+ */
+
+#define PGM_DSCR "Itinerary (.p8b) improvement by 2-opt and Or-opt moves"
+#define PGM_LAST_EDIT_DATE "2026.287"
+#include <stdio.h>
+#include <time.h>
+
+#include <nemo.h>
+#include "../scullions/scullions.h" /* include after nemo.h has been included */
+#include "../scullions/nemoStats.h"
+#include "../scullions/fileMap.h"
+#include "../scullions/ncsKdTree.h"
+#include "../scullions/chordSqBatch.h"
+#include "../scullions/us8Batch.h"
+#include "../scullions/us8Sort.h"
+#include "../scullions/itinEngine.h"
+#include "../scullions/itinLegs.h"
+
+#define METERS2NM          0.0005399568
+#define DEFAULT_NEIGHBOURS    8
+#define DEFAULT_SECONDS     600
+
+void usage(const char *, const char *);
+static void itinReport(const char *, const nemoPtUs8 *);
+
+static int lcnCnt;                                      /* number of locations */
+static const char *progName;    /* for error logging by this source file only */
+/* ========================================================================== */
+int main (int argc,
+          const char *argv[],
+          const char *envr[]) {
+
+   int n, iErr;
+   const char *optKey, *optVal;            /* options, in -keyword=value form */
+   const char *fnIn, *fnOut;                  /* as given on the command line */
+   fileMap inMap;                  /* input binary file, location coordinates */
+   nemoPtUs8 *lcnUs8;                           /* locations, as in input... */
+   nemoPtUs8 *outUs8;                       /* ...and in improved itinerary */
+   ncsSoa lcnSoa;                 /* location coordinates, NCS, decoded once */
+   int *tour;                          /* location at each itinerary position */
+   itinPlan plan;                      /* budget: moves (0: no limit), time */
+   FILE *outFp;
+   double wallStart;
+/* -------------------------------------------------------------------------- */
+   progName = strrchr(argv[0], '/');                                 /* POSIX */
+   if (progName == NULL) progName = strrchr(argv[0], '\\');         /* MS Win */
+   if (progName == NULL) progName = argv[0];                      /* neither? */
+   else progName += 1;                        /* strip leading path separator */
+   fprintf(stderr, "\n[%s]: %s\nsource as of: %s, Nemo Library: %.3f\n",
+                   progName, PGM_DSCR, PGM_LAST_EDIT_DATE, NEMO_LIBRARY_DATE);
+   if (statsInit(progName, &argc, argv)) usage("invalid option", "-stats");
+
+   memset(&plan, 0, sizeof(plan));
+   plan.nNbrs = DEFAULT_NEIGHBOURS;
+   plan.maxSeconds = DEFAULT_SECONDS;
+   plan.isVerbose = 1;
+   while ((optKey = clOption(argc, argv, &optVal))) {
+      if (*optKey == 'h') usage(NULL, NULL);
+      else if (*optKey == 'k') plan.nNbrs = atoi(optVal);
+      else if (*optKey == 's') plan.maxSeconds = strtod(optVal, NULL);
+      else if (*optKey == 'm') plan.maxMoves = atoi(optVal);
+      else usage("unrecognized option", optKey);
+      }
+   if ((plan.nNbrs < 1) || (plan.nNbrs > KDT_MAX_SEP - 1)) usage("invalid option",
+                                                   "neighbours (0 < k < 16)");
+   if ((plan.maxSeconds <= 0.0) || (plan.maxMoves < 0)) usage("invalid option",
+                                                              "budget");
+
+   fnIn = clFileName(argc, argv);
+   if (fnIn == NULL) usage("Missing input file name", NULL);
+   fnOut = clFileName(argc, argv);
+   if (fnOut == NULL) usage("Missing output file name", NULL);
+   statsPhase("load");
+   iErr = p8bMapOpen(&inMap, fnIn);              /* Open input itinerary file */
+   if (iErr) errorExit(progName, __LINE__,
+        "Can't read [%s] locations: %s\n", fnIn, fileMapErrStr(iErr));
+   lcnCnt = (int)inMap.nPts;
+   if (lcnCnt < 4) errorExit(progName, __LINE__,
+                             "Not enough locations in [%s]?\n", fnIn);
+   fprintf(stderr, "Input itinerary: %s, %d locations\n", fnIn, lcnCnt);
+   fprintf(stderr, "Neighbours: %d, budget: %.0f seconds, %d moves\n",
+                   plan.nNbrs, plan.maxSeconds, plan.maxMoves);
+
+   lcnUs8 = malloc(lcnCnt * sizeof(nemoPtUs8));
+   outUs8 = malloc(lcnCnt * sizeof(nemoPtUs8));
+   tour = malloc(lcnCnt * sizeof(int));
+   if ((lcnUs8 == NULL) || (outUs8 == NULL) || (tour == NULL) ||
+       ncsSoaAlloc(&lcnSoa, lcnCnt))
+      errorExit(progName, __LINE__, "No memory for locations?\n");
+   memcpy(lcnUs8, inMap.pts, lcnCnt * sizeof(nemoPtUs8));
+   fileMapClose(&inMap);
+   itinReport("Input", lcnUs8);
+
+   statsPhase("improvement");
+   wallStart = statsWall();
+   us8ToSoa(lcnUs8, lcnCnt, &lcnSoa, 0);
+   for (n = 0; n < lcnCnt; n++) tour[n] = n;  /* input order is the itinerary */
+   iErr = itinImprove(&lcnSoa, lcnCnt, &plan, tour);
+   if (iErr) errorExit(progName, __LINE__, "No memory for spatial index?\n");
+   fprintf(stderr, "Neighbour lists: %6.3f seconds\n", plan.nbrSeconds);
+   fprintf(stderr, "Moves applied, 2-opt: %d, Or-opt: %d (%s)\n", plan.n2opt,
+           plan.nOrOpt, plan.isOptimum ? "local optimum" : "budget exhausted");
+   fprintf(stderr, "Itinerary improvement: %6.3f seconds\n", statsWall() - wallStart);
+
+   statsAdd("moves2opt", plan.n2opt);
+   statsAdd("movesOrOpt", plan.nOrOpt);
+   statsAdd("locationsPopped", plan.nPopped);
+
+   statsPhase("write");
+   for (n = 0; n < lcnCnt; n++) outUs8[n] = lcnUs8[tour[n]];
+   outFp = fopen(fnOut, "wb");
+   if (outFp == NULL) errorExit(progName, __LINE__,
+                                "Can't open [%s] for writing\n", fnOut);
+   n = fwrite(outUs8, sizeof(nemoPtUs8), lcnCnt, outFp);
+   if (n != lcnCnt) errorExit(progName, __LINE__,
+                        "Error in writing itinerary (record:%d)\n", n);
+   fclose(outFp);
+   itinReport("Improved", outUs8);
+
+   free(lcnUs8);
+   free(outUs8);
+   free(tour);
+   ncsSoaFree(&lcnSoa);
+   statsReport();
+   return(0);
+   }
+/* ========================================================================== */
+void usage(const char *mA,                  /* first message string (or NULL) */
+           const char *mB) {               /* second message string (or NULL) */
+   if (mA || mB) fprintf (stderr, "Error: %s %s\n", mA ? mA : "\0", mB ? mB : "\0");
+   fprintf (stderr, "Usage: %s [options] inFile outFile\n", progName);
+   fprintf (stderr, "  inFile:  .p8b itinerary input file\n");
+   fprintf (stderr, "  outFile: .p8b improved itinerary output file\n");
+   fprintf (stderr, "Options:\n");
+   fprintf (stderr, " -h(elp)        to print this usage help and exit\n");
+   fprintf (stderr, " -k=n           neighbours per location (default: %d)\n",
+                    DEFAULT_NEIGHBOURS);
+   fprintf (stderr, " -s(econds)=n   time budget (default: %d)\n", DEFAULT_SECONDS);
+   fprintf (stderr, " -m(oves)=n     moves budget (default: no limit)\n");
+   fprintf (stderr, " -stats=text|json|file.json  phases and counters report\n");
+   exit(1);
+   }
+/* ========================================================================== */
+/* Report itinerary length, as does bonVoyageP8b: total of the "open"
+   itinerary legs, on spherical and on ellipsoidal Earth.
+ */
+static void itinReport(const char *title, const nemoPtUs8 *itin) {
+   int iErr;
+   itinStats st;
+/* -------------------------------------------------------------------------- */
+   iErr = itinLegsUs8(itin, lcnCnt, 0, &st);
+   if (iErr) errorExit(progName, __LINE__, "Leg lengths failed (%d)\n", iErr);
+   printf("%s itinerary, legs: %d (meters, nautical miles):\n", title, st.nLegs);
+   printf("   spherical Earth: %18.3f, %12.3f\n", st.arcTotal, METERS2NM * st.arcTotal);
+   printf("   WGS84 Ellipsoid: %18.3f, %12.3f\n", st.gdsTotal, METERS2NM * st.gdsTotal);
+   return;
+   }
+/* ========================================================================== */
+#include "../scullions/errorExit.c"
+#include "../scullions/nemoStrings.c"
+#include "../scullions/clFileOpt.c"
+#include "../scullions/fileMap.c"
+#include "../scullions/ncsKdTree.c"
+#include "../scullions/chordSqBatch.c"
+#include "../scullions/us8Batch.c"
+#include "../scullions/us8Sort.c"
+#include "../scullions/nemoStats.c"
+#include "../scullions/itinEngine.c"
+#include "../scullions/itinLegs.c"
+/* ========================================================================== */
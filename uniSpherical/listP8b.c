@@ -19,27 +19,53 @@ Commonly run as:
    is endianness specific. By convention, binary coordinate filec in mixed
    hardware environments should be assumed to be of little-Endian variety.
 
-   Output should be redirected if further processing is anticipated.
+   The file is checked before anything is listed; the lines are then
+   formatted in chunks (scullions/textOut), by -t(hreads)=n threads, and
+   written in large blocks, the coordinates of each chunk decoded in one
+   batch (scullions/us8Batch). With the -b(inary) option, the output is its
+   binary equivalent: for each location φ and λ (decimal degrees) as two
+   doubles, and the Us8 number, 8 bytes each, little-endian (as the binary
+   coordinate files are, by the convention above).
+
+   Output should be redirected if further processing is anticipated. The
+   -stats=text (or json, file.json) option reports the time it all took.
  */
 
 #define PGM_DSCR "List coordinates in .p8b file"
-#define PGM_LAST_EDIT_DATE "2025.075"
+#define PGM_LAST_EDIT_DATE "2026.287"
 #include <stdio.h>
 #include <nemo.h>
 #include "../scullions/scullions.h" /* include after nemo.h has been included */
+#include "../scullions/nemoStats.h"
+#include "../scullions/fileMap.h"
+#include "../scullions/chordSqBatch.h"
+#include "../scullions/us8Batch.h"
+#include "../scullions/asyncOut.h"
+#include "../scullions/textOut.h"
+
+#define MAX_LINE_BYTES    40                /* output line: 36, or binary 24 */
+
+struct listJob {                  /* record formatting, shared by threads */
+   const nemoPtUs8 *pts;                                 /* input records */
+   int isBinary;                        /* 1: φ, λ as doubles, and the Us8 */
+   ncsSoa soa[TEXT_OUT_MAX_THREADS];    /* per buffer: decoded, by chunk */
+   };
+
+static size_t listChunk(void *, int, int, int, char *);
 
 static const char *progName;    /* for error logging by this source file only */
 /* ========================================================================== */
 int main (int argc,
           const char *argv[],
           const char *envr[]) {
-   int k, n, m;
-   FILE *inFp;                       /* input binary file, locations to visit */
+   int i, k, n, iErr, nThreads;
+   fileMap inMap;                 /* input binary file, mapped Us8 records */
+   const char *optKey, *optVal;            /* options, in -keyword=value form */
+   const char *inFn, *strLimit;               /* as given on the command line */
    nemoPtUs8 ptUs8, prevPtUs8;
-   nemoPtEll locEll;
-   nemoPtNcs locNcs;
    int iPlate;
    int platePop[6];
+   struct listJob job;                            /* formatting by chunks */
 /* -------------------------------------------------------------------------- */
    progName = strrchr(argv[0], '/');                                 /* POSIX */
    if (progName == NULL) progName = strrchr(argv[0], '\\');         /* MS Win */
@@ -47,25 +73,38 @@ int main (int argc,
    else progName += 1;                        /* strip leading path separator */
    fprintf(stderr, "\n[%s]: %s\nsource as of: %s, Nemo Library: %.3f\n",
                    progName, PGM_DSCR, PGM_LAST_EDIT_DATE, NEMO_LIBRARY_DATE);
+   if (statsInit(progName, &argc, argv)) errorExit(progName, __LINE__,
+                "-stats=text, -stats=json or -stats=file.json, please\n");
 
-   if (argc < 2) errorExit(progName, __LINE__,
-                 "usage: %s xyzName.p8b [n]\n", progName);
+   memset(&job, 0, sizeof(job));
+   nThreads = 0;
+   while ((optKey = clOption(argc, argv, &optVal))) {
+      if (*optKey == 'b') job.isBinary = 1;
+      else if (*optKey == 't') nThreads = atoi(optVal);
+      else errorExit(progName, __LINE__, "unrecognized option [%s]\n", optKey);
+      }
+   if ((nThreads < 0) || (nThreads > TEXT_OUT_MAX_THREADS))
+      errorExit(progName, __LINE__, "invalid thread count %d\n", nThreads);
+   if (nThreads < 1) nThreads = 1;
+   inFn = clFileName(argc, argv);
+   strLimit = clFileName(argc, argv);
+   if (inFn == NULL) errorExit(progName, __LINE__,
+                 "usage: %s xyzName.p8b [n] [-b] [-t=n]\n", progName);
 
-   inFp = fopen(argv[1], "rb");                            /* Open input file */
-   if (inFp == NULL) errorExit(progName, __LINE__,
-                                "Can't open [%s] for reading\n", argv[1]);
+   iErr = p8bMapOpen(&inMap, inFn);                        /* Open input file */
+   if (iErr) errorExit(progName, __LINE__,
+                "Can't read [%s]: %s\n", inFn, fileMapErrStr(iErr));
 
-   if (argc > 2) k = atoi(argv[2]);           /* limit number of output lines */
+   if (strLimit) k = atoi(strLimit);          /* limit number of output lines */
    else k = 0;                                               /* list them all */
 
+   statsPhase("check");
    for (n = 0; n < 6; n++) platePop[n] = 0;
    prevPtUs8 = n = 0;
 
-   m = fread(&ptUs8, sizeof(nemoPtUs8), 1, inFp);
-/* fprintf(stderr, "first read: %d\n", m); */
-   while (m) {
+   while (n < (int)inMap.nPts) {
       if ((k) && (n >= k)) break;                             /* want no more */
-      nemo_Us8ToNcs(ptUs8, &locNcs);
+      ptUs8 = inMap.pts[n];
       if (ptUs8 == prevPtUs8) errorExit(progName, __LINE__,
                  "input line %d: duplicate coordinates.\n", n);
       if (ptUs8 < prevPtUs8) errorExit(progName, __LINE__,
@@ -73,15 +112,23 @@ int main (int argc,
       iPlate = (int)((ptUs8 & 0xf000000000000000) >> 60);
       if ((iPlate < 1) || (iPlate > 6)) errorExit(progName, __LINE__,
                  "input line %d: invalid digiNental plate number [%016lx].\n", n, ptUs8);
-
-      nemo_NcsToEll(nemo_ElrWgs84(), &locNcs, &locEll);
-      printf("%8.4f %9.4f %016lx\n", NEMO_RAD2DEG * locEll.a[0],
-                                     NEMO_RAD2DEG * locEll.a[1], ptUs8);
       n++;
       platePop[iPlate - 1] += 1;
-      m = fread(&ptUs8, sizeof(nemoPtUs8), 1, inFp);
+      prevPtUs8 = ptUs8;
       }
-   fclose(inFp);
+
+   statsPhase("list");
+   job.pts = inMap.pts;
+   for (i = 0; i < nThreads; i++) {                  /* decoding buffers */
+      if (ncsSoaAlloc(job.soa + i, TEXT_OUT_CHUNK)) errorExit(progName,
+          __LINE__, "No memory for decoding buffers?\n");
+      }
+   iErr = textOutRun(stdout, n, MAX_LINE_BYTES, listChunk, &job, nThreads);
+   if (iErr) errorExit(progName, __LINE__, "Output failed (%s)\n",
+                (iErr == TEXT_OUT_WRITE) ? "write error" : "memory or threads");
+   fflush(stdout);
+   for (i = 0; i < nThreads; i++) ncsSoaFree(job.soa + i);
+   fileMapClose(&inMap);
 
 /* if whole file was traversed, produce some rudimentary statistics: */
    if (k == 0) fprintf(stderr,
@@ -90,8 +137,50 @@ int main (int argc,
                 platePop[3], platePop[4], platePop[5]);
 
    fprintf(stderr, "%s done, locations total:  %d\n", progName, n);
+   statsAdd("locations", n);
+   statsReport();
    return(0);
    }
 /* ========================================================================== */
+/* Format the n records from the first one into buf, their coordinates
+   decoded in one batch into the buffer's arrays; returns the bytes written.
+ */
+static size_t listChunk(void *arg, int iBuf, int first, int n, char *buf) {
+   struct listJob *job = arg;
+   int i;
+   char *p = buf;
+   double phiLam[2];
+   nemoPtEll locEll;
+   nemoPtNcs locNcs;
+/* -------------------------------------------------------------------------- */
+   us8ToSoa(job->pts + first, n, job->soa + iBuf, 0);
+   for (i = 0; i < n; i++) {
+      NCS_SOA_GET(job->soa + iBuf, i, &locNcs);
+      nemo_NcsToEll(nemo_ElrWgs84(), &locNcs, &locEll);
+      phiLam[0] = NEMO_RAD2DEG * locEll.a[0];
+      phiLam[1] = NEMO_RAD2DEG * locEll.a[1];
+      if (job->isBinary) {
+         memcpy(p, phiLam, sizeof(phiLam));
+         memcpy(p + sizeof(phiLam), job->pts + first + i, sizeof(nemoPtUs8));
+         p += sizeof(phiLam) + sizeof(nemoPtUs8);
+         continue;
+         }
+      p = textFixed(p, phiLam[0], 8, 4);
+      *p++ = ' ';
+      p = textFixed(p, phiLam[1], 9, 4);
+      *p++ = ' ';
+      p = textHex16(p, job->pts[first + i]);
+      *p++ = '\n';
+      }
+   return((size_t)(p - buf));
+   }
+/* ========================================================================== */
 #include "../scullions/errorExit.c"
+#include "../scullions/clFileOpt.c"
+#include "../scullions/fileMap.c"
+#include "../scullions/nemoStats.c"
+#include "../scullions/chordSqBatch.c"
+#include "../scullions/us8Batch.c"
+#include "../scullions/asyncOut.c"
+#include "../scullions/textOut.c"
 /* ========================================================================== */
@@ -0,0 +1,173 @@
+/* mergeP8b.c: Merge sorted .p8b files - arrays of Us8 point locations in
+   ascending (canonical) coordinate order, as created by csvToP8b - into a
+   single sorted .p8b file, without duplicate locations. Typically, the first
+   input is a large "base" file and the others are (much smaller) "delta"
+   files with new locations, so that the base file need not be re-created
+   from the complete .csv source.
+
+   The input files are read, and the output written, sequentially, a buffer
+   of MERGE_BUF locations at a time: memory used does not depend on the size
+   of the files. At each step, the smallest of the current locations of all
+   the input files is written, unless it is the same as the last one written.
+   An input file that is found not to be in ascending order is reported, and
+   the program aborts.
+
+   Command line arguments are two or more input files followed by the output
+   file; for instance:
+
+   mergeP8b w1904711.p8b w1904711_0412.p8b w1904711_0413.p8b w1904711_new.p8b
+
+   With -stats=text (or json, file.json) the merge time and the location
+   counts are also reported, see scullions/nemoStats.
+ */
+
+#define PGM_DSCR "Merge sorted .p8b (Us8 binary format) files"
+#define PGM_LAST_EDIT_DATE "2026.287"
+#include <stdio.h>
+
+#include <nemo.h>
+#include "../scullions/scullions.h" /* include after nemo.h has been included */
+#include "../scullions/nemoStats.h"
+
+#define MERGE_BUF      65536                 /* locations per buffer, each */
+#define MAX_INPUTS        64
+
+struct p8bStream {                         /* one input file, read buffered */
+   const char *fn;
+   FILE *fp;
+   nemoPtUs8 buf[MERGE_BUF];
+   int nBuf, iBuf;                        /* locations in buf, next one */
+   long nRead;                        /* locations taken from the file */
+   nemoPtUs8 cur;                                /* current location... */
+   int isLive;                                /* ...unless at end of file */
+   };
+
+static void streamNext(struct p8bStream *);
+
+static const char *progName;    /* for error logging by this source file only */
+/* ========================================================================== */
+int main (int argc,
+          const char *argv[],
+          const char *envr[]) {
+   int i, iMin, nIn, nOut;
+   long nWritten, nDups;
+   const char *fn[MAX_INPUTS + 1];            /* as given on the command line */
+   const char *fnOut;
+   struct p8bStream *in;                                     /* input files */
+   nemoPtUs8 *outBuf, last;
+   FILE *outFp;
+/* -------------------------------------------------------------------------- */
+   progName = strrchr(argv[0], '/');                                 /* POSIX */
+   if (progName == NULL) progName = strrchr(argv[0], '\\');         /* MS Win */
+   if (progName == NULL) progName = argv[0];                      /* neither? */
+   else progName += 1;                        /* strip leading path separator */
+   fprintf(stderr, "\n[%s]: %s\nsource as of: %s, Nemo Library: %.3f\n",
+                   progName, PGM_DSCR, PGM_LAST_EDIT_DATE, NEMO_LIBRARY_DATE);
+   if (statsInit(progName, &argc, argv)) errorExit(progName, __LINE__,
+                "-stats=text, -stats=json or -stats=file.json, please\n");
+
+   for (nIn = 0; nIn <= MAX_INPUTS; nIn++) {
+      fn[nIn] = clFileName(argc, argv);
+      if (fn[nIn] == NULL) break;
+      }
+   if ((nIn > MAX_INPUTS) && clFileName(argc, argv)) errorExit(progName, __LINE__,
+                               "Too many input files (max. %d)\n", MAX_INPUTS);
+   if (nIn < 3) errorExit(progName, __LINE__,
+                 "usage: %s base.p8b delta.p8b [...] merged.p8b\n", progName);
+   fnOut = fn[--nIn];
+   for (i = 0; i < nIn; i++) if (strcmp(fn[i], fnOut) == 0)
+      errorExit(progName, __LINE__, "Output [%s] is also an input?\n", fnOut);
+
+   in = calloc(nIn, sizeof(struct p8bStream));
+   outBuf = malloc(MERGE_BUF * sizeof(nemoPtUs8));
+   if ((in == NULL) || (outBuf == NULL))
+      errorExit(progName, __LINE__, "No memory for buffers?\n");
+   for (i = 0; i < nIn; i++) {
+      in[i].fn = fn[i];
+      in[i].fp = fopen(fn[i], "rb");
+      if (in[i].fp == NULL) errorExit(progName, __LINE__,
+                                      "Can't open [%s] for reading\n", fn[i]);
+      streamNext(in + i);                       /* its first location, if any */
+      }
+   outFp = fopen(fnOut, "wb");
+   if (outFp == NULL) errorExit(progName, __LINE__,
+                                "Can't open [%s] for writing\n", fnOut);
+
+   statsPhase("merge");
+   nOut = 0;
+   nWritten = nDups = 0;
+   last = 0;
+   for (;;) {
+      iMin = -1;                         /* smallest current location... */
+      for (i = 0; i < nIn; i++) {
+         if (in[i].isLive && ((iMin < 0) || (in[i].cur < in[iMin].cur))) iMin = i;
+         }
+      if (iMin < 0) break;                       /* ...none: all inputs done */
+      if ((nWritten + nOut == 0) || (in[iMin].cur != last)) {
+         last = in[iMin].cur;
+         outBuf[nOut++] = last;
+         if (nOut == MERGE_BUF) {
+            if (fwrite(outBuf, sizeof(nemoPtUs8), nOut, outFp) != (size_t)nOut)
+               errorExit(progName, __LINE__, "Error in writing [%s]\n", fnOut);
+            nWritten += nOut;
+            nOut = 0;
+            }
+         }
+      else nDups++;
+      streamNext(in + iMin);
+      }
+   if (fwrite(outBuf, sizeof(nemoPtUs8), nOut, outFp) != (size_t)nOut)
+      errorExit(progName, __LINE__, "Error in writing [%s]\n", fnOut);
+   nWritten += nOut;
+   fclose(outFp);
+
+   for (i = 0; i < nIn; i++) {
+      fprintf(stderr, "input: %s, locations: %ld\n", in[i].fn, in[i].nRead);
+      fclose(in[i].fp);
+      }
+   fprintf(stderr, "duplicates dropped: %ld\n", nDups);
+   statsAdd("inputs", nIn);
+   statsAdd("duplicates", nDups);
+   statsAdd("locations", nWritten);
+   fprintf(stderr, "%s done, locations:  %ld\n", progName, nWritten);
+   free(in);
+   free(outBuf);
+   statsReport();
+   return(0);
+   }
+/* ========================================================================== */
+/* Advance the input stream to its next location, refilling its buffer when
+   needed; at end of file, the stream is no longer "live". Abort if the file
+   is not in ascending order, or its size is not a multiple of a Us8.
+ */
+static void streamNext(struct p8bStream *s) {
+   size_t n;
+   nemoPtUs8 prev;
+/* -------------------------------------------------------------------------- */
+   if (s->iBuf == s->nBuf) {
+      n = fread(s->buf, 1, sizeof(s->buf), s->fp);
+      if (n % sizeof(nemoPtUs8)) errorExit(progName, __LINE__,
+             "[%s] size is not a multiple of %d\n", s->fn, (int)sizeof(nemoPtUs8));
+      if ((n == 0) && ferror(s->fp)) errorExit(progName, __LINE__,
+                                           "Error in reading [%s]\n", s->fn);
+      s->nBuf = (int)(n / sizeof(nemoPtUs8));
+      s->iBuf = 0;
+      if (s->nBuf == 0) {
+         s->isLive = 0;
+         return;
+         }
+      }
+   prev = s->cur;
+   s->cur = s->buf[s->iBuf++];
+   if (s->isLive && (s->cur < prev)) errorExit(progName, __LINE__,
+                 "[%s] location %ld: file sort order?\n", s->fn, s->nRead);
+   s->nRead++;
+   s->isLive = 1;
+   return;
+   }
+/* ========================================================================== */
+#include "../scullions/errorExit.c"
+#include "../scullions/nemoStrings.c"
+#include "../scullions/clFileOpt.c"
+#include "../scullions/nemoStats.c"
+/* ========================================================================== */
@@ -4,21 +4,45 @@
    command line argument is the name of the output file; the same binary Us8
    coordinates, re-ordered to form the the proposed  itinerary.
 
-   Note the extreme simplicity of the algorithm!
+   Note the extreme simplicity of the algorithm! Each step goes to the truly
+   nearest of all the un-visited locations, so this is the exact reference
+   for the itineraries of the (much faster) heuristic programs.
+
+   The search is the ITIN_BRUTE strategy of scullions/itinEngine (also used
+   by the "nearNextP8bWindow -b" command): the locations are decoded once,
+   to NCS direction cosines in SoA form, and the un-visited ones are kept
+   together, at the end of the arrays, as the visited ones are swapped in
+   front of them. With the -t(hreads)=n option, each step's search for the
+   nearest one is split into n slices, searched at the same time; the
+   itinerary does not depend on it (on equal distance, the first location
+   is always taken). The totals are reported by scullions/itinLegs, as by
+   nearNextP8bWindow.
 
    The program is invoked as:
 
-   nearNextP8bBruteForce w1904711.p8b w1904711_nn.p8b
+   nearNextP8bBruteForce w1904711.p8b w1904711_nn.p8b -t=16
+
+   (and with an extra -stats=text, json or file.json argument, also reports
+   the phase times and geodesic iterations, see scullions/nemoStats).
  */
 
 #define PGM_DSCR "Brute-force nearest-next itinerary for .p8b input file"
-#define PGM_LAST_EDIT_DATE "2025.085"
+#define PGM_LAST_EDIT_DATE "2026.287"
 #define METERS2NM       0.0005399568
 #include <stdio.h>
 #include <time.h>
 
 #include <nemo.h>
 #include "../scullions/scullions.h" /* include after nemo.h has been included */
+#include "../scullions/nemoStats.h"
+#include "../scullions/fileMap.h"
+#include "../scullions/ncsKdTree.h"
+#include "../scullions/chordSqBatch.h"
+#include "../scullions/us8Batch.h"
+#include "../scullions/us8Sort.h"
+#include "../scullions/itinEngine.h"
+#include "../scullions/itinLegs.h"
+
 
 static const char *progName;    /* for error logging by this source file only */
 /* ========================================================================== */
@@ -26,22 +50,19 @@ int main (int argc,
           const char *argv[],
           const char *envr[]) {
 
-   int n, nn, nx;
-   FILE *inFp;
-   int inFileSize;
+   int n, iErr;
+   const char *optKey, *optVal;            /* options, in -keyword=value form */
+   const char *fnIn, *fnOut;                  /* as given on the command line */
+   fileMap inMap;                       /* input binary file, Us8 locations */
    int lcnCnt;              /* count of locations in input binary (.ptb) file */
    FILE *outFp;
-   nemoPtUs8 location;
-   nemoPtUs8 *locations;
-   nemoPtUs8 holdLoc;
-   nemoPtNcs ptNcs;                                     /* leg start location */
-   nemoPtNcs cndNcs;                                           /* "candidate" */
-   double cld;                               /* "candidate" location distance */
-   double nld;                                   /* nearest location distance */
-   nemoPtEnr ptEnr, ptEnrPrev;      /* ellipsoid leg start/end coordinates... */
-   double totalLength, returnLegLength;    /* ...used for itinerary reporting */
+   nemoPtUs8 *locations;                    /* locations, in itinerary order */
+   int *itinIdx;                           /* location indices, in itinerary */
+   ncsSoa lcnSoa;         /* location coordinates, structure of arrays (SoA) */
+   itinPlan plan;
+   itinStats itin;                        /* used only in itinerary report */
    double clockSeconds, clockHours;                              /* timing... */
-   time_t clockStart;                                      /* ...paraphenalia */
+   double clockStart;                                      /* ...paraphenalia */
 /* -------------------------------------------------------------------------- */
    progName = strrchr(argv[0], '/');                                 /* POSIX */
    if (progName == NULL) progName = strrchr(argv[0], '\\');         /* MS Win */
@@ -49,78 +70,68 @@ int main (int argc,
    else progName += 1;                        /* strip leading path separator */
    fprintf(stderr, "\n[%s]: %s\nsource as of: %s, Nemo Library: %.3f\n",
                    progName, PGM_DSCR, PGM_LAST_EDIT_DATE, NEMO_LIBRARY_DATE);
+   if (statsInit(progName, &argc, argv)) errorExit(progName, __LINE__,
+                "-stats=text, -stats=json or -stats=file.json, please\n");
 
-   if (argc < 3) errorExit(progName, __LINE__,
-      "command-line argumens: input.p8b output.p8b\n");
-
-   inFp = fopen(argv[1], "rb");                            /* Open input file */
-   if (inFp == NULL) errorExit(progName, __LINE__,
-                                "Can't open [%s] for reading\n", argv[1]);
-/* Input file is a flat array of Us8 coordinates */
-/* Load the input file as memory-resident array, first get the file size:     */
-   if (fseek(inFp, 0, SEEK_END)) errorExit(progName, __LINE__,
-                                "Can't read [%s]?\n", argv[1]);
-   inFileSize = ftell(inFp);
-   rewind(inFp);
-   lcnCnt = (int)(inFileSize / sizeof(nemoPtUs8));
-   if (inFileSize%lcnCnt) errorExit(progName, __LINE__,
-    "Input file size (%d) not multiple of %d\n", inFileSize, sizeof(nemoPtUs8));
-
-   fprintf(stderr, "Input file has: %d records\n", (int)(inFileSize / sizeof(nemoPtUs8)));
-   locations = malloc(lcnCnt * sizeof(location));
-   if (locations == NULL) errorExit(progName, __LINE__, "No memory?\n");
-   n = fread(locations, sizeof(nemoPtUs8), lcnCnt, inFp);
-   fclose(inFp);
-   fprintf(stderr, "Locations loaded: %d\n", n);
-
-   clockStart = clock();
-   for (n = 0; n < (lcnCnt - 2); n++) {
-      if (n%100 == 0) fprintf(stderr, "Itinerary head at %d\r", n);
-      nemo_Us8ToNcs(locations[n], &ptNcs); /* got leg start, find closest end */
-      nld = NEMO_DOUBLE_HUGE;
-      nx = -1;
-      for (nn = n + 1; nn < lcnCnt; nn++) {
-         nemo_Us8ToNcs(locations[nn], &cndNcs);
-         cld = NEMO_ChordSq3(ptNcs.dc, cndNcs.dc);
-         if (cld < nld) {
-            nld = cld;
-            nx = nn;
-            }
-         }
-      if (nx == -1) errorExit(progName, __LINE__,                     /* WtF? */
-               "Unexpected error while searching for next location at %d\n", n);
-/*    found next location to visit. Swap it with n + 1, move to the next n */
-      holdLoc = locations[n + 1];
-      locations[n + 1] = locations[nx];
-      locations[nx] = holdLoc;
-      n++;
+   memset(&plan, 0, sizeof(plan));
+   plan.strategy = ITIN_BRUTE;
+   plan.isVerbose = 1;
+   while ((optKey = clOption(argc, argv, &optVal))) {
+      if (*optKey == 't') plan.nThreads = atoi(optVal);
+      else errorExit(progName, __LINE__, "unrecognized option [%s]\n", optKey);
       }
-   clockSeconds = (double)(clock() - clockStart) / (double)CLOCKS_PER_SEC;
+   if ((plan.nThreads < 0) || (plan.nThreads > ITIN_ENGINE_MAX_THREADS))
+      errorExit(progName, __LINE__, "invalid thread count %d\n", plan.nThreads);
+   fnIn = clFileName(argc, argv);
+   fnOut = clFileName(argc, argv);
+   if (fnOut == NULL) errorExit(progName, __LINE__,
+      "command-line arguments: input.p8b output.p8b [-t(hreads)=n]\n");
+
+   statsPhase("load");
+   iErr = p8bMapOpen(&inMap, fnIn);                        /* Open input file */
+   if (iErr) errorExit(progName, __LINE__,
+                "Can't read [%s]: %s\n", fnIn, fileMapErrStr(iErr));
+   lcnCnt = (int)inMap.nPts;
+   if (lcnCnt == 0) errorExit(progName, __LINE__, "No locations in [%s]?\n", fnIn);
+
+   fprintf(stderr, "Input file has: %d records\n", lcnCnt);
+   locations = malloc(lcnCnt * sizeof(nemoPtUs8));
+   itinIdx = malloc(lcnCnt * sizeof(int));
+   if ((locations == NULL) || (itinIdx == NULL) || ncsSoaAlloc(&lcnSoa, lcnCnt))
+      errorExit(progName, __LINE__, "No memory?\n");
+   if (us8ToSoa(inMap.pts, lcnCnt, &lcnSoa, plan.nThreads)) errorExit(progName,
+                                           __LINE__, "Can't start threads?\n");
+   fprintf(stderr, "Locations loaded: %d\n", lcnCnt);
+
+   statsPhase("itinerary");
+   clockStart = statsWall();
+   iErr = itinNearNext(&lcnSoa, lcnCnt, &plan, itinIdx);
+   if (iErr) errorExit(progName, __LINE__,                            /* WtF? */
+                       "Unexpected error while searching (%d)\n", iErr);
+   clockSeconds = statsWall() - clockStart;
    fprintf(stderr, "TSP itinerary sort of %d locations completed, duration: ", lcnCnt);
    clockHours = clockSeconds / (60.0 * 60.0);
    if (clockHours < 1) fprintf(stderr, "%.3f seconds\n", clockSeconds);
    else fprintf(stderr, "%.3f hours (%.3f seconds)\n", clockHours, clockSeconds);
+   statsAdd("chordTests", (lcnCnt > 2) ?
+            (long)(lcnCnt - 2) * (long)(lcnCnt - 1) / 2 : 0);
+   for (n = 0; n < lcnCnt; n++) locations[n] = inMap.pts[itinIdx[n]];
+   fileMapClose(&inMap);
+   ncsSoaFree(&lcnSoa);
+   free(itinIdx);
 
 /* report total itinerary length along geodesics */
-   totalLength = 0.0;
-   nemo_Us8ToNcs(locations[0], &ptNcs);
-   nemo_NcsToEnr(nemo_ElrWgs84(), &ptNcs, &ptEnrPrev);
-   for (n = 1; n < lcnCnt; n++) {
-      nemo_Us8ToNcs(locations[n], &ptNcs);
-      nemo_NcsToEnr(nemo_ElrWgs84(), &ptNcs, &ptEnr);
-      totalLength += nemo_GeodesicSzpila(nemo_ElrWgs84(), &ptEnrPrev, &ptEnr, NULL);
-      ptEnrPrev = ptEnr;
-      }
-   fprintf(stderr, "Open itinerary total: %12.3f\n", METERS2NM * totalLength);
-   nemo_Us8ToNcs(locations[0], &ptNcs);
-   nemo_NcsToEnr(nemo_ElrWgs84(), &ptNcs, &ptEnrPrev);
-   returnLegLength = nemo_GeodesicSzpila(nemo_ElrWgs84(), &ptEnrPrev, &ptEnr, NULL);
-   fprintf(stderr, "Return leg length: %12.3f\n", METERS2NM * returnLegLength);
+   statsPhase("legs");
+   iErr = itinLegsUs8(locations, lcnCnt, plan.nThreads, &itin);
+   if (iErr) errorExit(progName, __LINE__, "Leg lengths failed (%d)\n", iErr);
+   fprintf(stderr, "Open itinerary total: %12.3f\n", METERS2NM * itin.gdsTotal);
+   fprintf(stderr, "Return leg length:    %12.3f\n", METERS2NM * itin.gdsStartEnd);
 
 /* write output file */
-   outFp = fopen(argv[2], "wb");                /* Open output locations file */
+   statsPhase("write");
+   outFp = fopen(fnOut, "wb");                  /* Open output locations file */
    if (outFp == NULL) errorExit(progName, __LINE__,
-                     "Can't open [%s] for writing itinerary sorted locations\n", argv[2]);
+                     "Can't open [%s] for writing itinerary sorted locations\n", fnOut);
 
    n = fwrite(locations, sizeof(nemoPtUs8), lcnCnt, outFp);
    if (n != lcnCnt) errorExit(progName, __LINE__,
@@ -128,8 +139,19 @@ int main (int argc,
    fclose(outFp);
    free(locations);
 
+   statsReport();
    return(0);
    }
 /* ========================================================================== */
 #include "../scullions/errorExit.c"
+#include "../scullions/nemoStrings.c"
+#include "../scullions/clFileOpt.c"
+#include "../scullions/ncsKdTree.c"
+#include "../scullions/fileMap.c"
+#include "../scullions/chordSqBatch.c"
+#include "../scullions/us8Batch.c"
+#include "../scullions/us8Sort.c"
+#include "../scullions/nemoStats.c"
+#include "../scullions/itinEngine.c"
+#include "../scullions/itinLegs.c"
 /* ========================================================================== */
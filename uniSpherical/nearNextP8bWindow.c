@@ -16,54 +16,89 @@
    improved. The third argument is an integer, the size of "moving window"
    that is used ro limit the initial search for the nearest neighbor.
 
+   If the window size is given as 0, the window search is replaced by the
+   search of a k-d tree spatial index (see scullions/ncsKdTree.c) from which
+   the locations are deleted as they are visited. Each step of the itinerary
+   then goes to the true nearest un-visited location, at the cost of building
+   the index before the itinerary construction starts. With the -b(rute)
+   option (and no window size), it is found by the scan of all un-visited
+   locations, by -t(hreads)=n threads: as by nearNextP8bBruteForce.
+
+   With the -h(ilbert) option, the search is done over the locations re-
+   ordered along a Hilbert curve on the faces of the cube around the sphere
+   (stitched into a closed loop, see scullions/itinEngine.h), instead of the
+   input order: the window then finds the nearest locations also where the
+   numeric order of the coordinates breaks (at plate edges), and far fewer
+   are searched for outside it. The -c(urve) option (and no window size)
+   skips the search: the itinerary is then that curve order itself, a quick
+   start for the improvement.
+
+   With the -i(mprove)=seconds option, the itinerary is then improved by 2-opt
+   and Or-opt moves (as by improveP8b, between -k=n nearest neighbours of each
+   location) for at most that many seconds.
+
+   The searches and moves are those of the scullions/itinEngine, where the
+   locations are kept in parallel arrays: the coordinates as in the file and
+   their NCS direction cosines, decoded once by the codec of the coordinate
+   format. This source is compiled for Us8 (.p8b, or .z8b) files; with
+   ITIN_CODEC defined as itinCodecCs8 (see nearNextP8b.c), for Cs8 (.ptb).
+
    For instance:
 
    nearNextP8bWindow w1904711.p8b w1904711Itin_win.p8b 1000
+   nearNextP8bWindow w1904711.p8b w1904711Itin_kdt.p8b 0 -i=60
+   nearNextP8bWindow w1904711.p8b w1904711Itin_bf.p8b -b -t=16
+   nearNextP8bWindow w1904711.p8b w1904711Itin_hw.p8b 1000 -h
+   nearNextP8bWindow w1904711.p8b w1904711Itin_hc.p8b -c -i=60
+
+   An extra -stats=text (or json, file.json) argument, anywhere on the command
+   line, reports the phase times and search counts (scullions/nemoStats).
  */
 
+#ifndef ITIN_CODEC
+#define ITIN_CODEC       itinCodecUs8        /* coordinate format of the files */
 #define PGM_DSCR "Itinerary (window search) from (.p8b) file"
-#define PGM_LAST_EDIT_DATE "2025.086"
+#endif
+#define PGM_LAST_EDIT_DATE "2026.287"
 #include <stdio.h>
 #include <time.h>
 
 #include <nemo.h>
 #include "../scullions/scullions.h" /* include after nemo.h has been included */
+#include "../scullions/nemoStats.h"
+#include "../scullions/fileMap.h"
+#include "../scullions/ncsKdTree.h"
+#include "../scullions/chordSqBatch.h"
+#include "../scullions/us8Batch.h"
+#include "../scullions/us8Sort.h"
+#include "../scullions/itinEngine.h"
+#include "../scullions/itinLegs.h"
 
 #define METERS2NM       0.0005399568
-#define MIN_WIN        16         /* the low value only for testing/debbuging */
-#define MAX_WIN     32000
-
-static int closeInWin(int);
-static int closeOutWin(int);
-static int compIntsIx0(const void *, const void *);
-
-struct loc {                                 /* locations to be "TSP ordered" */
-   int iOrd;             /* sort order - fist the cluster, then the itinerary */
-   int unused;
-   nemoPtUs8 ptUs8;                                   /* location coordinates */
-   };
-
-static int lcnCnt;                                      /* number of locations */
-static struct loc *locs;                                         /* locations */
-static int iWin;       /* first-pass nerest neighbour search window (half of) */
+#define DEFAULT_NEIGHBOURS    8
+
+
 static const char *progName;    /* for error logging by this source file only */
-static int nInsideWin, nOutsideWin;          /* to report algorithm behaviour */
 /* ========================================================================== */
 int main (int argc,
           const char *argv[],
           const char *envr[]) {
 
    int k, n;
-   int nPrev, nNext;
-   int inFileSize;
-   FILE *inFp;                       /* input binary file, locations to visit */
+   int iErr;
+   int lcnCnt;                                          /* number of locations */
+   const itinCodec *codec = &ITIN_CODEC;
+   const char *optKey, *optVal;            /* options, in -keyword=value form */
+   const char *fnIn, *fnOut, *strWin;         /* as given on the command line */
+   fileMap inMap;                    /* input binary file, locations to visit */
    FILE *outFp;                                    /* itinerary-sorted output */
-   nemoPtUs8 locUs8;                              /* location Us8 coordinates */
-   nemoPtNcs ptNcs;                     /* used only in itinerary report pass */
-   nemoPtEnr ptEnr, ptEnrPrev;                                       /* ditto */
-   double totalLength, returnLegLength;                              /* ditto */
+   ncsSoa lcnSoa;                 /* location coordinates, NCS, decoded once */
+   nemoPtNcs *itinNcs;                  /* used only in itinerary report pass */
+   int *itinIdx;                           /* location indices, in itinerary */
+   itinPlan plan;                               /* strategy, budget, results */
+   itinStats itin;                        /* used only in itinerary report */
    double clockSeconds;                                          /* timing... */
-   time_t clockStart;                                      /* ...paraphenalia */
+   double clockStart;                                      /* ...paraphenalia */
 /* -------------------------------------------------------------------------- */
    progName = strrchr(argv[0], '/');                                 /* POSIX */
    if (progName == NULL) progName = strrchr(argv[0], '\\');         /* MS Win */
@@ -71,169 +106,157 @@ int main (int argc,
    else progName += 1;                        /* strip leading path separator */
    fprintf(stderr, "\n[%s]: %s\nsource as of: %s, Nemo Library: %.3f\n",
                    progName, PGM_DSCR, PGM_LAST_EDIT_DATE, NEMO_LIBRARY_DATE);
+   if (statsInit(progName, &argc, argv)) errorExit(progName, __LINE__,
+                "-stats=text, -stats=json or -stats=file.json, please\n");
 
-   if (argc < 4) errorExit(progName, __LINE__,
-      "command-line arguments: w1904711.ptb w1904711_nn.itin\n");
+   memset(&plan, 0, sizeof(plan));
+   plan.strategy = ITIN_WINDOW;
+   plan.nNbrs = DEFAULT_NEIGHBOURS;
+   plan.isVerbose = 1;
+   while ((optKey = clOption(argc, argv, &optVal))) {
+      if (*optKey == 'b') plan.strategy = ITIN_BRUTE;
+      else if (*optKey == 'c') plan.strategy = ITIN_CURVE;
+      else if (*optKey == 'h') plan.isSeeded = 1;
+      else if (*optKey == 't') plan.nThreads = atoi(optVal);
+      else if (*optKey == 'i') plan.maxSeconds = strtod(optVal, NULL);
+      else if (*optKey == 'k') plan.nNbrs = atoi(optVal);
+      else errorExit(progName, __LINE__, "unrecognized option [%s]\n", optKey);
+      }
+   if ((plan.nThreads < 0) || (plan.nThreads > ITIN_ENGINE_MAX_THREADS))
+      errorExit(progName, __LINE__, "invalid thread count %d\n", plan.nThreads);
+   if ((plan.nNbrs < 1) || (plan.nNbrs > KDT_MAX_SEP - 1) || (plan.maxSeconds < 0.0))
+      errorExit(progName, __LINE__, "invalid option: -k (0 < k < 16) or -i\n");
+   fnIn = clFileName(argc, argv);
+   fnOut = clFileName(argc, argv);
+   strWin = clFileName(argc, argv);
+   if ((fnOut == NULL) || ((strWin == NULL) && (plan.strategy == ITIN_WINDOW)))
+      errorExit(progName, __LINE__, "command-line arguments: w1904711.p8b "
+                "w1904711_nn.p8b window|-b|-c [-h] [-t=n] [-i=seconds] [-k=n]\n");
 
-   fprintf(stderr, "Binary input from: %s\n", argv[1]);
-   inFp = fopen(argv[1], "rb");                  /* Open input locations file */
-   if (inFp == NULL) errorExit(progName, __LINE__,
-                                "Can't open [%s] for reading locations\n", argv[1]);
+   statsPhase("load");
+   fprintf(stderr, "Binary input from: %s\n", fnIn);
+   iErr = (codec == &itinCodecUs8) ? p8bMapOpen(&inMap, fnIn) :   /* or .z8b */
+                                     fileMapOpen(&inMap, fnIn);
+   if (iErr) errorExit(progName, __LINE__,
+        "Can't read [%s] locations: %s\n", fnIn, fileMapErrStr(iErr));
 
-   fprintf(stderr, "Binary output to: %s\n", argv[2]);
-   outFp = fopen(argv[2], "wb");                /* Open output locations file */
+   fprintf(stderr, "Binary output to: %s\n", fnOut);
+   outFp = fopen(fnOut, "wb");                  /* Open output locations file */
    if (outFp == NULL) errorExit(progName, __LINE__,
-                                "Can't open [%s] for writing locations\n", argv[2]);
+                                "Can't open [%s] for writing locations\n", fnOut);
    fclose(outFp);              /* we'll open it again when it's time to writa */
 
-   n = atoi(argv[3]);
-   if ((n < MIN_WIN) || (n > MAX_WIN)) errorExit(progName, __LINE__,
-       "invalid window size (%d < n < %)\n", MIN_WIN, MAX_WIN);
-   fprintf(stderr, "Search window :%d\n", n);
-   iWin = n / 2;   /* half "below" and half "above" the last visited location */
+   if (plan.strategy == ITIN_BRUTE) fprintf(stderr,
+                 "Search: all un-visited, by %d thread(s)\n", plan.nThreads);
+   else if (plan.strategy == ITIN_CURVE)
+      fprintf(stderr, "Search: none, Hilbert curve order\n");
+   else {
+      n = atoi(strWin);
+      if ((n != 0) && ((n < ITIN_MIN_WIN) || (n > ITIN_MAX_WIN)))
+         errorExit(progName, __LINE__, "invalid window size (%d < n < %d, or 0)\n",
+                                       ITIN_MIN_WIN, ITIN_MAX_WIN);
+      if (n) fprintf(stderr, "Search window :%d\n", n);
+      else fprintf(stderr, "Search window: none, k-d tree spatial index\n");
+      plan.strategy = n ? ITIN_WINDOW : ITIN_TREE;
+      plan.window = n;
+      }
+   if (plan.isSeeded && (plan.strategy != ITIN_CURVE))
+      fprintf(stderr, "Search order: Hilbert curve\n");
 
-/* Load locations into memory-resident array of location structs */
-   if (fseek(inFp, 0, SEEK_END)) errorExit(progName, __LINE__,
-                                "Can't read [%s]?\n", argv[1]);
-   inFileSize = ftell(inFp);
-   rewind(inFp);
-   lcnCnt = (int)(inFileSize / sizeof(nemoPtUs8));
-   if (inFileSize%lcnCnt) errorExit(progName, __LINE__,
-    "Input file size (%d) not multiple of %d\n", inFileSize, sizeof(nemoPtUs8));
+/* Load locations into memory-resident parallel arrays */
+   if (inMap.nBytes % codec->recSize) errorExit(progName, __LINE__,
+       "Input file size (%d) not multiple of %d\n", (int)inMap.nBytes,
+       codec->recSize);
+   lcnCnt = (int)(inMap.nBytes / codec->recSize);
+   if (lcnCnt == 0) errorExit(progName, __LINE__, "No locations in [%s]?\n", fnIn);
+   fprintf(stderr, "Input file has: %d records (%s)\n", lcnCnt, codec->name);
 
-   fprintf(stderr, "Input file has: %d records\n",
-                    (int)(inFileSize / sizeof(nemoPtUs8)));
+   itinIdx = malloc(lcnCnt * sizeof(int));
+   if ((itinIdx == NULL) || ncsSoaAlloc(&lcnSoa, lcnCnt))
+      errorExit(progName, __LINE__, "No memory for locations?\n");
+   if (codec->toSoa(inMap.bytes, lcnCnt, &lcnSoa, plan.nThreads))
+      errorExit(progName, __LINE__, "Can't start threads?\n");
+   fprintf(stderr, "Locations loaded: %d\n", lcnCnt);
 
-   locs = malloc(lcnCnt * sizeof(struct loc));
-   if (locs == NULL) errorExit(progName, __LINE__, "No memory for locations?\n");
+   statsPhase((plan.strategy == ITIN_TREE) ? "index and itinerary" : "itinerary");
+   clockStart = statsWall();                                 /* time TSP sort */
+   iErr = itinNearNext(&lcnSoa, lcnCnt, &plan, itinIdx);
+   if (iErr) errorExit(progName, __LINE__, "Itinerary failed (%d)\n", iErr);
+   k = lcnCnt;
+   clockSeconds = statsWall() - clockStart;
+   fprintf(stderr, "%s coordinates itinerary ordering  %6.3f seconds\n",
+                   codec->name, clockSeconds);
 
-   for (n = 0; n < lcnCnt; n++) {
-      fread(&locUs8, sizeof(nemoPtUs8), 1, inFp);
-      locs[n].iOrd = -1;                            /* set all to "unvisited" */
-      locs[n].ptUs8 = locUs8;
-/*    fprintf(stderr, "%d %s\n", n, nemo_StrUs8Coords(locs[n].ptUs8)); */
+   if (plan.strategy == ITIN_TREE) {
+      fprintf(stderr, "found in k-d tree: %d\n", plan.nInside);
+      statsAdd("foundInTree", plan.nInside);
       }
-   fclose(inFp);
-   fprintf(stderr, "Locations loaded: %d\n", n);
-
-   nInsideWin = nOutsideWin = 0;
-   clockStart = clock();                                     /* time TSP sort */
-   locs[0].iOrd = 0;
-   nPrev = 0;                               /* index of last visited location */
-   k = 1;
-   while (k < lcnCnt) {
-     if (k%1000 == 0) fprintf(stderr, "Itinerary stations: %dK\r", k);
-      nNext = closeInWin(nPrev); /* Search for closest inside "search window" */
-/*    fprintf(stderr, "next: %2d prev: %2d, in Win next: %2d\n", k, nPrev, nNext); */
-      if (nNext == -1) nNext = closeOutWin(nPrev);  /* none found, go outside */
-      if (nNext == -1) errorExit(progName, __LINE__, "Program assertion?\n");
-      locs[nNext].iOrd = k++;  /* assign itinerary visitation order to loc... */
-      nPrev = nNext;                              /* ...and resume the search */
+   else if (plan.strategy == ITIN_BRUTE) {
+      fprintf(stderr, "found by brute force: %d\n", plan.nInside);
+      statsAdd("foundByScan", plan.nInside);
+      }
+   else if (plan.strategy == ITIN_WINDOW) {
+      fprintf(stderr, "found inWin: %d, found outWin %d\n", plan.nInside,
+                                                          plan.nOutside);
+      statsAdd("insideWindow", plan.nInside);
+      statsAdd("outsideWindow", plan.nOutside);
       }
-   qsort(locs, lcnCnt, sizeof(struct loc), compIntsIx0);    /* sort for output */
-   clockSeconds = (double)(clock() - clockStart) / (double)CLOCKS_PER_SEC;
-   fprintf(stderr, "Cc8 coordinates itinerary ordering  %6.3f seconds\n", clockSeconds);
-
-   fprintf(stderr, "found inWin: %d, found outWin %d\n", nInsideWin, nOutsideWin);
-
    fprintf(stderr, "Locations sorted: %d\n", k);
 
+   if (plan.maxSeconds > 0.0) {                 /* improve it, by local search */
+      statsPhase("improvement");
+      clockStart = statsWall();
+      iErr = itinImprove(&lcnSoa, lcnCnt, &plan, itinIdx);
+      if (iErr) errorExit(progName, __LINE__, "Improvement failed (%d)\n", iErr);
+      fprintf(stderr, "Moves applied, 2-opt: %d, Or-opt: %d (%s), %6.3f seconds\n",
+                      plan.n2opt, plan.nOrOpt, plan.isOptimum ? "local optimum" :
+                      "budget exhausted", statsWall() - clockStart);
+      statsAdd("moves2opt", plan.n2opt);
+      statsAdd("movesOrOpt", plan.nOrOpt);
+      clockSeconds += statsWall() - clockStart;
+      }
+
 /* report total itinerary length along geodesics */
-   totalLength = 0.0;
-    nemo_Us8ToNcs(locs[0].ptUs8, &ptNcs);
-    nemo_NcsToEnr(nemo_ElrWgs84(), &ptNcs, &ptEnrPrev);
-    for (n = 1; n < lcnCnt; n++) {
-       nemo_Us8ToNcs(locs[n].ptUs8, &ptNcs);
-       nemo_NcsToEnr(nemo_ElrWgs84(), &ptNcs, &ptEnr);
-       totalLength += nemo_GeodesicSzpila(nemo_ElrWgs84(), &ptEnrPrev, &ptEnr, NULL);
-       ptEnrPrev = ptEnr;
-       }
-   fprintf(stderr, "Open itinerary total: %12.3f\n", METERS2NM * totalLength);
-   nemo_Us8ToNcs(locs[0].ptUs8, &ptNcs);
-   nemo_NcsToEnr(nemo_ElrWgs84(), &ptNcs, &ptEnrPrev);
-   returnLegLength = nemo_GeodesicSzpila(nemo_ElrWgs84(), &ptEnrPrev, &ptEnr, NULL);
-   fprintf(stderr, "Return leg length:    %12.3f\n", METERS2NM * returnLegLength);
-
-/* write output file */
-   outFp = fopen(argv[2], "wb");                /* Open output locations file */
+   statsPhase("legs");
+   itinNcs = malloc(lcnCnt * sizeof(nemoPtNcs));
+   if (itinNcs == NULL) errorExit(progName, __LINE__, "No memory for report?\n");
+   for (n = 0; n < lcnCnt; n++) NCS_SOA_GET(&lcnSoa, itinIdx[n], itinNcs + n);
+   iErr = itinLegsNcs(itinNcs, lcnCnt, plan.nThreads, &itin);
+   if (iErr) errorExit(progName, __LINE__, "Leg lengths failed (%d)\n", iErr);
+   free(itinNcs);
+   fprintf(stderr, "Open itinerary total: %12.3f\n", METERS2NM * itin.gdsTotal);
+   fprintf(stderr, "Return leg length:    %12.3f\n", METERS2NM * itin.gdsStartEnd);
+
+/* write output file: the input records, in the itinerary order */
+   statsPhase("write");
+   outFp = fopen(fnOut, "wb");                  /* Open output locations file */
    if (outFp == NULL) errorExit(progName, __LINE__,
-                     "Can't open [%s] for writing itinerary sorted locations\n", argv[2]);
+                     "Can't open [%s] for writing itinerary sorted locations\n", fnOut);
    for (n = 0; n < lcnCnt; n++) {
-      locUs8 = locs[n].ptUs8;
-      fwrite(&locUs8, sizeof(nemoPtUs8), 1, outFp);
+      if (fwrite(inMap.bytes + (size_t)itinIdx[n] * codec->recSize,
+                 codec->recSize, 1, outFp) != 1) errorExit(progName, __LINE__,
+                 "Error in writing itinerary sorted locations (record:%d)\n", n);
       }
    fclose(outFp);
-   free(locs);
+   fileMapClose(&inMap);
+   free(itinIdx);
+   ncsSoaFree(&lcnSoa);
 
    printf("Itinerary total, nautical miles: %.3f; Sort duration: %.3f\n",
-           METERS2NM * (totalLength + returnLegLength), clockSeconds);
+           METERS2NM * (itin.gdsTotal + itin.gdsStartEnd), clockSeconds);
+   statsReport();
    return(0);
    }
 /* ========================================================================== */
-/* Search for the closest location inside the window +/- slots from nLast
- */
-static int closeInWin(int nLast) {
-   int n, nStart, nEnd, nMin;
-   double csqMin, csq;                       /* square chord search distances */
-   nemoPtNcs ptNcsLast, ptNcs;  /* ncs coords of the "stable", "moving" point */
-/* -------------------------------------------------------------------------- */
-   nStart = nLast - iWin;
-   if (nStart < 0) nStart = 0;
-   nEnd = nLast + iWin;
-   if (nEnd > lcnCnt) nEnd = lcnCnt;
-/* fprintf(stderr, "closeInWin, from %d to %d\n", nStart, nEnd); */
-   nemo_Us8ToNcs(locs[nLast].ptUs8, &ptNcsLast);
-   csqMin = NEMO_DOUBLE_HUGE;
-   nMin = -1;
-   for (n = nStart; n < nEnd; n++) {
-      if (locs[n].iOrd != -1) continue;          /* this location was visited */
-/*    fprintf(stderr, "candidate next %d\n", n); */
-      nemo_Us8ToNcs(locs[n].ptUs8, &ptNcs);
-      csq = NEMO_ChordSq3(ptNcsLast.dc, ptNcs.dc);
-      if (csq < csqMin) {            /* new closest in-window point was found */
-         csqMin = csq;
-         nMin = n;                               /* location index of closest */
-/*       fprintf(stderr, "best so far %d\n", nMin); */
-         }
-      }
-   nInsideWin++;
-   return(nMin);
-   }
-/* ========================================================================== */
-/* Search for the next point to resume itinerary outside the "close search"
-   window, alternating between high and low side of last visited location.
-   Not finding a point would be an obvious "two-level-search" algorithm error.
- */
-static int closeOutWin(int nLast) {
-   int nLow, nHigh;
-/* -------------------------------------------------------------------------- */
-   nLow = nLast - iWin;
-   if (nLow < 0) nLow = 0;
-   nHigh = nLast + iWin;
-   if (nHigh > lcnCnt) nHigh = lcnCnt;
-   nOutsideWin++;
-   while ((nLow > 0) || (nHigh < lcnCnt)) {
-      if (nLow > 0) {
-         if (locs[nLow].iOrd == -1) return(nLow);
-         nLow--;
-         }
-      if (nHigh < lcnCnt) {
-         if (locs[nHigh].iOrd == -1) return(nHigh);
-         nHigh++;
-         }
-      }
-   return(-1);                                     /* this better not happen! */
-   }
-/* ========================================================================== */
-/* Natural integer compare function. Two structures are assumed to start with
-   an array of natural integers. Compare them (in a manner required by C
-   standard library qsort() and bsearch() functions. This implementation
-   assumes first (ix:0) element of the array of int's 'determines the order. */
-#define COMP_INDEX 0
-int compIntsIx0(const void *p1, const void *p2) {
-   return(((int *)p1)[COMP_INDEX] - ((int *)p2)[COMP_INDEX]);
-   }
-/* ========================================================================== */
 #include "../scullions/errorExit.c"
 #include "../scullions/nemoStrings.c"
+#include "../scullions/clFileOpt.c"
+#include "../scullions/ncsKdTree.c"
+#include "../scullions/fileMap.c"
+#include "../scullions/chordSqBatch.c"
+#include "../scullions/us8Batch.c"
+#include "../scullions/us8Sort.c"
+#include "../scullions/nemoStats.c"
+#include "../scullions/itinEngine.c"
+#include "../scullions/itinLegs.c"
 /* ========================================================================== */
@@ -0,0 +1,163 @@
+/* p8bToZ8b.c: Create compressed .z8b file from a sorted .p8b one - an array
+   of Us8 point locations in ascending (canonical) coordinate order, as
+   created by csvToP8b, with no duplicates (a zero difference is invalid in
+   .z8b, and the file is not written if there are any). The points are
+   stored in blocks: the first point of each block is kept in the block
+   index (file header), and the others are stored as differences from the
+   previous point, as variable length integers (see scullions/fileMap.h for
+   the file layout). Programs that read .p8b files with p8bMapOpen() read
+   .z8b ones just the same, and those that read them block by block, with
+   p8bMapOpenBlocks(), decode only the blocks they use.
+
+   First command line argument is the input, the second the output file;
+   with -b(lock)=n option, the blocks have n points. If the output file
+   name ends with ".p8b", the input file (.z8b presumably) is written
+   uncompressed. For instance:
+
+   p8bToZ8b w1904711.p8b w1904711.z8b
+   p8bToZ8b w1904711.z8b w1904711Copy.p8b
+
+   The -stats=text (or json, file.json) option reports the time taken to read
+   (and, for .z8b output, to encode) the points, see scullions/nemoStats.
+ */
+
+#define PGM_DSCR "Compressed (.z8b) from sorted (.p8b) Us8 file, or back"
+#define PGM_LAST_EDIT_DATE "2026.287"
+#include <stdio.h>
+
+#include <nemo.h>
+#include "../scullions/scullions.h" /* include after nemo.h has been included */
+#include "../scullions/nemoStats.h"
+#include "../scullions/fileMap.h"
+
+#define VARINT_MAX       10          /* bytes, LEB128 of a 64-bit difference */
+
+static void put64(unsigned char *, uint64_t);
+
+static const char *progName;    /* for error logging by this source file only */
+/* ========================================================================== */
+int main (int argc,
+          const char *argv[],
+          const char *envr[]) {
+   int i, blockPts, nBlocks;
+   size_t n, k, nOut, len;
+   uint64_t d, offset;
+   const char *optKey, *optVal;            /* options, in -keyword=value form */
+   const char *fnIn, *fnOut;                  /* as given on the command line */
+   fileMap inMap;                                   /* input, as Us8 array */
+   unsigned char *index, *buf, *p;        /* output block index, and data */
+   unsigned char header[Z8B_HEADER];
+   FILE *outFp;
+/* -------------------------------------------------------------------------- */
+   progName = strrchr(argv[0], '/');                                 /* POSIX */
+   if (progName == NULL) progName = strrchr(argv[0], '\\');         /* MS Win */
+   if (progName == NULL) progName = argv[0];                      /* neither? */
+   else progName += 1;                        /* strip leading path separator */
+   fprintf(stderr, "\n[%s]: %s\nsource as of: %s, Nemo Library: %.3f\n",
+                   progName, PGM_DSCR, PGM_LAST_EDIT_DATE, NEMO_LIBRARY_DATE);
+   if (statsInit(progName, &argc, argv)) errorExit(progName, __LINE__,
+                "-stats=text, -stats=json or -stats=file.json, please\n");
+
+   blockPts = Z8B_BLOCK_PTS;
+   while ((optKey = clOption(argc, argv, &optVal))) {
+      if (*optKey == 'b') blockPts = atoi(optVal);
+      else errorExit(progName, __LINE__, "unrecognized option [%s]\n", optKey);
+      }
+   if ((blockPts < 2) || (blockPts > 1000000))
+      errorExit(progName, __LINE__, "invalid block size %d\n", blockPts);
+   fnIn = clFileName(argc, argv);
+   fnOut = clFileName(argc, argv);
+   if (fnOut == NULL) errorExit(progName, __LINE__,
+                 "usage: %s [-b(lock)=n] xyz.p8b xyz.z8b\n", progName);
+
+   statsPhase("load");
+   i = p8bMapOpen(&inMap, fnIn);                           /* Open input file */
+   if (i) errorExit(progName, __LINE__,
+                    "Can't read [%s]: %s\n", fnIn, fileMapErrStr(i));
+   outFp = fopen(fnOut, "wb");                        /* Open output file */
+   if (outFp == NULL) errorExit(progName, __LINE__,
+                                "Can't open [%s] for writing\n", fnOut);
+
+   statsPhase("write");
+   len = strlen(fnOut);
+   if ((len > 4) && (strcmp(fnOut + len - 4, ".p8b") == 0)) {  /* plain... */
+      if (fwrite(inMap.pts, sizeof(nemoPtUs8), inMap.nPts, outFp) != inMap.nPts)
+         errorExit(progName, __LINE__, "Error in writing [%s]\n", fnOut);
+      fclose(outFp);
+      fprintf(stderr, "%s done, locations: %lu\n", progName,
+                      (unsigned long)inMap.nPts);
+      statsAdd("locations", (long)inMap.nPts);
+      fileMapClose(&inMap);
+      statsReport();
+      return(0);
+      }
+
+/* ...or compressed: encode each block, after the header and index */
+   n = inMap.nPts;
+   nBlocks = n ? (int)((n - 1) / blockPts + 1) : 0;
+   index = malloc((size_t)(nBlocks ? nBlocks : 1) * Z8B_INDEX_ENTRY);
+   buf = malloc((size_t)blockPts * VARINT_MAX);
+   if ((index == NULL) || (buf == NULL))
+      errorExit(progName, __LINE__, "No memory for buffers?\n");
+   memcpy(header, Z8B_MAGIC, 8);
+   put64(header + 8, (uint64_t)n);
+   put64(header + 16, ((uint64_t)nBlocks << 32) | (uint64_t)blockPts);
+/* the index is written once it is complete; here just reserve its space */
+   if ((fwrite(header, 1, Z8B_HEADER, outFp) != Z8B_HEADER) ||
+       (fwrite(index, Z8B_INDEX_ENTRY, nBlocks, outFp) != (size_t)nBlocks))
+      errorExit(progName, __LINE__, "Error in writing [%s]\n", fnOut);
+   offset = Z8B_HEADER + (uint64_t)nBlocks * Z8B_INDEX_ENTRY;
+   for (i = 0; i < nBlocks; i++) {
+      k = (size_t)i * blockPts;
+      put64(index + (size_t)i * Z8B_INDEX_ENTRY, (uint64_t)inMap.pts[k]);
+      put64(index + (size_t)i * Z8B_INDEX_ENTRY + 8, offset);
+      for (p = buf, k++; (k < n) && (k % blockPts); k++) {
+         if (inMap.pts[k] <= inMap.pts[k - 1]) errorExit(progName, __LINE__,
+                 "[%s] location %lu: file sort order, or duplicate?\n",
+                 fnIn, (unsigned long)k);
+         d = (uint64_t)(inMap.pts[k] - inMap.pts[k - 1]);
+         while (d >= 0x80) {                        /* LEB128, 7 bits a byte */
+            *p++ = (unsigned char)(d | 0x80);
+            d >>= 7;
+            }
+         *p++ = (unsigned char)d;
+         }
+      nOut = (size_t)(p - buf);
+      if (fwrite(buf, 1, nOut, outFp) != nOut)
+         errorExit(progName, __LINE__, "Error in writing [%s]\n", fnOut);
+      offset += nOut;
+      }
+   if (fseek(outFp, Z8B_HEADER, SEEK_SET) ||
+       (fwrite(index, Z8B_INDEX_ENTRY, nBlocks, outFp) != (size_t)nBlocks))
+      errorExit(progName, __LINE__, "Error in writing [%s] index\n", fnOut);
+   fclose(outFp);
+   fileMapClose(&inMap);
+   free(index);
+   free(buf);
+
+   fprintf(stderr, "locations: %lu, blocks: %d, bytes: %lu (%.2f per location)\n",
+                   (unsigned long)n, nBlocks, (unsigned long)offset,
+                   n ? (double)offset / (double)n : 0.0);
+   fprintf(stderr, "%s done, compression ratio: %.2f\n", progName,
+                   offset ? (double)(n * sizeof(nemoPtUs8)) / (double)offset : 0.0);
+   statsAdd("locations", (long)n);
+   statsAdd("blocks", nBlocks);
+   statsAdd("bytes", (long)offset);
+   statsReport();
+   return(0);
+   }
+/* ========================================================================== */
+/* 64-bit little-endian integer, to any (byte) alignment */
+static void put64(unsigned char *p, uint64_t v) {
+   int i;
+/* -------------------------------------------------------------------------- */
+   for (i = 0; i < 8; i++, v >>= 8) p[i] = (unsigned char)(v & 0xff);
+   return;
+   }
+/* ========================================================================== */
+#include "../scullions/errorExit.c"
+#include "../scullions/nemoStrings.c"
+#include "../scullions/clFileOpt.c"
+#include "../scullions/fileMap.c"
+#include "../scullions/nemoStats.c"
+/* ========================================================================== */